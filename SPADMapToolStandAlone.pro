@@ -3,16 +3,61 @@ CONFIG += console
 CONFIG -= app_bundle
 CONFIG -= qt
 QMAKE_CC= gcc -std=c99
+LIBS += -lpthread -lm
 
 SOURCES += \
+    tmf8x2x_batch.c \
+    tmf8x2x_cache.c \
+    tmf8x2x_clock.c \
+    tmf8x2x_corpus.c \
+    tmf8x2x_decoder.c \
+    tmf8x2x_device_model.c \
+    tmf8x2x_format.c \
+    tmf8x2x_multiplex.c \
+    tmf8x2x_optimizer.c \
+    tmf8x2x_output_sink.c \
+    tmf8x2x_placement.c \
+    tmf8x2x_pool.c \
+    tmf8x2x_register_image.c \
+    tmf8x2x_schedule.c \
+    tmf8x2x_server.c \
+    tmf8x2x_spad_kernels.c \
+    tmf8x2x_spad_lib.c \
     tmf8x2x_spad_mask_tool.c \
-    tmf8x2x_test_masks.c
+    tmf8x2x_spad_parser.c \
+    tmf8x2x_test_masks.c \
+    tmf8x2x_validator.c \
+    tmf8x2x_zone_stats.c
 
 HEADERS += \
+    tmf8x2x_batch.h \
+    tmf8x2x_cache.h \
+    tmf8x2x_clock.h \
+    tmf8x2x_corpus.h \
+    tmf8x2x_decoder.h \
+    tmf8x2x_device_model.h \
+    tmf8x2x_format.h \
+    tmf8x2x_multiplex.h \
     tmf8x2x_includes.h \
-    tmf8x2x_spad_mask_tool.h
+    tmf8x2x_optimizer.h \
+    tmf8x2x_output_sink.h \
+    tmf8x2x_placement.h \
+    tmf8x2x_pool.h \
+    tmf8x2x_register_image.h \
+    tmf8x2x_schedule.h \
+    tmf8x2x_server.h \
+    tmf8x2x_spad_kernels.h \
+    tmf8x2x_spad_lib.h \
+    tmf8x2x_spad_mask_tool.h \
+    tmf8x2x_spad_parser.h \
+    tmf8x2x_validator.h \
+    tmf8x2x_zone_stats.h
 
 CONFIG += outputInWorkspace
 
+# the benchmark (make bench) has its own main( ) and is not part of this project: tmf8x2x_bench.c
+# the differential fuzzer (make fuzz) has its own main( ) and is not part of this project: tmf8x2x_fuzz.c
+# the compile-time check (make static_check) is C++17 and not part of this project: tmf8x2x_constexpr.hpp, tmf8x2x_constexpr_example.cpp
+
 DISTFILES += \
     readme.md
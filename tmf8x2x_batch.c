@@ -0,0 +1,571 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_batch.c
+ *  \brief streaming batch mode, validates a concatenated stream of SPAD map / mask records.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_spad_parser.h"
+#include "tmf8x2x_cache.h"
+#include "tmf8x2x_pool.h"
+#include "tmf8x2x_spad_lib.h"
+#include "tmf8x2x_zone_stats.h"
+#include "tmf8x2x_format.h"
+#include "tmf8x2x_batch.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* which part of a record the current line belongs to */
+#define BATCH_SECTION_NONE                  0
+#define BATCH_SECTION_MAP                   1
+#define BATCH_SECTION_MASK                  2
+
+/* name of the cached output, the same as spad_tool -m uses so that both modes share cache entries */
+#define BATCH_CACHE_NAME                    "tmf8x2xSpadMap"
+
+/* records that are read while the workers check the previous chunk */
+#define BATCH_CHUNK_SIZE                    1024
+/* records a worker takes from its range at once */
+#define BATCH_GRAIN                         16
+/* result of a record that could not be parsed */
+#define BATCH_RESULT_FORMAT                 0xFF
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* what the sequential batch mode checks with and outputs, context of batchCheckRecord */
+typedef struct _batchOutput
+{
+    tmf8x2xCache * cache;
+    uint32_t formats;
+    uint8_t connectivity;                   /* strict mode, 0 if off */
+} batchOutput;
+
+/* records of the parallel batch mode, filled by the reading thread and checked by the workers */
+typedef struct _batchChunk
+{
+    tmf8x2xBatchRecord records[ BATCH_CHUNK_SIZE ];
+    uint8_t results[ BATCH_CHUNK_SIZE ];    /* TMF8X2X_VALIDATE_* or BATCH_RESULT_FORMAT */
+    tmf8x2xLibStatus status[ BATCH_CHUNK_SIZE ];            /* only with formats */
+    tmf8x2xHalMainSpadConfig configs[ BATCH_CHUNK_SIZE ];   /* only with formats */
+    tmf8x2xCache * cache;                   /* 0 without a cache */
+    uint32_t formats;
+    uint8_t connectivity;                   /* strict mode, 0 if off */
+    uint32_t count;
+} batchChunk;
+
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief batchAppendLine adds a line to the map or mask text of the current section
+ * @param record current record
+ * @param line to be added
+ */
+static void batchAppendLine( tmf8x2xBatchRecord * record, const char * line );
+/**
+ * @brief batchDumpRecord dumps the output of one record: the result line and the selected human readable formats, or the JSON line / CSV row
+ * @param formats TMF8X2X_FORMAT_* bits, 0 for the result line only
+ * @param index running number of the record in the stream
+ * @param name of the record
+ * @param result TMF8X2X_VALIDATE_* or BATCH_RESULT_FORMAT
+ * @param status verdict and failure reason, only used with formats
+ * @param config packed configuration, only used with formats
+ * @param mask SPAD map / mask of the record, only used for TMF8X2X_FORMAT_CHANNEL_TEXT
+ */
+static void batchDumpRecord( uint32_t formats, uint32_t index, const char * name, uint8_t result, const tmf8x2xLibStatus * status, const tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask );
+/**
+ * @brief batchValidate checks a SPAD map through the cache (verdict and register image only) or directly, then the strict mode
+ * @param cache opened cache, 0 without a cache
+ * @param formats TMF8X2X_FORMAT_* bits, with formats the configuration and status of failed maps are complete
+ * @param connectivity strict mode, 0 if off
+ * @param mask SPAD map / mask of the record
+ * @param config receives the packed configuration
+ * @param status receives the verdict, without cache and formats only status->check is set
+ */
+static void batchValidate( tmf8x2xCache * cache, uint32_t formats, uint8_t connectivity, const tmf8x2xSpadMask * mask, tmf8x2xHalMainSpadConfig * config, tmf8x2xLibStatus * status );
+/**
+ * @brief batchCheckRecord record handler of tmf8x2xRunBatch, validates the record and dumps its output
+ * @param context batchOutput
+ * @param index running number of the record in the stream
+ * @param name of the record
+ * @param mask SPAD map / mask of the record, 0 if it could not be parsed
+ * @return TMF8X2X_VALIDATE_OK or the TMF8X2X_VALIDATE_ERROR_* code, TMF8X2X_VALIDATE_ERROR_CREATE for records that could not be parsed
+ */
+static uint8_t batchCheckRecord( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask );
+/**
+ * @brief batchCheckChunk pool task of the parallel batch mode, parses and validates records of a chunk
+ * @param context batchChunk
+ * @param begin first record
+ * @param end record after the last one
+ */
+static void batchCheckChunk( void * context, uint32_t begin, uint32_t end );
+/**
+ * @brief batchDumpChunk dumps the result lines of a checked chunk in stream order
+ * @param chunk checked records
+ * @param index running number of the first record in the stream
+ * @return number of records that failed
+ */
+static uint32_t batchDumpChunk( const batchChunk * chunk, uint32_t index );
+/**
+ * @brief batchRunParallel checks a stream with a pool of workers, the calling thread reads the next chunk while the workers check the current one
+ * @param input stream of records
+ * @param threads number of workers
+ * @param cache opened cache, 0 without a cache
+ * @param formats TMF8X2X_FORMAT_* bits, 0 for the result lines only
+ * @param connectivity strict mode, 0 if off
+ * @param count receives the number of records
+ * @return number of records that failed
+ */
+static uint32_t batchRunParallel( FILE * input, uint32_t threads, tmf8x2xCache * cache, uint32_t formats, uint8_t connectivity, uint32_t * count );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static void batchAppendLine ( tmf8x2xBatchRecord * record, const char * line )
+{
+    char * text = ( record->section == BATCH_SECTION_MASK ) ? record->maskText : record->mapText;
+    uint32_t * length = ( record->section == BATCH_SECTION_MASK ) ? &record->maskLength : &record->mapLength;
+    size_t lineLength = strlen( line );
+
+    if ( *length + lineLength > TMF8X2X_BATCH_TEXT_SIZE )
+    {
+        record->broken = 1;
+        return;
+    }
+    memcpy( text + *length, line, lineLength );
+    *length += (uint32_t)lineLength;
+}
+
+static void batchDumpRecord ( uint32_t formats, uint32_t index, const char * name, uint8_t result, const tmf8x2xLibStatus * status, const tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask )
+{
+    if ( formats & TMF8X2X_FORMAT_MACHINE )
+    {
+        if ( result == BATCH_RESULT_FORMAT )
+        {
+            tmf8x2xEmitRecord( formats, index, name, 0, 0 );
+        }
+        else
+        {
+            tmf8x2xEmitRecord( formats, index, name, status, ( result != TMF8X2X_VALIDATE_ERROR_CREATE ) ? config : 0 );
+        }
+        return;
+    }
+
+    dumpSignedDecimal( (int32_t)index );
+    dumpString( " " );
+    dumpString( name );
+    if ( result == TMF8X2X_VALIDATE_OK )
+    {
+        dumpString( " OK\n" );
+        if ( formats )
+        {
+            tmf8x2xDumpFormats( formats, name, mask, config );
+        }
+    }
+    else if ( result == BATCH_RESULT_FORMAT )
+    {
+        dumpString( " ERROR (record format)\n" );
+    }
+    else
+    {
+        dumpString( " ERROR (" );
+        dumpString( tmf8x2xValidateResultName( result ) );
+        dumpString( ")\n" );
+    }
+}
+
+static void batchValidate ( tmf8x2xCache * cache, uint32_t formats, uint8_t connectivity, const tmf8x2xSpadMask * mask, tmf8x2xHalMainSpadConfig * config, tmf8x2xLibStatus * status )
+{
+    tmf8x2xCacheEntry entry;    /* on the stack, the pool workers run this concurrently */
+
+    if ( cache )
+    {
+        if ( tmf8x2xCacheLookup( cache, mask, BATCH_CACHE_NAME, &entry ) != TMF8X2X_CACHE_HIT )
+        {
+            tmf8x2xCacheValidate( &entry, mask ); /* the output is rendered from the configuration, not cached */
+            tmf8x2xCacheStore( cache, mask, BATCH_CACHE_NAME, &entry );
+        }
+        *status = entry.status;
+        tmf8x2xUnpackRegisterImage( config, entry.image );
+    }
+    if ( formats && ( ! cache || status->code != TMF8X2X_LIB_OK ) ) /* the cache keeps the configuration of valid SPAD maps only */
+    {
+        tmf8x2xLibValidateMask( config, mask, status );
+    }
+    else if ( ! cache )
+    {
+        status->check = tmf8x2xValidateSpadMask( config, mask ); /* the verdict is all the result line needs */
+    }
+    if ( connectivity && status->check == TMF8X2X_VALIDATE_OK )
+    {
+        tmf8x2xLibCheckConnectivity( config, connectivity, status );
+    }
+}
+
+static uint8_t batchCheckRecord ( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask )
+{
+    const batchOutput * output = (const batchOutput *)context;
+    tmf8x2xHalMainSpadConfig cfg;
+    tmf8x2xLibStatus status;
+
+    if ( ! mask )
+    {
+        batchDumpRecord( output->formats, index, name, BATCH_RESULT_FORMAT, 0, 0, 0 );
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+
+    batchValidate( output->cache, output->formats, output->connectivity, mask, &cfg, &status );
+    batchDumpRecord( output->formats, index, name, status.check, &status, &cfg, mask );
+    return status.check;
+}
+
+static void batchCheckChunk ( void * context, uint32_t begin, uint32_t end )
+{
+    batchChunk * chunk = (batchChunk *)context;
+    tmf8x2xSpadMaskStorage storage;     /* scratch of this worker */
+    tmf8x2xHalMainSpadConfig cfg;
+
+    for ( uint32_t i = begin; i < end; i++ )
+    {
+        if ( tmf8x2xParseBatchRecord( &storage, &chunk->records[ i ] ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            chunk->results[ i ] = BATCH_RESULT_FORMAT;
+        }
+        else if ( chunk->formats || chunk->cache )
+        {
+            batchValidate( chunk->cache, chunk->formats, chunk->connectivity, &storage.mask, &chunk->configs[ i ], &chunk->status[ i ] );
+            chunk->results[ i ] = chunk->status[ i ].check;
+        }
+        else
+        {
+            chunk->results[ i ] = tmf8x2xValidateSpadMask( &cfg, &storage.mask );
+            if (  chunk->results[ i ] == TMF8X2X_VALIDATE_OK
+               && chunk->connectivity
+               && tmf8x2xLibCheckConnectivity( &cfg, chunk->connectivity, 0 ) != TMF8X2X_LIB_OK
+               )
+            {
+                chunk->results[ i ] = TMF8X2X_VALIDATE_ERROR_CONNECTIVITY;
+            }
+        }
+    }
+}
+
+static uint32_t batchDumpChunk ( const batchChunk * chunk, uint32_t index )
+{
+    tmf8x2xSpadMaskStorage storage;
+    uint32_t failed = 0;
+
+    for ( uint32_t i = 0; i < chunk->count; i++ )
+    {
+        uint8_t result = chunk->results[ i ];
+        const tmf8x2xSpadMask * mask = 0;
+        if (  result == TMF8X2X_VALIDATE_OK
+           && ( chunk->formats & TMF8X2X_FORMAT_CHANNEL_TEXT )
+           && tmf8x2xParseBatchRecord( &storage, &chunk->records[ i ] ) == TMF8X2X_SPAD_MAP_OK
+           )
+        {
+            mask = &storage.mask; /* the channel map is dumped from the record, parse it again */
+        }
+        batchDumpRecord( chunk->formats, index + i, chunk->records[ i ].name, result, &chunk->status[ i ], &chunk->configs[ i ], mask );
+        failed += ( result != TMF8X2X_VALIDATE_OK );
+    }
+    return failed;
+}
+
+static uint32_t batchRunParallel ( FILE * input, uint32_t threads, tmf8x2xCache * cache, uint32_t formats, uint8_t connectivity, uint32_t * count )
+{
+    static batchChunk chunk[ 2 ];
+    static tmf8x2xPool pool;
+    tmf8x2xBatchReader reader;
+    uint32_t current = 0;
+    uint32_t records = 0;
+    uint32_t failed = 0;
+    uint32_t previous = 0;      /* records of the other chunk that were checked but not dumped yet */
+
+    reader.hasPending = 0;
+    chunk[ 0 ].cache = cache;
+    chunk[ 1 ].cache = cache;
+    chunk[ 0 ].formats = formats;
+    chunk[ 1 ].formats = formats;
+    chunk[ 0 ].connectivity = connectivity;
+    chunk[ 1 ].connectivity = connectivity;
+    tmf8x2xPoolStart( &pool, threads );
+    chunk[ current ].count = tmf8x2xReadBatchRecords( input, &reader, chunk[ current ].records, BATCH_CHUNK_SIZE );
+
+    /* check chunk n, dump chunk n-1 and read chunk n+1 into its place at the same time */
+    while ( chunk[ current ].count || previous )
+    {
+        batchChunk * next = &chunk[ current ^ 1 ];
+        uint32_t checking = chunk[ current ].count;
+
+        if ( checking )
+        {
+            tmf8x2xPoolSubmit( &pool, checking, BATCH_GRAIN, batchCheckChunk, &chunk[ current ] );
+        }
+        if ( previous )
+        {
+            failed += batchDumpChunk( next, records );
+            records += previous;
+        }
+        next->count = checking ? tmf8x2xReadBatchRecords( input, &reader, next->records, BATCH_CHUNK_SIZE ) : 0;
+        if ( checking )
+        {
+            tmf8x2xPoolWait( &pool );
+        }
+        previous = checking;
+        current ^= 1;
+    }
+    tmf8x2xPoolStop( &pool );
+    *count = records;
+    return failed;
+}
+
+/*
+ *****************************************************************************
+ * BATCH MODE
+ *****************************************************************************
+ */
+
+void tmf8x2xStartBatchRecord ( tmf8x2xBatchRecord * record, const char * line )
+{
+    int xOffset_2 = 0;
+    int yOffset_2 = 0;
+    int fields;
+
+    record->mapLength = 0;
+    record->maskLength = 0;
+    record->hasMask = 0;
+    record->broken = 0;
+    record->section = BATCH_SECTION_MAP;
+    strcpy( record->name, "-" );
+
+    if ( ! line )
+    {
+        record->broken = 1; /* map data without a header line */
+        return;
+    }
+
+    fields = sscanf( line, "map %d %d %63s", &xOffset_2, &yOffset_2, record->name );
+    if (  fields < 2
+        || xOffset_2 < INT8_MIN || xOffset_2 > INT8_MAX
+        || yOffset_2 < INT8_MIN || yOffset_2 > INT8_MAX
+        )
+    {
+        record->broken = 1;
+    }
+    record->xOffset_2 = (int8_t)xOffset_2;
+    record->yOffset_2 = (int8_t)yOffset_2;
+}
+
+void tmf8x2xAddBatchLine ( tmf8x2xBatchRecord * record, const char * line )
+{
+    if ( strncmp( line, "mask", 4 ) == 0 )
+    {
+        if ( record->section != BATCH_SECTION_MAP || record->hasMask )
+        {
+            record->broken = 1;
+        }
+        record->section = BATCH_SECTION_MASK;
+        record->hasMask = 1;
+        return;
+    }
+    batchAppendLine( record, line );
+}
+
+uint32_t tmf8x2xReadBatchRecords ( FILE * input, tmf8x2xBatchReader * reader, tmf8x2xBatchRecord * records, uint32_t capacity )
+{
+    char line[ TMF8X2X_BATCH_LINE_SIZE ];
+    tmf8x2xBatchRecord * record = 0;    /* record in progress */
+    uint32_t count = 0;
+
+    if ( reader->hasPending )
+    {
+        record = &records[ count ];
+        tmf8x2xStartBatchRecord( record, reader->pending );
+        reader->hasPending = 0;
+    }
+
+    while ( fgets( line, sizeof( line ), input ) )
+    {
+        const char * p = line;
+        size_t length = strlen( line );
+
+        if ( length == sizeof( line ) - 1 && line[ length - 1 ] != '\n' )
+        {
+            int c;
+            while ( ( c = fgetc( input ) ) != EOF && c != '\n' ) /* drop the rest of an overlong line */
+            {
+            }
+            if ( record )
+            {
+                record->broken = 1;
+            }
+            continue;
+        }
+        while ( *p == ' ' || *p == '\t' )
+        {
+            p++;
+        }
+        if ( *p == '#' || *p == '\n' || *p == '\r' || *p == 0 )
+        {
+            continue;
+        }
+        if ( strncmp( p, "map", 3 ) == 0 )
+        {
+            if ( record && ++count == capacity )
+            {
+                strcpy( reader->pending, p ); /* the header of the next record, it starts the next call */
+                reader->hasPending = 1;
+                return count;
+            }
+            record = &records[ count ];
+            tmf8x2xStartBatchRecord( record, p );
+        }
+        else
+        {
+            if ( ! record )
+            {
+                record = &records[ count ];
+                tmf8x2xStartBatchRecord( record, 0 );
+            }
+            tmf8x2xAddBatchLine( record, p );
+        }
+    }
+    return record ? count + 1 : count;
+}
+
+uint8_t tmf8x2xParseBatchRecord ( tmf8x2xSpadMaskStorage * storage, const tmf8x2xBatchRecord * record )
+{
+    if (  record->broken
+        || tmf8x2xParseSpadMask( storage, record->mapText, record->mapLength, record->hasMask ? record->maskText : 0, record->maskLength, record->xOffset_2, record->yOffset_2 ) != TMF8X2X_SPAD_MAP_OK
+        )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint32_t tmf8x2xReadBatch ( FILE * input, tmf8x2xBatchHandler handler, void * context, uint32_t * count )
+{
+    static tmf8x2xBatchRecord record;
+    tmf8x2xBatchReader reader;
+    tmf8x2xSpadMaskStorage storage;
+    uint32_t records = 0;
+    uint32_t failed = 0;
+
+    reader.hasPending = 0;
+    while ( tmf8x2xReadBatchRecords( input, &reader, &record, 1 ) )
+    {
+        const tmf8x2xSpadMask * mask = ( tmf8x2xParseBatchRecord( &storage, &record ) == TMF8X2X_SPAD_MAP_OK ) ? &storage.mask : 0;
+        failed += ( handler( context, records++, record.name, mask ) != TMF8X2X_VALIDATE_OK );
+    }
+    *count = records;
+    return failed;
+}
+
+uint32_t tmf8x2xRunBatch ( FILE * input, tmf8x2xCache * cache, uint32_t threads, uint32_t formats, uint8_t connectivity )
+{
+    batchOutput output;
+    uint32_t records;
+    uint32_t failed;
+    uint64_t start = tmf8x2xTimeNs();
+    uint64_t elapsed;
+
+    tmf8x2xEmitHeader( formats );
+    threads = tmf8x2xPoolThreads( threads );
+    if ( threads == 1 )
+    {
+        output.cache = cache;
+        output.formats = formats;
+        output.connectivity = connectivity;
+        failed = tmf8x2xReadBatch( input, batchCheckRecord, &output, &records );
+    }
+    else
+    {
+        failed = batchRunParallel( input, threads, cache, formats, connectivity, &records );
+    }
+    elapsed = tmf8x2xTimeNs() - start;
+    if ( formats & TMF8X2X_FORMAT_MACHINE )
+    {
+        tmf8x2xEmitSummary( formats, records, failed, elapsed );
+        return failed;
+    }
+    dumpString( "# records: " );
+    dumpSignedDecimal( (int32_t)records );
+    dumpString( " ok: " );
+    dumpSignedDecimal( (int32_t)( records - failed ) );
+    dumpString( " failed: " );
+    dumpSignedDecimal( (int32_t)failed );
+    dumpString( " time: " );
+    dumpUnsignedDecimal( elapsed / 1000u );
+    dumpString( " us throughput: " );
+    dumpSignedDecimal( (int32_t)( elapsed ? ( (uint64_t)records * 1000000000u / elapsed ) : 0 ) );
+    dumpString( " records/s\n" );
+    if ( cache )
+    {
+        dumpString( "# cache hits: " );
+        dumpSignedDecimal( (int32_t)cache->stats.hits );
+        dumpString( " misses: " );
+        dumpSignedDecimal( (int32_t)cache->stats.misses );
+        dumpString( " stores: " );
+        dumpSignedDecimal( (int32_t)cache->stats.stores );
+        dumpString( " store errors: " );
+        dumpSignedDecimal( (int32_t)cache->stats.storeErrors );
+        dumpString( " rejected: " );
+        dumpSignedDecimal( (int32_t)cache->stats.rejected );
+        dumpString( "\n" );
+    }
+
+    return failed;
+}
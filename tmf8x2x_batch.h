@@ -0,0 +1,163 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_batch.h
+ *  \brief streaming batch mode, validates a concatenated stream of SPAD map / mask records.
+ *
+ * Record format (linux driver text format with a header line per record):
+ *
+ *   # comment lines and empty lines are ignored
+ *   map <xOffset_2> <yOffset_2> [name]
+ *   <SPAD map, one row of TDC channels per line>
+ *   mask
+ *   <SPAD mask, one row of enable bits per line>
+ *
+ * The mask section is optional, without it all SPADs are enabled. A record ends with the next "map" line or the end of the stream.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tmf8x2x_spad_parser.h"
+#include "tmf8x2x_cache.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_BATCH_H
+#define TMF8X2X_BATCH_H
+
+/* longest line that is accepted in a record stream */
+#define TMF8X2X_BATCH_LINE_SIZE             256
+/* largest SPAD map / mask text of one record */
+#define TMF8X2X_BATCH_TEXT_SIZE             1024
+/* longest record name */
+#define TMF8X2X_BATCH_NAME_SIZE             64
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* one record of the stream as text, see tmf8x2xReadBatchRecords */
+typedef struct _tmf8x2xBatchRecord
+{
+    char name[ TMF8X2X_BATCH_NAME_SIZE ];
+    char mapText[ TMF8X2X_BATCH_TEXT_SIZE ];
+    char maskText[ TMF8X2X_BATCH_TEXT_SIZE ];
+    uint32_t mapLength;
+    uint32_t maskLength;
+    int8_t xOffset_2;
+    int8_t yOffset_2;
+    uint8_t section;
+    uint8_t hasMask;
+    uint8_t broken;     /* set for syntax errors in the record structure */
+} tmf8x2xBatchRecord;
+
+/* state of tmf8x2xReadBatchRecords between calls, set hasPending to 0 before the first call */
+typedef struct _tmf8x2xBatchReader
+{
+    char pending[ TMF8X2X_BATCH_LINE_SIZE ];    /* header line of the first record of the next call */
+    uint8_t hasPending;
+} tmf8x2xBatchReader;
+
+/* receives the records of a stream one at a time, mask is 0 for records that could not be parsed. Returns TMF8X2X_VALIDATE_OK
+   for records that passed, anything else counts as failed. */
+typedef uint8_t ( * tmf8x2xBatchHandler )( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask );
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xReadBatchRecords reads the text of up to capacity records from the stream, without parsing the SPAD maps / masks
+ * @param input stream of records
+ * @param reader state between calls
+ * @param records receives the records
+ * @param capacity size of the records array, at least 1
+ * @return number of records read, 0 at the end of the stream
+ */
+uint32_t tmf8x2xReadBatchRecords( FILE * input, tmf8x2xBatchReader * reader, tmf8x2xBatchRecord * records, uint32_t capacity );
+
+/**
+ * @brief tmf8x2xStartBatchRecord resets a record and parses its "map <xOffset_2> <yOffset_2> [name]" header line, for readers other than tmf8x2xReadBatchRecords
+ * @param record to be reset
+ * @param line header line, 0 for data lines without a header (the record is broken)
+ */
+void tmf8x2xStartBatchRecord( tmf8x2xBatchRecord * record, const char * line );
+
+/**
+ * @brief tmf8x2xAddBatchLine adds a line after the header to a record: the "mask" line or a row of the SPAD map / mask
+ * @param record started with tmf8x2xStartBatchRecord
+ * @param line to be added, without leading white space
+ */
+void tmf8x2xAddBatchLine( tmf8x2xBatchRecord * record, const char * line );
+
+/**
+ * @brief tmf8x2xParseBatchRecord parses SPAD map and mask of a record read with tmf8x2xReadBatchRecords
+ * @param storage receives the SPAD mask
+ * @param record to parse
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the record structure or a text is broken, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xParseBatchRecord( tmf8x2xSpadMaskStorage * storage, const tmf8x2xBatchRecord * record );
+
+/**
+ * @brief tmf8x2xReadBatch reads records one at a time from the stream and hands each to the handler
+ * @param input stream of records
+ * @param handler receives each record, the mask is only valid during the call
+ * @param context passed to the handler
+ * @param count receives the number of records
+ * @return number of records the handler reported as failed
+ */
+uint32_t tmf8x2xReadBatch( FILE * input, tmf8x2xBatchHandler handler, void * context, uint32_t * count );
+
+/**
+ * @brief tmf8x2xRunBatch reads records one at a time from the stream, validates each and dumps one result line per record, followed by throughput statistics
+ * @param input stream of records
+ * @param cache checked SPAD maps, records found in the cache are not checked again; 0 to check every record
+ * @param threads number of worker threads (up to TMF8X2X_POOL_MAX_THREADS), 0 for one per online CPU. With a cache the records are checked on the calling thread.
+ * @param formats TMF8X2X_FORMAT_* bits: the human readable formats are dumped after the result line of each valid record, JSON Lines / CSV
+ * replace the result lines and the statistics. 0 for the result lines only.
+ * @param connectivity strict mode: TMF8X2X_CONNECTIVITY_4 / TMF8X2X_CONNECTIVITY_8 rejects records with a zone that is split into
+ * several islands (TMF8X2X_VALIDATE_ERROR_CONNECTIVITY), 0 for the checks of tmf8x2xValidateSpadMask only
+ * @return number of records that failed (parsing or checks)
+ */
+uint32_t tmf8x2xRunBatch( FILE * input, tmf8x2xCache * cache, uint32_t threads, uint32_t formats, uint8_t connectivity );
+
+#endif /* TMF8X2X_BATCH_H */
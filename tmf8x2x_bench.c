@@ -0,0 +1,444 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_bench.c
+ *  \brief microbenchmarks for the SPAD map create / check / dump pipeline, one JSON line per corpus and stage on stdout.
+ *
+ * usage: spad_bench [-r runs] [-n operations per run] [-k scalar|sse2|avx2|bmi2]
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_spad_kernels.h"
+#include "tmf8x2x_validator.h"
+#include "tmf8x2x_zone_stats.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <x86intrin.h>
+#define BENCH_CYCLES()      __rdtsc()
+#else
+#define BENCH_CYCLES()      0
+#endif
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#define BENCH_DEFAULT_RUNS                  51
+#define BENCH_DEFAULT_OPS                   20000
+#define BENCH_MAX_RUNS                      1001
+#define BENCH_RANDOM_MAPS                   256     /* number of maps in the random corpus */
+#define BENCH_DUMP_OPS_DIVIDER              20      /* dump stages are much slower, run fewer operations per run */
+#define BENCH_MAP_SIZE                      ( TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+
+/* benchmarked stages */
+#define STAGE_PACK                          0
+#define STAGE_CREATE                        1
+#define STAGE_CHECK_AREA                    2
+#define STAGE_CHECK_CHANNEL_SETUP           3
+#define STAGE_CHECK_ASSIGNMENT              4
+#define STAGE_CHECK_ASSIGNMENT_REFERENCE    5
+#define STAGE_VALIDATE                      6
+#define STAGE_VALIDATOR_SET_ENABLE          7
+#define STAGE_PACK_REGISTER_IMAGE           8
+#define STAGE_ZONE_STATS                    9
+#define STAGE_DUMP_CSTRUCT                  10
+#define STAGE_DUMP_I2C                      11
+#define STAGE_DUMP_I2C_BURST                12
+#define STAGE_DUMP_CHANNEL_TEXT             13
+#define STAGE_DUMP_ENABLE_TEXT              14
+#define STAGE_COUNT                         15
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* one map of a corpus with its own storage */
+typedef struct _benchMap
+{
+    uint8_t channels[ BENCH_MAP_SIZE ];
+    uint8_t enable[ BENCH_MAP_SIZE ];
+    uint32_t enablePacked[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    tmf8x2xSpadMask mask;
+    tmf8x2xHalMainSpadConfig config;
+    tmf8x2xSpadValidator validator;
+    uint32_t edits;                                                     /* SPAD toggled next by the validator stage */
+} benchMap;
+
+/* a set of maps that is benchmarked as a whole */
+typedef struct _benchCorpus
+{
+    const char * name;
+    benchMap * maps;
+    uint32_t count;
+} benchCorpus;
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+static const char * const stageNames[ STAGE_COUNT ] =
+{
+    "pack", "create", "check_area", "check_channel_setup", "check_assignment", "check_assignment_reference",
+    "validate", "validator_set_enable", "pack_register_image", "zone_stats", "dump_cstruct", "dump_i2c", "dump_i2c_burst", "dump_channel_text", "dump_enable_text"
+};
+
+/* 3x3 checkerboard, the sample map of tmf8x2x_test_masks.c */
+static const uint8_t checkerboardChannel[ 18 * 6 ] =
+{
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3,
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6,
+    4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6,
+    7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9,
+    7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9
+};
+
+static uint32_t randomState = 0x2545f491;
+
+/* results of all stages are accumulated here so that the compiler cannot drop the work */
+static volatile uint32_t benchSink;
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static uint32_t benchRandom ( void )
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static int compareDouble ( const void * a, const void * b )
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return ( da > db ) - ( da < db );
+}
+
+/* fill in the mask structure of a map and create its packed configuration, returns TMF8X2X_VALIDATE_* */
+static uint8_t benchPrepareMap ( benchMap * map, uint8_t xSize, uint8_t ySize, int8_t xOffset_2, int8_t yOffset_2 )
+{
+    tmf8x2xPackEnableMask( map->enablePacked, map->enable, xSize, ySize );
+    map->mask.enable = map->enablePacked;
+    map->mask.channels = map->channels;
+    map->mask.id = 0;
+    map->mask.xOffset_2 = xOffset_2;
+    map->mask.yOffset_2 = yOffset_2;
+    map->mask.xSize = xSize;
+    map->mask.ySize = ySize;
+    tmf8x2xValidatorInit( &map->validator, &map->mask );
+    map->edits = 0;
+    return tmf8x2xValidateSpadMask( &map->config, &map->mask );
+}
+
+/*
+ *****************************************************************************
+ * CORPORA
+ *****************************************************************************
+ */
+
+static void benchCheckerboard ( benchCorpus * corpus )
+{
+    static benchMap map;
+
+    memcpy( map.channels, checkerboardChannel, sizeof( checkerboardChannel ) );
+    for ( uint32_t i = 0; i < sizeof( checkerboardChannel ); i++ )
+    {
+        map.enable[ i ] = ( ( i / 18 ) + ( i % 18 ) + 1 ) & 1;
+    }
+    benchPrepareMap( &map, 18, 6, 0, 0 );
+    corpus->name = "checkerboard";
+    corpus->maps = &map;
+    corpus->count = 1;
+}
+
+/* random sizes, channels 2..9 in random rectangular zones, about 75% of the SPADs enabled; only valid maps are kept */
+static void benchRandomMaps ( benchCorpus * corpus )
+{
+    static benchMap maps[ BENCH_RANDOM_MAPS ];
+    uint32_t count = 0;
+
+    while ( count < BENCH_RANDOM_MAPS )
+    {
+        benchMap * map = &maps[ count ];
+        uint8_t xSize = (uint8_t)( 2 + benchRandom() % ( TMF8X2X_MAIN_SPAD_MAX_X_SIZE - 1 ) );
+        uint8_t ySize = (uint8_t)( 2 + benchRandom() % ( TMF8X2X_MAIN_SPAD_MAX_Y_SIZE - 1 ) );
+        uint8_t zoneWidth = (uint8_t)( 1 + benchRandom() % 6 );
+        uint8_t zoneHeight = (uint8_t)( 1 + benchRandom() % 4 );
+        uint8_t first = (uint8_t)( benchRandom() % 8 );
+
+        for ( uint32_t y = 0; y < ySize; y++ )
+        {
+            for ( uint32_t x = 0; x < xSize; x++ )
+            {
+                uint32_t zone = ( x / zoneWidth ) + ( y / zoneHeight ) * 3 + first;
+                map->channels[ y * xSize + x ] = (uint8_t)( CHANNEL_2 + zone % 8 );
+                map->enable[ y * xSize + x ] = ( benchRandom() & 3 ) != 0;
+            }
+        }
+        if ( benchPrepareMap( map, xSize, ySize, (int8_t)( xSize & 1 ), (int8_t)( ySize & 1 ) ) == TMF8X2X_VALIDATE_OK )
+        {
+            count++;
+        }
+    }
+    corpus->name = "random";
+    corpus->maps = maps;
+    corpus->count = count;
+}
+
+/* largest possible map with all channels in use and all SPADs enabled */
+static void benchWorstCase ( benchCorpus * corpus )
+{
+    static benchMap map;
+
+    for ( uint32_t y = 0; y < TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; y++ )
+    {
+        for ( uint32_t x = 0; x < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; x++ )
+        {
+            uint32_t i = y * TMF8X2X_MAIN_SPAD_MAX_X_SIZE + x;
+            map.channels[ i ] = (uint8_t)( ( y < 3 ) ? 1 + x / 6 : ( y < 6 ) ? 4 + x / 6 : 7 + x / 6 );
+            map.enable[ i ] = 1;
+        }
+    }
+    benchPrepareMap( &map, TMF8X2X_MAIN_SPAD_MAX_X_SIZE, TMF8X2X_MAIN_SPAD_MAX_Y_SIZE, 0, 0 );
+    corpus->name = "worst_18x10";
+    corpus->maps = &map;
+    corpus->count = 1;
+}
+
+/*
+ *****************************************************************************
+ * BENCHMARK
+ *****************************************************************************
+ */
+
+/* run one operation of a stage on a map */
+static void benchStage ( uint32_t stage, benchMap * map )
+{
+    tmf8x2xHalMainSpadConfig cfg;
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    tmf8x2xSpadMapStats stats;
+
+    switch ( stage )
+    {
+        case STAGE_PACK:
+            tmf8x2xPackEnableMask( map->enablePacked, map->enable, map->mask.xSize, map->mask.ySize );
+            benchSink += map->enablePacked[ 0 ];
+            break;
+        case STAGE_CREATE:
+            benchSink += ( tmf8x2xCreateMainSpad( &cfg, &map->mask ) != 0 ) + cfg.tdcChannel[ 0 ];
+            break;
+        case STAGE_CHECK_AREA:
+            benchSink += tmf8x2xCheckMainSpadArea( &map->config );
+            break;
+        case STAGE_CHECK_CHANNEL_SETUP:
+            benchSink += tmf8x2xCheckMainSpadChannelSetup( map->channels, map->mask.xSize, map->mask.ySize );
+            break;
+        case STAGE_CHECK_ASSIGNMENT:
+            benchSink += tmf8x2xCheckMainSpadAssignment( &map->config );
+            break;
+        case STAGE_CHECK_ASSIGNMENT_REFERENCE:
+            benchSink += tmf8x2xCheckMainSpadAssignmentReference( &map->config );
+            break;
+        case STAGE_VALIDATE:
+            benchSink += tmf8x2xValidateSpadMask( &cfg, &map->mask );
+            break;
+        case STAGE_VALIDATOR_SET_ENABLE:
+        {
+            /* toggle the SPADs in turn, each op is one edit */
+            uint8_t x = (uint8_t)( map->edits % map->mask.xSize );
+            uint8_t y = (uint8_t)( ( map->edits / map->mask.xSize ) % map->mask.ySize );
+            uint8_t i = (uint8_t)( ( map->mask.ySize - 1 - y ) * map->mask.xSize + x );
+            map->edits++;
+            tmf8x2xValidatorSetEnable( &map->validator, x, y, ! map->validator.enable[ i ] );
+            benchSink += tmf8x2xValidatorResult( &map->validator );
+            break;
+        }
+        case STAGE_PACK_REGISTER_IMAGE:
+            tmf8x2xPackRegisterImage( image, &map->config );
+            benchSink += image[ TMF8X2X_REGISTER_IMAGE_SIZE - 1 ];
+            break;
+        case STAGE_ZONE_STATS:
+            tmf8x2xComputeZoneStats( &map->config, &stats );
+            benchSink += stats.boundary + stats.zones[ 1 ].xAngle;
+            break;
+        case STAGE_DUMP_CSTRUCT:
+            dumpMainSpadConfigAsCstruct( "tmf8x2xBenchSpadMap", &map->config );
+            break;
+        case STAGE_DUMP_I2C:
+            dumpMainSpadConfigAsI2Cstrings( "tmf8x2xBenchSpadMap", &map->config );
+            break;
+        case STAGE_DUMP_I2C_BURST:
+            dumpMainSpadConfigAsI2Cburst( "tmf8x2xBenchSpadMap", &map->config );
+            break;
+        case STAGE_DUMP_CHANNEL_TEXT:
+            dumpChannelMapAsText( &map->mask );
+            break;
+        default:
+            dumpMainSpadEnableBitsAsText( &map->config );
+            break;
+    }
+}
+
+static void benchRun ( FILE * out, const benchCorpus * corpus, uint32_t stage, uint32_t runs, uint32_t ops )
+{
+    static double nsPerOp[ BENCH_MAX_RUNS ];
+    uint64_t totalNs = 0;
+    uint64_t totalCycles = 0;
+    uint32_t index = 0;
+    double meanNs;
+
+    if ( stage >= STAGE_DUMP_CSTRUCT )
+    {
+        ops = ( ops / BENCH_DUMP_OPS_DIVIDER ) + 1;
+    }
+    for ( uint32_t op = 0; op < ops; op++ ) /* warm up caches and branch predictors */
+    {
+        benchStage( stage, &corpus->maps[ op % corpus->count ] );
+    }
+
+    for ( uint32_t run = 0; run < runs; run++ )
+    {
+        uint64_t start = tmf8x2xTimeNs();
+        uint64_t startCycles = BENCH_CYCLES();
+        uint64_t ns;
+        for ( uint32_t op = 0; op < ops; op++ )
+        {
+            benchStage( stage, &corpus->maps[ index ] );
+            if ( ++index == corpus->count )
+            {
+                index = 0;
+            }
+        }
+        dumpFlush(); /* dump stages: include the write of the formatted output */
+        totalCycles += BENCH_CYCLES() - startCycles;
+        ns = tmf8x2xTimeNs() - start;
+        totalNs += ns;
+        nsPerOp[ run ] = (double)ns / ops;
+    }
+    qsort( nsPerOp, runs, sizeof( nsPerOp[ 0 ] ), compareDouble );
+    meanNs = (double)totalNs / ( (double)runs * ops );
+
+    fprintf( out, "{\"corpus\":\"%s\",\"maps\":%u,\"stage\":\"%s\",\"kernel\":\"%s\",\"runs\":%u,\"ops_per_run\":%u,"
+                  "\"ns_per_op\":%.2f,\"cycles_per_op\":%.2f,\"ops_per_s\":%.0f,\"p50_ns\":%.2f,\"p99_ns\":%.2f}\n"
+           , corpus->name, corpus->count, stageNames[ stage ], tmf8x2xKernelName( tmf8x2xGetKernel() ), runs, ops
+           , meanNs, (double)totalCycles / ( (double)runs * ops ), meanNs > 0 ? 1e9 / meanNs : 0.0
+           , nsPerOp[ runs / 2 ], nsPerOp[ ( runs * 99 ) / 100 ] );
+    fflush( out );
+}
+
+static int benchKernel ( const char * name )
+{
+    for ( uint8_t kernel = TMF8X2X_KERNEL_SCALAR; kernel <= TMF8X2X_KERNEL_BMI2; kernel++ )
+    {
+        if ( strcmp( name, tmf8x2xKernelName( kernel ) ) == 0 )
+        {
+            return tmf8x2xSetKernel( kernel ) == TMF8X2X_SPAD_MAP_OK;
+        }
+    }
+    return 0;
+}
+
+int main ( int argc, char **argv )
+{
+    benchCorpus corpora[ 3 ];
+    uint32_t runs = BENCH_DEFAULT_RUNS;
+    uint32_t ops = BENCH_DEFAULT_OPS;
+    FILE * out = stdout;
+    static tmf8x2xOutputSink nullSink;
+    int nullFd;
+    int validArgs = ( argc & 1 ) == 1; /* options come in pairs */
+
+    for ( int i = 1; validArgs && i + 1 < argc; i += 2 )
+    {
+        if ( strcmp( argv[ i ], "-r" ) == 0 )
+        {
+            runs = (uint32_t)strtoul( argv[ i + 1 ], 0, 10 );
+        }
+        else if ( strcmp( argv[ i ], "-n" ) == 0 )
+        {
+            ops = (uint32_t)strtoul( argv[ i + 1 ], 0, 10 );
+        }
+        else if ( strcmp( argv[ i ], "-k" ) != 0 || ! benchKernel( argv[ i + 1 ] ) )
+        {
+            validArgs = 0; /* unknown option, or a kernel this CPU does not support */
+        }
+    }
+    if ( ! validArgs || runs == 0 || runs > BENCH_MAX_RUNS || ops == 0 )
+    {
+        fprintf( stderr, "usage: spad_bench [-r runs (1..%d)] [-n operations per run] [-k scalar|sse2|avx2|bmi2]\n", BENCH_MAX_RUNS );
+        return 1;
+    }
+
+    /* results go to stdout, the dumped text to /dev/null */
+    nullFd = open( "/dev/null", O_WRONLY );
+    if ( nullFd < 0 )
+    {
+        fprintf( stderr, "ERROR opening /dev/null\n" );
+        return 1;
+    }
+    tmf8x2xSinkInitFd( &nullSink, nullFd );
+    dumpSelectSink( &nullSink );
+
+    benchCheckerboard( &corpora[ 0 ] );
+    benchRandomMaps( &corpora[ 1 ] );
+    benchWorstCase( &corpora[ 2 ] );
+
+    for ( uint32_t c = 0; c < sizeof( corpora ) / sizeof( corpora[ 0 ] ); c++ )
+    {
+        for ( uint32_t stage = 0; stage < STAGE_COUNT; stage++ )
+        {
+            benchRun( out, &corpora[ c ], stage, runs, ops );
+        }
+    }
+    close( nullFd );
+    return 0;
+}
@@ -0,0 +1,485 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_cache.c
+ *  \brief content-addressed on-disk cache of checked SPAD maps: verdict, register image and rendered output.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L /* open, mkdir, rename, opendir */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_cache.h"
+#include "tmf8x2x_format.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* largest key input: version, name, size, offsets, channels, enable rows */
+#define CACHE_INPUT_SIZE                    512
+/* longest name of a SPAD setup that is cached */
+#define CACHE_NAME_SIZE                     64
+/* longest path of an entry: directory, key, process id, store count */
+#define CACHE_PATH_SIZE                     ( TMF8X2X_CACHE_DIR_SIZE + 48 )
+
+/* FNV-1a, 64 bit */
+#define CACHE_HASH_OFFSET                   0xcbf29ce484222325ull
+#define CACHE_HASH_PRIME                    0x100000001b3ull
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* start of an entry file, followed by the key input and the text (not zero terminated) */
+typedef struct _cacheFileHeader
+{
+    char magic[ 8 ];
+    uint64_t key;
+    uint32_t inputLength;
+    uint32_t textLength;
+    tmf8x2xLibStatus status;
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+} cacheFileHeader;
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief cacheInput serializes everything the output of a SPAD map depends on
+ * @param input receives at most CACHE_INPUT_SIZE bytes
+ * @param mask SPAD configuration in human readable format
+ * @param name of the SPAD setup
+ * @return number of bytes, 0 if the map cannot be cached (size out of range, name too long)
+ */
+static uint32_t cacheInput( uint8_t * input, const tmf8x2xSpadMask * mask, const char * name );
+
+/**
+ * @brief cacheHash computes the 64-bit FNV-1a hash of a buffer
+ * @param data to hash
+ * @param length of data
+ * @return hash
+ */
+static uint64_t cacheHash( const uint8_t * data, uint32_t length );
+
+/**
+ * @brief cachePath builds the file name of an entry
+ * @param path receives the file name, CACHE_PATH_SIZE bytes
+ * @param cache opened cache
+ * @param key of the entry
+ * @param suffix ".spad" for the entry, or a temporary suffix
+ */
+static void cachePath( char * path, const tmf8x2xCache * cache, uint64_t key, const char * suffix );
+
+/**
+ * @brief cacheWriteAll writes a complete buffer to a file descriptor
+ * @param fd file descriptor
+ * @param data to write
+ * @param length of data
+ * @return 0 on success
+ */
+static int cacheWriteAll( int fd, const void * data, uint32_t length );
+
+/**
+ * @brief cacheCount increments a counter of the statistics, lookups and stores may run on several threads
+ * @param cache opened cache
+ * @param counter in cache->stats
+ */
+static void cacheCount( tmf8x2xCache * cache, uint32_t * counter );
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+static const char cacheMagic[ 8 ] = { 'T', 'M', 'F', '8', 'X', '2', 'X', 'C' };
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static uint32_t cacheInput ( uint8_t * input, const tmf8x2xSpadMask * mask, const char * name )
+{
+    uint32_t length = sizeof( TMF8X2X_CACHE_TOOL_VERSION );
+    size_t nameLength = strlen( name ) + 1;
+    uint32_t spads = (uint32_t)mask->xSize * mask->ySize;
+    uint32_t xMask;
+
+    if ( mask->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || mask->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE || nameLength > CACHE_NAME_SIZE )
+    {
+        return 0;
+    }
+    xMask = ( 1u << mask->xSize ) - 1;
+
+    memcpy( input, TMF8X2X_CACHE_TOOL_VERSION, length );
+    memcpy( input + length, name, nameLength );
+    length += (uint32_t)nameLength;
+    input[ length++ ] = mask->xSize;
+    input[ length++ ] = mask->ySize;
+    input[ length++ ] = (uint8_t)mask->xOffset_2;
+    input[ length++ ] = (uint8_t)mask->yOffset_2;
+    memcpy( input + length, mask->channels, spads );
+    length += spads;
+    for ( uint8_t y = 0; y < mask->ySize; y++ ) /* bits outside the map are not used, leave them out of the key */
+    {
+        uint32_t row = mask->enable[ y ] & xMask;
+        input[ length++ ] = (uint8_t)row;
+        input[ length++ ] = (uint8_t)( row >> 8 );
+        input[ length++ ] = (uint8_t)( row >> 16 );
+    }
+    return length;
+}
+
+static uint64_t cacheHash ( const uint8_t * data, uint32_t length )
+{
+    uint64_t hash = CACHE_HASH_OFFSET;
+
+    for ( uint32_t i = 0; i < length; i++ )
+    {
+        hash = ( hash ^ data[ i ] ) * CACHE_HASH_PRIME;
+    }
+    return hash;
+}
+
+static void cachePath ( char * path, const tmf8x2xCache * cache, uint64_t key, const char * suffix )
+{
+    snprintf( path, CACHE_PATH_SIZE, "%s/%016llx%s", cache->directory, (unsigned long long)key, suffix );
+}
+
+static int cacheWriteAll ( int fd, const void * data, uint32_t length )
+{
+    const char * p = (const char *)data;
+
+    while ( length )
+    {
+        ssize_t written = write( fd, p, length );
+        if ( written < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( written <= 0 )
+        {
+            return 1;
+        }
+        p += written;
+        length -= (uint32_t)written;
+    }
+    return 0;
+}
+
+static void cacheCount ( tmf8x2xCache * cache, uint32_t * counter )
+{
+    pthread_mutex_lock( &cache->lock );
+    ( *counter )++;
+    pthread_mutex_unlock( &cache->lock );
+}
+
+/*
+ *****************************************************************************
+ * CACHE
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xCacheOpen ( tmf8x2xCache * cache, const char * directory )
+{
+    memset( &cache->stats, 0, sizeof( cache->stats ) );
+    cache->storeCount = 0;
+    pthread_mutex_init( &cache->lock, 0 );
+    if ( strlen( directory ) >= TMF8X2X_CACHE_DIR_SIZE )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    strcpy( cache->directory, directory );
+    if ( mkdir( directory, 0777 ) != 0 && errno != EEXIST )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+void tmf8x2xCacheClose ( tmf8x2xCache * cache )
+{
+    char path[ CACHE_PATH_SIZE ];
+    char line[ 96 ];
+    int fd;
+    int length;
+
+    snprintf( path, sizeof( path ), "%s/stats", cache->directory );
+    length = snprintf( line, sizeof( line ), "%u %u %u %u %u\n"
+                     , cache->stats.hits, cache->stats.misses, cache->stats.stores, cache->stats.storeErrors, cache->stats.rejected );
+    fd = open( path, O_WRONLY | O_CREAT | O_APPEND, 0666 );
+    if ( fd >= 0 )
+    {
+        cacheWriteAll( fd, line, (uint32_t)length ); /* a single short append, lines of concurrent processes do not mix */
+        close( fd );
+    }
+    pthread_mutex_destroy( &cache->lock );
+}
+
+uint64_t tmf8x2xCacheKey ( const tmf8x2xSpadMask * mask, const char * name )
+{
+    uint8_t input[ CACHE_INPUT_SIZE ];
+    return cacheHash( input, cacheInput( input, mask, name ) );
+}
+
+void tmf8x2xCacheRender ( tmf8x2xCacheEntry * entry, const tmf8x2xSpadMask * mask, const char * name )
+{
+    tmf8x2xHalMainSpadConfig cfg;
+    tmf8x2xOutputSink sink;
+    tmf8x2xOutputSink * previous;
+
+    memset( entry->image, 0, sizeof( entry->image ) );
+    entry->textLength = 0;
+    entry->text[ 0 ] = 0;
+    if ( tmf8x2xLibValidateMask( &cfg, mask, &entry->status ) != TMF8X2X_LIB_OK )
+    {
+        return;
+    }
+    tmf8x2xPackRegisterImage( entry->image, &cfg );
+
+    tmf8x2xSinkInitMemory( &sink, entry->text, TMF8X2X_CACHE_TEXT_SIZE );
+    previous = dumpSelectSink( &sink );
+    tmf8x2xDumpFormats( TMF8X2X_FORMAT_TEXT, name, mask, &cfg );
+    dumpSelectSink( previous );
+    entry->textLength = sink.used;
+}
+
+void tmf8x2xCacheValidate ( tmf8x2xCacheEntry * entry, const tmf8x2xSpadMask * mask )
+{
+    tmf8x2xHalMainSpadConfig cfg;
+
+    memset( entry->image, 0, sizeof( entry->image ) );
+    entry->textLength = 0;
+    entry->text[ 0 ] = 0;
+    if ( tmf8x2xLibValidateMask( &cfg, mask, &entry->status ) == TMF8X2X_LIB_OK )
+    {
+        tmf8x2xPackRegisterImage( entry->image, &cfg );
+    }
+}
+
+uint8_t tmf8x2xCacheLookup ( tmf8x2xCache * cache, const tmf8x2xSpadMask * mask, const char * name, tmf8x2xCacheEntry * entry )
+{
+    uint8_t input[ CACHE_INPUT_SIZE ];
+    uint8_t file[ sizeof( cacheFileHeader ) + CACHE_INPUT_SIZE + TMF8X2X_CACHE_TEXT_SIZE ];
+    char path[ CACHE_PATH_SIZE ];
+    cacheFileHeader header;
+    uint32_t inputLength = cacheInput( input, mask, name );
+    uint64_t key = cacheHash( input, inputLength );
+    uint32_t length = 0;
+    int fd;
+
+    cachePath( path, cache, key, ".spad" );
+    fd = inputLength ? open( path, O_RDONLY ) : -1;
+    if ( fd < 0 )
+    {
+        cacheCount( cache, &cache->stats.misses );
+        return TMF8X2X_CACHE_MISS;
+    }
+    while ( length < sizeof( file ) )
+    {
+        ssize_t got = read( fd, file + length, sizeof( file ) - length );
+        if ( got < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( got <= 0 )
+        {
+            break;
+        }
+        length += (uint32_t)got;
+    }
+    close( fd );
+
+    /* entries are only renamed into place when complete, anything else is a broken file or another input with the same hash */
+    memcpy( &header, file, ( length < sizeof( header ) ) ? length : sizeof( header ) );
+    if (  length < sizeof( header )
+       || memcmp( header.magic, cacheMagic, sizeof( cacheMagic ) ) != 0
+       || header.key != key
+       || header.inputLength != inputLength
+       || header.textLength >= TMF8X2X_CACHE_TEXT_SIZE
+       || length != sizeof( header ) + header.inputLength + header.textLength
+       || memcmp( file + sizeof( header ), input, inputLength ) != 0
+       )
+    {
+        cacheCount( cache, &cache->stats.rejected );
+        cacheCount( cache, &cache->stats.misses );
+        return TMF8X2X_CACHE_MISS;
+    }
+    entry->status = header.status;
+    memcpy( entry->image, header.image, sizeof( entry->image ) );
+    entry->textLength = header.textLength;
+    memcpy( entry->text, file + sizeof( header ) + inputLength, header.textLength );
+    entry->text[ header.textLength ] = 0;
+    cacheCount( cache, &cache->stats.hits );
+    return TMF8X2X_CACHE_HIT;
+}
+
+uint8_t tmf8x2xCacheStore ( tmf8x2xCache * cache, const tmf8x2xSpadMask * mask, const char * name, const tmf8x2xCacheEntry * entry )
+{
+    uint8_t input[ CACHE_INPUT_SIZE ];
+    char path[ CACHE_PATH_SIZE ];
+    char temporary[ CACHE_PATH_SIZE ];
+    char suffix[ 32 ];
+    cacheFileHeader header;
+    uint32_t inputLength = cacheInput( input, mask, name );
+    uint32_t store;
+    int fd;
+    int error;
+
+    if ( ! inputLength || entry->textLength >= TMF8X2X_CACHE_TEXT_SIZE - 1 ) /* a full text buffer may be truncated */
+    {
+        cacheCount( cache, &cache->stats.storeErrors );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, cacheMagic, sizeof( cacheMagic ) );
+    header.key = cacheHash( input, inputLength );
+    header.inputLength = inputLength;
+    header.textLength = entry->textLength;
+    header.status = entry->status;
+    memcpy( header.image, entry->image, sizeof( header.image ) );
+
+    pthread_mutex_lock( &cache->lock );
+    store = cache->storeCount++;
+    pthread_mutex_unlock( &cache->lock );
+    snprintf( suffix, sizeof( suffix ), ".%ld.%u.tmp", (long)getpid( ), store ); /* unique per process and store, threads do not share a temporary file */
+    cachePath( temporary, cache, header.key, suffix );
+    cachePath( path, cache, header.key, ".spad" );
+    fd = open( temporary, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    if ( fd < 0 )
+    {
+        cacheCount( cache, &cache->stats.storeErrors );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    error = cacheWriteAll( fd, &header, sizeof( header ) );
+    error |= cacheWriteAll( fd, input, inputLength );
+    error |= cacheWriteAll( fd, entry->text, entry->textLength );
+    error |= ( close( fd ) != 0 );
+    if ( error || rename( temporary, path ) != 0 ) /* rename( ) replaces the entry atomically, readers never see a partial file */
+    {
+        unlink( temporary );
+        cacheCount( cache, &cache->stats.storeErrors );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    cacheCount( cache, &cache->stats.stores );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xCacheReport ( const char * directory )
+{
+    char path[ CACHE_PATH_SIZE ];
+    tmf8x2xCacheStats sum = { 0, 0, 0, 0, 0 };
+    tmf8x2xCacheStats run;
+    uint32_t entries = 0;
+    uint32_t runs = 0;
+    uint64_t bytes = 0;
+    struct dirent * file;
+    FILE * stats;
+    DIR * dir = ( strlen( directory ) < TMF8X2X_CACHE_DIR_SIZE ) ? opendir( directory ) : 0;
+
+    if ( ! dir )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    while ( ( file = readdir( dir ) ) != 0 )
+    {
+        size_t length = strlen( file->d_name );
+        struct stat info;
+        if ( length > 5 && strcmp( file->d_name + length - 5, ".spad" ) == 0 )
+        {
+            snprintf( path, sizeof( path ), "%s/%s", directory, file->d_name );
+            if ( stat( path, &info ) == 0 )
+            {
+                entries++;
+                bytes += (uint64_t)info.st_size;
+            }
+        }
+    }
+    closedir( dir );
+
+    snprintf( path, sizeof( path ), "%s/stats", directory );
+    stats = fopen( path, "r" );
+    if ( stats )
+    {
+        while ( fscanf( stats, "%u %u %u %u %u", &run.hits, &run.misses, &run.stores, &run.storeErrors, &run.rejected ) == 5 )
+        {
+            runs++;
+            sum.hits += run.hits;
+            sum.misses += run.misses;
+            sum.stores += run.stores;
+            sum.storeErrors += run.storeErrors;
+            sum.rejected += run.rejected;
+        }
+        fclose( stats );
+    }
+
+    dumpString( "# cache entries: " );
+    dumpSignedDecimal( (int32_t)entries );
+    dumpString( " bytes: " );
+    dumpSignedDecimal( (int32_t)( bytes > INT32_MAX ? INT32_MAX : bytes ) );
+    dumpString( "\n# runs: " );
+    dumpSignedDecimal( (int32_t)runs );
+    dumpString( " hits: " );
+    dumpSignedDecimal( (int32_t)sum.hits );
+    dumpString( " misses: " );
+    dumpSignedDecimal( (int32_t)sum.misses );
+    dumpString( " hit rate: " );
+    dumpSignedDecimal( (int32_t)( ( sum.hits + sum.misses ) ? ( (uint64_t)sum.hits * 100u / ( sum.hits + sum.misses ) ) : 0 ) );
+    dumpString( "% stores: " );
+    dumpSignedDecimal( (int32_t)sum.stores );
+    dumpString( " store errors: " );
+    dumpSignedDecimal( (int32_t)sum.storeErrors );
+    dumpString( " rejected: " );
+    dumpSignedDecimal( (int32_t)sum.rejected );
+    dumpString( "\n" );
+    return TMF8X2X_SPAD_MAP_OK;
+}
@@ -0,0 +1,177 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_cache.h
+ *  \brief content-addressed on-disk cache of checked SPAD maps: verdict, register image and rendered output.
+ *
+ * An entry is stored in <directory>/<key>.spad, the key is a 64-bit hash of the tool version, the name of the
+ * SPAD setup and the SPAD map / mask as given (size, offsets, channels, enable bits). The input is stored in the
+ * entry as well, so a hash collision is a miss and never returns the output of another map.
+ *
+ * Readers take no locks: writers create the complete entry under a temporary name and rename( ) it into place,
+ * so several processes can share one directory and a reader sees either no entry or a complete one. The temporary
+ * names are unique per store, threads of one process may look up and store entries of the same cache concurrently.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_register_image.h"
+#include "tmf8x2x_spad_lib.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_CACHE_H
+#define TMF8X2X_CACHE_H
+
+/* part of every key, change it whenever the checks or the output formats change */
+#define TMF8X2X_CACHE_TOOL_VERSION          "v1.0"
+/* longest rendered output of one SPAD map */
+#define TMF8X2X_CACHE_TEXT_SIZE             16384
+/* longest path of a cache directory */
+#define TMF8X2X_CACHE_DIR_SIZE              256
+
+/* results of tmf8x2xCacheLookup */
+#define TMF8X2X_CACHE_MISS                  0
+#define TMF8X2X_CACHE_HIT                   1
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* everything that is known about a SPAD map after the checks */
+typedef struct _tmf8x2xCacheEntry
+{
+    tmf8x2xLibStatus status;                            /* verdict of the checks */
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];       /* register image 0x24..0x90, only valid if status.code is TMF8X2X_LIB_OK */
+    uint32_t textLength;                                /* 0 for entries without output (tmf8x2xCacheValidate) */
+    char text[ TMF8X2X_CACHE_TEXT_SIZE ];               /* C struct, I2C strings, I2C burst, channel map and enable bits, zero terminated */
+} tmf8x2xCacheEntry;
+
+/* hit / miss counters, of one process or summed up over all processes that used a directory */
+typedef struct _tmf8x2xCacheStats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t stores;
+    uint32_t storeErrors;       /* entry could not be written, e.g. directory not writable */
+    uint32_t rejected;          /* entry was found but broken or belongs to another input (hash collision), counted as miss as well */
+} tmf8x2xCacheStats;
+
+/* an opened cache directory */
+typedef struct _tmf8x2xCache
+{
+    char directory[ TMF8X2X_CACHE_DIR_SIZE ];
+    tmf8x2xCacheStats stats;
+    uint32_t storeCount;        /* part of the temporary names */
+    pthread_mutex_t lock;       /* protects stats and storeCount */
+} tmf8x2xCache;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xCacheOpen creates the cache directory if it does not exist and clears the statistics
+ * @param cache to set up
+ * @param directory of the cache
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the path is too long or the directory cannot be created, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xCacheOpen( tmf8x2xCache * cache, const char * directory );
+
+/**
+ * @brief tmf8x2xCacheClose appends the statistics of this process to <directory>/stats, see tmf8x2xCacheReport, and releases the lock
+ * @param cache to close
+ */
+void tmf8x2xCacheClose( tmf8x2xCache * cache );
+
+/**
+ * @brief tmf8x2xCacheKey computes the key of a SPAD map
+ * @param mask SPAD configuration in human readable format
+ * @param name of the SPAD setup, part of the rendered output
+ * @return 64-bit key
+ */
+uint64_t tmf8x2xCacheKey( const tmf8x2xSpadMask * mask, const char * name );
+
+/**
+ * @brief tmf8x2xCacheRender runs all checks on a SPAD map and renders all output formats, this is what a cache hit saves
+ * @param entry receives verdict, register image and output text (empty after errors)
+ * @param mask SPAD configuration in human readable format
+ * @param name of the SPAD setup
+ */
+void tmf8x2xCacheRender( tmf8x2xCacheEntry * entry, const tmf8x2xSpadMask * mask, const char * name );
+
+/**
+ * @brief tmf8x2xCacheValidate runs all checks on a SPAD map without rendering output, for users that need the verdict and the register image only
+ * @param entry receives verdict and register image, the output text stays empty
+ * @param mask SPAD configuration in human readable format
+ */
+void tmf8x2xCacheValidate( tmf8x2xCacheEntry * entry, const tmf8x2xSpadMask * mask );
+
+/**
+ * @brief tmf8x2xCacheLookup reads the entry of a SPAD map
+ * @param cache opened cache
+ * @param mask SPAD configuration in human readable format
+ * @param name of the SPAD setup
+ * @param entry receives the entry on a hit
+ * @return TMF8X2X_CACHE_HIT or TMF8X2X_CACHE_MISS
+ */
+uint8_t tmf8x2xCacheLookup( tmf8x2xCache * cache, const tmf8x2xSpadMask * mask, const char * name, tmf8x2xCacheEntry * entry );
+
+/**
+ * @brief tmf8x2xCacheStore writes the entry of a SPAD map, replacing an existing one atomically
+ * @param cache opened cache
+ * @param mask SPAD configuration in human readable format
+ * @param name of the SPAD setup
+ * @param entry filled by tmf8x2xCacheRender or tmf8x2xCacheValidate
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the entry could not be written, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xCacheStore( tmf8x2xCache * cache, const tmf8x2xSpadMask * mask, const char * name, const tmf8x2xCacheEntry * entry );
+
+/**
+ * @brief tmf8x2xCacheReport dumps size and summed up hit / miss statistics of a cache directory
+ * @param directory of the cache
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the directory cannot be read, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xCacheReport( const char * directory );
+
+#endif /* TMF8X2X_CACHE_H */
@@ -0,0 +1,318 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C++17
+ *
+ */
+
+/*! \file tmf8x2x_constexpr.hpp
+ *  \brief compile-time version of tmf8x2xValidateSpadMask, validates a SPAD map in firmware sources during the build.
+ *
+ * The constexpr functions follow tmf8x2xCreateMainSpad, tmf8x2xCheckMainSpadArea, tmf8x2xCheckMainSpadChannelSetup
+ * and tmf8x2xCheckMainSpadAssignment rule by rule. TMF8X2X_STATIC_SPAD_MAP fails the build with the name of the first
+ * failing check, and otherwise defines the packed tmf8x2xHalMainSpadConfig as a constant with C linkage:
+ *
+ *   // my_spad_map.cpp, compiled with c++ -std=c++17, channel map and enable mask top row first as in spad_tool
+ *   static constexpr uint8_t channels[ 18 * 6 ] = { ... };
+ *   static constexpr uint8_t enable[ 18 * 6 ] = { ... };
+ *   TMF8X2X_STATIC_SPAD_MAP( mySpadMap, channels, enable, 0, 0, 18, 6 );
+ *
+ *   // firmware C sources
+ *   extern const tmf8x2xHalMainSpadConfig mySpadMap;
+ *
+ * Neither the checks nor the conversion end up in the firmware image, only the constant.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+extern "C"
+{
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+}
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_CONSTEXPR_HPP
+#define TMF8X2X_CONSTEXPR_HPP
+
+/* checks a SPAD map at compile time and defines the packed configuration "name" with C linkage */
+#define TMF8X2X_STATIC_SPAD_MAP( name, channels, enable, xOffset_2, yOffset_2, xSize, ySize )                                                                     \
+    static_assert( tmf8x2x::validateSpadMask( channels, enable, xOffset_2, yOffset_2, xSize, ySize ) != TMF8X2X_VALIDATE_ERROR_CREATE,                           \
+                   #name ": basic checks and channel 0/1 / 8/9 assignment" );                                                                                   \
+    static_assert( tmf8x2x::validateSpadMask( channels, enable, xOffset_2, yOffset_2, xSize, ySize ) != TMF8X2X_VALIDATE_ERROR_AREA,                             \
+                   #name ": SPAD map out of bounds - size / offset" );                                                                                          \
+    static_assert( tmf8x2x::validateSpadMask( channels, enable, xOffset_2, yOffset_2, xSize, ySize ) != TMF8X2X_VALIDATE_ERROR_CHANNEL,                          \
+                   #name ": channel setup checks" );                                                                                                            \
+    static_assert( tmf8x2x::validateSpadMask( channels, enable, xOffset_2, yOffset_2, xSize, ySize ) != TMF8X2X_VALIDATE_ERROR_ASSIGNMENT,                       \
+                   #name ": SPAD assignment checks" );                                                                                                          \
+    static constexpr tmf8x2xHalMainSpadConfig name##Constexpr = tmf8x2x::createMainSpad( channels, enable, xOffset_2, yOffset_2, xSize, ySize ).config;       \
+    extern "C" const tmf8x2xHalMainSpadConfig name = name##Constexpr
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+namespace tmf8x2x
+{
+
+/* result of createMainSpad */
+struct CreatedSpadConfig
+{
+    tmf8x2xHalMainSpadConfig config;
+    bool ok;
+};
+
+/* same as mainSpadLlc / mainSpadUrc of tmf8x2x_spad_mask_tool.c, including the 8-bit parameter types */
+constexpr int mainSpadLlc ( uint8_t center_2, int8_t offset_2, uint8_t size )
+{
+    return ( center_2 + offset_2 - size ) / 2;
+}
+
+constexpr int mainSpadUrc ( uint8_t llc, uint8_t size )
+{
+    return llc + size - 1;
+}
+
+/**
+ * @brief createMainSpad packs a SPAD map like tmf8x2xCreateMainSpad
+ * @param channels channel map, top row first
+ * @param enable enable mask, top row first, any value > 0 enables a SPAD
+ * @param xOffset_2 center offset in x direction in Q1 format
+ * @param yOffset_2 center offset in y direction in Q1 format
+ * @param xSize SPAD map size in x direction, N has to be xSize * ySize
+ * @param ySize SPAD map size in y direction
+ * @return the packed configuration, ok is false where tmf8x2xCreateMainSpad returns 0
+ */
+template < size_t N >
+constexpr CreatedSpadConfig createMainSpad ( const uint8_t ( &channels )[ N ], const uint8_t ( &enable )[ N ], int8_t xOffset_2, int8_t yOffset_2, uint8_t xSize, uint8_t ySize )
+{
+    CreatedSpadConfig result = { {}, false };
+    tmf8x2xHalMainSpadConfig & config = result.config;
+    uint32_t conflict = 0;
+
+    if ( xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE || N != (size_t)xSize * ySize )
+    {
+        return result;
+    }
+    for ( uint8_t center = 0; center < 2; center++ )
+    {
+        int llcX = mainSpadLlc( center ? X_CENTER_2_B : X_CENTER_2_A, xOffset_2, xSize );
+        int llcY = mainSpadLlc( center ? Y_CENTER_2_B : Y_CENTER_2_A, yOffset_2, ySize );
+        if (  mainSpadUrc( (uint8_t)llcX, xSize ) - llcX >= TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE
+           || mainSpadUrc( (uint8_t)llcY, ySize ) - llcY >= TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE
+           )
+        {
+            return result;
+        }
+    }
+
+    for ( int y = 0; y < ySize; y++ )
+    {
+        int offset = ( ySize - 1 - y ) * xSize; /* the human readable map starts with the top row */
+        uint32_t low = 0;
+        uint32_t alt = 0;
+        for ( int x = 0; x < xSize; x++ )
+        {
+            uint8_t ch = channels[ offset + x ];
+            config.enableSpad[ y ] |= (uint32_t)( enable[ offset + x ] > 0 ) << x;
+            config.tdcChannel[ x ] |= TMF8X2X_MAIN_SPAD_ENCODE_CHANNEL( (uint32_t)ch, y );  /* 8 is encoded as 0, 9 as 1 */
+            low |= (uint32_t)( ch == 0 || ch == 1 ) << x;
+            alt |= (uint32_t)( ch == 8 || ch == 9 ) << x;
+        }
+        if ( alt )
+        {
+            config.tdcChannelSelect |= 1u << y;
+            conflict |= low;
+        }
+    }
+    config.xOffset_2 = xOffset_2;
+    config.yOffset_2 = yOffset_2;
+    config.xSize = xSize;
+    config.ySize = ySize;
+    result.ok = ( conflict == 0 );
+    return result;
+}
+
+/**
+ * @brief checkMainSpadArea same as tmf8x2xCheckMainSpadArea
+ * @param config configuration in machine readable format (packed)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if checks found an error, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+constexpr uint8_t checkMainSpadArea ( const tmf8x2xHalMainSpadConfig & config )
+{
+    for ( uint8_t odd = 0; odd < 2; odd++ )
+    {
+        int8_t llcX = (int8_t)mainSpadLlc( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE - odd, config.xOffset_2, config.xSize );
+        int8_t llcY = (int8_t)mainSpadLlc( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE - odd, config.yOffset_2, config.ySize );
+        if (  llcX < 0
+           || llcY < 0
+           || mainSpadUrc( (uint8_t)llcX, config.xSize ) >= TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE
+           || mainSpadUrc( (uint8_t)llcY, config.ySize ) >= TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE
+           )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/**
+ * @brief checkMainSpadChannelSetup same as tmf8x2xCheckMainSpadChannelSetup
+ * @param channels channel map
+ * @param count number of SPADs (xSize * ySize)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if checks found an error, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+constexpr uint8_t checkMainSpadChannelSetup ( const uint8_t * channels, size_t count )
+{
+    uint32_t spadsPerChannel[ TMF8X2X_NUMBER_OF_CHANNELS ] = {};
+
+    for ( size_t c = 0; c < count; c++ )
+    {
+        if ( channels[ c ] == 0 || channels[ c ] >= TMF8X2X_NUMBER_OF_CHANNELS )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+        spadsPerChannel[ channels[ c ] ]++;
+    }
+    if (  spadsPerChannel[ CHANNEL_2 ] + spadsPerChannel[ CHANNEL_3 ] == 0
+       || spadsPerChannel[ CHANNEL_4 ] + spadsPerChannel[ CHANNEL_5 ] == 0
+       || spadsPerChannel[ CHANNEL_6 ] + spadsPerChannel[ CHANNEL_7 ] == 0
+       || spadsPerChannel[ CHANNEL_8 ] + spadsPerChannel[ CHANNEL_9 ] == 0
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/* channel of SPAD x|y as the firmware decodes it from the packed configuration */
+constexpr uint8_t decodeChannel ( const tmf8x2xHalMainSpadConfig & config, int x, int y )
+{
+    uint8_t ch = (uint8_t)TMF8X2X_MAIN_SPAD_DECODE_CHANNEL( config.tdcChannel[ x ], y );
+    return ( ( config.tdcChannelSelect >> y ) & 1 ) && ch <= 1 ? (uint8_t)( ch + 8 ) : ch;
+}
+
+/**
+ * @brief checkMainSpadAssignment same as tmf8x2xCheckMainSpadAssignment: each used channel needs two adjacent enabled SPADs
+ * @param config configuration in machine readable format (packed)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if checks found an error, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+constexpr uint8_t checkMainSpadAssignment ( const tmf8x2xHalMainSpadConfig & config )
+{
+    bool used[ TMF8X2X_NUMBER_OF_CHANNELS ] = {};
+    bool adjacent[ TMF8X2X_NUMBER_OF_CHANNELS ] = {};
+
+    if (  config.xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE
+       || config.ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE
+       || config.xSize < 1
+       || config.ySize < 1
+       || ( config.xSize == 1 && config.ySize == 1 )  /* single SPAD are not allowed */
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    for ( int y = 0; y < config.ySize; y++ )
+    {
+        for ( int x = 0; x < config.xSize; x++ )
+        {
+            uint8_t ch = decodeChannel( config, x, y );
+            if ( ! ( ( config.enableSpad[ y ] >> x ) & 1 ) || ch >= TMF8X2X_NUMBER_OF_CHANNELS )
+            {
+                continue;
+            }
+            used[ ch ] = true;
+            for ( int n = 0; n < 4; n++ ) /* (x+1|y), (x-1|y+1), (x|y+1), (x+1|y+1), the other neighbours see this SPAD */
+            {
+                int nx = ( n == 0 ) ? x + 1 : x + n - 2;
+                int ny = ( n == 0 ) ? y : y + 1;
+                if (  nx >= 0 && nx < config.xSize && ny < config.ySize
+                   && ( ( config.enableSpad[ ny ] >> nx ) & 1 )
+                   && decodeChannel( config, nx, ny ) == ch
+                   )
+                {
+                    adjacent[ ch ] = true;
+                }
+            }
+        }
+    }
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        if ( used[ ch ] && ! adjacent[ ch ] )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/**
+ * @brief validateSpadMask same as tmf8x2xValidateSpadMask
+ * @param channels channel map, top row first
+ * @param enable enable mask, top row first
+ * @param xOffset_2 center offset in x direction in Q1 format
+ * @param yOffset_2 center offset in y direction in Q1 format
+ * @param xSize SPAD map size in x direction
+ * @param ySize SPAD map size in y direction
+ * @return TMF8X2X_VALIDATE_OK if all checks passed, otherwise the TMF8X2X_VALIDATE_ERROR_* code of the first failing check
+ */
+template < size_t N >
+constexpr uint8_t validateSpadMask ( const uint8_t ( &channels )[ N ], const uint8_t ( &enable )[ N ], int8_t xOffset_2, int8_t yOffset_2, uint8_t xSize, uint8_t ySize )
+{
+    CreatedSpadConfig created = createMainSpad( channels, enable, xOffset_2, yOffset_2, xSize, ySize );
+
+    if ( ! created.ok )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    if ( checkMainSpadArea( created.config ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_AREA;
+    }
+    if ( checkMainSpadChannelSetup( channels, N ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CHANNEL;
+    }
+    if ( checkMainSpadAssignment( created.config ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_ASSIGNMENT;
+    }
+    return TMF8X2X_VALIDATE_OK;
+}
+
+} /* namespace tmf8x2x */
+
+#endif /* TMF8X2X_CONSTEXPR_HPP */
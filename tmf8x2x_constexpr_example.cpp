@@ -0,0 +1,84 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD sample selection masks
+ *      $Revision: $
+ *      LANGUAGE:  C++17
+ *
+ */
+
+/*! \file tmf8x2x_constexpr_example.cpp
+ *  \brief the 3x3 checkerboard test SPAD map of tmf8x2x_test_masks.c, checked and packed at compile time.
+ *
+ * c++ -std=c++17 -c tmf8x2x_constexpr_example.cpp gives an object with the constant tmf8x2xTestSpadMap (C linkage),
+ * the build fails if the map does not pass all checks. Build with -DTMF8X2X_CONSTEXPR_EXAMPLE_BROKEN to see a failure.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include "tmf8x2x_constexpr.hpp"
+
+/*
+ *****************************************************************************
+ * TEST SPAD MAP, 3x3 checkerboard, 41° x 32°
+ *****************************************************************************
+ */
+
+static constexpr uint8_t testSpadMapChannel[ 18 * 6 ] =
+        /* x = 0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15 16 17 */
+/* y =  5 */ { 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3
+    /*  4 */ , 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3
+    /*  3 */ , 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6
+    /*  2 */ , 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6
+    /*  1 */ , 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9
+    /*  0 */ , 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9
+             };
+
+static constexpr uint8_t testSpadMapEnable[ 18 * 6 ] =
+    /* x = 0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15 16 17 */
+    /* y =  5 */ { 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0
+        /*  4 */ , 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1
+        /*  3 */ , 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0
+        /*  2 */ , 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1
+        /*  1 */ , 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0
+        /*  0 */ , 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1
+    };
+
+TMF8X2X_STATIC_SPAD_MAP( tmf8x2xTestSpadMap, testSpadMapChannel, testSpadMapEnable, 0, 0, 18, 6 );
+
+#ifdef TMF8X2X_CONSTEXPR_EXAMPLE_BROKEN
+/* channel 1 and channel 9 share the top row: the build stops with "basic checks and channel 0/1 / 8/9 assignment" */
+static constexpr uint8_t brokenSpadMapChannel[ 18 * 6 ] =
+             { 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 9, 9
+             , 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3
+             , 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6
+             , 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6
+             , 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9
+             , 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9
+             };
+
+TMF8X2X_STATIC_SPAD_MAP( tmf8x2xBrokenSpadMap, brokenSpadMapChannel, testSpadMapEnable, 0, 0, 18, 6 );
+#endif
@@ -0,0 +1,547 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_corpus.c
+ *  \brief binary SPAD mask corpus: fixed-size records that are validated in place from a memory mapped file.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L /* mmap, posix_madvise */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_batch.h"
+#include "tmf8x2x_pool.h"
+#include "tmf8x2x_corpus.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#if defined( __BYTE_ORDER__ ) && ( __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ )
+#error "corpus records are little endian and used in place, big endian hosts are not supported"
+#endif
+
+/* the records are used in place, the layout must not depend on the compiler */
+typedef char corpusHeaderSizeCheck[ ( sizeof( tmf8x2xCorpusHeader ) == TMF8X2X_CORPUS_HEADER_SIZE ) ? 1 : -1 ];
+typedef char corpusRecordSizeCheck[ ( sizeof( tmf8x2xCorpusRecord ) == TMF8X2X_CORPUS_RECORD_SIZE ) ? 1 : -1 ];
+
+/* records that are validated in parallel before their results are dumped */
+#define CORPUS_CHUNK_SIZE                   65536
+/* records a worker takes from its range at once */
+#define CORPUS_GRAIN                        256
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* state of tmf8x2xConvertBatchToCorpus, the records go to the file directly, index and names are written at the end */
+typedef struct _corpusWriter
+{
+    FILE * output;
+    uint32_t * index;
+    char * names;
+    uint32_t records;
+    uint32_t indexSize;         /* entries allocated */
+    uint32_t nameUsed;
+    uint32_t nameSize;          /* bytes allocated */
+    uint8_t error;              /* out of memory or write error */
+} corpusWriter;
+
+/* records of a chunk of the parallel corpus mode and their results */
+typedef struct _corpusChunk
+{
+    const tmf8x2xCorpusRecord * records;
+    uint8_t results[ CORPUS_CHUNK_SIZE ];
+} corpusChunk;
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief corpusCheckChunk pool task of tmf8x2xRunCorpus, validates records of a chunk in place
+ * @param context corpusChunk
+ * @param begin first record of the chunk
+ * @param end record after the last one
+ */
+static void corpusCheckChunk( void * context, uint32_t begin, uint32_t end );
+
+
+/**
+ * @brief corpusWriteRecord record handler of tmf8x2xConvertBatchToCorpus, appends a record and its name
+ * @param context corpusWriter
+ * @param index running number of the record in the stream
+ * @param name of the record
+ * @param mask SPAD map / mask of the record, 0 if it could not be parsed
+ * @return TMF8X2X_VALIDATE_OK if the record was written, TMF8X2X_VALIDATE_ERROR_CREATE otherwise
+ */
+static uint8_t corpusWriteRecord( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask );
+/**
+ * @brief corpusSection checks that a section of a corpus file starts at or after a given offset and ends inside the file, without overflow
+ * @param offset file offset of the section
+ * @param length of the section in bytes
+ * @param start first file offset the section may use (end of the previous section)
+ * @param size of the file
+ * @return 1 if the section fits, 0 otherwise
+ */
+static int corpusSection( uint64_t offset, uint64_t length, uint64_t start, uint64_t size );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static void corpusCheckChunk ( void * context, uint32_t begin, uint32_t end )
+{
+    corpusChunk * chunk = (corpusChunk *)context;
+    uint8_t channels[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];    /* scratch of this worker */
+    tmf8x2xHalMainSpadConfig cfg;
+
+    for ( uint32_t i = begin; i < end; i++ )
+    {
+        chunk->results[ i ] = tmf8x2xCorpusValidate( &cfg, &chunk->records[ i ], channels );
+    }
+}
+
+static uint8_t corpusWriteRecord ( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask )
+{
+    corpusWriter * writer = (corpusWriter *)context;
+    tmf8x2xCorpusRecord record;
+    uint32_t nameLength = (uint32_t)strlen( name ) + 1;
+    uint32_t xMask;
+
+    if ( ! mask )
+    {
+        dumpSignedDecimal( (int32_t)index );
+        dumpString( " " );
+        dumpString( name );
+        dumpString( " ERROR (record format), left out\n" );
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    if ( writer->error )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+
+    memset( &record, 0, sizeof( record ) );
+    xMask = ( 1u << mask->xSize ) - 1;
+    for ( uint8_t y = 0; y < mask->ySize; y++ )
+    {
+        record.enable[ y ] = mask->enable[ y ] & xMask;
+    }
+    record.xSize = mask->xSize;
+    record.ySize = mask->ySize;
+    record.xOffset_2 = mask->xOffset_2;
+    record.yOffset_2 = mask->yOffset_2;
+    for ( uint32_t i = 0; i < (uint32_t)mask->xSize * mask->ySize; i++ )
+    {
+        record.channels[ i / 2 ] |= (uint8_t)( ( mask->channels[ i ] & 0xF ) << ( ( i & 1 ) * 4 ) );
+    }
+
+    if ( writer->records == writer->indexSize )
+    {
+        uint32_t size = writer->indexSize ? 2 * writer->indexSize : 1024;
+        uint32_t * grown = (uint32_t *)realloc( writer->index, size * sizeof( uint32_t ) );
+        if ( ! grown )
+        {
+            writer->error = 1;
+            return TMF8X2X_VALIDATE_ERROR_CREATE;
+        }
+        writer->index = grown;
+        writer->indexSize = size;
+    }
+    while ( writer->nameUsed + nameLength > writer->nameSize )
+    {
+        uint32_t size = writer->nameSize ? 2 * writer->nameSize : 16384;
+        char * grown = (char *)realloc( writer->names, size );
+        if ( ! grown )
+        {
+            writer->error = 1;
+            return TMF8X2X_VALIDATE_ERROR_CREATE;
+        }
+        writer->names = grown;
+        writer->nameSize = size;
+    }
+    writer->index[ writer->records++ ] = writer->nameUsed;
+    memcpy( writer->names + writer->nameUsed, name, nameLength );
+    writer->nameUsed += nameLength;
+
+    if ( fwrite( &record, sizeof( record ), 1, writer->output ) != 1 )
+    {
+        writer->error = 1;
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    return TMF8X2X_VALIDATE_OK;
+}
+
+static int corpusSection ( uint64_t offset, uint64_t length, uint64_t start, uint64_t size )
+{
+    return offset >= start && offset <= size && length <= size - offset;
+}
+
+/*
+ *****************************************************************************
+ * CORPUS ACCESS
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xCorpusOpen ( tmf8x2xCorpus * corpus, const char * fileName )
+{
+    static const char magic[ 8 ] = { 'T', 'M', 'F', '8', 'X', '2', 'X', 'R' };
+    const tmf8x2xCorpusHeader * header;
+    struct stat info;
+    void * data;
+    uint64_t records;
+    uint64_t indexes;
+    int fd = open( fileName, O_RDONLY );
+
+    memset( corpus, 0, sizeof( *corpus ) );
+    if ( fd < 0 )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    if ( fstat( fd, &info ) != 0 || (uint64_t)info.st_size < TMF8X2X_CORPUS_HEADER_SIZE )
+    {
+        close( fd );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    data = mmap( 0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd ); /* the mapping stays valid */
+    if ( data == MAP_FAILED )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    posix_madvise( data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL );
+    corpus->data = (const uint8_t *)data;
+    corpus->size = (size_t)info.st_size;
+
+    /* all sections must be inside the file, in order and aligned for in place access, the name table must end with a zero.
+       The end of a section is only computed after the section was found inside the file, it cannot overflow. */
+    header = (const tmf8x2xCorpusHeader *)data;
+    records = (uint64_t)header->recordCount * TMF8X2X_CORPUS_RECORD_SIZE;
+    indexes = (uint64_t)header->recordCount * sizeof( uint32_t );
+    if (  memcmp( header->magic, magic, sizeof( magic ) ) != 0
+       || header->version != TMF8X2X_CORPUS_VERSION
+       || header->recordSize != TMF8X2X_CORPUS_RECORD_SIZE
+       || ( header->recordOffset & 7 ) != 0
+       || ! corpusSection( header->recordOffset, records, TMF8X2X_CORPUS_HEADER_SIZE, corpus->size )
+       || ( header->indexOffset & 3 ) != 0
+       || ! corpusSection( header->indexOffset, indexes, header->recordOffset + records, corpus->size )
+       || header->nameSize == 0
+       || ! corpusSection( header->nameOffset, header->nameSize, header->indexOffset + indexes, corpus->size )
+       || corpus->data[ header->nameOffset + header->nameSize - 1 ] != 0
+       )
+    {
+        tmf8x2xCorpusClose( corpus );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    corpus->header = header;
+    corpus->records = (const tmf8x2xCorpusRecord *)( corpus->data + header->recordOffset );
+    corpus->index = (const uint32_t *)( corpus->data + header->indexOffset );
+    corpus->names = (const char *)( corpus->data + header->nameOffset );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+void tmf8x2xCorpusClose ( tmf8x2xCorpus * corpus )
+{
+    if ( corpus->data )
+    {
+        munmap( (void *)corpus->data, corpus->size );
+    }
+    memset( corpus, 0, sizeof( *corpus ) );
+}
+
+const char * tmf8x2xCorpusName ( const tmf8x2xCorpus * corpus, uint32_t record )
+{
+    uint32_t offset = corpus->index[ record ];
+    return ( offset < corpus->header->nameSize ) ? corpus->names + offset : "-";
+}
+
+uint8_t tmf8x2xCorpusExpand ( tmf8x2xSpadMask * mask, const tmf8x2xCorpusRecord * record, uint8_t * channels )
+{
+    uint32_t spads = (uint32_t)record->xSize * record->ySize;
+
+    if ( record->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || record->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG; /* do not expand more channels than the scratch holds */
+    }
+    for ( uint32_t i = 0; i < spads; i += 2 )
+    {
+        uint8_t pair = record->channels[ i / 2 ];
+        channels[ i ] = pair & 0xF;
+        channels[ i + 1 ] = pair >> 4; /* odd sizes: one byte past the map, inside the scratch buffer */
+    }
+    mask->enable = record->enable;
+    mask->channels = channels;
+    mask->id = 0;
+    mask->xOffset_2 = record->xOffset_2;
+    mask->yOffset_2 = record->yOffset_2;
+    mask->xSize = record->xSize;
+    mask->ySize = record->ySize;
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xCorpusValidate ( tmf8x2xHalMainSpadConfig * config, const tmf8x2xCorpusRecord * record, uint8_t * channels )
+{
+    tmf8x2xSpadMask mask;
+
+    if ( tmf8x2xCorpusExpand( &mask, record, channels ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE; /* same result as tmf8x2xCreateMainSpad */
+    }
+    return tmf8x2xValidateSpadMask( config, &mask );
+}
+
+/*
+ *****************************************************************************
+ * CORPUS MODES
+ *****************************************************************************
+ */
+
+uint32_t tmf8x2xRunCorpus ( const char * fileName, uint32_t threads )
+{
+    static corpusChunk chunk;
+    static tmf8x2xPool pool;
+    tmf8x2xCorpus corpus;
+    uint32_t failed = 0;
+    uint64_t start;
+    uint64_t elapsed;
+
+    if ( tmf8x2xCorpusOpen( &corpus, fileName ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        dumpString( "ERROR reading SPAD corpus file.\n" );
+        return 1;
+    }
+
+    threads = tmf8x2xPoolThreads( threads );
+    start = tmf8x2xTimeNs();
+    if ( threads > 1 )
+    {
+        tmf8x2xPoolStart( &pool, threads );
+    }
+    for ( uint32_t first = 0; first < corpus.header->recordCount; first += CORPUS_CHUNK_SIZE )
+    {
+        uint32_t count = corpus.header->recordCount - first;
+        count = ( count > CORPUS_CHUNK_SIZE ) ? CORPUS_CHUNK_SIZE : count;
+        chunk.records = &corpus.records[ first ];
+        if ( threads > 1 )
+        {
+            tmf8x2xPoolSubmit( &pool, count, CORPUS_GRAIN, corpusCheckChunk, &chunk );
+            tmf8x2xPoolWait( &pool );
+        }
+        else
+        {
+            corpusCheckChunk( &chunk, 0, count );
+        }
+
+        for ( uint32_t i = 0; i < count; i++ )
+        {
+            if ( chunk.results[ i ] != TMF8X2X_VALIDATE_OK ) /* the passed records are only counted, a line each would cost more than the check */
+            {
+                failed++;
+                dumpSignedDecimal( (int32_t)( first + i ) );
+                dumpString( " " );
+                dumpString( tmf8x2xCorpusName( &corpus, first + i ) );
+                dumpString( " ERROR (" );
+                dumpString( tmf8x2xValidateResultName( chunk.results[ i ] ) );
+                dumpString( ")\n" );
+            }
+        }
+    }
+    if ( threads > 1 )
+    {
+        tmf8x2xPoolStop( &pool );
+    }
+    elapsed = tmf8x2xTimeNs() - start;
+
+    dumpString( "# records: " );
+    dumpSignedDecimal( (int32_t)corpus.header->recordCount );
+    dumpString( " ok: " );
+    dumpSignedDecimal( (int32_t)( corpus.header->recordCount - failed ) );
+    dumpString( " failed: " );
+    dumpSignedDecimal( (int32_t)failed );
+    dumpString( " time: " );
+    dumpUnsignedDecimal( elapsed / 1000u );
+    dumpString( " us throughput: " );
+    dumpSignedDecimal( (int32_t)( elapsed ? ( (uint64_t)corpus.header->recordCount * 1000000000u / elapsed ) : 0 ) );
+    dumpString( " records/s " );
+    dumpSignedDecimal( (int32_t)( elapsed ? ( (uint64_t)corpus.header->recordCount * TMF8X2X_CORPUS_RECORD_SIZE * 1000u / elapsed ) : 0 ) );
+    dumpString( " MB/s\n" );
+
+    tmf8x2xCorpusClose( &corpus );
+    return failed;
+}
+
+uint32_t tmf8x2xConvertBatchToCorpus ( FILE * input, const char * fileName )
+{
+    tmf8x2xCorpusHeader header;
+    corpusWriter writer;
+    uint32_t records;
+    uint32_t failed;
+
+    memset( &writer, 0, sizeof( writer ) );
+    memset( &header, 0, sizeof( header ) );
+    writer.output = fopen( fileName, "wb" );
+    if ( ! writer.output )
+    {
+        dumpString( "ERROR writing SPAD corpus file.\n" );
+        return 1;
+    }
+    writer.error = ( fwrite( &header, sizeof( header ), 1, writer.output ) != 1 ); /* filled in when the counts are known */
+
+    failed = tmf8x2xReadBatch( input, corpusWriteRecord, &writer, &records );
+
+    memcpy( header.magic, "TMF8X2XR", sizeof( header.magic ) );
+    header.version = TMF8X2X_CORPUS_VERSION;
+    header.recordSize = TMF8X2X_CORPUS_RECORD_SIZE;
+    header.recordCount = writer.records;
+    header.recordOffset = TMF8X2X_CORPUS_HEADER_SIZE;
+    header.indexOffset = header.recordOffset + (uint64_t)writer.records * TMF8X2X_CORPUS_RECORD_SIZE;
+    header.nameOffset = header.indexOffset + (uint64_t)writer.records * sizeof( uint32_t );
+    header.nameSize = writer.nameUsed ? writer.nameUsed : 1;
+    if ( ! writer.error )
+    {
+        writer.error |= ( writer.records && fwrite( writer.index, sizeof( uint32_t ), writer.records, writer.output ) != writer.records );
+        writer.error |= ( writer.nameUsed ? fwrite( writer.names, 1, writer.nameUsed, writer.output ) != writer.nameUsed : fputc( 0, writer.output ) == EOF );
+        writer.error |= ( fseek( writer.output, 0, SEEK_SET ) != 0 );
+        writer.error |= ( fwrite( &header, sizeof( header ), 1, writer.output ) != 1 );
+    }
+    writer.error |= ( fclose( writer.output ) != 0 );
+    free( writer.index );
+    free( writer.names );
+
+    if ( writer.error )
+    {
+        dumpString( "ERROR writing SPAD corpus file.\n" );
+        return 1;
+    }
+    dumpString( "# records: " );
+    dumpSignedDecimal( (int32_t)records );
+    dumpString( " written: " );
+    dumpSignedDecimal( (int32_t)writer.records );
+    dumpString( " left out: " );
+    dumpSignedDecimal( (int32_t)failed );
+    dumpString( "\n" );
+    return failed;
+}
+
+uint8_t tmf8x2xConvertCorpusToBatch ( const char * fileName, const char * textFileName )
+{
+    static tmf8x2xOutputSink sink;
+    tmf8x2xOutputSink * previous;
+    tmf8x2xCorpus corpus;
+    uint32_t records;
+    uint8_t error;
+    int fd;
+
+    if ( tmf8x2xCorpusOpen( &corpus, fileName ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        dumpString( "ERROR reading SPAD corpus file.\n" );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    fd = open( textFileName, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    if ( fd < 0 )
+    {
+        tmf8x2xCorpusClose( &corpus );
+        dumpString( "ERROR writing SPAD record file.\n" );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    /* the records are written with the dump functions, to the record file instead of stdout */
+    tmf8x2xSinkInitFd( &sink, fd );
+    previous = dumpSelectSink( &sink );
+    for ( uint32_t i = 0; i < corpus.header->recordCount; i++ )
+    {
+        const tmf8x2xCorpusRecord * record = &corpus.records[ i ];
+        uint32_t xSize = ( record->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE ) ? TMF8X2X_MAIN_SPAD_MAX_X_SIZE : record->xSize;
+        uint32_t ySize = ( record->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ) ? TMF8X2X_MAIN_SPAD_MAX_Y_SIZE : record->ySize;
+
+        dumpString( "map " );
+        dumpSignedDecimal( record->xOffset_2 );
+        dumpString( " " );
+        dumpSignedDecimal( record->yOffset_2 );
+        dumpString( " " );
+        dumpString( tmf8x2xCorpusName( &corpus, i ) );
+        dumpString( "\n" );
+        for ( uint32_t y = 0; y < ySize; y++ )
+        {
+            for ( uint32_t x = 0; x < xSize; x++ )
+            {
+                uint32_t c = y * xSize + x;
+                dumpString( x ? " " : "" );
+                dumpSignedDecimal( ( record->channels[ c / 2 ] >> ( ( c & 1 ) * 4 ) ) & 0xF );
+            }
+            dumpString( "\n" );
+        }
+        dumpString( "mask\n" );
+        for ( uint32_t y = 0; y < ySize; y++ )
+        {
+            for ( uint32_t x = 0; x < xSize; x++ )
+            {
+                dumpString( x ? " " : "" );
+                dumpSignedDecimal( ( record->enable[ y ] >> x ) & 1 );
+            }
+            dumpString( "\n" );
+        }
+    }
+    dumpFlush( );
+    dumpSelectSink( previous );
+    error = sink.error | ( close( fd ) != 0 );
+    records = corpus.header->recordCount;
+    tmf8x2xCorpusClose( &corpus );
+
+    if ( error )
+    {
+        dumpString( "ERROR writing SPAD record file.\n" );
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    dumpString( "# records: " );
+    dumpSignedDecimal( (int32_t)records );
+    dumpString( "\n" );
+    return TMF8X2X_SPAD_MAP_OK;
+}
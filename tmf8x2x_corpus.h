@@ -0,0 +1,182 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_corpus.h
+ *  \brief binary SPAD mask corpus: fixed-size records that are validated in place from a memory mapped file.
+ *
+ * File format, all numbers little endian:
+ *
+ *   header      TMF8X2X_CORPUS_HEADER_SIZE bytes, tmf8x2xCorpusHeader
+ *   records     recordCount x TMF8X2X_CORPUS_RECORD_SIZE bytes, tmf8x2xCorpusRecord
+ *   index       recordCount x uint32_t, offset of the name of each record in the name table
+ *   names       zero terminated record names
+ *
+ * A record holds sizes, Q1 offsets, the packed enable rows (same layout as tmf8x2xSpadMask::enable) and the channel
+ * map with two SPADs per byte (low nibble first, top row first).
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_CORPUS_H
+#define TMF8X2X_CORPUS_H
+
+#define TMF8X2X_CORPUS_VERSION              1
+#define TMF8X2X_CORPUS_HEADER_SIZE          64
+#define TMF8X2X_CORPUS_RECORD_SIZE          136
+/* bytes of the 4-bit packed channel map of a record */
+#define TMF8X2X_CORPUS_CHANNEL_BYTES        ( TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE / 2 )
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* start of a corpus file */
+typedef struct _tmf8x2xCorpusHeader
+{
+    char magic[ 8 ];                /* "TMF8X2XR" */
+    uint16_t version;               /* TMF8X2X_CORPUS_VERSION */
+    uint16_t recordSize;            /* TMF8X2X_CORPUS_RECORD_SIZE */
+    uint32_t recordCount;
+    uint64_t recordOffset;          /* file offsets of the sections */
+    uint64_t indexOffset;
+    uint64_t nameOffset;
+    uint64_t nameSize;
+    uint8_t reserved[ 16 ];
+} tmf8x2xCorpusHeader;
+
+/* one SPAD map / mask, the enable rows can be used as tmf8x2xSpadMask::enable directly */
+typedef struct _tmf8x2xCorpusRecord
+{
+    uint32_t enable[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];        /* packed enable bits, top row first */
+    uint8_t xSize;
+    uint8_t ySize;
+    int8_t xOffset_2;
+    int8_t yOffset_2;
+    uint8_t channels[ TMF8X2X_CORPUS_CHANNEL_BYTES ];       /* two channels per byte, low nibble first, top row first */
+    uint8_t reserved[ 2 ];
+} tmf8x2xCorpusRecord;
+
+/* an opened corpus file, all pointers point into the mapping */
+typedef struct _tmf8x2xCorpus
+{
+    const uint8_t * data;
+    size_t size;
+    const tmf8x2xCorpusHeader * header;
+    const tmf8x2xCorpusRecord * records;
+    const uint32_t * index;
+    const char * names;
+} tmf8x2xCorpus;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xCorpusOpen maps a corpus file into memory and checks header and section bounds
+ * @param corpus to set up
+ * @param fileName of the corpus
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the file cannot be mapped or is not a corpus of this version, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xCorpusOpen( tmf8x2xCorpus * corpus, const char * fileName );
+
+/**
+ * @brief tmf8x2xCorpusClose unmaps a corpus file
+ * @param corpus opened with tmf8x2xCorpusOpen
+ */
+void tmf8x2xCorpusClose( tmf8x2xCorpus * corpus );
+
+/**
+ * @brief tmf8x2xCorpusName returns the name of a record
+ * @param corpus opened corpus
+ * @param record number of the record
+ * @return name, "-" if the index entry is out of bounds
+ */
+const char * tmf8x2xCorpusName( const tmf8x2xCorpus * corpus, uint32_t record );
+
+/**
+ * @brief tmf8x2xCorpusExpand sets up a SPAD mask for a record: the enable rows are used in place, the channel nibbles are expanded into the scratch buffer
+ * @param mask receives the SPAD mask, valid as long as record and scratch buffer
+ * @param record to expand, e.g. in a corpus file or received from a client
+ * @param channels scratch buffer for the channel map, TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE bytes
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the record is larger than the SPAD array, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xCorpusExpand( tmf8x2xSpadMask * mask, const tmf8x2xCorpusRecord * record, uint8_t * channels );
+
+/**
+ * @brief tmf8x2xCorpusValidate runs tmf8x2xValidateSpadMask on a record in place, only the channel nibbles are expanded into the scratch buffer
+ * @param config receives the SPAD configuration in machine readable format (packed)
+ * @param record to validate
+ * @param channels scratch buffer for the channel map, TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE bytes
+ * @return TMF8X2X_VALIDATE_OK or the TMF8X2X_VALIDATE_ERROR_* code of the first failing check
+ */
+uint8_t tmf8x2xCorpusValidate( tmf8x2xHalMainSpadConfig * config, const tmf8x2xCorpusRecord * record, uint8_t * channels );
+
+/**
+ * @brief tmf8x2xRunCorpus validates all records of a corpus file, dumps a line for each failed record, followed by throughput statistics
+ * @param fileName of the corpus
+ * @param threads number of worker threads (up to TMF8X2X_POOL_MAX_THREADS), 0 for one per online CPU
+ * @return number of records that failed, 1 if the corpus cannot be opened
+ */
+uint32_t tmf8x2xRunCorpus( const char * fileName, uint32_t threads );
+
+/**
+ * @brief tmf8x2xConvertBatchToCorpus converts a stream of text records (see tmf8x2x_batch.h) to a corpus file
+ * @param input stream of records
+ * @param fileName of the corpus to write
+ * @return number of records that could not be parsed and were left out, 1 if the corpus cannot be written
+ */
+uint32_t tmf8x2xConvertBatchToCorpus( FILE * input, const char * fileName );
+
+/**
+ * @brief tmf8x2xConvertCorpusToBatch writes all records of a corpus file as text records (see tmf8x2x_batch.h), with a mask section each
+ * @param fileName of the corpus
+ * @param textFileName of the record file to write
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the corpus cannot be read or the record file cannot be written, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xConvertCorpusToBatch( const char * fileName, const char * textFileName );
+
+#endif /* TMF8X2X_CORPUS_H */
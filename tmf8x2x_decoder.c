@@ -0,0 +1,730 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_decoder.c
+ *  \brief reverse decoder, reconstructs human readable SPAD masks from I2C logs and C-struct dumps.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_decoder.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* longest line that is accepted in a decoder stream, a single burst of the register image needs about 340 characters */
+#define DECODE_LINE_SIZE                    1024
+/* longest configuration name */
+#define DECODE_NAME_SIZE                    64
+
+/* position of the values in a tmf8x2xHalMainSpadConfig initialiser */
+#define CSTRUCT_ENABLE_SPAD                 0
+#define CSTRUCT_TDC_CHANNEL                 ( CSTRUCT_ENABLE_SPAD + TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+#define CSTRUCT_TDC_CHANNEL_SELECT          ( CSTRUCT_TDC_CHANNEL + TMF8X2X_MAIN_SPAD_MAX_X_SIZE )
+#define CSTRUCT_X_OFFSET_2                  ( CSTRUCT_TDC_CHANNEL_SELECT + 1 )
+#define CSTRUCT_Y_OFFSET_2                  ( CSTRUCT_X_OFFSET_2 + 1 )
+#define CSTRUCT_X_SIZE                      ( CSTRUCT_Y_OFFSET_2 + 1 )
+#define CSTRUCT_Y_SIZE                      ( CSTRUCT_X_SIZE + 1 )
+
+/* largest value of the 24 bit registers */
+#define REGISTER_24_BIT_MAX                 0xffffff
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief isSpace checks for characters that separate tokens
+ * @param c character to check
+ * @return 1 for blanks and line ends, 0 otherwise
+ */
+static int isSpace( char c );
+
+/**
+ * @brief hexDigit converts a hex digit
+ * @param c character to convert
+ * @return value of the digit, or -1 if c is no hex digit
+ */
+static int hexDigit( char c );
+
+/**
+ * @brief nextToken finds the next blank separated token
+ * @param pos current position, is moved behind the token
+ * @param end end of the text
+ * @param token receives the start of the token
+ * @return length of the token, 0 at the end of the text
+ */
+static uint32_t nextToken( const char ** pos, const char * end, const char ** token );
+
+/**
+ * @brief parseHexByte converts a token of one or two hex digits (optionally with 0x prefix)
+ * @param token to convert
+ * @param length of the token
+ * @param value receives the byte
+ * @return 1 on success, 0 otherwise
+ */
+static int parseHexByte( const char * token, uint32_t length, uint8_t * value );
+
+/**
+ * @brief copyName copies a C identifier to a name buffer, "-" for an empty identifier
+ * @param name receives the name (DECODE_NAME_SIZE characters)
+ * @param text start of the identifier, leading blanks are skipped
+ */
+static void copyName( char * name, const char * text );
+
+/**
+ * @brief decodeFinish audits one decoded configuration and dumps the result line and the reconstructed SPAD map / mask
+ * @param index of the configuration in the stream
+ * @param name of the configuration
+ * @param format of the input ("i2c" or "cstruct")
+ * @param config decoded configuration, or 0 if decoding failed
+ * @param error description of the decoding error if config is 0
+ * @return TMF8X2X_VALIDATE_OK or the reason of the failure
+ */
+static uint8_t decodeFinish( uint32_t index, const char * name, const char * format, const tmf8x2xHalMainSpadConfig * config, const char * error );
+
+/**
+ * @brief dumpMatrixRows dumps a human readable matrix, one row per line
+ * @param matrix values, top row first
+ * @param xSize number of values per row
+ * @param ySize number of rows
+ */
+static void dumpMatrixRows( const uint8_t * matrix, uint8_t xSize, uint8_t ySize );
+
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static int isSpace ( char c )
+{
+    return ( c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f' );
+}
+
+static int hexDigit ( char c )
+{
+    if ( c >= '0' && c <= '9' )
+    {
+        return c - '0';
+    }
+    if ( c >= 'a' && c <= 'f' )
+    {
+        return c - 'a' + 10;
+    }
+    if ( c >= 'A' && c <= 'F' )
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static uint32_t nextToken ( const char ** pos, const char * end, const char ** token )
+{
+    const char * p = *pos;
+    while ( p < end && isSpace( *p ) )
+    {
+        p++;
+    }
+    *token = p;
+    while ( p < end && ! isSpace( *p ) )
+    {
+        p++;
+    }
+    *pos = p;
+    return (uint32_t)( p - *token );
+}
+
+static int parseHexByte ( const char * token, uint32_t length, uint8_t * value )
+{
+    uint32_t result = 0;
+    if ( length > 2 && token[ 0 ] == '0' && ( token[ 1 ] == 'x' || token[ 1 ] == 'X' ) )
+    {
+        token += 2;
+        length -= 2;
+    }
+    if ( length == 0 || length > 2 )
+    {
+        return 0;
+    }
+    for ( uint32_t i = 0; i < length; i++ )
+    {
+        int digit = hexDigit( token[ i ] );
+        if ( digit < 0 )
+        {
+            return 0;
+        }
+        result = ( result << 4 ) | (uint32_t)digit;
+    }
+    *value = (uint8_t)result;
+    return 1;
+}
+
+static void copyName ( char * name, const char * text )
+{
+    uint32_t length = 0;
+    while ( *text == ' ' || *text == '\t' )
+    {
+        text++;
+    }
+    while (  length < DECODE_NAME_SIZE - 1
+          && ( ( *text >= 'a' && *text <= 'z' ) || ( *text >= 'A' && *text <= 'Z' ) || ( *text >= '0' && *text <= '9' ) || *text == '_' )
+          )
+    {
+        name[ length++ ] = *text++;
+    }
+    if ( length == 0 )
+    {
+        name[ length++ ] = '-';
+    }
+    name[ length ] = 0;
+}
+
+/*
+ *****************************************************************************
+ * I2C LOGS
+ *****************************************************************************
+ */
+
+void tmf8x2xDecodeImageReset ( tmf8x2xDecodeImage * image )
+{
+    memset( image->written, 0, sizeof( image->written ) );
+    image->count = 0;
+}
+
+uint8_t tmf8x2xParseI2Cwrite ( const char * line, uint32_t length, uint8_t * reg, uint8_t * data, uint32_t * count )
+{
+    const char * end = line + length;
+    const char * token;
+    uint32_t tokenLength;
+    uint8_t address;
+
+    /* S <address> W <register> */
+    if (  nextToken( &line, end, &token ) != 1 || token[ 0 ] != 'S'
+       || ! parseHexByte( token, nextToken( &line, end, &token ), &address ) || address != TMF8X2X_DECODE_I2C_ADDRESS
+       || nextToken( &line, end, &token ) != 1 || token[ 0 ] != 'W'
+       || ! parseHexByte( token, nextToken( &line, end, &token ), reg )
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    /* data bytes up to the stop condition */
+    for ( *count = 0; ( tokenLength = nextToken( &line, end, &token ) ) != 0; ( *count )++ )
+    {
+        if ( tokenLength == 1 && token[ 0 ] == 'P' )
+        {
+            return TMF8X2X_SPAD_MAP_OK;
+        }
+        if ( *count == TMF8X2X_DECODE_I2C_DATA_SIZE || ! parseHexByte( token, tokenLength, &data[ *count ] ) )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_ERROR_CONFIG; /* stop condition is missing */
+}
+
+uint8_t tmf8x2xDecodeI2Cline ( tmf8x2xDecodeImage * image, const char * line, uint32_t length )
+{
+    uint8_t data[ TMF8X2X_DECODE_I2C_DATA_SIZE ];
+    uint32_t count;
+    uint8_t first;
+
+    if ( tmf8x2xParseI2Cwrite( line, length, &first, data, &count ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    /* data bytes are written to consecutive registers */
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+        uint32_t reg = (uint32_t)first + i;
+        if ( reg >= TMF8X2X_REGISTER_IMAGE_START && reg < TMF8X2X_REGISTER_IMAGE_START + TMF8X2X_REGISTER_IMAGE_SIZE )
+        {
+            uint32_t offset = TMF8X2X_REGISTER_IMAGE_OFFSET( reg );
+            image->image[ offset ] = data[ i ];
+            image->count += ! image->written[ offset ];
+            image->written[ offset ] = 1;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xDecodeI2Cstrings ( tmf8x2xHalMainSpadConfig * config, const char * text, uint32_t length )
+{
+    tmf8x2xDecodeImage image;
+    const char * end = text + length;
+
+    tmf8x2xDecodeImageReset( &image );
+    while ( text < end )
+    {
+        const char * lineEnd = memchr( text, '\n', (size_t)( end - text ) );
+        if ( ! lineEnd )
+        {
+            lineEnd = end;
+        }
+        (void)tmf8x2xDecodeI2Cline( &image, text, (uint32_t)( lineEnd - text ) ); /* other lines are comments */
+        text = lineEnd + 1;
+    }
+    if ( image.count != TMF8X2X_REGISTER_IMAGE_SIZE )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    tmf8x2xUnpackRegisterImage( config, image.image );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/*
+ *****************************************************************************
+ * C-STRUCT DUMPS
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xDecodeCstruct ( tmf8x2xHalMainSpadConfig * config, const char * text, uint32_t length )
+{
+    int64_t values[ TMF8X2X_DECODE_CSTRUCT_VALUES ];
+    const char * end = text + length;
+    uint32_t count = 0;
+
+    text = memchr( text, '{', length );
+    if ( ! text )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    text++;
+
+    for ( ;; )
+    {
+        int negative = 0;
+        uint64_t value = 0;
+
+        while ( text < end && ( isSpace( *text ) || *text == ',' ) )
+        {
+            text++;
+        }
+        if ( text + 1 < end && text[ 0 ] == '/' && text[ 1 ] == '*' ) /* comments with the member names */
+        {
+            const char * p = text + 2;
+            while ( p + 1 < end && ! ( p[ 0 ] == '*' && p[ 1 ] == '/' ) )
+            {
+                p++;
+            }
+            if ( p + 1 >= end )
+            {
+                return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+            }
+            text = p + 2;
+            continue;
+        }
+        if ( text + 1 < end && text[ 0 ] == '/' && text[ 1 ] == '/' )
+        {
+            while ( text < end && *text != '\n' )
+            {
+                text++;
+            }
+            continue;
+        }
+        if ( text >= end )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG; /* closing brace is missing */
+        }
+        if ( *text == '}' )
+        {
+            break;
+        }
+
+        if ( *text == '-' )
+        {
+            negative = 1;
+            text++;
+        }
+        if ( text + 2 < end && text[ 0 ] == '0' && ( text[ 1 ] == 'x' || text[ 1 ] == 'X' ) && hexDigit( text[ 2 ] ) >= 0 )
+        {
+            for ( text += 2; text < end && hexDigit( *text ) >= 0 && value <= UINT32_MAX; text++ )
+            {
+                value = ( value << 4 ) | (uint64_t)hexDigit( *text );
+            }
+        }
+        else if ( text < end && *text >= '0' && *text <= '9' )
+        {
+            for ( ; text < end && *text >= '0' && *text <= '9' && value <= UINT32_MAX; text++ )
+            {
+                value = value * 10 + (uint64_t)( *text - '0' );
+            }
+        }
+        else
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+        while ( text < end && ( *text == 'u' || *text == 'U' || *text == 'l' || *text == 'L' ) ) /* integer suffixes */
+        {
+            text++;
+        }
+        if ( value > UINT32_MAX || count >= TMF8X2X_DECODE_CSTRUCT_VALUES )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+        values[ count++ ] = negative ? -(int64_t)value : (int64_t)value;
+    }
+
+    if ( count != TMF8X2X_DECODE_CSTRUCT_VALUES )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    /* every value has to fit into its register */
+    for ( uint32_t i = 0; i < TMF8X2X_DECODE_CSTRUCT_VALUES; i++ )
+    {
+        int64_t min = 0;
+        int64_t max = UINT8_MAX;
+        if ( i < CSTRUCT_TDC_CHANNEL || i == CSTRUCT_TDC_CHANNEL_SELECT )
+        {
+            max = REGISTER_24_BIT_MAX;
+        }
+        else if ( i < CSTRUCT_TDC_CHANNEL_SELECT )
+        {
+            max = UINT32_MAX;
+        }
+        else if ( i == CSTRUCT_X_OFFSET_2 || i == CSTRUCT_Y_OFFSET_2 )
+        {
+            min = INT8_MIN;
+            max = INT8_MAX;
+        }
+        if ( values[ i ] < min || values[ i ] > max )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; i++ )
+    {
+        config->enableSpad[ i ] = (uint32_t)values[ CSTRUCT_ENABLE_SPAD + i ];
+    }
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; i++ )
+    {
+        config->tdcChannel[ i ] = (uint32_t)values[ CSTRUCT_TDC_CHANNEL + i ];
+    }
+    config->tdcChannelSelect = (uint32_t)values[ CSTRUCT_TDC_CHANNEL_SELECT ];
+    config->xOffset_2 = (int8_t)values[ CSTRUCT_X_OFFSET_2 ];
+    config->yOffset_2 = (int8_t)values[ CSTRUCT_Y_OFFSET_2 ];
+    config->xSize = (uint8_t)values[ CSTRUCT_X_SIZE ];
+    config->ySize = (uint8_t)values[ CSTRUCT_Y_SIZE ];
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/*
+ *****************************************************************************
+ * RECONSTRUCTION
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xReconstructSpadMask ( tmf8x2xSpadMaskStorage * storage, const tmf8x2xHalMainSpadConfig * config )
+{
+    uint8_t xSize = config->xSize;
+    uint8_t ySize = config->ySize;
+    uint32_t xMask = ( 1u << xSize ) - 1;
+
+    if (  xSize == 0 || xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE
+       || ySize == 0 || ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    for ( uint32_t y = 0; y < ySize; y++ )
+    {
+        uint32_t row = ySize - 1 - y; /* the human readable mask starts with the top row */
+        uint32_t enable = config->enableSpad[ y ] & xMask;
+        uint8_t alternate = ( config->tdcChannelSelect >> y ) & 1; /* channels 0/1 of this row are channels 8/9 */
+        uint8_t * channels = storage->channels + row * xSize;
+        uint8_t * enables = storage->enable + row * xSize;
+
+        storage->enablePacked[ row ] = enable;
+        for ( uint32_t x = 0; x < xSize; x++ )
+        {
+            uint8_t ch = (uint8_t)TMF8X2X_MAIN_SPAD_DECODE_CHANNEL( config->tdcChannel[ x ], y );
+            if ( alternate && ch < CHANNEL_2 )
+            {
+                ch += CHANNEL_8;
+            }
+            channels[ x ] = ch;
+            enables[ x ] = ( enable >> x ) & 1;
+        }
+    }
+
+    storage->mask.enable = storage->enablePacked;
+    storage->mask.channels = storage->channels;
+    storage->mask.id = 0;
+    storage->mask.xOffset_2 = config->xOffset_2;
+    storage->mask.yOffset_2 = config->yOffset_2;
+    storage->mask.xSize = xSize;
+    storage->mask.ySize = ySize;
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xAuditSpadConfig ( tmf8x2xSpadMaskStorage * storage, const tmf8x2xHalMainSpadConfig * config )
+{
+    tmf8x2xHalMainSpadConfig encoded;
+    uint8_t result;
+
+    if ( tmf8x2xReconstructSpadMask( storage, config ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    result = tmf8x2xValidateSpadMask( &encoded, &storage->mask );
+    if ( result != TMF8X2X_VALIDATE_OK )
+    {
+        return result;
+    }
+
+    /* stray bits outside of the map, or select bits of rows without channels 8/9 do not survive the round trip */
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; i++ )
+    {
+        if ( encoded.enableSpad[ i ] != config->enableSpad[ i ] )
+        {
+            return TMF8X2X_VALIDATE_ERROR_ROUND_TRIP;
+        }
+    }
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; i++ )
+    {
+        if ( encoded.tdcChannel[ i ] != config->tdcChannel[ i ] )
+        {
+            return TMF8X2X_VALIDATE_ERROR_ROUND_TRIP;
+        }
+    }
+    if (  encoded.tdcChannelSelect != config->tdcChannelSelect
+       || encoded.xOffset_2 != config->xOffset_2
+       || encoded.yOffset_2 != config->yOffset_2
+       || encoded.xSize != config->xSize
+       || encoded.ySize != config->ySize
+       )
+    {
+        return TMF8X2X_VALIDATE_ERROR_ROUND_TRIP;
+    }
+    return TMF8X2X_VALIDATE_OK;
+}
+
+/*
+ *****************************************************************************
+ * STREAM DECODING
+ *****************************************************************************
+ */
+
+static void dumpMatrixRows ( const uint8_t * matrix, uint8_t xSize, uint8_t ySize )
+{
+    char line[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * 2 + 1 ]; /* one digit and a blank per SPAD */
+
+    for ( uint32_t y = 0; y < ySize; y++ )
+    {
+        for ( uint32_t x = 0; x < xSize; x++ )
+        {
+            line[ 2 * x ] = (char)( '0' + matrix[ y * xSize + x ] );
+            line[ 2 * x + 1 ] = ( x + 1 < xSize ) ? ' ' : '\n';
+        }
+        line[ 2 * xSize ] = 0;
+        dumpString( line );
+    }
+}
+
+static uint8_t decodeFinish ( uint32_t index, const char * name, const char * format, const tmf8x2xHalMainSpadConfig * config, const char * error )
+{
+    static tmf8x2xSpadMaskStorage storage;
+    uint8_t result = TMF8X2X_VALIDATE_ERROR_CREATE;
+    uint8_t reconstructed = 0;
+
+    if ( config )
+    {
+        reconstructed = ( tmf8x2xReconstructSpadMask( &storage, config ) == TMF8X2X_SPAD_MAP_OK );
+        if ( reconstructed )
+        {
+            result = tmf8x2xAuditSpadConfig( &storage, config );
+            error = tmf8x2xValidateResultName( result );
+        }
+        else
+        {
+            error = "SPAD map size";
+        }
+    }
+
+    dumpString( "# " );
+    dumpSignedDecimal( (int32_t)index );
+    dumpString( " " );
+    dumpString( name );
+    dumpString( " " );
+    dumpString( format );
+    if ( result == TMF8X2X_VALIDATE_OK )
+    {
+        dumpString( " OK\n" );
+    }
+    else
+    {
+        dumpString( " ERROR (" );
+        dumpString( error );
+        dumpString( ")\n" );
+    }
+
+    /* the reconstructed SPAD map / mask in batch record format, also for configurations that fail the checks */
+    if ( reconstructed )
+    {
+        dumpString( "map " );
+        dumpSignedDecimal( config->xOffset_2 );
+        dumpString( " " );
+        dumpSignedDecimal( config->yOffset_2 );
+        dumpString( " " );
+        dumpString( name );
+        dumpString( "\n" );
+        dumpMatrixRows( storage.channels, config->xSize, config->ySize );
+        dumpString( "mask\n" );
+        dumpMatrixRows( storage.enable, config->xSize, config->ySize );
+    }
+    dumpString( "\n" );
+    return result;
+}
+
+uint32_t tmf8x2xRunDecode ( FILE * input )
+{
+    static tmf8x2xDecodeImage image;
+    static char text[ TMF8X2X_DECODE_TEXT_SIZE ];
+    char line[ DECODE_LINE_SIZE ];
+    char i2cName[ DECODE_NAME_SIZE ] = "-";
+    char structName[ DECODE_NAME_SIZE ] = "-";
+    tmf8x2xHalMainSpadConfig config;
+    uint32_t textLength = 0;
+    uint8_t inStruct = 0;
+    uint32_t configs = 0;
+    uint32_t failed = 0;
+    uint64_t start = tmf8x2xTimeNs();
+    uint64_t elapsed;
+
+    tmf8x2xDecodeImageReset( &image );
+
+    while ( fgets( line, sizeof( line ), input ) )
+    {
+        const char * p = line;
+        size_t length = strlen( line );
+        const char * type;
+
+        if ( inStruct )
+        {
+            if ( textLength + length < sizeof( text ) )
+            {
+                memcpy( text + textLength, line, length );
+                textLength += (uint32_t)length;
+            }
+            if ( strchr( line, '}' ) )
+            {
+                uint8_t ok = ( tmf8x2xDecodeCstruct( &config, text, textLength ) == TMF8X2X_SPAD_MAP_OK );
+                failed += ( decodeFinish( configs++, structName, "cstruct", ok ? &config : 0, "C-struct format" ) != TMF8X2X_VALIDATE_OK );
+                inStruct = 0;
+            }
+            continue;
+        }
+
+        while ( *p == ' ' || *p == '\t' )
+        {
+            p++;
+        }
+        if ( p[ 0 ] == 'S' && ( p[ 1 ] == ' ' || p[ 1 ] == '\t' ) )
+        {
+            if ( tmf8x2xDecodeI2Cline( &image, p, (uint32_t)( length - (size_t)( p - line ) ) ) == TMF8X2X_SPAD_MAP_OK && image.count == TMF8X2X_REGISTER_IMAGE_SIZE )
+            {
+                tmf8x2xUnpackRegisterImage( &config, image.image );
+                failed += ( decodeFinish( configs++, i2cName, "i2c", &config, 0 ) != TMF8X2X_VALIDATE_OK );
+                tmf8x2xDecodeImageReset( &image );
+                strcpy( i2cName, "-" );
+            }
+            continue;
+        }
+
+        type = strstr( p, "tmf8x2xHalMainSpadConfig" );
+        if ( ! type )
+        {
+            continue;
+        }
+        if ( p[ 0 ] == '#' ) /* name of the following I2C writes */
+        {
+            if ( image.count )
+            {
+                failed += ( decodeFinish( configs++, i2cName, "i2c", 0, "incomplete register image" ) != TMF8X2X_VALIDATE_OK );
+                tmf8x2xDecodeImageReset( &image );
+            }
+            copyName( i2cName, type + strlen( "tmf8x2xHalMainSpadConfig" ) );
+        }
+        else if ( strchr( type, '=' ) ) /* start of a C-struct initialiser */
+        {
+            const char * body = strchr( type, '=' ) + 1;
+            copyName( structName, type + strlen( "tmf8x2xHalMainSpadConfig" ) );
+            textLength = (uint32_t)strlen( body );
+            memcpy( text, body, textLength );
+            inStruct = 1;
+            if ( strchr( body, '}' ) )
+            {
+                uint8_t ok = ( tmf8x2xDecodeCstruct( &config, text, textLength ) == TMF8X2X_SPAD_MAP_OK );
+                failed += ( decodeFinish( configs++, structName, "cstruct", ok ? &config : 0, "C-struct format" ) != TMF8X2X_VALIDATE_OK );
+                inStruct = 0;
+            }
+        }
+    }
+    if ( inStruct )
+    {
+        failed += ( decodeFinish( configs++, structName, "cstruct", 0, "C-struct format" ) != TMF8X2X_VALIDATE_OK );
+    }
+    if ( image.count )
+    {
+        failed += ( decodeFinish( configs++, i2cName, "i2c", 0, "incomplete register image" ) != TMF8X2X_VALIDATE_OK );
+    }
+
+    elapsed = tmf8x2xTimeNs() - start;
+    dumpString( "# configs: " );
+    dumpSignedDecimal( (int32_t)configs );
+    dumpString( " ok: " );
+    dumpSignedDecimal( (int32_t)( configs - failed ) );
+    dumpString( " failed: " );
+    dumpSignedDecimal( (int32_t)failed );
+    dumpString( " time: " );
+    dumpUnsignedDecimal( elapsed / 1000u );
+    dumpString( " us throughput: " );
+    dumpSignedDecimal( (int32_t)( elapsed ? ( (uint64_t)configs * 1000000000u / elapsed ) : 0 ) );
+    dumpString( " configs/s\n" );
+
+    return failed;
+}
@@ -0,0 +1,165 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_decoder.h
+ *  \brief reverse decoder, reconstructs human readable SPAD masks from I2C logs and C-struct dumps.
+ *
+ * Accepted input formats, as produced by dumpMainSpadConfigAsI2Cstrings, dumpMainSpadConfigAsI2Cburst and dumpMainSpadConfigAsCstruct:
+ *
+ *   S 41 W <register> <data bytes> P               any number of writes that together cover the registers 0x24..0x90
+ *   const tmf8x2xHalMainSpadConfig <name> = { ... };   33 numbers in structure order, C comments are allowed
+ *
+ * In a stream a register image is complete as soon as all of its bytes were written. A comment line
+ * "# tmf8x2xHalMainSpadConfig <name>" names the following I2C writes, all other lines are ignored. The output of
+ * spad_tool can therefore be decoded directly.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_register_image.h"
+#include "tmf8x2x_spad_parser.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_DECODER_H
+#define TMF8X2X_DECODER_H
+
+/* 7-bit I2C address of the TMF882x as written in the I2C logs */
+#define TMF8X2X_DECODE_I2C_ADDRESS          0x41
+
+/* most data bytes of one I2C write, a write covers at most the 8-bit register address space */
+#define TMF8X2X_DECODE_I2C_DATA_SIZE        256
+
+/* number of values in a tmf8x2xHalMainSpadConfig initialiser */
+#define TMF8X2X_DECODE_CSTRUCT_VALUES       ( TMF8X2X_MAIN_SPAD_MAX_Y_SIZE + TMF8X2X_MAIN_SPAD_MAX_X_SIZE + 5 )
+
+/* largest C-struct initialiser that is accepted in a stream */
+#define TMF8X2X_DECODE_TEXT_SIZE            2048
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* register image that is assembled from single I2C writes */
+typedef struct _tmf8x2xDecodeImage
+{
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    uint8_t written[ TMF8X2X_REGISTER_IMAGE_SIZE ];     /* 1 for each byte of the image that was written */
+    uint32_t count;                                     /* number of different bytes written */
+} tmf8x2xDecodeImage;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xDecodeImageReset marks all bytes of the register image as not written
+ * @param image register image to reset
+ */
+void tmf8x2xDecodeImageReset( tmf8x2xDecodeImage * image );
+
+/**
+ * @brief tmf8x2xParseI2Cwrite parses one I2C write "S 41 W <register> <data bytes> P"
+ * @param line text of the line, does not need to be zero terminated
+ * @param length of the line in characters
+ * @param reg receives the first register
+ * @param data receives the data bytes, TMF8X2X_DECODE_I2C_DATA_SIZE bytes
+ * @param count receives the number of data bytes
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the line is not an I2C write to the TMF882x, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xParseI2Cwrite( const char * line, uint32_t length, uint8_t * reg, uint8_t * data, uint32_t * count );
+
+/**
+ * @brief tmf8x2xDecodeI2Cline applies one I2C write "S 41 W <register> <data bytes> P" to the register image.
+ * Bytes for registers outside of the SPAD configuration are ignored.
+ * @param image register image
+ * @param line text of the line, does not need to be zero terminated
+ * @param length of the line in characters
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the line is not an I2C write to the TMF882x, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xDecodeI2Cline( tmf8x2xDecodeImage * image, const char * line, uint32_t length );
+
+/**
+ * @brief tmf8x2xDecodeI2Cstrings decodes a SPAD configuration from the I2C writes in a text, other lines are ignored
+ * @param config receives the SPAD configuration in machine readable format (packed)
+ * @param text with the I2C writes, does not need to be zero terminated
+ * @param length of the text in characters
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the writes do not cover all registers 0x24..0x90, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xDecodeI2Cstrings( tmf8x2xHalMainSpadConfig * config, const char * text, uint32_t length );
+
+/**
+ * @brief tmf8x2xDecodeCstruct decodes a SPAD configuration from a tmf8x2xHalMainSpadConfig initialiser, parsing starts at the first '{'
+ * @param config receives the SPAD configuration in machine readable format (packed)
+ * @param text with the initialiser, does not need to be zero terminated
+ * @param length of the text in characters
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG for syntax errors, a wrong number of values or values that do not fit their register, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xDecodeCstruct( tmf8x2xHalMainSpadConfig * config, const char * text, uint32_t length );
+
+/**
+ * @brief tmf8x2xReconstructSpadMask builds the human readable SPAD mask of a SPAD configuration.
+ * Channels 0/1 in rows with a set tdcChannelSelect bit are restored as channels 8/9.
+ * @param storage receives the human readable mask, storage->mask is ready for tmf8x2xCreateMainSpad afterwards
+ * @param config SPAD configuration in machine readable format (packed)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the size of the configuration is out of range, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xReconstructSpadMask( tmf8x2xSpadMaskStorage * storage, const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xAuditSpadConfig reconstructs the human readable SPAD mask, runs all checks on it and verifies that it encodes to the same configuration again
+ * @param storage receives the human readable mask
+ * @param config SPAD configuration in machine readable format (packed)
+ * @return TMF8X2X_VALIDATE_OK, the first check that failed (TMF8X2X_VALIDATE_ERROR_*) or TMF8X2X_VALIDATE_ERROR_ROUND_TRIP
+ */
+uint8_t tmf8x2xAuditSpadConfig( tmf8x2xSpadMaskStorage * storage, const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xRunDecode decodes all configurations in a stream of I2C logs / C-struct dumps, dumps a result line and the reconstructed
+ * SPAD map / mask (in batch record format) per configuration, followed by statistics
+ * @param input stream with I2C logs and / or C-struct dumps
+ * @return number of configurations that failed (decoding, checks or round trip)
+ */
+uint32_t tmf8x2xRunDecode( FILE * input );
+
+#endif /* TMF8X2X_DECODER_H */
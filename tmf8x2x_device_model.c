@@ -0,0 +1,575 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_device_model.c
+ *  \brief virtual TMF882x register file with an I2C bus time model, measures what applying a SPAD map costs without hardware.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_register_image.h"
+#include "tmf8x2x_decoder.h"
+#include "tmf8x2x_batch.h"
+#include "tmf8x2x_spad_lib.h"
+#include "tmf8x2x_device_model.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* text of a stream that is split into lines at once, longer lines are dropped */
+#define DEVICE_BUFFER_SIZE                  8192
+/* longest configuration name */
+#define DEVICE_NAME_SIZE                    64
+
+/* clock cycles of one byte on the bus: 8 bits and the ACK */
+#define I2C_CYCLES_PER_BYTE                 9
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* timing of a bus speed, minimum values of the I2C specification in ns */
+typedef struct _i2cTiming
+{
+    uint32_t hz;
+    uint32_t cycleNs;               /* SCL period */
+    uint32_t startHoldNs;           /* tHD;STA */
+    uint32_t stopSetupNs;           /* tSU;STO */
+    uint32_t busFreeNs;             /* tBUF, between a stop and the next start */
+} i2cTiming;
+
+/* counters of the model at the start of a configuration */
+typedef struct _deviceSegment
+{
+    char name[ DEVICE_NAME_SIZE ];
+    uint32_t transfers;
+    uint32_t bytes;
+    uint64_t busNs[ TMF8X2X_I2C_SPEEDS ];
+} deviceSegment;
+
+/* state of the register delta mode between the records, see tmf8x2xRunRegisterDelta */
+typedef struct _deviceDeltaRun
+{
+    tmf8x2xHalMainSpadConfig loaded;                /* configuration of the last valid record */
+    uint8_t hasLoaded;
+    tmf8x2xI2cCost totals;                          /* writes of all valid records */
+} deviceDeltaRun;
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+static const i2cTiming i2cTimings[ TMF8X2X_I2C_SPEEDS ] =
+{ {  100000, 10000, 4000, 4000, 4700 }     /* standard mode */
+, {  400000,  2500,  600,  600, 1300 }     /* fast mode */
+, { 1000000,  1000,  260,  260,  500 }     /* fast mode plus */
+};
+
+static const char * const i2cSpeedNames[ TMF8X2X_I2C_SPEEDS ] = { "100 kHz", "400 kHz", "1 MHz" };
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief deviceStartSegment starts a configuration at the current counters of the model
+ * @param segment to start
+ * @param model register file
+ * @param name of the configuration
+ */
+static void deviceStartSegment( deviceSegment * segment, const tmf8x2xDeviceModel * model, const char * name );
+/**
+ * @brief deviceDumpMicroseconds dumps a bus time in us with one decimal
+ * @param ns bus time in nanoseconds
+ */
+static void deviceDumpMicroseconds( uint64_t ns );
+/**
+ * @brief deviceDumpBusTime dumps transfers, bytes and bus time at all speeds since the start of a configuration
+ * @param model register file
+ * @param segment counters at the start, all zero for the totals
+ */
+static void deviceDumpBusTime( const tmf8x2xDeviceModel * model, const deviceSegment * segment );
+/**
+ * @brief deviceFinishSegment dumps the line of a configuration: what its writes cost and the check result of the registers afterwards
+ * @param model register file
+ * @param segment counters at the start of the configuration
+ * @param index running number of the configuration
+ * @return TMF8X2X_VALIDATE_OK, the first check that failed or TMF8X2X_VALIDATE_ERROR_CREATE if the registers are incomplete
+ */
+static uint8_t deviceFinishSegment( const tmf8x2xDeviceModel * model, const deviceSegment * segment, uint32_t index );
+/**
+ * @brief deviceTextLine applies a line of a text stream, a configuration name line ends the configuration before
+ * @param model register file
+ * @param segment current configuration
+ * @param line zero terminated
+ * @param configs running number of the configurations, incremented for each finished one
+ * @return number of configurations that failed (0 or 1)
+ */
+static uint32_t deviceTextLine( tmf8x2xDeviceModel * model, deviceSegment * segment, const char * line, uint32_t * configs );
+/**
+ * @brief deviceDeltaRecord tmf8x2xBatchHandler of the register delta mode: dumps the writes from the last valid record to this one
+ * @param context deviceDeltaRun
+ * @param index of the record
+ * @param name of the record
+ * @param mask SPAD mask, 0 if the record could not be parsed
+ * @return TMF8X2X_VALIDATE_OK or the first check that failed
+ */
+static uint8_t deviceDeltaRecord( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static void deviceStartSegment ( deviceSegment * segment, const tmf8x2xDeviceModel * model, const char * name )
+{
+    strcpy( segment->name, name );
+    segment->transfers = model->transfers;
+    segment->bytes = model->bytes;
+    memcpy( segment->busNs, model->busNs, sizeof( segment->busNs ) );
+}
+
+static void deviceDumpMicroseconds ( uint64_t ns )
+{
+    uint64_t tenths = ( ns + 50 ) / 100; /* us with one decimal */
+
+    dumpSignedDecimal( (int32_t)( tenths / 10 ) );
+    dumpString( "." );
+    dumpSignedDecimal( (int32_t)( tenths % 10 ) );
+    dumpString( " us" );
+}
+
+static void deviceDumpBusTime ( const tmf8x2xDeviceModel * model, const deviceSegment * segment )
+{
+    dumpString( " transfers: " );
+    dumpSignedDecimal( (int32_t)( model->transfers - segment->transfers ) );
+    dumpString( " bytes: " );
+    dumpSignedDecimal( (int32_t)( model->bytes - segment->bytes ) );
+    for ( uint8_t speed = 0; speed < TMF8X2X_I2C_SPEEDS; speed++ )
+    {
+        dumpString( " " );
+        dumpString( i2cSpeedNames[ speed ] );
+        dumpString( ": " );
+        deviceDumpMicroseconds( model->busNs[ speed ] - segment->busNs[ speed ] );
+    }
+}
+
+static uint8_t deviceFinishSegment ( const tmf8x2xDeviceModel * model, const deviceSegment * segment, uint32_t index )
+{
+    static tmf8x2xSpadMaskStorage storage;
+    tmf8x2xHalMainSpadConfig config;
+    uint8_t result = TMF8X2X_VALIDATE_ERROR_CREATE;
+    const char * error = "incomplete register image";
+
+    if ( tmf8x2xDeviceModelDecode( model, &config ) == TMF8X2X_SPAD_MAP_OK )
+    {
+        if ( tmf8x2xReconstructSpadMask( &storage, &config ) == TMF8X2X_SPAD_MAP_OK )
+        {
+            result = tmf8x2xAuditSpadConfig( &storage, &config );
+            error = tmf8x2xValidateResultName( result );
+        }
+        else
+        {
+            error = "SPAD map size";
+        }
+    }
+
+    dumpString( "# " );
+    dumpSignedDecimal( (int32_t)index );
+    dumpString( " " );
+    dumpString( segment->name );
+    deviceDumpBusTime( model, segment );
+    if ( result == TMF8X2X_VALIDATE_OK )
+    {
+        dumpString( " OK\n" );
+    }
+    else
+    {
+        dumpString( " ERROR (" );
+        dumpString( error );
+        dumpString( ")\n" );
+    }
+    return result;
+}
+
+static uint32_t deviceTextLine ( tmf8x2xDeviceModel * model, deviceSegment * segment, const char * line, uint32_t * configs )
+{
+    const char * p = line;
+    const char * type;
+    char name[ DEVICE_NAME_SIZE ];
+    uint32_t failed = 0;
+
+    while ( *p == ' ' || *p == '\t' )
+    {
+        p++;
+    }
+    if ( p[ 0 ] == 'S' && ( p[ 1 ] == ' ' || p[ 1 ] == '\t' ) )
+    {
+        (void)tmf8x2xDeviceModelI2Cline( model, p, (uint32_t)strlen( p ) ); /* reads and other devices are not modelled */
+        return 0;
+    }
+    type = strstr( p, "tmf8x2xHalMainSpadConfig" );
+    if ( p[ 0 ] != '#' || ! type ) /* comment lines other than the name of the following I2C writes */
+    {
+        return 0;
+    }
+    if ( model->transfers != segment->transfers )
+    {
+        failed = ( deviceFinishSegment( model, segment, ( *configs )++ ) != TMF8X2X_VALIDATE_OK );
+    }
+    if ( sscanf( type + strlen( "tmf8x2xHalMainSpadConfig" ), " %63[^, \t\r\n]", name ) != 1 )
+    {
+        strcpy( name, "-" );
+    }
+    deviceStartSegment( segment, model, name );
+    return failed;
+}
+
+static uint8_t deviceDeltaRecord ( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask )
+{
+    deviceDeltaRun * run = (deviceDeltaRun *)context;
+    tmf8x2xHalMainSpadConfig config;
+    tmf8x2xLibStatus status;
+
+    if ( ! mask || tmf8x2xLibValidateMask( &config, mask, &status ) != TMF8X2X_LIB_OK )
+    {
+        dumpString( "# " );
+        dumpSignedDecimal( (int32_t)index );
+        dumpString( " " );
+        dumpString( name );
+        dumpString( " ERROR (" );
+        dumpString( mask ? tmf8x2xValidateResultName( status.check ) : "record format" );
+        dumpString( ")\n\n" );
+        return mask ? status.check : TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    tmf8x2xDumpRegisterDelta( index, name, run->hasLoaded ? &run->loaded : 0, &config, &run->totals );
+    run->loaded = config;
+    run->hasLoaded = 1;
+    return TMF8X2X_VALIDATE_OK;
+}
+
+/*
+ *****************************************************************************
+ * I2C BUS TIME
+ *****************************************************************************
+ */
+
+uint32_t tmf8x2xI2cSpeedHz ( uint8_t speed )
+{
+    return i2cTimings[ speed ].hz;
+}
+
+uint32_t tmf8x2xI2cWriteNs ( uint8_t speed, uint32_t dataBytes )
+{
+    const i2cTiming * timing = &i2cTimings[ speed ];
+
+    return ( TMF8X2X_I2C_WRITE_HEADER_BYTES + dataBytes ) * I2C_CYCLES_PER_BYTE * timing->cycleNs
+         + timing->startHoldNs + timing->stopSetupNs + timing->busFreeNs;
+}
+
+uint32_t tmf8x2xI2cMergeGap ( uint8_t speed )
+{
+    /* a second transfer costs the header bytes and the start, stop and bus free time: tmf8x2xI2cWriteNs( speed, 0 ) */
+    return ( tmf8x2xI2cWriteNs( speed, 0 ) - 1 ) / ( I2C_CYCLES_PER_BYTE * i2cTimings[ speed ].cycleNs );
+}
+
+uint32_t tmf8x2xI2cDeltaNs ( uint8_t speed, const tmf8x2xRegisterDelta * delta )
+{
+    uint32_t ns = 0;
+
+    for ( uint32_t w = 0; w < delta->count; w++ )
+    {
+        ns += tmf8x2xI2cWriteNs( speed, delta->writes[ w ].length );
+    }
+    return ns;
+}
+
+void tmf8x2xAddI2cCost ( tmf8x2xI2cCost * cost, const tmf8x2xRegisterDelta * delta )
+{
+    cost->configs++;
+    cost->transfers += delta->count;
+    cost->bytes += delta->count * TMF8X2X_I2C_WRITE_HEADER_BYTES + delta->bytes;
+    for ( uint8_t speed = 0; speed < TMF8X2X_I2C_SPEEDS; speed++ )
+    {
+        cost->busNs[ speed ] += tmf8x2xI2cDeltaNs( speed, delta );
+    }
+}
+
+void tmf8x2xDumpI2cCost ( const tmf8x2xI2cCost * cost )
+{
+    dumpString( " transfers: " );
+    dumpSignedDecimal( (int32_t)cost->transfers );
+    dumpString( " bytes: " );
+    dumpSignedDecimal( (int32_t)cost->bytes );
+    dumpString( " (burst " );
+    dumpSignedDecimal( (int32_t)( cost->configs * ( TMF8X2X_I2C_WRITE_HEADER_BYTES + TMF8X2X_REGISTER_IMAGE_SIZE ) ) );
+    dumpString( ")" );
+    for ( uint8_t speed = 0; speed < TMF8X2X_I2C_SPEEDS; speed++ )
+    {
+        uint64_t burstNs = (uint64_t)cost->configs * tmf8x2xI2cWriteNs( speed, TMF8X2X_REGISTER_IMAGE_SIZE );
+        dumpString( " " );
+        dumpString( i2cSpeedNames[ speed ] );
+        dumpString( ": " );
+        deviceDumpMicroseconds( cost->busNs[ speed ] );
+        dumpString( " (burst " );
+        deviceDumpMicroseconds( burstNs );
+        dumpString( ", saves " );
+        deviceDumpMicroseconds( burstNs > cost->busNs[ speed ] ? burstNs - cost->busNs[ speed ] : 0 );
+        dumpString( ")" );
+    }
+    dumpString( "\n" );
+}
+
+/*
+ *****************************************************************************
+ * REGISTER FILE
+ *****************************************************************************
+ */
+
+void tmf8x2xDeviceModelReset ( tmf8x2xDeviceModel * model )
+{
+    memset( model, 0, sizeof( *model ) );
+}
+
+void tmf8x2xDeviceModelWrite ( tmf8x2xDeviceModel * model, uint8_t reg, const uint8_t * data, uint32_t count )
+{
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+        uint8_t address = (uint8_t)( reg + i ); /* the register address wraps around */
+        model->registers[ address ] = data[ i ];
+        if (  ! model->written[ address ]
+           && address >= TMF8X2X_REGISTER_IMAGE_START && address < TMF8X2X_REGISTER_IMAGE_START + TMF8X2X_REGISTER_IMAGE_SIZE
+           )
+        {
+            model->spadWritten++;
+        }
+        model->written[ address ] = 1;
+    }
+    model->transfers++;
+    model->bytes += TMF8X2X_I2C_WRITE_HEADER_BYTES + count;
+    for ( uint8_t speed = 0; speed < TMF8X2X_I2C_SPEEDS; speed++ )
+    {
+        model->busNs[ speed ] += tmf8x2xI2cWriteNs( speed, count );
+    }
+}
+
+uint8_t tmf8x2xDeviceModelI2Cline ( tmf8x2xDeviceModel * model, const char * line, uint32_t length )
+{
+    uint8_t data[ TMF8X2X_DECODE_I2C_DATA_SIZE ];
+    uint32_t count;
+    uint8_t reg;
+
+    if ( tmf8x2xParseI2Cwrite( line, length, &reg, data, &count ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    tmf8x2xDeviceModelWrite( model, reg, data, count );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xDeviceModelDecode ( const tmf8x2xDeviceModel * model, tmf8x2xHalMainSpadConfig * config )
+{
+    if ( model->spadWritten != TMF8X2X_REGISTER_IMAGE_SIZE )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    tmf8x2xUnpackRegisterImage( config, model->registers + TMF8X2X_REGISTER_IMAGE_START );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/*
+ *****************************************************************************
+ * DEVICE MODEL MODE
+ *****************************************************************************
+ */
+
+uint32_t tmf8x2xRunDeviceModel ( FILE * input )
+{
+    static tmf8x2xDeviceModel model;
+    static char buffer[ DEVICE_BUFFER_SIZE + 1 ];
+    tmf8x2xHalMainSpadConfig config;
+    deviceSegment segment;
+    deviceSegment totals;
+    uint32_t used = (uint32_t)fread( buffer, 1, TMF8X2X_REGISTER_IMAGE_SIZE, input );
+    uint32_t configs = 0;
+    uint32_t failed = 0;
+
+    tmf8x2xDeviceModelReset( &model );
+    deviceStartSegment( &totals, &model, "-" );
+    deviceStartSegment( &segment, &model, "-" );
+
+    if ( memchr( buffer, 0, used ) ) /* register images, byte 0x8c (bits 23..16 of tdcChannelSelect) is always 0 */
+    {
+        while ( used )
+        {
+            tmf8x2xDeviceModelWrite( &model, TMF8X2X_REGISTER_IMAGE_START, (const uint8_t *)buffer, used );
+            failed += ( deviceFinishSegment( &model, &segment, configs++ ) != TMF8X2X_VALIDATE_OK );
+            deviceStartSegment( &segment, &model, "-" );
+            used = (uint32_t)fread( buffer, 1, TMF8X2X_REGISTER_IMAGE_SIZE, input );
+        }
+    }
+    else
+    {
+        int more = 1;
+        uint8_t overlong = 0;   /* the rest of a line that did not fit is dropped */
+
+        while ( more || used )
+        {
+            uint32_t begin = 0;
+            char * end;
+
+            if ( more && used < DEVICE_BUFFER_SIZE )
+            {
+                used += (uint32_t)fread( buffer + used, 1, DEVICE_BUFFER_SIZE - used, input );
+                more = ! feof( input ) && ! ferror( input );
+            }
+            if ( ! more && used && buffer[ used - 1 ] != '\n' )
+            {
+                buffer[ used++ ] = '\n'; /* the last line of the stream, buffer has room for it */
+            }
+            while ( ( end = memchr( buffer + begin, '\n', used - begin ) ) != 0 )
+            {
+                *end = 0;
+                if ( ! overlong )
+                {
+                    failed += deviceTextLine( &model, &segment, buffer + begin, &configs );
+                }
+                overlong = 0;
+                begin = (uint32_t)( end + 1 - buffer );
+            }
+            memmove( buffer, buffer + begin, used - begin );
+            used -= begin;
+            if ( used == DEVICE_BUFFER_SIZE )
+            {
+                used = 0;
+                overlong = 1;
+            }
+        }
+        if ( model.transfers != segment.transfers )
+        {
+            failed += ( deviceFinishSegment( &model, &segment, configs++ ) != TMF8X2X_VALIDATE_OK );
+        }
+    }
+
+    dumpString( "# configs: " );
+    dumpSignedDecimal( (int32_t)configs );
+    dumpString( " ok: " );
+    dumpSignedDecimal( (int32_t)( configs - failed ) );
+    dumpString( " failed: " );
+    dumpSignedDecimal( (int32_t)failed );
+    deviceDumpBusTime( &model, &totals );
+    dumpString( "\n\n" );
+
+    /* what the device holds at the end of the stream */
+    if ( tmf8x2xDeviceModelDecode( &model, &config ) == TMF8X2X_SPAD_MAP_OK )
+    {
+        dumpMainSpadConfigAsCstruct( "tmf8x2xDeviceSpadMap", &config );
+    }
+    return failed;
+}
+
+/*
+ *****************************************************************************
+ * REGISTER DELTA MODE
+ *****************************************************************************
+ */
+
+void tmf8x2xDumpRegisterDelta ( uint32_t index, const char * name, const tmf8x2xHalMainSpadConfig * from, const tmf8x2xHalMainSpadConfig * to, tmf8x2xI2cCost * totals )
+{
+    uint8_t fromImage[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    uint8_t toImage[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    uint32_t mergeGap = tmf8x2xI2cMergeGap( TMF8X2X_I2C_FAST );
+    tmf8x2xRegisterDelta delta;
+    tmf8x2xI2cCost cost;
+
+    tmf8x2xPackRegisterImage( toImage, to );
+    if ( from )
+    {
+        tmf8x2xPackRegisterImage( fromImage, from );
+        tmf8x2xDiffRegisterImages( &delta, fromImage, toImage, mergeGap );
+        dumpMainSpadConfigDeltaAsI2Cstrings( name, from, to, mergeGap );
+    }
+    else /* nothing is known about the registers of the device, all are written */
+    {
+        delta.count = 1;
+        delta.changed = TMF8X2X_REGISTER_IMAGE_SIZE;
+        delta.bytes = TMF8X2X_REGISTER_IMAGE_SIZE;
+        delta.writes[ 0 ].offset = 0;
+        delta.writes[ 0 ].length = TMF8X2X_REGISTER_IMAGE_SIZE;
+        dumpMainSpadConfigAsI2Cburst( name, to );
+    }
+    memset( &cost, 0, sizeof( cost ) );
+    tmf8x2xAddI2cCost( &cost, &delta );
+    tmf8x2xAddI2cCost( totals, &delta );
+
+    dumpString( "# " );
+    dumpSignedDecimal( (int32_t)index );
+    dumpString( " " );
+    dumpString( name );
+    dumpString( " changed: " );
+    dumpSignedDecimal( (int32_t)delta.changed );
+    tmf8x2xDumpI2cCost( &cost );
+    dumpString( "\n" );
+}
+
+uint32_t tmf8x2xRunRegisterDelta ( FILE * input )
+{
+    static deviceDeltaRun run;
+    uint32_t records;
+    uint32_t failed;
+
+    memset( &run, 0, sizeof( run ) );
+    failed = tmf8x2xReadBatch( input, deviceDeltaRecord, &run, &records );
+
+    dumpString( "# records: " );
+    dumpSignedDecimal( (int32_t)records );
+    dumpString( " ok: " );
+    dumpSignedDecimal( (int32_t)( records - failed ) );
+    dumpString( " failed: " );
+    dumpSignedDecimal( (int32_t)failed );
+    tmf8x2xDumpI2cCost( &run.totals );
+    return failed;
+}
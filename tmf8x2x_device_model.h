@@ -0,0 +1,212 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_device_model.h
+ *  \brief virtual TMF882x register file with an I2C bus time model, measures what applying a SPAD map costs without hardware.
+ *
+ * The model holds the 8-bit register address space of the device. I2C writes are applied as the device does: the data
+ * bytes go to consecutive registers starting at the register byte. The SPAD configuration registers 0x24..0x90
+ * (TMF8X2X_COM_SPAD_*) are decoded back into a tmf8x2xHalMainSpadConfig as soon as all of them were written.
+ *
+ * Bus time of a write transfer with n data bytes: ( 2 + n ) x 9 clock cycles (address byte, register byte and data
+ * bytes, 8 bits and the ACK each), plus the hold time of the start condition, the setup time of the stop condition and
+ * the bus free time before the next start (minimum values of the I2C specification for the speed).
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_register_image.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_DEVICE_MODEL_H
+#define TMF8X2X_DEVICE_MODEL_H
+
+/* registers of the model, the register address is one byte */
+#define TMF8X2X_DEVICE_REGISTERS            256
+
+/* I2C bus speeds of the time model */
+#define TMF8X2X_I2C_STANDARD                0   /* 100 kHz */
+#define TMF8X2X_I2C_FAST                    1   /* 400 kHz */
+#define TMF8X2X_I2C_FAST_PLUS               2   /* 1 MHz */
+#define TMF8X2X_I2C_SPEEDS                  3
+
+/* bytes on the bus of a write transfer next to its data bytes: address byte and register byte */
+#define TMF8X2X_I2C_WRITE_HEADER_BYTES      2
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* the register file and what the writes to it cost, reset with tmf8x2xDeviceModelReset */
+typedef struct _tmf8x2xDeviceModel
+{
+    uint8_t registers[ TMF8X2X_DEVICE_REGISTERS ];
+    uint8_t written[ TMF8X2X_DEVICE_REGISTERS ];    /* 1 for each register that was written since the reset */
+    uint32_t spadWritten;                           /* number of SPAD configuration registers written since the reset */
+    uint32_t transfers;                             /* write transfers (start ... stop) */
+    uint32_t bytes;                                 /* bytes on the bus, including address and register bytes */
+    uint64_t busNs[ TMF8X2X_I2C_SPEEDS ];           /* bus time of all transfers per TMF8X2X_I2C_* speed */
+} tmf8x2xDeviceModel;
+
+/* what a number of SPAD configurations cost on the bus, see tmf8x2xAddI2cCost */
+typedef struct _tmf8x2xI2cCost
+{
+    uint32_t configs;                               /* register deltas, each compares with a burst of the complete register image */
+    uint32_t transfers;                             /* write transfers */
+    uint32_t bytes;                                 /* bytes on the bus, including address and register bytes */
+    uint64_t busNs[ TMF8X2X_I2C_SPEEDS ];           /* bus time per TMF8X2X_I2C_* speed */
+} tmf8x2xI2cCost;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xI2cSpeedHz returns the clock frequency of a bus speed
+ * @param speed TMF8X2X_I2C_*
+ * @return SCL frequency in Hz
+ */
+uint32_t tmf8x2xI2cSpeedHz( uint8_t speed );
+
+/**
+ * @brief tmf8x2xI2cWriteNs returns the bus time of one write transfer
+ * @param speed TMF8X2X_I2C_*
+ * @param dataBytes number of data bytes after the register byte
+ * @return bus time in nanoseconds, including start and stop condition and the bus free time after it
+ */
+uint32_t tmf8x2xI2cWriteNs( uint8_t speed, uint32_t dataBytes );
+
+/**
+ * @brief tmf8x2xI2cMergeGap returns the longest run of unwritten registers between two writes for which one write transfer
+ * that writes the run along is faster than two transfers, the merge gap of tmf8x2xDiffRegisterImages
+ * @param speed TMF8X2X_I2C_*
+ * @return number of registers
+ */
+uint32_t tmf8x2xI2cMergeGap( uint8_t speed );
+
+/**
+ * @brief tmf8x2xI2cDeltaNs returns the bus time of the write transfers of a register delta
+ * @param speed TMF8X2X_I2C_*
+ * @param delta write transfers, see tmf8x2xDiffRegisterImages
+ * @return bus time in nanoseconds
+ */
+uint32_t tmf8x2xI2cDeltaNs( uint8_t speed, const tmf8x2xRegisterDelta * delta );
+
+/**
+ * @brief tmf8x2xAddI2cCost adds the transfers, bytes and bus time at all speeds of a register delta
+ * @param cost to add to, set to 0 before the first delta
+ * @param delta write transfers, see tmf8x2xDiffRegisterImages
+ */
+void tmf8x2xAddI2cCost( tmf8x2xI2cCost * cost, const tmf8x2xRegisterDelta * delta );
+
+/**
+ * @brief tmf8x2xDumpI2cCost dumps transfers, bytes and bus time at all speeds, each next to what bursts of the complete register image
+ * cost instead and the time saved, ends the line
+ * @param cost to dump
+ */
+void tmf8x2xDumpI2cCost( const tmf8x2xI2cCost * cost );
+
+/**
+ * @brief tmf8x2xDeviceModelReset sets all registers to 0, marks them as not written and clears the counters
+ * @param model to reset
+ */
+void tmf8x2xDeviceModelReset( tmf8x2xDeviceModel * model );
+
+/**
+ * @brief tmf8x2xDeviceModelWrite applies one write transfer, the register address wraps around after 0xff
+ * @param model register file
+ * @param reg first register
+ * @param data bytes written to reg, reg + 1, ...
+ * @param count number of data bytes
+ */
+void tmf8x2xDeviceModelWrite( tmf8x2xDeviceModel * model, uint8_t reg, const uint8_t * data, uint32_t count );
+
+/**
+ * @brief tmf8x2xDeviceModelI2Cline applies one I2C write "S 41 W <register> <data bytes> P" (dumpMainSpadConfigAsI2Cstrings, dumpMainSpadConfigAsI2Cburst)
+ * @param model register file
+ * @param line text of the line, does not need to be zero terminated
+ * @param length of the line in characters
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the line is not an I2C write to the TMF882x (nothing is applied), TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xDeviceModelI2Cline( tmf8x2xDeviceModel * model, const char * line, uint32_t length );
+
+/**
+ * @brief tmf8x2xDeviceModelDecode decodes the SPAD configuration registers of the register file
+ * @param model register file
+ * @param config receives the SPAD configuration in machine readable format (packed)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if not all SPAD configuration registers were written since the reset, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xDeviceModelDecode( const tmf8x2xDeviceModel * model, tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xRunDeviceModel applies a stream to the register file and dumps a line with transfers, bytes and bus time per configuration
+ * (the writes after a line "# tmf8x2xHalMainSpadConfig <name>"), the totals and the SPAD configuration the device holds at the end.
+ * A stream with a zero byte is binary: register images of TMF8X2X_REGISTER_IMAGE_SIZE bytes (spad_tool -r), each written as one burst.
+ * @param input stream of I2C writes or register images
+ * @return number of configurations that could not be decoded or failed the checks
+ */
+uint32_t tmf8x2xRunDeviceModel( FILE * input );
+
+/**
+ * @brief tmf8x2xDumpRegisterDelta dumps the I2C writes that switch the device from one SPAD configuration to another (tmf8x2xDiffRegisterImages
+ * with the merge gap of 400 kHz) and a line with their cost compared with a burst of the complete register image
+ * @param index running number of the configuration in the cost line
+ * @param name of the configuration that is loaded
+ * @param from configuration that is currently loaded (packed), 0 if unknown: all registers are written in one burst
+ * @param to configuration that is loaded by the writes (packed)
+ * @param totals the cost of the writes is added to it
+ */
+void tmf8x2xDumpRegisterDelta( uint32_t index, const char * name, const tmf8x2xHalMainSpadConfig * from, const tmf8x2xHalMainSpadConfig * to, tmf8x2xI2cCost * totals );
+
+/**
+ * @brief tmf8x2xRunRegisterDelta validates a stream of SPAD map / mask records (tmf8x2x_batch.h) and dumps the I2C writes that load
+ * them one after the other: the first valid record as one burst, each further one as the register delta from the valid record before
+ * (tmf8x2xDiffRegisterImages with the merge gap of 400 kHz). A line per record compares transfers, bytes and bus time with a burst
+ * of the complete register image, the last line the totals. Records that fail are reported and skipped.
+ * @param input stream of records
+ * @return number of records that failed (parsing or checks)
+ */
+uint32_t tmf8x2xRunRegisterDelta( FILE * input );
+
+#endif /* TMF8X2X_DEVICE_MODEL_H */
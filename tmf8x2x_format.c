@@ -0,0 +1,560 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_format.c
+ *  \brief output format selection (-f) and the streaming machine-readable emitters (JSON Lines, CSV).
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_register_image.h"
+#include "tmf8x2x_zone_stats.h"
+#include "tmf8x2x_format.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* longest format name in a -f list */
+#define FORMAT_NAME_SIZE                    16
+/* a name is written in pieces of this size */
+#define FORMAT_ESCAPE_SIZE                  64
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* name of a format in a -f list */
+typedef struct _formatName
+{
+    const char * name;
+    uint32_t formats;
+} formatName;
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+static const formatName formatNames[ ] =
+{
+    { "cstruct",    TMF8X2X_FORMAT_CSTRUCT },
+    { "i2c",        TMF8X2X_FORMAT_I2C },
+    { "burst",      TMF8X2X_FORMAT_I2C_BURST },
+    { "channels",   TMF8X2X_FORMAT_CHANNEL_TEXT },
+    { "enable",     TMF8X2X_FORMAT_ENABLE_TEXT },
+    { "stats",      TMF8X2X_FORMAT_ZONE_STATS },
+    { "islands",    TMF8X2X_FORMAT_ISLANDS },
+    { "text",       TMF8X2X_FORMAT_TEXT },
+    { "json",       TMF8X2X_FORMAT_JSON },
+    { "csv",        TMF8X2X_FORMAT_CSV },
+};
+
+static const char hexDigits[ ] = "0123456789abcdef";
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief formatUnsigned dumps an unsigned decimal number (dumpSignedDecimal would show enable words with bit 31 set as negative)
+ * @param value to dump
+ */
+static void formatUnsigned( uint32_t value );
+/**
+ * @brief formatQuoted dumps a string in double quotes, escaped for JSON (backslash) or CSV (doubled quotes)
+ * @param text to dump
+ * @param json 1 for JSON, 0 for CSV
+ */
+static void formatQuoted( const char * text, int json );
+/**
+ * @brief formatDetail dumps one failure detail (channel, x, y) as number, or as null / empty field if the status has none
+ * @param value detail of the status, TMF8X2X_LIB_NONE if there is none
+ * @param json 1 for JSON, 0 for CSV
+ */
+static void formatDetail( uint8_t value, int json );
+/**
+ * @brief formatRegisters dumps the register bytes 0x24..0x90 of a configuration as one hex string in double quotes
+ * @param config configuration in machine readable format (packed)
+ */
+static void formatRegisters( const tmf8x2xHalMainSpadConfig * config );
+/**
+ * @brief formatHundredths dumps a number in hundredths as decimal number with two decimals
+ * @param value in hundredths
+ */
+static void formatHundredths( int32_t value );
+/**
+ * @brief formatZoneStats dumps the zone statistics of a configuration as JSON object (null if the sizes are out of range)
+ * @param config configuration in machine readable format (packed)
+ */
+static void formatZoneStats( const tmf8x2xHalMainSpadConfig * config );
+/**
+ * @brief formatIslands dumps the islands of each zone for 4- and 8-connectivity as JSON array (null if the sizes are out of range)
+ * @param config configuration in machine readable format (packed)
+ */
+static void formatIslands( const tmf8x2xHalMainSpadConfig * config );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static void formatUnsigned ( uint32_t value )
+{
+    char text[ 11 ];
+    uint32_t i = sizeof( text ) - 1;
+
+    text[ i ] = 0;
+    do
+    {
+        text[ --i ] = (char)( '0' + value % 10 );
+        value /= 10;
+    } while ( value );
+    dumpString( text + i );
+}
+
+static void formatQuoted ( const char * text, int json )
+{
+    char piece[ FORMAT_ESCAPE_SIZE + 8 ];
+    uint32_t length = 0;
+
+    dumpString( "\"" );
+    for ( ; *text; text++ )
+    {
+        unsigned char c = (unsigned char)*text;
+        if ( json && ( c == '"' || c == '\\' ) )
+        {
+            piece[ length++ ] = '\\';
+            piece[ length++ ] = (char)c;
+        }
+        else if ( json && c < 0x20 )
+        {
+            memcpy( piece + length, "\\u00", 4 );
+            piece[ length + 4 ] = hexDigits[ c >> 4 ];
+            piece[ length + 5 ] = hexDigits[ c & 0xF ];
+            length += 6;
+        }
+        else if ( ! json && c == '"' )
+        {
+            piece[ length++ ] = '"';
+            piece[ length++ ] = '"';
+        }
+        else
+        {
+            piece[ length++ ] = (char)c;
+        }
+        if ( length >= FORMAT_ESCAPE_SIZE )
+        {
+            piece[ length ] = 0;
+            dumpString( piece );
+            length = 0;
+        }
+    }
+    piece[ length ] = 0;
+    dumpString( piece );
+    dumpString( "\"" );
+}
+
+static void formatDetail ( uint8_t value, int json )
+{
+    if ( value == TMF8X2X_LIB_NONE )
+    {
+        dumpString( json ? "null" : "" );
+    }
+    else
+    {
+        dumpSignedDecimal( value );
+    }
+}
+
+static void formatRegisters ( const tmf8x2xHalMainSpadConfig * config )
+{
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    char text[ 2 * TMF8X2X_REGISTER_IMAGE_SIZE + 3 ];
+
+    tmf8x2xPackRegisterImage( image, config );
+    text[ 0 ] = '"';
+    for ( uint32_t i = 0; i < TMF8X2X_REGISTER_IMAGE_SIZE; i++ )
+    {
+        text[ 1 + 2 * i ] = hexDigits[ image[ i ] >> 4 ];
+        text[ 2 + 2 * i ] = hexDigits[ image[ i ] & 0xF ];
+    }
+    text[ 2 * TMF8X2X_REGISTER_IMAGE_SIZE + 1 ] = '"';
+    text[ 2 * TMF8X2X_REGISTER_IMAGE_SIZE + 2 ] = 0;
+    dumpString( text );
+}
+
+static void formatHundredths ( int32_t value )
+{
+    char text[ 4 ] = { '.', 0, 0, 0 };
+    uint32_t magnitude = (uint32_t)( value < 0 ? -value : value );
+
+    text[ 1 ] = (char)( '0' + magnitude / 10 % 10 );
+    text[ 2 ] = (char)( '0' + magnitude % 10 );
+    dumpString( value < 0 ? "-" : "" );
+    formatUnsigned( magnitude / 100 );
+    dumpString( text );
+}
+
+static void formatZoneStats ( const tmf8x2xHalMainSpadConfig * config )
+{
+    tmf8x2xSpadMapStats stats;
+
+    if ( tmf8x2xComputeZoneStats( config, &stats ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        dumpString( "null" );
+        return;
+    }
+    dumpString( "{\"spads\":" );
+    formatUnsigned( stats.spads );
+    dumpString( ",\"boundary\":" );
+    formatUnsigned( stats.boundary );
+    dumpString( ",\"xFov\":" );
+    formatHundredths( stats.xFov );
+    dumpString( ",\"yFov\":" );
+    formatHundredths( stats.yFov );
+    dumpString( ",\"zones\":[" );
+    for ( uint8_t ch = 0, first = 1; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        const tmf8x2xZoneStats * zone = &stats.zones[ ch ];
+        if ( ! ( stats.zoneMask & ( 1u << ch ) ) )
+        {
+            continue;
+        }
+        dumpString( first ? "{\"channel\":" : ",{\"channel\":" );
+        first = 0;
+        formatUnsigned( ch );
+        dumpString( ",\"spads\":" );
+        formatUnsigned( zone->spads );
+        dumpString( ",\"xCentroid\":" );
+        formatHundredths( zone->xCentroid );
+        dumpString( ",\"yCentroid\":" );
+        formatHundredths( zone->yCentroid );
+        dumpString( ",\"xMin\":" );
+        formatUnsigned( zone->xMin );
+        dumpString( ",\"xMax\":" );
+        formatUnsigned( zone->xMax );
+        dumpString( ",\"yMin\":" );
+        formatUnsigned( zone->yMin );
+        dumpString( ",\"yMax\":" );
+        formatUnsigned( zone->yMax );
+        dumpString( ",\"boundary\":" );
+        formatUnsigned( zone->boundary );
+        dumpString( ",\"xAngle\":" );
+        formatHundredths( zone->xAngle );
+        dumpString( ",\"yAngle\":" );
+        formatHundredths( zone->yAngle );
+        dumpString( ",\"xFov\":" );
+        formatHundredths( zone->xFov );
+        dumpString( ",\"yFov\":" );
+        formatHundredths( zone->yFov );
+        dumpString( "}" );
+    }
+    dumpString( "]}" );
+}
+
+static void formatIslands ( const tmf8x2xHalMainSpadConfig * config )
+{
+    tmf8x2xSpadMapComponents connected[ 2 ];
+    static const char * const names[ 2 ][ 4 ] =
+    {
+        { ",\"islands4\":", ",\"largest4\":", ",\"share4\":", ",\"stray4\":" },
+        { ",\"islands8\":", ",\"largest8\":", ",\"share8\":", ",\"stray8\":" },
+    };
+
+    if (  tmf8x2xFindZoneComponents( config, TMF8X2X_CONNECTIVITY_4, &connected[ 0 ] ) != TMF8X2X_SPAD_MAP_OK
+       || tmf8x2xFindZoneComponents( config, TMF8X2X_CONNECTIVITY_8, &connected[ 1 ] ) != TMF8X2X_SPAD_MAP_OK
+       )
+    {
+        dumpString( "null" );
+        return;
+    }
+    dumpString( "[" );
+    for ( uint8_t ch = 0, first = 1; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        if ( ! connected[ 0 ].zones[ ch ].spads )
+        {
+            continue;
+        }
+        dumpString( first ? "{\"channel\":" : ",{\"channel\":" );
+        first = 0;
+        formatUnsigned( ch );
+        dumpString( ",\"spads\":" );
+        formatUnsigned( connected[ 0 ].zones[ ch ].spads );
+        for ( uint32_t i = 0; i < 2; i++ )
+        {
+            const tmf8x2xZoneComponents * zone = &connected[ i ].zones[ ch ];
+            dumpString( names[ i ][ 0 ] );
+            formatUnsigned( zone->components );
+            dumpString( names[ i ][ 1 ] );
+            formatUnsigned( zone->largest );
+            dumpString( names[ i ][ 2 ] );
+            formatHundredths( (int32_t)( ( 10000u * zone->largest + zone->spads / 2 ) / zone->spads ) );
+            dumpString( names[ i ][ 3 ] );
+            formatUnsigned( zone->stray );
+        }
+        dumpString( "}" );
+    }
+    dumpString( "]" );
+}
+
+/*
+ *****************************************************************************
+ * FORMAT SELECTION
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xParseFormats ( const char * text, uint32_t * formats )
+{
+    *formats = 0;
+    while ( *text )
+    {
+        uint32_t length = 0;
+        uint32_t found = 0;
+        while ( text[ length ] && text[ length ] != ',' )
+        {
+            length++;
+        }
+        for ( uint32_t i = 0; i < sizeof( formatNames ) / sizeof( formatNames[ 0 ] ); i++ )
+        {
+            if ( strlen( formatNames[ i ].name ) == length && strncmp( formatNames[ i ].name, text, length ) == 0 )
+            {
+                found = formatNames[ i ].formats;
+            }
+        }
+        if ( ! found )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+        *formats |= found;
+        text += length + ( text[ length ] == ',' );
+    }
+
+    /* a machine-readable format only on its own, JSON lines can carry the analyses */
+    if (  *formats == 0
+       || (  ( *formats & TMF8X2X_FORMAT_MACHINE )
+          && ( *formats & ~TMF8X2X_FORMAT_ANALYSIS ) != TMF8X2X_FORMAT_JSON
+          && *formats != TMF8X2X_FORMAT_CSV
+          )
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+void tmf8x2xDumpFormats ( uint32_t formats, const char * name, const tmf8x2xSpadMask * mask, const tmf8x2xHalMainSpadConfig * config )
+{
+    uint32_t written = 0; /* formats are separated by a blank line, except the C struct and the I2C strings */
+
+    if ( formats & TMF8X2X_FORMAT_CSTRUCT )
+    {
+        dumpMainSpadConfigAsCstruct( name, config );
+        written = 1;
+    }
+    if ( formats & TMF8X2X_FORMAT_I2C )
+    {
+        dumpMainSpadConfigAsI2Cstrings( name, config );
+        written = 1;
+    }
+    if ( formats & TMF8X2X_FORMAT_I2C_BURST )
+    {
+        dumpString( written ? "\n" : "" );
+        dumpMainSpadConfigAsI2Cburst( name, config );
+        written = 1;
+    }
+    if ( ( formats & TMF8X2X_FORMAT_CHANNEL_TEXT ) && mask )
+    {
+        dumpString( written ? "\n" : "" );
+        dumpChannelMapAsText( mask );
+        written = 1;
+    }
+    if ( formats & TMF8X2X_FORMAT_ENABLE_TEXT )
+    {
+        dumpString( written ? "\n" : "" );
+        dumpMainSpadEnableBitsAsText( config );
+        written = 1;
+    }
+    if ( formats & TMF8X2X_FORMAT_ZONE_STATS )
+    {
+        tmf8x2xSpadMapStats stats;
+        if ( tmf8x2xComputeZoneStats( config, &stats ) == TMF8X2X_SPAD_MAP_OK )
+        {
+            dumpString( written ? "\n" : "" );
+            dumpZoneStatsAsText( &stats );
+            written = 1;
+        }
+    }
+    if ( formats & TMF8X2X_FORMAT_ISLANDS )
+    {
+        tmf8x2xSpadMapComponents connected4;
+        tmf8x2xSpadMapComponents connected8;
+        if (  tmf8x2xFindZoneComponents( config, TMF8X2X_CONNECTIVITY_4, &connected4 ) == TMF8X2X_SPAD_MAP_OK
+           && tmf8x2xFindZoneComponents( config, TMF8X2X_CONNECTIVITY_8, &connected8 ) == TMF8X2X_SPAD_MAP_OK
+           )
+        {
+            dumpString( written ? "\n" : "" );
+            dumpZoneComponentsAsText( &connected4, &connected8 );
+        }
+    }
+}
+
+/*
+ *****************************************************************************
+ * MACHINE-READABLE EMITTERS
+ *****************************************************************************
+ */
+
+void tmf8x2xEmitHeader ( uint32_t formats )
+{
+    if ( formats & TMF8X2X_FORMAT_CSV )
+    {
+        dumpString( "index,name,result,check,reason,channel,x,y,xOffset_2,yOffset_2,xSize,ySize,tdcChannelSelect,registers\n" );
+    }
+}
+
+void tmf8x2xEmitRecord ( uint32_t formats, uint32_t index, const char * name, const tmf8x2xLibStatus * status, const tmf8x2xHalMainSpadConfig * config )
+{
+    int json = !! ( formats & TMF8X2X_FORMAT_JSON );
+    const char * separator = json ? "," : "";
+    int ok = status && status->code == TMF8X2X_LIB_OK;
+
+    if ( ! ( formats & TMF8X2X_FORMAT_MACHINE ) )
+    {
+        return;
+    }
+
+    /* verdict and failure reason */
+    dumpString( json ? "{\"index\":" : "" );
+    formatUnsigned( index );
+    dumpString( json ? ",\"name\":" : "," );
+    formatQuoted( name, json );
+    dumpString( json ? ",\"result\":" : "," );
+    dumpString( ok ? "\"ok\"" : "\"error\"" );
+    dumpString( json ? ",\"check\":" : "," );
+    if ( ok )
+    {
+        dumpString( json ? "null,\"reason\":null" : "," );
+    }
+    else
+    {
+        formatQuoted( status ? tmf8x2xValidateResultName( status->check ) : "record format", json );
+        dumpString( json ? ",\"reason\":" : "," );
+        formatQuoted( status ? tmf8x2xLibErrorText( status->code ) : "SPAD map / mask could not be parsed", json );
+    }
+    dumpString( json ? ",\"channel\":" : "," );
+    formatDetail( status ? status->channel : TMF8X2X_LIB_NONE, json );
+    dumpString( json ? ",\"x\":" : "," );
+    formatDetail( status ? status->x : TMF8X2X_LIB_NONE, json );
+    dumpString( json ? ",\"y\":" : "," );
+    formatDetail( status ? status->y : TMF8X2X_LIB_NONE, json );
+
+    /* packed configuration and register bytes */
+    if ( ! config )
+    {
+        dumpString( json ? ",\"xOffset_2\":null,\"yOffset_2\":null,\"xSize\":null,\"ySize\":null,\"enableSpad\":null,\"tdcChannel\":null"
+                           ",\"tdcChannelSelect\":null,\"registers\":null" : ",,,,,,\n" );
+        dumpString( ( json && ( formats & TMF8X2X_FORMAT_ZONE_STATS ) ) ? ",\"stats\":null" : "" );
+        dumpString( ( json && ( formats & TMF8X2X_FORMAT_ISLANDS ) ) ? ",\"islands\":null" : "" );
+        dumpString( json ? "}\n" : "" );
+        return;
+    }
+    dumpString( json ? ",\"xOffset_2\":" : "," );
+    dumpSignedDecimal( config->xOffset_2 );
+    dumpString( json ? ",\"yOffset_2\":" : "," );
+    dumpSignedDecimal( config->yOffset_2 );
+    dumpString( json ? ",\"xSize\":" : "," );
+    dumpSignedDecimal( config->xSize );
+    dumpString( json ? ",\"ySize\":" : "," );
+    dumpSignedDecimal( config->ySize );
+    if ( json )
+    {
+        dumpString( ",\"enableSpad\":[" );
+        for ( uint32_t y = 0; y < TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; y++ )
+        {
+            dumpString( y ? separator : "" );
+            formatUnsigned( config->enableSpad[ y ] );
+        }
+        dumpString( "],\"tdcChannel\":[" );
+        for ( uint32_t x = 0; x < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; x++ )
+        {
+            dumpString( x ? separator : "" );
+            formatUnsigned( config->tdcChannel[ x ] );
+        }
+        dumpString( "]" );
+    }
+    dumpString( json ? ",\"tdcChannelSelect\":" : "," );
+    formatUnsigned( config->tdcChannelSelect );
+    dumpString( json ? ",\"registers\":" : "," );
+    formatRegisters( config );
+    if ( json && ( formats & TMF8X2X_FORMAT_ZONE_STATS ) )
+    {
+        dumpString( ",\"stats\":" );
+        formatZoneStats( config );
+    }
+    if ( json && ( formats & TMF8X2X_FORMAT_ISLANDS ) )
+    {
+        dumpString( ",\"islands\":" );
+        formatIslands( config );
+    }
+    dumpString( json ? "}\n" : "\n" );
+}
+
+void tmf8x2xEmitSummary ( uint32_t formats, uint32_t records, uint32_t failed, uint64_t elapsedNs )
+{
+    if ( formats & TMF8X2X_FORMAT_JSON )
+    {
+        dumpString( "{\"summary\":{\"records\":" );
+        formatUnsigned( records );
+        dumpString( ",\"ok\":" );
+        formatUnsigned( records - failed );
+        dumpString( ",\"failed\":" );
+        formatUnsigned( failed );
+        dumpString( ",\"time_us\":" );
+        dumpUnsignedDecimal( elapsedNs / 1000u );
+        dumpString( ",\"records_per_s\":" );
+        formatUnsigned( (uint32_t)( elapsedNs ? ( (uint64_t)records * 1000000000u / elapsedNs ) : 0 ) );
+        dumpString( "}}\n" );
+    }
+}
+
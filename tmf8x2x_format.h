@@ -0,0 +1,125 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_format.h
+ *  \brief output format selection (-f) and the streaming machine-readable emitters (JSON Lines, CSV).
+ *
+ * The human readable formats are the dump functions of tmf8x2x_spad_mask_tool.h, only the selected ones run.
+ * JSON Lines and CSV write one line per SPAD map with the verdict, the failure reason, the packed configuration and
+ * the register bytes 0x24..0x90 as hex string. All output goes to the selected output sink as it is produced, so the
+ * memory use does not depend on the number of SPAD maps.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_lib.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_FORMAT_H
+#define TMF8X2X_FORMAT_H
+
+/* output formats, a selection is a combination of these bits */
+#define TMF8X2X_FORMAT_CSTRUCT              0x01    /* cstruct:  dumpMainSpadConfigAsCstruct */
+#define TMF8X2X_FORMAT_I2C                  0x02    /* i2c:      dumpMainSpadConfigAsI2Cstrings */
+#define TMF8X2X_FORMAT_I2C_BURST            0x04    /* burst:    dumpMainSpadConfigAsI2Cburst */
+#define TMF8X2X_FORMAT_CHANNEL_TEXT         0x08    /* channels: dumpChannelMapAsText */
+#define TMF8X2X_FORMAT_ENABLE_TEXT          0x10    /* enable:   dumpMainSpadEnableBitsAsText */
+#define TMF8X2X_FORMAT_JSON                 0x20    /* json:     one JSON object per line */
+#define TMF8X2X_FORMAT_CSV                  0x40    /* csv:      a header row, then one row per SPAD map */
+#define TMF8X2X_FORMAT_ZONE_STATS           0x80    /* stats:    dumpZoneStatsAsText, or the "stats" object of a JSON line */
+#define TMF8X2X_FORMAT_ISLANDS              0x100   /* islands:  dumpZoneComponentsAsText, or the "islands" array of a JSON line */
+
+/* text: all human readable formats, the output of spad_tool -m */
+#define TMF8X2X_FORMAT_TEXT                 ( TMF8X2X_FORMAT_CSTRUCT | TMF8X2X_FORMAT_I2C | TMF8X2X_FORMAT_I2C_BURST | TMF8X2X_FORMAT_CHANNEL_TEXT | TMF8X2X_FORMAT_ENABLE_TEXT )
+#define TMF8X2X_FORMAT_MACHINE              ( TMF8X2X_FORMAT_JSON | TMF8X2X_FORMAT_CSV )
+/* analyses that JSON lines can carry */
+#define TMF8X2X_FORMAT_ANALYSIS             ( TMF8X2X_FORMAT_ZONE_STATS | TMF8X2X_FORMAT_ISLANDS )
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xParseFormats parses a comma separated list of format names (cstruct, i2c, burst, channels, enable, stats, islands, text, json, csv).
+ * json and csv cannot be combined with any other format, the lines would not parse any more, except json with stats / islands.
+ * @param text format list
+ * @param formats receives the TMF8X2X_FORMAT_* bits
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG for unknown names or an invalid combination, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xParseFormats( const char * text, uint32_t * formats );
+
+/**
+ * @brief tmf8x2xDumpFormats dumps a checked SPAD setup in the selected human readable formats, in the order and with the blank lines of spad_tool -m
+ * @param formats TMF8X2X_FORMAT_* bits, the machine-readable ones are ignored
+ * @param name of the SPAD setup
+ * @param mask SPAD configuration in human readable format, only used for TMF8X2X_FORMAT_CHANNEL_TEXT
+ * @param config SPAD configuration in machine readable format (packed)
+ */
+void tmf8x2xDumpFormats( uint32_t formats, const char * name, const tmf8x2xSpadMask * mask, const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xEmitHeader writes what comes before the first record: the CSV header row (nothing for JSON Lines)
+ * @param formats TMF8X2X_FORMAT_* bits
+ */
+void tmf8x2xEmitHeader( uint32_t formats );
+
+/**
+ * @brief tmf8x2xEmitRecord writes the JSON line or CSV row of one SPAD map
+ * @param formats TMF8X2X_FORMAT_* bits, nothing is written without TMF8X2X_FORMAT_JSON / TMF8X2X_FORMAT_CSV,
+ * JSON lines get the zone statistics with TMF8X2X_FORMAT_ZONE_STATS and the islands with TMF8X2X_FORMAT_ISLANDS
+ * @param index running number of the SPAD map
+ * @param name of the SPAD map
+ * @param status verdict and failure reason, 0 if the record could not be parsed
+ * @param config packed configuration, 0 if there is none (the configuration is complete unless creating it failed)
+ */
+void tmf8x2xEmitRecord( uint32_t formats, uint32_t index, const char * name, const tmf8x2xLibStatus * status, const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xEmitSummary writes the totals of a batch run as JSON line (nothing for CSV, the rows would not be uniform any more)
+ * @param formats TMF8X2X_FORMAT_* bits
+ * @param records number of SPAD maps
+ * @param failed number of SPAD maps that failed
+ * @param elapsedNs run time in nanoseconds
+ */
+void tmf8x2xEmitSummary( uint32_t formats, uint32_t records, uint32_t failed, uint64_t elapsedNs );
+
+#endif /* TMF8X2X_FORMAT_H */
+
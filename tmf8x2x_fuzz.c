@@ -0,0 +1,859 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_fuzz.c
+ *  \brief differential fuzzer for SPAD map creation and checks. Each input is run through tmf8x2xCreateMainSpad (with every SIMD kernel),
+ *  every check, tmf8x2xValidateSpadMask, the library and the incremental validator, and all results are compared with a straightforward
+ *  reference model of the same rules.
+ *
+ * usage: spad_fuzz [-n execs] [-t seconds] [-s seed] [-o directory] [input file ...]
+ *
+ * Without input files, random masks are generated (edge sizes 1xN, Nx1, 18x10 and extreme offsets favoured). With input files, each file
+ * is run once. Divergent inputs are minimized and saved in the output directory as <hash>.bin (fuzzer input) and, if the mask fits the
+ * batch record format, as <hash>.txt (for spad_tool -b).
+ *
+ * Built with -DTMF8X2X_FUZZ_LIBFUZZER the file provides LLVMFuzzerTestOneInput instead of main( ) and aborts on a divergence.
+ *
+ * Input format, missing bytes are 0:
+ *   0  xSize % 20          1  ySize % 12          2  xOffset_2           3  yOffset_2
+ *   4  bit r set: the enable bits above xSize are set in row r % 8 (ignored by all checks)
+ *   5  SPAD that the validator edits      6  bits 0..3: new channel % 10, bit 7: toggle the enable bit
+ *   7..  one byte per SPAD, top row first: bits 0..3 channel, bit 4 enable
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L /* mkdir */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_spad_kernels.h"
+#include "tmf8x2x_spad_lib.h"
+#include "tmf8x2x_validator.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* decoded sizes reach one past the maximum, to exercise the size checks */
+#define FUZZ_X_SIZES                        ( TMF8X2X_MAIN_SPAD_MAX_X_SIZE + 2 )
+#define FUZZ_Y_SIZES                        ( TMF8X2X_MAIN_SPAD_MAX_Y_SIZE + 2 )
+#define FUZZ_MAX_SPADS                      ( ( FUZZ_X_SIZES - 1 ) * ( FUZZ_Y_SIZES - 1 ) )
+
+/* input format */
+#define FUZZ_X_SIZE                         0
+#define FUZZ_Y_SIZE                         1
+#define FUZZ_X_OFFSET                       2
+#define FUZZ_Y_OFFSET                       3
+#define FUZZ_JUNK                           4
+#define FUZZ_EDIT_SPAD                      5
+#define FUZZ_EDIT_VALUE                     6
+#define FUZZ_HEADER_SIZE                    7
+#define FUZZ_INPUT_SIZE                     ( FUZZ_HEADER_SIZE + FUZZ_MAX_SPADS )
+#define FUZZ_SPAD_CHANNEL                   0x0F
+#define FUZZ_SPAD_ENABLE                    0x10
+#define FUZZ_EDIT_TOGGLE                    0x80
+
+#define FUZZ_DEFAULT_EXECS                  1000000
+#define FUZZ_REPORT_NS                      10000000000ull  /* status line every 10 s */
+#define FUZZ_DEFAULT_DIRECTORY              "fuzz_divergent"
+#define FUZZ_MAX_SAVED                      16              /* divergent inputs saved per run */
+
+/* divergences, one bit per compared result */
+#define DIFF_VALIDATE                       0x0001
+#define DIFF_CREATE                         0x0002
+#define DIFF_KERNEL                         0x0004
+#define DIFF_AREA                           0x0008
+#define DIFF_CHANNEL_SETUP                  0x0010
+#define DIFF_ASSIGNMENT                     0x0020
+#define DIFF_ASSIGNMENT_REFERENCE           0x0040
+#define DIFF_LIB_VALIDATE                   0x0080
+#define DIFF_LIB_CHECK                      0x0100
+#define DIFF_VALIDATOR                      0x0200
+#define DIFF_VALIDATOR_EDIT                 0x0400
+#define DIFF_COUNT                          11
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* a decoded fuzzer input */
+typedef struct _fuzzInput
+{
+    uint8_t channels[ FUZZ_MAX_SPADS ];
+    uint32_t enable[ FUZZ_Y_SIZES ];
+    tmf8x2xSpadMask mask;
+} fuzzInput;
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+static const char * const diffNames[ DIFF_COUNT ] =
+{
+    "validate", "create", "kernel", "area", "channel_setup", "assignment", "assignment_reference",
+    "lib_validate", "lib_check", "validator", "validator_edit"
+};
+
+/* reference results (TMF8X2X_VALIDATE_*) of all inputs, shows which checks the inputs reach */
+static uint64_t referenceResults[ TMF8X2X_VALIDATE_ERROR_ASSIGNMENT + 1 ];
+
+/*
+ *****************************************************************************
+ * REFERENCE MODEL
+ *****************************************************************************
+ */
+
+/* the rules are written down cell by cell, independent of the packed formats, the kernels and the bitboards of the tool */
+
+/* lower left corner of the map for the given center in Q1, the division truncates toward zero as in the firmware */
+static int refCorner ( int center_2, int offset_2, int size )
+{
+    return ( center_2 + offset_2 - size ) / 2;
+}
+
+/* channel of SPAD x|y (y = 0 is the bottom row) as seen in the packed configuration: only 3 bits are stored, 8/9 are restored by the row
+   select bit, so channels 10..15 read back as channel & 7 */
+static uint8_t refChannel ( const tmf8x2xSpadMask * mask, int x, int y )
+{
+    uint8_t ch = mask->channels[ ( mask->ySize - 1 - y ) * mask->xSize + x ];
+    return ( ch < TMF8X2X_NUMBER_OF_CHANNELS ) ? ch : ( ch & 7 );
+}
+
+static int refEnabled ( const tmf8x2xSpadMask * mask, int x, int y )
+{
+    return ( mask->enable[ mask->ySize - 1 - y ] >> x ) & 1;
+}
+
+/* tmf8x2xCreateMainSpad: the map has to be placed at a non-negative corner for both FoV centers, and no row may mix 0/1 with 8/9 */
+static uint8_t refCreate ( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask )
+{
+    if (  mask->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE
+       || mask->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE
+       || refCorner( X_CENTER_2_A, mask->xOffset_2, mask->xSize ) < 0
+       || refCorner( Y_CENTER_2_A, mask->yOffset_2, mask->ySize ) < 0
+       || refCorner( X_CENTER_2_B, mask->xOffset_2, mask->xSize ) < 0
+       || refCorner( Y_CENTER_2_B, mask->yOffset_2, mask->ySize ) < 0
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    memset( config, 0, sizeof( *config ) );
+    for ( int y = 0; y < mask->ySize; y++ )
+    {
+        int low = 0;
+        int high = 0;
+        config->enableSpad[ y ] = mask->enable[ mask->ySize - 1 - y ];
+        for ( int x = 0; x < mask->xSize; x++ )
+        {
+            uint8_t ch = mask->channels[ ( mask->ySize - 1 - y ) * mask->xSize + x ];
+            low |= ( ch == 0 || ch == 1 );
+            high |= ( ch == 8 || ch == 9 );
+            config->tdcChannel[ x ] |= (uint32_t)( ch & 1 ) << ( TMF8X2X_MAIN_SPAD_VERTICAL_LSB_SHIFT + y );
+            config->tdcChannel[ x ] |= (uint32_t)( ( ch >> 1 ) & 1 ) << ( TMF8X2X_MAIN_SPAD_VERTICAL_MID_SHIFT + y );
+            config->tdcChannel[ x ] |= (uint32_t)( ( ch >> 2 ) & 1 ) << ( TMF8X2X_MAIN_SPAD_VERTICAL_MSB_SHIFT + y );
+        }
+        if ( high )
+        {
+            config->tdcChannelSelect |= 1u << y;
+        }
+        if ( low && high )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    config->xOffset_2 = mask->xOffset_2;
+    config->yOffset_2 = mask->yOffset_2;
+    config->xSize = mask->xSize;
+    config->ySize = mask->ySize;
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/* tmf8x2xCheckMainSpadArea: the map has to fit into the 18x12 area, for the center of even and of odd map sizes */
+static uint8_t refArea ( int xOffset_2, int yOffset_2, int xSize, int ySize )
+{
+    for ( int odd = 0; odd < 2; odd++ )
+    {
+        int llcX = refCorner( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE - odd, xOffset_2, xSize );
+        int llcY = refCorner( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE - odd, yOffset_2, ySize );
+        if (  llcX < 0
+           || llcY < 0
+           || llcX + xSize > TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE
+           || llcY + ySize > TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE
+           )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/* tmf8x2xCheckMainSpadChannelSetup: no channel 0, no channel > 9, and each TDC (channels 2/3, 4/5, 6/7, 8/9) has a SPAD */
+static uint8_t refChannelSetup ( const uint8_t * channels, int spads )
+{
+    int used[ 16 ] = { 0 };
+    for ( int i = 0; i < spads; i++ )
+    {
+        if ( channels[ i ] == 0 || channels[ i ] >= TMF8X2X_NUMBER_OF_CHANNELS )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+        used[ channels[ i ] ] = 1;
+    }
+    for ( int tdc = CHANNEL_2; tdc <= CHANNEL_8; tdc += 2 )
+    {
+        if ( ! used[ tdc ] && ! used[ tdc + 1 ] )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/* tmf8x2xCheckMainSpadAssignment: every channel with an enabled SPAD needs an enabled SPAD of the same channel among its 8 neighbours */
+static uint8_t refAssignment ( const tmf8x2xSpadMask * mask )
+{
+    if (  mask->xSize < 1 || mask->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE
+       || mask->ySize < 1 || mask->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE
+       || ( mask->xSize == 1 && mask->ySize == 1 )
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        int used = 0;
+        int paired = 0;
+        for ( int y = 0; y < mask->ySize; y++ )
+        {
+            for ( int x = 0; x < mask->xSize; x++ )
+            {
+                if ( ! refEnabled( mask, x, y ) || refChannel( mask, x, y ) != ch )
+                {
+                    continue;
+                }
+                used = 1;
+                for ( int dy = -1; dy <= 1; dy++ )
+                {
+                    for ( int dx = -1; dx <= 1; dx++ )
+                    {
+                        int nx = x + dx;
+                        int ny = y + dy;
+                        if (  ( dx || dy )
+                           && nx >= 0 && nx < mask->xSize && ny >= 0 && ny < mask->ySize
+                           && refEnabled( mask, nx, ny ) && refChannel( mask, nx, ny ) == ch
+                           )
+                        {
+                            paired = 1;
+                        }
+                    }
+                }
+            }
+        }
+        if ( used && ! paired )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/* tmf8x2xValidateSpadMask */
+static uint8_t refValidate ( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask )
+{
+    if ( refCreate( config, mask ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    if ( refArea( mask->xOffset_2, mask->yOffset_2, mask->xSize, mask->ySize ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_VALIDATE_ERROR_AREA;
+    }
+    if ( refChannelSetup( mask->channels, mask->xSize * mask->ySize ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CHANNEL;
+    }
+    if ( refAssignment( mask ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_VALIDATE_ERROR_ASSIGNMENT;
+    }
+    return TMF8X2X_VALIDATE_OK;
+}
+
+/*
+ *****************************************************************************
+ * DIFFERENTIAL RUN
+ *****************************************************************************
+ */
+
+static void fuzzDecode ( fuzzInput * input, const uint8_t * data, size_t size )
+{
+    uint8_t bytes[ FUZZ_INPUT_SIZE ];
+    uint8_t xSize;
+    uint8_t ySize;
+
+    memset( bytes, 0, sizeof( bytes ) );
+    memcpy( bytes, data, ( size < sizeof( bytes ) ) ? size : sizeof( bytes ) );
+    xSize = bytes[ FUZZ_X_SIZE ] % FUZZ_X_SIZES;
+    ySize = bytes[ FUZZ_Y_SIZE ] % FUZZ_Y_SIZES;
+
+    memset( input, 0, sizeof( *input ) );
+    for ( int r = 0; r < ySize; r++ )
+    {
+        input->enable[ r ] = ( ( bytes[ FUZZ_JUNK ] >> ( r % 8 ) ) & 1 ) ? ( ~0u << xSize ) : 0;
+        for ( int x = 0; x < xSize; x++ )
+        {
+            uint8_t spad = bytes[ FUZZ_HEADER_SIZE + r * xSize + x ];
+            input->channels[ r * xSize + x ] = spad & FUZZ_SPAD_CHANNEL;
+            input->enable[ r ] |= (uint32_t)( !! ( spad & FUZZ_SPAD_ENABLE ) ) << x;
+        }
+    }
+    input->mask.enable = input->enable;
+    input->mask.channels = input->channels;
+    input->mask.xOffset_2 = (int8_t)bytes[ FUZZ_X_OFFSET ];
+    input->mask.yOffset_2 = (int8_t)bytes[ FUZZ_Y_OFFSET ];
+    input->mask.xSize = xSize;
+    input->mask.ySize = ySize;
+}
+
+/* the incremental validator on the input and on the input with one edit */
+static uint32_t fuzzValidator ( fuzzInput * input, const uint8_t * data, size_t size, uint8_t expected )
+{
+    static tmf8x2xSpadValidator validator;
+    tmf8x2xHalMainSpadConfig config;
+    tmf8x2xSpadMask * mask = &input->mask;
+    uint32_t spads = (uint32_t)mask->xSize * mask->ySize;
+    uint32_t differences = 0;
+    uint8_t spad = ( size > FUZZ_EDIT_SPAD ) ? data[ FUZZ_EDIT_SPAD ] : 0;
+    uint8_t value = ( size > FUZZ_EDIT_VALUE ) ? data[ FUZZ_EDIT_VALUE ] : 0;
+
+    if ( tmf8x2xValidatorInit( &validator, mask ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return 0; /* channels > 9 or too large, the validator does not take the mask */
+    }
+    if ( tmf8x2xValidatorResult( &validator ) != expected )
+    {
+        differences |= DIFF_VALIDATOR;
+    }
+    if ( spads )
+    {
+        uint32_t i = spad % spads;
+        uint8_t x = (uint8_t)( i % mask->xSize );
+        uint8_t y = (uint8_t)( mask->ySize - 1 - i / mask->xSize );
+        input->channels[ i ] = value % TMF8X2X_NUMBER_OF_CHANNELS;
+        tmf8x2xValidatorSetChannel( &validator, x, y, input->channels[ i ] );
+        if ( value & FUZZ_EDIT_TOGGLE )
+        {
+            input->enable[ i / mask->xSize ] ^= 1u << x;
+            tmf8x2xValidatorSetEnable( &validator, x, y, ( input->enable[ i / mask->xSize ] >> x ) & 1 );
+        }
+        if ( tmf8x2xValidatorResult( &validator ) != refValidate( &config, mask ) )
+        {
+            differences |= DIFF_VALIDATOR_EDIT;
+        }
+    }
+    return differences;
+}
+
+/* runs one input through the tool and the reference model, returns the DIFF_* bits of all results that differ */
+static uint32_t fuzzOne ( const uint8_t * data, size_t size )
+{
+    static fuzzInput input;
+    tmf8x2xHalMainSpadConfig expected;
+    tmf8x2xHalMainSpadConfig config;
+    tmf8x2xHalMainSpadConfig reference;
+    tmf8x2xSpadMask * mask = &input.mask;
+    uint32_t differences = 0;
+    uint8_t result;
+    uint8_t created;
+
+    fuzzDecode( &input, data, size );
+    result = refValidate( &reference, mask );
+    referenceResults[ result ]++;
+
+    if ( tmf8x2xValidateSpadMask( &config, mask ) != result )
+    {
+        differences |= DIFF_VALIDATE;
+    }
+
+    /* creation with every kernel the CPU supports, the packed configuration is compared as a whole (the structure has no padding) */
+    created = ( refCreate( &expected, mask ) == TMF8X2X_SPAD_MAP_OK );
+    for ( uint8_t kernel = TMF8X2X_KERNEL_AUTO; kernel <= TMF8X2X_KERNEL_BMI2; kernel++ )
+    {
+        if ( tmf8x2xSetKernel( kernel ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            continue;
+        }
+        if (  ( tmf8x2xCreateMainSpad( &config, mask ) != 0 ) != created
+           || ( created && memcmp( &config, &expected, sizeof( config ) ) != 0 )
+           )
+        {
+            differences |= ( kernel == TMF8X2X_KERNEL_AUTO ) ? DIFF_CREATE : DIFF_KERNEL;
+        }
+    }
+    tmf8x2xSetKernel( TMF8X2X_KERNEL_AUTO );
+
+    /* every check on its own, also behind a failing check */
+    if ( created )
+    {
+        uint8_t area = refArea( mask->xOffset_2, mask->yOffset_2, mask->xSize, mask->ySize );
+        uint8_t assignment = refAssignment( mask );
+        uint8_t readBack[ FUZZ_MAX_SPADS ];
+        if ( tmf8x2xCheckMainSpadArea( &expected ) != area )
+        {
+            differences |= DIFF_AREA;
+        }
+        if ( tmf8x2xCheckMainSpadChannelSetup( mask->channels, mask->xSize, mask->ySize ) != refChannelSetup( mask->channels, mask->xSize * mask->ySize ) )
+        {
+            differences |= DIFF_CHANNEL_SETUP;
+        }
+        if ( tmf8x2xCheckMainSpadAssignment( &expected ) != assignment )
+        {
+            differences |= DIFF_ASSIGNMENT;
+        }
+        if ( tmf8x2xCheckMainSpadAssignmentReference( &expected ) != assignment )
+        {
+            differences |= DIFF_ASSIGNMENT_REFERENCE;
+        }
+
+        /* tmf8x2xLibCheck sees the channels of the packed configuration */
+        for ( int i = 0; i < mask->xSize * mask->ySize; i++ )
+        {
+            readBack[ i ] = refChannel( mask, i % mask->xSize, mask->ySize - 1 - i / mask->xSize );
+        }
+        if ( ( tmf8x2xLibCheck( &expected, 0 ) == TMF8X2X_LIB_OK )
+          != ( area == TMF8X2X_SPAD_MAP_OK && refChannelSetup( readBack, mask->xSize * mask->ySize ) == TMF8X2X_SPAD_MAP_OK && assignment == TMF8X2X_SPAD_MAP_OK ) )
+        {
+            differences |= DIFF_LIB_CHECK;
+        }
+    }
+
+    if ( ( tmf8x2xLibValidateMask( &config, mask, 0 ) == TMF8X2X_LIB_OK ) != ( result == TMF8X2X_VALIDATE_OK ) )
+    {
+        differences |= DIFF_LIB_VALIDATE;
+    }
+
+    return differences | fuzzValidator( &input, data, size, result ); /* last, it edits the input */
+}
+
+#ifdef TMF8X2X_FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput ( const uint8_t * data, size_t size );
+
+int LLVMFuzzerTestOneInput ( const uint8_t * data, size_t size )
+{
+    uint32_t differences = fuzzOne( data, size );
+    if ( differences )
+    {
+        for ( uint32_t d = 0; d < DIFF_COUNT; d++ )
+        {
+            if ( differences & ( 1u << d ) )
+            {
+                fprintf( stderr, "divergent: %s\n", diffNames[ d ] );
+            }
+        }
+        abort( ); /* libFuzzer saves and minimizes the input */
+    }
+    return 0;
+}
+
+#else
+
+/*
+ *****************************************************************************
+ * STANDALONE DRIVER
+ *****************************************************************************
+ */
+
+static uint64_t randomState = 0x2545f4914f6cdd1dull;
+
+static uint32_t fuzzRandom ( void )
+{
+    /* xorshift64* */
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return (uint32_t)( ( randomState * 0x2545f4914f6cdd1dull ) >> 32 );
+}
+
+/* offset for a map of the given size: 0, in range, at the edges of the area / the corner checks, or extreme */
+static int8_t fuzzOffset ( int size, int area, int center_2, int limit )
+{
+    int extremes[ 6 ] = { -128, 127, -limit, limit, -limit - 1, limit + 1 };
+    int jitter = (int)( fuzzRandom( ) % 5 ) - 2;
+
+    switch ( fuzzRandom( ) % 12 )
+    {
+        case 0:  return (int8_t)( (int)( fuzzRandom( ) % ( 2 * limit + 1 ) ) - limit );
+        case 1:  return (int8_t)( area - size + jitter );
+        case 2:  return (int8_t)( size - area + jitter );
+        case 3:  return (int8_t)( size - center_2 + jitter );
+        case 4:  return (int8_t)extremes[ fuzzRandom( ) % 6 ];
+        default: return 0;
+    }
+}
+
+/* a random input, channels mostly in clusters and rows of 1..7 or 2..9, so that all checks are reached */
+static void fuzzGenerate ( uint8_t * data )
+{
+    uint32_t density = fuzzRandom( ) % 4;
+    int xSize;
+    int ySize;
+
+    switch ( fuzzRandom( ) % 8 )
+    {
+        case 0:  xSize = 1; ySize = 1 + fuzzRandom( ) % TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; break;
+        case 1:  xSize = 1 + fuzzRandom( ) % TMF8X2X_MAIN_SPAD_MAX_X_SIZE; ySize = 1; break;
+        case 2:  xSize = TMF8X2X_MAIN_SPAD_MAX_X_SIZE; ySize = TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; break;
+        case 3:  xSize = fuzzRandom( ) % FUZZ_X_SIZES; ySize = fuzzRandom( ) % FUZZ_Y_SIZES; break;
+        default: xSize = 1 + fuzzRandom( ) % TMF8X2X_MAIN_SPAD_MAX_X_SIZE; ySize = 1 + fuzzRandom( ) % TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; break;
+    }
+    data[ FUZZ_X_SIZE ] = (uint8_t)xSize;
+    data[ FUZZ_Y_SIZE ] = (uint8_t)ySize;
+    data[ FUZZ_X_OFFSET ] = (uint8_t)fuzzOffset( xSize, TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE, X_CENTER_2_A, 2 * TMF8X2X_MAIN_SPAD_COLUMNS - 1 );
+    data[ FUZZ_Y_OFFSET ] = (uint8_t)fuzzOffset( ySize, TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE, Y_CENTER_2_A, 2 * TMF8X2X_MAIN_SPAD_ROWS - 1 );
+    data[ FUZZ_JUNK ] = ( fuzzRandom( ) % 8 ) ? 0 : (uint8_t)fuzzRandom( );
+    data[ FUZZ_EDIT_SPAD ] = (uint8_t)fuzzRandom( );
+    data[ FUZZ_EDIT_VALUE ] = (uint8_t)fuzzRandom( );
+
+    for ( int r = 0; r < ySize; r++ )
+    {
+        int high = ( fuzzRandom( ) % 3 ) == 0;
+        for ( int x = 0; x < xSize; x++ )
+        {
+            uint8_t * spad = &data[ FUZZ_HEADER_SIZE + r * xSize + x ];
+            uint32_t ch;
+            if ( ( fuzzRandom( ) % 64 ) == 0 )
+            {
+                ch = fuzzRandom( ) & FUZZ_SPAD_CHANNEL;                 /* any value, also 0 and 10..15 */
+            }
+            else if ( x > 0 && ( fuzzRandom( ) % 4 ) != 0 )
+            {
+                ch = spad[ -1 ] & FUZZ_SPAD_CHANNEL;                    /* same as the left neighbour */
+            }
+            else if ( r > 0 && ( fuzzRandom( ) % 2 ) != 0 && ( spad[ -xSize ] & FUZZ_SPAD_CHANNEL ) >= 2 && ( spad[ -xSize ] & FUZZ_SPAD_CHANNEL ) <= 7 )
+            {
+                ch = spad[ -xSize ] & FUZZ_SPAD_CHANNEL;                /* same as the neighbour above, if it fits this row */
+            }
+            else
+            {
+                ch = 2 + fuzzRandom( ) % 6;
+                if ( ( fuzzRandom( ) % 4 ) == 0 )
+                {
+                    ch = high ? 8 + fuzzRandom( ) % 2 : 1;
+                }
+            }
+            *spad = (uint8_t)( ch | ( fuzzRandom( ) & ~( FUZZ_SPAD_CHANNEL | FUZZ_SPAD_ENABLE ) ) ); /* unused bits are random */
+            switch ( density )
+            {
+                case 0:  *spad |= FUZZ_SPAD_ENABLE; break;
+                case 1:  *spad |= ( fuzzRandom( ) & 1 ) ? FUZZ_SPAD_ENABLE : 0; break;
+                case 2:  *spad |= ( ( fuzzRandom( ) % 8 ) == 0 ) ? FUZZ_SPAD_ENABLE : 0; break;
+                default: *spad |= ( ( fuzzRandom( ) % 8 ) != 0 ) ? FUZZ_SPAD_ENABLE : 0; break;
+            }
+        }
+    }
+}
+
+/* greedy minimization: simplifies one byte at a time as long as one of the divergences stays */
+static void fuzzMinimize ( uint8_t * data, uint32_t differences )
+{
+    uint8_t candidate[ FUZZ_INPUT_SIZE ];
+    uint64_t results[ TMF8X2X_VALIDATE_ERROR_ASSIGNMENT + 1 ];
+    int changed = 1;
+
+    memcpy( results, referenceResults, sizeof( results ) ); /* the statistics are about generated inputs only */
+    while ( changed )
+    {
+        changed = 0;
+        for ( uint32_t i = 0; i < FUZZ_INPUT_SIZE; i++ )
+        {
+            /* smaller sizes and offsets closer to 0 first, then fewer enabled SPADs and lower channels */
+            for ( uint32_t value = 0; value < data[ i ]; value++ )
+            {
+                if ( ( i == FUZZ_X_OFFSET || i == FUZZ_Y_OFFSET ) && value > 0 && abs( (int8_t)value ) >= abs( (int8_t)data[ i ] ) )
+                {
+                    continue;
+                }
+                memcpy( candidate, data, FUZZ_INPUT_SIZE );
+                candidate[ i ] = (uint8_t)value;
+                if ( fuzzOne( candidate, FUZZ_INPUT_SIZE ) & differences )
+                {
+                    data[ i ] = (uint8_t)value;
+                    changed = 1;
+                    break;
+                }
+            }
+        }
+    }
+    memcpy( referenceResults, results, sizeof( results ) );
+}
+
+static uint64_t fuzzHash ( const uint8_t * data, uint32_t size )
+{
+    uint64_t hash = 0xcbf29ce484222325ull; /* FNV-1a */
+    for ( uint32_t i = 0; i < size; i++ )
+    {
+        hash = ( hash ^ data[ i ] ) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/* writes a minimized input, and the mask as batch record if the format can hold it */
+static void fuzzSave ( const char * directory, const uint8_t * data, uint32_t differences )
+{
+    static fuzzInput input;
+    tmf8x2xSpadMask * mask = &input.mask;
+    char fileName[ 1024 ];
+    uint32_t size;
+    uint64_t hash;
+    FILE * file;
+    int batch = 1;
+
+    fuzzDecode( &input, data, FUZZ_INPUT_SIZE );
+    size = FUZZ_HEADER_SIZE + mask->xSize * mask->ySize;
+    hash = fuzzHash( data, size );
+
+    if ( mkdir( directory, 0777 ) != 0 && errno != EEXIST )
+    {
+        fprintf( stderr, "ERROR creating %s\n", directory );
+        return;
+    }
+    snprintf( fileName, sizeof( fileName ), "%s/%016llx.bin", directory, (unsigned long long)hash );
+    file = fopen( fileName, "wb" );
+    if ( ! file || fwrite( data, 1, size, file ) != size )
+    {
+        fprintf( stderr, "ERROR writing %s\n", fileName );
+    }
+    if ( file )
+    {
+        fclose( file );
+    }
+    printf( "# divergent:" );
+    for ( uint32_t d = 0; d < DIFF_COUNT; d++ )
+    {
+        printf( ( differences & ( 1u << d ) ) ? " %s" : "", diffNames[ d ] );
+    }
+    printf( ", saved %s\n", fileName );
+
+    for ( int i = 0; i < mask->xSize * mask->ySize; i++ )
+    {
+        batch &= ( mask->channels[ i ] < TMF8X2X_NUMBER_OF_CHANNELS );
+    }
+    if (  ! batch || data[ FUZZ_JUNK ] != 0 || mask->xSize < 1 || mask->ySize < 1
+       || mask->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || mask->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE
+       )
+    {
+        return;
+    }
+    snprintf( fileName, sizeof( fileName ), "%s/%016llx.txt", directory, (unsigned long long)hash );
+    file = fopen( fileName, "w" );
+    if ( ! file )
+    {
+        fprintf( stderr, "ERROR writing %s\n", fileName );
+        return;
+    }
+    fprintf( file, "# divergent input %016llx, the validator edit is only in the .bin file\nmap %d %d fuzz%016llx\n"
+           , (unsigned long long)hash, mask->xOffset_2, mask->yOffset_2, (unsigned long long)hash );
+    for ( int r = 0; r < mask->ySize; r++ )
+    {
+        for ( int x = 0; x < mask->xSize; x++ )
+        {
+            fprintf( file, x ? " %u" : "%u", mask->channels[ r * mask->xSize + x ] );
+        }
+        fprintf( file, "\n" );
+    }
+    fprintf( file, "mask\n" );
+    for ( int r = 0; r < mask->ySize; r++ )
+    {
+        for ( int x = 0; x < mask->xSize; x++ )
+        {
+            fprintf( file, x ? " %u" : "%u", ( mask->enable[ r ] >> x ) & 1 );
+        }
+        fprintf( file, "\n" );
+    }
+    if ( fclose( file ) != 0 )
+    {
+        fprintf( stderr, "ERROR writing %s\n", fileName );
+    }
+}
+
+static void fuzzReport ( uint64_t execs, uint64_t divergent, uint64_t ns )
+{
+    double seconds = (double)ns / 1e9;
+    printf( "# execs: %llu, divergent: %llu, seconds: %.1f, exec/s: %.0f\n"
+          , (unsigned long long)execs, (unsigned long long)divergent, seconds, seconds > 0 ? execs / seconds : 0.0 );
+    fflush( stdout );
+}
+
+/* runs the given input files once each */
+static int fuzzFiles ( int count, char ** fileNames )
+{
+    int divergent = 0;
+
+    for ( int f = 0; f < count; f++ )
+    {
+        uint8_t data[ FUZZ_INPUT_SIZE ];
+        uint32_t differences;
+        size_t size;
+        FILE * file = fopen( fileNames[ f ], "rb" );
+        if ( ! file )
+        {
+            fprintf( stderr, "ERROR reading %s\n", fileNames[ f ] );
+            return 1;
+        }
+        size = fread( data, 1, sizeof( data ), file );
+        fclose( file );
+
+        differences = fuzzOne( data, size );
+        printf( "%s:%s", fileNames[ f ], differences ? "" : " OK" );
+        for ( uint32_t d = 0; d < DIFF_COUNT; d++ )
+        {
+            printf( ( differences & ( 1u << d ) ) ? " %s" : "", diffNames[ d ] );
+        }
+        printf( "\n" );
+        divergent |= ( differences != 0 );
+    }
+    return divergent;
+}
+
+int main ( int argc, char **argv )
+{
+    uint8_t data[ FUZZ_INPUT_SIZE ];
+    const char * directory = FUZZ_DEFAULT_DIRECTORY;
+    uint64_t execs = FUZZ_DEFAULT_EXECS;
+    uint64_t seconds = 0;
+    uint64_t seed = (uint64_t)tmf8x2xTimeNs( );
+    uint64_t divergent = 0;
+    uint64_t start;
+    uint64_t report;
+    uint64_t n;
+    int i;
+
+    for ( i = 1; i + 1 < argc && argv[ i ][ 0 ] == '-'; i += 2 )
+    {
+        if ( strcmp( argv[ i ], "-n" ) == 0 )
+        {
+            execs = strtoull( argv[ i + 1 ], 0, 10 );
+        }
+        else if ( strcmp( argv[ i ], "-t" ) == 0 )
+        {
+            seconds = strtoull( argv[ i + 1 ], 0, 10 );
+        }
+        else if ( strcmp( argv[ i ], "-s" ) == 0 )
+        {
+            seed = strtoull( argv[ i + 1 ], 0, 10 );
+        }
+        else if ( strcmp( argv[ i ], "-o" ) == 0 )
+        {
+            directory = argv[ i + 1 ];
+        }
+        else
+        {
+            break;
+        }
+    }
+    if ( i < argc && argv[ i ][ 0 ] == '-' )
+    {
+        fprintf( stderr, "usage: spad_fuzz [-n execs (0: no limit)] [-t seconds (0: no limit)] [-s seed] [-o directory] [input file ...]\n" );
+        return 1;
+    }
+    if ( i < argc )
+    {
+        return fuzzFiles( argc - i, argv + i );
+    }
+
+    randomState = seed ? seed : 1;
+    printf( "# seed: %llu, kernels:", (unsigned long long)seed );
+    for ( uint8_t kernel = TMF8X2X_KERNEL_SCALAR; kernel <= TMF8X2X_KERNEL_BMI2; kernel++ )
+    {
+        if ( tmf8x2xSetKernel( kernel ) == TMF8X2X_SPAD_MAP_OK )
+        {
+            printf( " %s", tmf8x2xKernelName( kernel ) );
+        }
+    }
+    tmf8x2xSetKernel( TMF8X2X_KERNEL_AUTO );
+    printf( "\n" );
+
+    start = tmf8x2xTimeNs( );
+    report = start + FUZZ_REPORT_NS;
+    for ( n = 0; execs == 0 || n < execs; n++ )
+    {
+        uint32_t differences;
+        memset( data, 0, sizeof( data ) );
+        fuzzGenerate( data );
+        differences = fuzzOne( data, sizeof( data ) );
+        if ( differences )
+        {
+            if ( divergent++ < FUZZ_MAX_SAVED )
+            {
+                fuzzMinimize( data, differences );
+                fuzzSave( directory, data, fuzzOne( data, sizeof( data ) ) );
+            }
+        }
+        if ( ( n & 0x3FF ) == 0 )
+        {
+            uint64_t now = tmf8x2xTimeNs( );
+            if ( seconds && now - start >= seconds * 1000000000u )
+            {
+                break;
+            }
+            if ( now >= report )
+            {
+                fuzzReport( n, divergent, now - start );
+                report = now + FUZZ_REPORT_NS;
+            }
+        }
+    }
+
+    fuzzReport( n, divergent, tmf8x2xTimeNs( ) - start );
+    printf( "# reference results: ok %llu, create %llu, area %llu, channel setup %llu, assignment %llu\n"
+          , (unsigned long long)referenceResults[ TMF8X2X_VALIDATE_OK ], (unsigned long long)referenceResults[ TMF8X2X_VALIDATE_ERROR_CREATE ]
+          , (unsigned long long)referenceResults[ TMF8X2X_VALIDATE_ERROR_AREA ], (unsigned long long)referenceResults[ TMF8X2X_VALIDATE_ERROR_CHANNEL ]
+          , (unsigned long long)referenceResults[ TMF8X2X_VALIDATE_ERROR_ASSIGNMENT ] );
+    return divergent != 0;
+}
+
+#endif /* TMF8X2X_FUZZ_LIBFUZZER */
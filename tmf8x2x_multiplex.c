@@ -0,0 +1,221 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_multiplex.c
+ *  \brief time-multiplexed 4x4 zone SPAD maps, splits one 16 zone layout into the two captures and checks them together.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_multiplex.h"
+
+/*
+ *****************************************************************************
+ * LAYOUT PARSING
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xParseMultiplexLayout ( tmf8x2xMultiplexLayout * layout, const char * zoneText, uint32_t zoneLength, const char * maskText, uint32_t maskLength, int8_t xOffset_2, int8_t yOffset_2 )
+{
+    uint8_t xSize;
+    uint8_t ySize;
+
+    if ( ! layout
+        || tmf8x2xParseSpadMatrix( layout->zones, &xSize, &ySize, zoneText, zoneLength, TMF8X2X_MULTIPLEX_ZONES ) != TMF8X2X_SPAD_MAP_OK
+        )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    for ( uint32_t i = 0; i < (uint32_t)xSize * ySize; i++ )
+    {
+        if ( layout->zones[ i ] == 0 ) /* zones are numbered from 1 */
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+
+    if ( maskText )
+    {
+        uint8_t maskXSize;
+        uint8_t maskYSize;
+        if (  tmf8x2xParseSpadMatrix( layout->enable, &maskXSize, &maskYSize, maskText, maskLength, TMF8X2X_PARSER_MAX_ENABLE ) != TMF8X2X_SPAD_MAP_OK
+            || maskXSize != xSize
+            || maskYSize != ySize
+            )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    else
+    {
+        for ( uint32_t i = 0; i < (uint32_t)xSize * ySize; i++ )
+        {
+            layout->enable[ i ] = 1;
+        }
+    }
+
+    layout->xOffset_2 = xOffset_2;
+    layout->yOffset_2 = yOffset_2;
+    layout->xSize = xSize;
+    layout->ySize = ySize;
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/*
+ *****************************************************************************
+ * CAPTURE SPLITTING
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xSplitMultiplexLayout ( tmf8x2xMultiplexPair * pair, const tmf8x2xMultiplexLayout * layout )
+{
+    uint32_t total = (uint32_t)layout->xSize * layout->ySize;
+
+    if ( layout->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || layout->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    for ( uint32_t c = 0; c < TMF8X2X_MULTIPLEX_CAPTURES; c++ )
+    {
+        tmf8x2xSpadMaskStorage * capture = &pair->capture[ c ];
+        for ( uint32_t i = 0; i < total; i++ )
+        {
+            uint32_t zone = layout->zones[ i ];
+            if ( zone == 0 || zone > TMF8X2X_MULTIPLEX_ZONES )
+            {
+                return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+            }
+            /* same channel map in both captures, only SPADs of the zones of this capture are enabled */
+            capture->channels[ i ] = (uint8_t)( ( zone - 1 ) % TMF8X2X_MULTIPLEX_ZONES_PER_CAPTURE + 1 );
+            capture->enable[ i ] = (uint8_t)( layout->enable[ i ] && ( zone - 1 ) / TMF8X2X_MULTIPLEX_ZONES_PER_CAPTURE == c );
+        }
+        tmf8x2xPackEnableMask( capture->enablePacked, capture->enable, layout->xSize, layout->ySize );
+
+        capture->mask.enable = capture->enablePacked;
+        capture->mask.channels = capture->channels;
+        capture->mask.id = (uint8_t)c;
+        capture->mask.xOffset_2 = layout->xOffset_2;
+        capture->mask.yOffset_2 = layout->yOffset_2;
+        capture->mask.xSize = layout->xSize;
+        capture->mask.ySize = layout->ySize;
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/*
+ *****************************************************************************
+ * PAIR CHECKS
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xValidateMultiplexPair ( tmf8x2xMultiplexPair * pair, const tmf8x2xMultiplexLayout * layout )
+{
+    const tmf8x2xHalMainSpadConfig * a = &pair->config[ TMF8X2X_MULTIPLEX_CAPTURE_A ];
+    const tmf8x2xHalMainSpadConfig * b = &pair->config[ TMF8X2X_MULTIPLEX_CAPTURE_B ];
+    uint32_t layoutEnable[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    uint32_t spadsPerZone[ TMF8X2X_MULTIPLEX_ZONES + 1 ] = { 0 };
+
+    pair->captureResult[ TMF8X2X_MULTIPLEX_CAPTURE_A ] = TMF8X2X_VALIDATE_ERROR_CREATE;
+    pair->captureResult[ TMF8X2X_MULTIPLEX_CAPTURE_B ] = TMF8X2X_VALIDATE_ERROR_CREATE;
+    if ( tmf8x2xSplitMultiplexLayout( pair, layout ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return TMF8X2X_MULTIPLEX_ERROR_LAYOUT;
+    }
+
+    for ( uint32_t c = 0; c < TMF8X2X_MULTIPLEX_CAPTURES; c++ )
+    {
+        pair->captureResult[ c ] = tmf8x2xValidateSpadMask( &pair->config[ c ], &pair->capture[ c ].mask );
+    }
+    if ( pair->captureResult[ TMF8X2X_MULTIPLEX_CAPTURE_A ] != TMF8X2X_VALIDATE_OK )
+    {
+        return TMF8X2X_MULTIPLEX_ERROR_CAPTURE_A;
+    }
+    if ( pair->captureResult[ TMF8X2X_MULTIPLEX_CAPTURE_B ] != TMF8X2X_VALIDATE_OK )
+    {
+        return TMF8X2X_MULTIPLEX_ERROR_CAPTURE_B;
+    }
+
+    /* both captures have to cover the same SPAD area */
+    if (  a->xOffset_2 != b->xOffset_2 || a->yOffset_2 != b->yOffset_2
+       || a->xSize != b->xSize || a->ySize != b->ySize
+       )
+    {
+        return TMF8X2X_MULTIPLEX_ERROR_GEOMETRY;
+    }
+
+    /* the captures are checked on the packed configurations, as they are sent to the device */
+    tmf8x2xPackEnableMask( layoutEnable, layout->enable, layout->xSize, layout->ySize );
+    for ( uint32_t y = 0; y < a->ySize; y++ )
+    {
+        if ( a->enableSpad[ y ] & b->enableSpad[ y ] )
+        {
+            return TMF8X2X_MULTIPLEX_ERROR_OVERLAP;
+        }
+        if ( ( a->enableSpad[ y ] | b->enableSpad[ y ] ) != layoutEnable[ a->ySize - 1 - y ] ) /* layout starts with the top row */
+        {
+            return TMF8X2X_MULTIPLEX_ERROR_COVERAGE;
+        }
+    }
+
+    for ( uint32_t i = 0; i < (uint32_t)layout->xSize * layout->ySize; i++ )
+    {
+        spadsPerZone[ layout->zones[ i ] ] += layout->enable[ i ];
+    }
+    for ( uint32_t zone = 1; zone <= TMF8X2X_MULTIPLEX_ZONES; zone++ )
+    {
+        if ( spadsPerZone[ zone ] == 0 )
+        {
+            return TMF8X2X_MULTIPLEX_ERROR_COVERAGE;
+        }
+    }
+
+    return TMF8X2X_MULTIPLEX_OK;
+}
+
+const char * tmf8x2xMultiplexResultName ( uint8_t result )
+{
+    switch ( result )
+    {
+        case TMF8X2X_MULTIPLEX_OK:                  return "OK";
+        case TMF8X2X_MULTIPLEX_ERROR_LAYOUT:        return "zone layout";
+        case TMF8X2X_MULTIPLEX_ERROR_CAPTURE_A:     return "capture A (zones 1..8)";
+        case TMF8X2X_MULTIPLEX_ERROR_CAPTURE_B:     return "capture B (zones 9..16)";
+        case TMF8X2X_MULTIPLEX_ERROR_GEOMETRY:      return "captures differ in size / offset";
+        case TMF8X2X_MULTIPLEX_ERROR_OVERLAP:       return "SPAD enabled in both captures";
+        case TMF8X2X_MULTIPLEX_ERROR_COVERAGE:      return "coverage, SPAD or zone missing";
+        default:                                    return "unknown error";
+    }
+}
@@ -0,0 +1,142 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_multiplex.h
+ *  \brief time-multiplexed 4x4 zone SPAD maps, splits one 16 zone layout into the two captures and checks them together.
+ *
+ * The layout assigns each SPAD to a zone 1..16. Capture A measures zones 1..8, capture B zones 9..16. Zone k uses
+ * TDC channel ((k-1) % 8) + 1 in both captures, so both captures share the same channel map and differ only in the
+ * enabled SPADs: a SPAD is enabled in the capture of its zone (if it is enabled in the layout) and disabled in the other one.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_parser.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_MULTIPLEX_H
+#define TMF8X2X_MULTIPLEX_H
+
+/* zones of the time-multiplexed layout, measured in two captures */
+#define TMF8X2X_MULTIPLEX_ZONES             16
+#define TMF8X2X_MULTIPLEX_CAPTURES          2
+#define TMF8X2X_MULTIPLEX_ZONES_PER_CAPTURE ( TMF8X2X_MULTIPLEX_ZONES / TMF8X2X_MULTIPLEX_CAPTURES )
+
+/* the two captures */
+#define TMF8X2X_MULTIPLEX_CAPTURE_A         0
+#define TMF8X2X_MULTIPLEX_CAPTURE_B         1
+
+/* results of tmf8x2xValidateMultiplexPair */
+#define TMF8X2X_MULTIPLEX_OK                0
+#define TMF8X2X_MULTIPLEX_ERROR_LAYOUT      1   /* a zone is out of range or the layout is too large */
+#define TMF8X2X_MULTIPLEX_ERROR_CAPTURE_A   2   /* capture A failed tmf8x2xValidateSpadMask, see captureResult */
+#define TMF8X2X_MULTIPLEX_ERROR_CAPTURE_B   3   /* capture B failed tmf8x2xValidateSpadMask, see captureResult */
+#define TMF8X2X_MULTIPLEX_ERROR_GEOMETRY    4   /* the captures differ in size or offset */
+#define TMF8X2X_MULTIPLEX_ERROR_OVERLAP     5   /* a SPAD is enabled in both captures */
+#define TMF8X2X_MULTIPLEX_ERROR_COVERAGE    6   /* an enabled SPAD of the layout is missing, or a zone has no enabled SPAD */
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* a time-multiplexed 4x4 layout in human readable format, top row first */
+typedef struct _tmf8x2xMultiplexLayout
+{
+    uint8_t zones[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];   /* zone 1..16 of each SPAD */
+    uint8_t enable[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];  /* SPAD enable bits */
+    int8_t xOffset_2;
+    int8_t yOffset_2;
+    uint8_t xSize;
+    uint8_t ySize;
+} tmf8x2xMultiplexLayout;
+
+/* both captures of a layout, in human readable and in machine readable format */
+typedef struct _tmf8x2xMultiplexPair
+{
+    tmf8x2xSpadMaskStorage capture[ TMF8X2X_MULTIPLEX_CAPTURES ];
+    tmf8x2xHalMainSpadConfig config[ TMF8X2X_MULTIPLEX_CAPTURES ];
+    uint8_t captureResult[ TMF8X2X_MULTIPLEX_CAPTURES ];        /* tmf8x2xValidateSpadMask result of each capture */
+} tmf8x2xMultiplexPair;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xParseMultiplexLayout builds a layout from the text of a zone map and a SPAD mask in linux driver format
+ * @param layout receives the layout
+ * @param zoneText text of the zone map, one row of zones 1..16 per line
+ * @param zoneLength length of the zone map text
+ * @param maskText text of the SPAD mask, or 0 to enable all SPADs
+ * @param maskLength length of the SPAD mask text
+ * @param xOffset_2 center offset in Q1 to FOV center in x direction
+ * @param yOffset_2 center offset in Q1 to FOV center in y direction
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if a text could not be parsed, a zone is out of range or the sizes differ, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xParseMultiplexLayout( tmf8x2xMultiplexLayout * layout, const char * zoneText, uint32_t zoneLength, const char * maskText, uint32_t maskLength, int8_t xOffset_2, int8_t yOffset_2 );
+
+/**
+ * @brief tmf8x2xSplitMultiplexLayout creates the human readable SPAD masks of both captures of a layout
+ * @param pair receives the SPAD masks in pair->capture[ ]
+ * @param layout time-multiplexed 4x4 layout
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if a zone is out of range or the size is too large, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xSplitMultiplexLayout( tmf8x2xMultiplexPair * pair, const tmf8x2xMultiplexLayout * layout );
+
+/**
+ * @brief tmf8x2xValidateMultiplexPair splits a layout, creates and checks both captures and checks them against each other
+ * (same geometry, no SPAD enabled in both captures, every enabled SPAD of the layout enabled in one capture, every zone has enabled SPADs)
+ * @param pair receives both captures
+ * @param layout time-multiplexed 4x4 layout
+ * @return TMF8X2X_MULTIPLEX_OK or the first check that failed (TMF8X2X_MULTIPLEX_ERROR_*)
+ */
+uint8_t tmf8x2xValidateMultiplexPair( tmf8x2xMultiplexPair * pair, const tmf8x2xMultiplexLayout * layout );
+
+/**
+ * @brief tmf8x2xMultiplexResultName returns a short description of a tmf8x2xValidateMultiplexPair result
+ * @param result of tmf8x2xValidateMultiplexPair
+ * @return description
+ */
+const char * tmf8x2xMultiplexResultName( uint8_t result );
+
+#endif /* TMF8X2X_MULTIPLEX_H */
@@ -0,0 +1,260 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_optimizer.c
+ *  \brief per-zone uniformity optimizer, searches the SPAD enable mask of a fixed channel layout for equal enabled SPAD counts per zone.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_validator.h"
+#include "tmf8x2x_optimizer.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#define OPTIMIZER_END_TEMPERATURE           0.05
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* state of the search, the validator checks each flip in constant time */
+typedef struct _optimizerState
+{
+    tmf8x2xSpadValidator validator;
+    uint8_t candidateX[ TMF8X2X_VALIDATOR_MAX_SPADS ];                      /* SPADs that may be flipped */
+    uint8_t candidateY[ TMF8X2X_VALIDATOR_MAX_SPADS ];
+    uint32_t candidateCount;
+    uint32_t zones;                                                         /* bit ch is set for scored channels */
+    int32_t total;
+    int32_t target;
+    int32_t weight;
+} optimizerState;
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief optimizerSetup builds the search state of a SPAD mask
+ * @param state receives the state
+ * @param storage SPAD mask, the enabled SPADs are the flip candidates
+ * @param target enabled SPADs per zone, 0 for the smallest zone of the start mask
+ * @param weight balance weight
+ */
+static void optimizerSetup( optimizerState * state, const tmf8x2xSpadMaskStorage * storage, int32_t target, int32_t weight );
+
+/**
+ * @brief optimizerScore computes the score of the current mask from scratch
+ * @param state search state
+ * @return score
+ */
+static int32_t optimizerScore( const optimizerState * state );
+
+/**
+ * @brief optimizerRandom xorshift random number generator
+ * @param random state of the generator, must not be 0
+ * @return next random number
+ */
+static uint32_t optimizerRandom( uint32_t * random );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static uint32_t optimizerRandom ( uint32_t * random )
+{
+    uint32_t x = *random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *random = x;
+    return x;
+}
+
+static int32_t optimizerScore ( const optimizerState * state )
+{
+    int32_t score = state->total;
+    for ( uint32_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        if ( state->zones & ( 1u << ch ) )
+        {
+            score -= state->weight * abs( state->validator.enabled[ ch ] - state->target );
+        }
+    }
+    return score;
+}
+
+static void optimizerSetup ( optimizerState * state, const tmf8x2xSpadMaskStorage * storage, int32_t target, int32_t weight )
+{
+    const tmf8x2xSpadValidator * validator = &state->validator;
+
+    tmf8x2xValidatorInit( &state->validator, &storage->mask );
+    state->candidateCount = 0;
+    state->zones = 0;
+    state->total = 0;
+    state->weight = weight;
+
+    for ( uint32_t y = 0; y < storage->mask.ySize; y++ )
+    {
+        for ( uint32_t x = 0; x < storage->mask.xSize; x++ )
+        {
+            uint32_t i = ( storage->mask.ySize - 1 - y ) * storage->mask.xSize + x;
+            if ( validator->enable[ i ] ) /* disabled SPADs of the start mask are never enabled */
+            {
+                state->candidateX[ state->candidateCount ] = (uint8_t)x;
+                state->candidateY[ state->candidateCount ] = (uint8_t)y;
+                state->candidateCount++;
+                state->zones |= 1u << validator->channel[ i ];
+                state->total++;
+            }
+        }
+    }
+
+    state->target = target;
+    for ( uint32_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS && target == 0; ch++ )
+    {
+        if (  ( state->zones & ( 1u << ch ) )
+           && ( state->target == 0 || validator->enabled[ ch ] < state->target )
+           )
+        {
+            state->target = validator->enabled[ ch ];
+        }
+    }
+}
+
+/*
+ *****************************************************************************
+ * OPTIMIZER
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xOptimizeUniformity ( tmf8x2xSpadMaskStorage * storage, uint32_t flips, uint32_t target, uint32_t balanceWeight, uint32_t seed, tmf8x2xOptimizerResult * result )
+{
+    static optimizerState state;
+    static uint8_t best[ TMF8X2X_VALIDATOR_MAX_SPADS ];
+    tmf8x2xSpadValidator * validator = &state.validator;
+    tmf8x2xHalMainSpadConfig config;
+    uint32_t random = seed ? seed : 1;
+    uint32_t size = (uint32_t)storage->mask.xSize * storage->mask.ySize;
+    int32_t score;
+    double temperature;
+    double cooling;
+    uint8_t check = tmf8x2xValidateSpadMask( &config, &storage->mask );
+
+    if ( check != TMF8X2X_VALIDATE_OK )
+    {
+        return check;
+    }
+    if ( target > TMF8X2X_OPTIMIZER_EQUAL_ZONES )
+    {
+        target = TMF8X2X_OPTIMIZER_EQUAL_ZONES;
+    }
+    if ( balanceWeight > TMF8X2X_OPTIMIZER_MAX_WEIGHT )
+    {
+        balanceWeight = TMF8X2X_OPTIMIZER_MAX_WEIGHT;
+    }
+    temperature = (double)balanceWeight + 1.0;  /* early on a larger deviation is accepted now and then */
+
+    optimizerSetup( &state, storage, (int32_t)target, (int32_t)balanceWeight );
+    score = optimizerScore( &state );
+    memcpy( best, validator->enable, size );
+    memset( result, 0, sizeof( *result ) );
+    for ( uint32_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        result->startSpads[ ch ] = validator->enabled[ ch ];
+    }
+    result->target = (uint16_t)state.target;
+    result->startScore = score;
+    result->bestScore = score;
+    cooling = flips ? pow( OPTIMIZER_END_TEMPERATURE / temperature, 1.0 / flips ) : 1.0;
+
+    for ( uint32_t f = 0; f < flips && state.candidateCount; f++, temperature *= cooling )
+    {
+        uint32_t c = optimizerRandom( &random ) % state.candidateCount;
+        uint8_t x = state.candidateX[ c ];
+        uint8_t y = state.candidateY[ c ];
+        uint32_t i = ( validator->ySize - 1u - y ) * validator->xSize + x;
+        uint8_t ch = validator->channel[ i ];
+        uint8_t enable = validator->enable[ i ];
+        int32_t step = enable ? -1 : 1;
+        int32_t spads = validator->enabled[ ch ];
+        int32_t delta = step - state.weight * ( abs( spads + step - state.target ) - abs( spads - state.target ) );
+
+        if ( delta < 0 && ( optimizerRandom( &random ) >> 8 ) * ( 1.0 / 16777216.0 ) >= exp( delta / temperature ) )
+        {
+            continue;
+        }
+
+        /* every candidate has to pass all checks, and no zone may lose all of its SPADs */
+        tmf8x2xValidatorSetEnable( validator, x, y, ! enable );
+        if ( tmf8x2xValidatorResult( validator ) != TMF8X2X_VALIDATE_OK || validator->enabled[ ch ] == 0 )
+        {
+            tmf8x2xValidatorSetEnable( validator, x, y, enable );
+            continue;
+        }
+
+        state.total += step;
+        score += delta;
+        result->accepted++;
+        if ( score > result->bestScore )
+        {
+            result->bestScore = score;
+            memcpy( best, validator->enable, size );
+        }
+    }
+    result->flips = flips;
+
+    /* the best mask replaces the start mask, the full checks confirm the incremental bookkeeping */
+    memcpy( storage->enable, best, size );
+    tmf8x2xPackEnableMask( storage->enablePacked, storage->enable, storage->mask.xSize, storage->mask.ySize );
+    for ( uint32_t i = 0; i < size; i++ )
+    {
+        result->bestSpads[ storage->channels[ i ] ] += storage->enable[ i ];
+    }
+    return tmf8x2xValidateSpadMask( &config, &storage->mask );
+}
@@ -0,0 +1,104 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_optimizer.h
+ *  \brief per-zone uniformity optimizer, searches the SPAD enable mask of a fixed channel layout for equal enabled SPAD counts per zone.
+ *
+ * The score of a mask is: total enabled SPADs - balanceWeight * sum over the zones of | enabled SPADs of the zone - target |.
+ * With a balance weight of at least the number of SPADs, the target count per zone comes first and the total is maximised after that.
+ * The default target is the largest count that all zones can reach: the enabled SPADs of the smallest zone of the start mask.
+ * The search flips single SPADs (simulated annealing). Every candidate passes all checks of tmf8x2xValidateSpadMask,
+ * the incremental validator (tmf8x2x_validator.h) checks each flip in constant time, and no zone may lose all of its SPADs. SPADs that are disabled in the start mask
+ * (e.g. screamers) stay disabled, zones without enabled SPADs in the start mask are not scored.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_parser.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_OPTIMIZER_H
+#define TMF8X2X_OPTIMIZER_H
+
+/* balance weight that makes the target SPAD count per zone the first goal */
+#define TMF8X2X_OPTIMIZER_EQUAL_ZONES       ( TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+
+/* largest balance weight, with targets up to TMF8X2X_OPTIMIZER_EQUAL_ZONES the score of any mask stays within int32 */
+#define TMF8X2X_OPTIMIZER_MAX_WEIGHT        65535
+
+/* default number of single SPAD flips that are tried */
+#define TMF8X2X_OPTIMIZER_DEFAULT_FLIPS     1000000
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* statistics of an optimizer run */
+typedef struct _tmf8x2xOptimizerResult
+{
+    uint16_t startSpads[ TMF8X2X_NUMBER_OF_CHANNELS ];  /* enabled SPADs per zone (channel) before */
+    uint16_t bestSpads[ TMF8X2X_NUMBER_OF_CHANNELS ];   /* enabled SPADs per zone (channel) of the best mask */
+    uint16_t target;                                    /* enabled SPADs per zone that were aimed for */
+    int32_t startScore;
+    int32_t bestScore;
+    uint32_t flips;                                     /* flips tried */
+    uint32_t accepted;                                  /* flips that were valid and accepted */
+} tmf8x2xOptimizerResult;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xOptimizeUniformity searches the enable mask with the best score for the channel layout of a SPAD mask
+ * @param storage SPAD mask to optimize, the channel layout is kept, the enable bits (human readable and packed) are replaced by the best mask found
+ * @param flips number of single SPAD flips to try
+ * @param target enabled SPADs per zone (up to TMF8X2X_OPTIMIZER_EQUAL_ZONES), or 0 for the largest count that all zones can reach
+ * @param balanceWeight SPADs of the total that are worth one SPAD less deviation from the target (TMF8X2X_OPTIMIZER_EQUAL_ZONES: target first), larger than TMF8X2X_OPTIMIZER_MAX_WEIGHT is taken as TMF8X2X_OPTIMIZER_MAX_WEIGHT
+ * @param seed of the random number generator, runs with the same seed give the same result
+ * @param result receives the statistics of the run
+ * @return TMF8X2X_VALIDATE_OK, or the first check that failed for the start mask (the storage is unchanged then)
+ */
+uint8_t tmf8x2xOptimizeUniformity( tmf8x2xSpadMaskStorage * storage, uint32_t flips, uint32_t target, uint32_t balanceWeight, uint32_t seed, tmf8x2xOptimizerResult * result );
+
+#endif /* TMF8X2X_OPTIMIZER_H */
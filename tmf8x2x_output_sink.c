@@ -0,0 +1,233 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_output_sink.c
+ *  \brief buffered output sinks (memory buffer, file descriptor, user callback) with hand-rolled number formatting.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L /* write */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "tmf8x2x_output_sink.h"
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+static const char hexDigits[ 16 ] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+/*
+ *****************************************************************************
+ * SINK SETUP
+ *****************************************************************************
+ */
+
+void tmf8x2xSinkInitMemory ( tmf8x2xOutputSink * sink, char * buffer, uint32_t size )
+{
+    sink->type = TMF8X2X_SINK_MEMORY;
+    sink->buffer = buffer;
+    sink->size = size;
+    sink->used = 0;
+    sink->error = 0;
+    sink->fd = -1;
+    sink->callback = 0;
+    sink->context = 0;
+    if ( size )
+    {
+        buffer[ 0 ] = 0;
+    }
+}
+
+void tmf8x2xSinkInitFd ( tmf8x2xOutputSink * sink, int fd )
+{
+    sink->type = TMF8X2X_SINK_FD;
+    sink->buffer = sink->storage;
+    sink->size = TMF8X2X_SINK_BUFFER_SIZE;
+    sink->used = 0;
+    sink->error = 0;
+    sink->fd = fd;
+    sink->callback = 0;
+    sink->context = 0;
+}
+
+void tmf8x2xSinkInitCallback ( tmf8x2xOutputSink * sink, tmf8x2xSinkCallback callback, void * context )
+{
+    sink->type = TMF8X2X_SINK_CALLBACK;
+    sink->buffer = sink->storage;
+    sink->size = TMF8X2X_SINK_BUFFER_SIZE;
+    sink->used = 0;
+    sink->error = 0;
+    sink->fd = -1;
+    sink->callback = callback;
+    sink->context = context;
+}
+
+/*
+ *****************************************************************************
+ * SINK OUTPUT
+ *****************************************************************************
+ */
+
+void tmf8x2xSinkFlush ( tmf8x2xOutputSink * sink )
+{
+    uint32_t done = 0;
+
+    if ( sink->type == TMF8X2X_SINK_MEMORY )
+    {
+        return;
+    }
+    if ( sink->type == TMF8X2X_SINK_CALLBACK )
+    {
+        if ( sink->used )
+        {
+            sink->callback( sink->context, sink->buffer, sink->used );
+        }
+        sink->used = 0;
+        return;
+    }
+    while ( done < sink->used )
+    {
+        ssize_t written = write( sink->fd, sink->buffer + done, sink->used - done );
+        if ( written < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( written <= 0 )
+        {
+            sink->error = 1; /* drop the output, there is nobody to report to */
+            break;
+        }
+        done += (uint32_t)written;
+    }
+    sink->used = 0;
+}
+
+void tmf8x2xSinkWrite ( tmf8x2xOutputSink * sink, const char * data, uint32_t length )
+{
+    if ( sink->type == TMF8X2X_SINK_MEMORY )
+    {
+        uint32_t space = sink->size ? sink->size - 1 - sink->used : 0; /* keep room for the terminating zero */
+        if ( length > space )
+        {
+            length = space;
+            sink->error = 1;
+        }
+        memcpy( sink->buffer + sink->used, data, length );
+        sink->used += length;
+        if ( sink->size )
+        {
+            sink->buffer[ sink->used ] = 0;
+        }
+        return;
+    }
+    while ( length )
+    {
+        uint32_t chunk = sink->size - sink->used;
+        if ( chunk == 0 )
+        {
+            tmf8x2xSinkFlush( sink );
+            chunk = sink->size;
+        }
+        if ( chunk > length )
+        {
+            chunk = length;
+        }
+        memcpy( sink->buffer + sink->used, data, chunk );
+        sink->used += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void tmf8x2xSinkString ( tmf8x2xOutputSink * sink, const char * text )
+{
+    tmf8x2xSinkWrite( sink, text, (uint32_t)strlen( text ) );
+}
+
+void tmf8x2xSinkHex ( tmf8x2xOutputSink * sink, uint32_t number )
+{
+    char digits[ 8 ];
+    uint32_t pos = sizeof( digits );
+
+    do
+    {
+        digits[ --pos ] = hexDigits[ number & 0xf ];
+        number >>= 4;
+    } while ( number );
+    tmf8x2xSinkWrite( sink, digits + pos, sizeof( digits ) - pos );
+}
+
+void tmf8x2xSinkHexByte ( tmf8x2xOutputSink * sink, uint8_t value )
+{
+    char digits[ 2 ];
+
+    digits[ 0 ] = hexDigits[ value >> 4 ];
+    digits[ 1 ] = hexDigits[ value & 0xf ];
+    tmf8x2xSinkWrite( sink, digits, sizeof( digits ) );
+}
+
+void tmf8x2xSinkSignedDecimal ( tmf8x2xOutputSink * sink, int32_t number )
+{
+    char digits[ 11 ]; /* sign and 10 digits */
+    uint32_t pos = sizeof( digits );
+    uint32_t magnitude = ( number < 0 ) ? 0u - (uint32_t)number : (uint32_t)number;
+
+    do
+    {
+        digits[ --pos ] = (char)( '0' + magnitude % 10 );
+        magnitude /= 10;
+    } while ( magnitude );
+    if ( number < 0 )
+    {
+        digits[ --pos ] = '-';
+    }
+    tmf8x2xSinkWrite( sink, digits + pos, sizeof( digits ) - pos );
+}
+
+void tmf8x2xSinkUnsignedDecimal ( tmf8x2xOutputSink * sink, uint64_t number )
+{
+    char digits[ 20 ]; /* 18446744073709551615 */
+    uint32_t pos = sizeof( digits );
+
+    do
+    {
+        digits[ --pos ] = (char)( '0' + number % 10 );
+        number /= 10;
+    } while ( number );
+    tmf8x2xSinkWrite( sink, digits + pos, sizeof( digits ) - pos );
+}
@@ -0,0 +1,160 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_output_sink.h
+ *  \brief buffered output sinks (memory buffer, file descriptor, user callback) with hand-rolled number formatting.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_OUTPUT_SINK_H
+#define TMF8X2X_OUTPUT_SINK_H
+
+/* size of the internal buffer of file descriptor and callback sinks */
+#define TMF8X2X_SINK_BUFFER_SIZE            4096
+
+/* sink types */
+#define TMF8X2X_SINK_MEMORY                 0   /* output is collected in a caller-owned buffer */
+#define TMF8X2X_SINK_FD                     1   /* output is buffered and written to a file descriptor */
+#define TMF8X2X_SINK_CALLBACK               2   /* output is buffered and handed to a callback */
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* receives the buffered output of a callback sink, data is not zero terminated */
+typedef void ( * tmf8x2xSinkCallback )( void * context, const char * data, uint32_t length );
+
+/* an output sink, initialise with one of the tmf8x2xSinkInit* functions */
+typedef struct _tmf8x2xOutputSink
+{
+    char * buffer;                  /* caller buffer for memory sinks, internal storage otherwise */
+    uint32_t size;                  /* size of buffer */
+    uint32_t used;                  /* characters in buffer */
+    uint8_t type;                   /* TMF8X2X_SINK_* */
+    uint8_t error;                  /* memory sink: output was truncated, fd sink: write failed */
+    int fd;
+    tmf8x2xSinkCallback callback;
+    void * context;
+    char storage[ TMF8X2X_SINK_BUFFER_SIZE ];
+} tmf8x2xOutputSink;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xSinkInitMemory sets up a sink that writes into a caller-owned buffer. The content is kept zero terminated,
+ * output that does not fit is dropped and flagged in sink->error.
+ * @param sink to set up
+ * @param buffer receives the output
+ * @param size of the buffer in bytes (including the terminating zero)
+ */
+void tmf8x2xSinkInitMemory( tmf8x2xOutputSink * sink, char * buffer, uint32_t size );
+
+/**
+ * @brief tmf8x2xSinkInitFd sets up a sink that writes to a file descriptor with write( ) whenever its buffer is full, or on tmf8x2xSinkFlush
+ * @param sink to set up
+ * @param fd file descriptor, e.g. 1 for stdout
+ */
+void tmf8x2xSinkInitFd( tmf8x2xOutputSink * sink, int fd );
+
+/**
+ * @brief tmf8x2xSinkInitCallback sets up a sink that hands its buffer to a callback whenever it is full, or on tmf8x2xSinkFlush
+ * @param sink to set up
+ * @param callback receives the output
+ * @param context passed to the callback
+ */
+void tmf8x2xSinkInitCallback( tmf8x2xOutputSink * sink, tmf8x2xSinkCallback callback, void * context );
+
+/**
+ * @brief tmf8x2xSinkWrite appends raw data to the sink
+ * @param sink to write to
+ * @param data to write
+ * @param length of the data in bytes
+ */
+void tmf8x2xSinkWrite( tmf8x2xOutputSink * sink, const char * data, uint32_t length );
+
+/**
+ * @brief tmf8x2xSinkString appends a zero terminated string
+ * @param sink to write to
+ * @param text to write
+ */
+void tmf8x2xSinkString( tmf8x2xOutputSink * sink, const char * text );
+
+/**
+ * @brief tmf8x2xSinkHex appends an unsigned hex number without leading zeros (like printf "%x")
+ * @param sink to write to
+ * @param number to write
+ */
+void tmf8x2xSinkHex( tmf8x2xOutputSink * sink, uint32_t number );
+
+/**
+ * @brief tmf8x2xSinkHexByte appends a byte as two hex digits (like printf "%02x")
+ * @param sink to write to
+ * @param value to write
+ */
+void tmf8x2xSinkHexByte( tmf8x2xOutputSink * sink, uint8_t value );
+
+/**
+ * @brief tmf8x2xSinkSignedDecimal appends a signed decimal number (like printf "%d")
+ * @param sink to write to
+ * @param number to write
+ */
+void tmf8x2xSinkSignedDecimal( tmf8x2xOutputSink * sink, int32_t number );
+
+/**
+ * @brief tmf8x2xSinkUnsignedDecimal appends an unsigned 64-bit decimal number (like printf "%llu"), for times and counters
+ * @param sink to write to
+ * @param number to write
+ */
+void tmf8x2xSinkUnsignedDecimal( tmf8x2xOutputSink * sink, uint64_t number );
+
+/**
+ * @brief tmf8x2xSinkFlush hands buffered output to the file descriptor or callback, no-op for memory sinks
+ * @param sink to flush
+ */
+void tmf8x2xSinkFlush( tmf8x2xOutputSink * sink );
+
+#endif /* TMF8X2X_OUTPUT_SINK_H */
@@ -0,0 +1,535 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_placement.c
+ *  \brief defect aware placement search, finds the SPAD map offset that loses the fewest enabled SPADs to the screamers of one device.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_spad_parser.h"
+#include "tmf8x2x_placement.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* longest line / defect map text / unit name in a defect stream */
+#define PLACEMENT_LINE_SIZE                 256
+#define PLACEMENT_TEXT_SIZE                 1024
+#define PLACEMENT_NAME_SIZE                 64
+
+/* search results of a unit */
+#define UNIT_OK                             0
+#define UNIT_ERROR_FORMAT                   1
+#define UNIT_ERROR_NO_PLACEMENT             2
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* one device of the defect stream */
+typedef struct _placementUnit
+{
+    char name[ PLACEMENT_NAME_SIZE ];
+    tmf8x2xDefectMap defects;
+    tmf8x2xPlacement placement;
+    uint8_t result;
+} placementUnit;
+
+/* work of one search thread: every step-th unit of the chunk, starting with first */
+typedef struct _placementWork
+{
+    const tmf8x2xPlacementLayout * layout;
+    placementUnit * units;
+    uint32_t count;
+    uint32_t first;
+    uint32_t step;
+} placementWork;
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief countBits counts the set bits of a word
+ * @param bits word
+ * @return number of set bits
+ */
+static uint32_t countBits( uint32_t bits );
+
+/**
+ * @brief placementWorker searches the placements of a share of the units of a chunk (thread function)
+ * @param arg placementWork of the thread
+ * @return 0
+ */
+static void * placementWorker( void * arg );
+
+/**
+ * @brief placementFinishUnit parses the defect map of a unit once its record is complete
+ * @param unit receives the defect map, unit->result is set to UNIT_ERROR_FORMAT on errors
+ * @param text of the defect map
+ * @param length of the text
+ * @param broken set if the record structure was broken
+ */
+static void placementFinishUnit( placementUnit * unit, const char * text, uint32_t length, uint8_t broken );
+
+/**
+ * @brief placementSearchChunk searches all units of a chunk in parallel and dumps their results in stream order
+ * @param layout prepared SPAD map
+ * @param units of the chunk
+ * @param count number of units in the chunk
+ * @param index stream index of the first unit
+ * @param threads number of search threads
+ * @return number of units without a placement
+ */
+static uint32_t placementSearchChunk( const tmf8x2xPlacementLayout * layout, placementUnit * units, uint32_t count, uint32_t index, uint32_t threads );
+
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static uint32_t countBits ( uint32_t bits )
+{
+    uint32_t count = 0;
+    while ( bits )
+    {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+/*
+ *****************************************************************************
+ * PLACEMENT SEARCH
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xPreparePlacement ( tmf8x2xPlacementLayout * layout, const tmf8x2xSpadMask * mask )
+{
+    tmf8x2xHalMainSpadConfig * config = &layout->config;
+    uint8_t distance[ TMF8X2X_PLACEMENT_MAX_OFFSETS ];
+
+    if ( tmf8x2xCreateMainSpad( config, mask ) == 0 )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    if ( tmf8x2xCheckMainSpadChannelSetup( mask->channels, config->xSize, config->ySize ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CHANNEL;
+    }
+    if ( tmf8x2xCheckMainSpadAssignment( config ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG ) /* without defects */
+    {
+        return TMF8X2X_VALIDATE_ERROR_ASSIGNMENT;
+    }
+
+    /* the channel map does not depend on the offset, only the enable bits do */
+    tmf8x2xDecodeChannelPlanes( config, layout->planes );
+    layout->usedChannels = 0;
+    for ( uint32_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        for ( uint32_t y = 0; y < config->ySize; y++ )
+        {
+            layout->planes[ ch ][ y ] &= config->enableSpad[ y ];
+            if ( layout->planes[ ch ][ y ] )
+            {
+                layout->usedChannels |= 1u << ch;
+            }
+        }
+    }
+
+    /* all offsets that pass the area check, sorted by their distance to the FoV center (insertion sort keeps the scan order for equal distances) */
+    layout->offsetCount = 0;
+    for ( int32_t yOffset_2 = -( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE + 1 ); yOffset_2 <= TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE; yOffset_2++ )
+    {
+        for ( int32_t xOffset_2 = -( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE + 1 ); xOffset_2 <= TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE; xOffset_2++ )
+        {
+            int32_t xShift = ( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE - config->xSize + xOffset_2 ) >> 1;
+            int32_t yShift = ( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE - config->ySize + yOffset_2 ) >> 1;
+            uint8_t d = (uint8_t)( abs( xOffset_2 ) + abs( yOffset_2 ) );
+            uint32_t i = layout->offsetCount;
+
+            config->xOffset_2 = (int8_t)xOffset_2;
+            config->yOffset_2 = (int8_t)yOffset_2;
+            if (  tmf8x2xCheckMainSpadArea( config ) != TMF8X2X_SPAD_MAP_OK
+               || xShift < 0 || xShift + config->xSize > TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE
+               || yShift < 0 || yShift + config->ySize > TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE
+               )
+            {
+                continue;
+            }
+            while ( i > 0 && distance[ i - 1 ] > d )
+            {
+                distance[ i ] = distance[ i - 1 ];
+                layout->xOffsets_2[ i ] = layout->xOffsets_2[ i - 1 ];
+                layout->yOffsets_2[ i ] = layout->yOffsets_2[ i - 1 ];
+                i--;
+            }
+            distance[ i ] = d;
+            layout->xOffsets_2[ i ] = (int8_t)xOffset_2;
+            layout->yOffsets_2[ i ] = (int8_t)yOffset_2;
+            layout->offsetCount++;
+        }
+    }
+    config->xOffset_2 = mask->xOffset_2;
+    config->yOffset_2 = mask->yOffset_2;
+
+    return layout->offsetCount ? TMF8X2X_VALIDATE_OK : TMF8X2X_VALIDATE_ERROR_AREA;
+}
+
+uint8_t tmf8x2xFindPlacement ( tmf8x2xPlacement * placement, const tmf8x2xPlacementLayout * layout, const tmf8x2xDefectMap * defects )
+{
+    tmf8x2xHalMainSpadConfig config = layout->config;
+    uint32_t xMask = ( 1u << config.xSize ) - 1;
+    uint32_t bestLost = UINT32_MAX;
+
+    for ( uint32_t i = 0; i < layout->offsetCount && bestLost > 0; i++ )
+    {
+        int8_t xOffset_2 = layout->xOffsets_2[ i ];
+        int8_t yOffset_2 = layout->yOffsets_2[ i ];
+        uint32_t xShift = (uint32_t)( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE - config.xSize + xOffset_2 ) >> 1;
+        uint32_t yShift = (uint32_t)( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE - config.ySize + yOffset_2 ) >> 1;
+        uint32_t lost = 0;
+        uint32_t ch;
+
+        /* disable the defective SPADs under the map */
+        for ( uint32_t y = 0; y < config.ySize; y++ )
+        {
+            uint32_t enable = layout->config.enableSpad[ y ];
+            uint32_t defective = ( defects->rows[ yShift + y ] >> xShift ) & xMask & enable;
+            lost += countBits( defective );
+            config.enableSpad[ y ] = enable & ~defective;
+        }
+        if ( lost >= bestLost ) /* offsets are sorted by distance, an equal loss further away is no improvement */
+        {
+            continue;
+        }
+
+        /* a zone that loses all of its SPADs would pass the assignment check, but is dead */
+        for ( ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+        {
+            uint32_t left = 0;
+            if ( ! ( layout->usedChannels & ( 1u << ch ) ) )
+            {
+                continue;
+            }
+            for ( uint32_t y = 0; y < config.ySize; y++ )
+            {
+                left |= layout->planes[ ch ][ y ] & config.enableSpad[ y ];
+            }
+            if ( ! left )
+            {
+                break;
+            }
+        }
+        if ( ch < TMF8X2X_NUMBER_OF_CHANNELS )
+        {
+            continue;
+        }
+
+        config.xOffset_2 = xOffset_2;
+        config.yOffset_2 = yOffset_2;
+        if ( tmf8x2xCheckMainSpadAssignment( &config ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            continue;
+        }
+
+        bestLost = lost;
+        placement->xOffset_2 = xOffset_2;
+        placement->yOffset_2 = yOffset_2;
+        placement->lost = (uint16_t)lost;
+    }
+
+    return ( bestLost == UINT32_MAX ) ? TMF8X2X_SPAD_MAP_ERROR_CONFIG : TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xParseDefectMap ( tmf8x2xDefectMap * defects, const char * text, uint32_t length )
+{
+    uint8_t matrix[ TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE ];
+    uint32_t packed[ TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE ];
+    uint8_t xSize = 0;
+    uint8_t ySize = 0;
+    const char * end = text + length;
+    uint32_t rows = 0;
+
+    /* tmf8x2xParseSpadMatrix is limited to the size of a SPAD map, so the rows are parsed one at a time */
+    while ( text < end )
+    {
+        const char * lineEnd = memchr( text, '\n', (size_t)( end - text ) );
+        uint8_t rowXSize;
+        uint8_t rowYSize;
+        if ( ! lineEnd )
+        {
+            lineEnd = end;
+        }
+        if ( tmf8x2xParseSpadMatrix( matrix + rows * TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE, &rowXSize, &rowYSize, text, (uint32_t)( lineEnd - text ), 1 ) == TMF8X2X_SPAD_MAP_OK )
+        {
+            if ( rowXSize != TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE || rows >= TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE )
+            {
+                return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+            }
+            xSize = rowXSize;
+            ySize = (uint8_t)++rows;
+        }
+        else
+        {
+            for ( const char * p = text; p < lineEnd; p++ )
+            {
+                if ( *p != ' ' && *p != '\t' && *p != '\r' ) /* only empty lines may fail to parse */
+                {
+                    return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+                }
+            }
+        }
+        text = lineEnd + 1;
+    }
+    if ( xSize != TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE || ySize != TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    tmf8x2xPackEnableMask( packed, matrix, xSize, ySize );
+    for ( uint32_t y = 0; y < TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE; y++ )
+    {
+        defects->rows[ y ] = packed[ TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE - 1 - y ]; /* the text starts with the top row */
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+/*
+ *****************************************************************************
+ * STREAM SEARCH
+ *****************************************************************************
+ */
+
+static void * placementWorker ( void * arg )
+{
+    placementWork * work = arg;
+    for ( uint32_t i = work->first; i < work->count; i += work->step )
+    {
+        placementUnit * unit = &work->units[ i ];
+        if ( unit->result == UNIT_OK && tmf8x2xFindPlacement( &unit->placement, work->layout, &unit->defects ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            unit->result = UNIT_ERROR_NO_PLACEMENT;
+        }
+    }
+    return 0;
+}
+
+static void placementFinishUnit ( placementUnit * unit, const char * text, uint32_t length, uint8_t broken )
+{
+    unit->result = UNIT_OK;
+    if ( broken || tmf8x2xParseDefectMap( &unit->defects, text, length ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        unit->result = UNIT_ERROR_FORMAT;
+    }
+}
+
+static uint32_t placementSearchChunk ( const tmf8x2xPlacementLayout * layout, placementUnit * units, uint32_t count, uint32_t index, uint32_t threads )
+{
+    pthread_t thread[ TMF8X2X_PLACEMENT_MAX_THREADS ];
+    placementWork work[ TMF8X2X_PLACEMENT_MAX_THREADS ];
+    uint8_t started[ TMF8X2X_PLACEMENT_MAX_THREADS ];
+    uint32_t failed = 0;
+
+    /* interleaved shares, neighbouring units tend to have similar search times */
+    for ( uint32_t t = 0; t < threads; t++ )
+    {
+        work[ t ].layout = layout;
+        work[ t ].units = units;
+        work[ t ].count = count;
+        work[ t ].first = t;
+        work[ t ].step = threads;
+        started[ t ] = ( t > 0 && t < count && pthread_create( &thread[ t ], 0, placementWorker, &work[ t ] ) == 0 );
+    }
+    for ( uint32_t t = 0; t < threads; t++ )
+    {
+        if ( started[ t ] )
+        {
+            pthread_join( thread[ t ], 0 );
+        }
+        else
+        {
+            placementWorker( &work[ t ] ); /* the calling thread takes the first share, and those of threads that could not be started */
+        }
+    }
+
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+        dumpSignedDecimal( (int32_t)( index + i ) );
+        dumpString( " " );
+        dumpString( units[ i ].name );
+        if ( units[ i ].result == UNIT_OK )
+        {
+            dumpString( " OK xOffset_2=" );
+            dumpSignedDecimal( units[ i ].placement.xOffset_2 );
+            dumpString( " yOffset_2=" );
+            dumpSignedDecimal( units[ i ].placement.yOffset_2 );
+            dumpString( " lost=" );
+            dumpSignedDecimal( units[ i ].placement.lost );
+            dumpString( "\n" );
+        }
+        else
+        {
+            dumpString( ( units[ i ].result == UNIT_ERROR_FORMAT ) ? " ERROR (defect map format)\n" : " ERROR (no placement passes the checks)\n" );
+            failed++;
+        }
+    }
+    return failed;
+}
+
+uint32_t tmf8x2xRunPlacement ( FILE * input, const tmf8x2xPlacementLayout * layout, uint32_t threads )
+{
+    static placementUnit units[ TMF8X2X_PLACEMENT_CHUNK_SIZE ];
+    static char text[ PLACEMENT_TEXT_SIZE ];
+    char line[ PLACEMENT_LINE_SIZE ];
+    uint32_t textLength = 0;
+    uint32_t count = 0;         /* units in the current chunk */
+    uint32_t total = 0;         /* units in completed chunks */
+    uint32_t failed = 0;
+    uint8_t inUnit = 0;
+    uint8_t broken = 0;
+    uint64_t start = tmf8x2xTimeNs();
+    uint64_t elapsed;
+
+    if ( threads == 0 )
+    {
+        long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        threads = ( cpus > 0 ) ? (uint32_t)cpus : 1;
+    }
+    if ( threads > TMF8X2X_PLACEMENT_MAX_THREADS )
+    {
+        threads = TMF8X2X_PLACEMENT_MAX_THREADS;
+    }
+
+    for ( ;; )
+    {
+        int more = ( fgets( line, sizeof( line ), input ) != 0 );
+        const char * p = line;
+        size_t length = more ? strlen( line ) : 0;
+
+        if ( more && length == sizeof( line ) - 1 && line[ length - 1 ] != '\n' )
+        {
+            int c;
+            while ( ( c = fgetc( input ) ) != EOF && c != '\n' ) /* drop the rest of an overlong line */
+            {
+            }
+            broken = 1;
+            continue;
+        }
+        while ( more && ( *p == ' ' || *p == '\t' ) )
+        {
+            p++;
+        }
+        if ( more && ( *p == '#' || *p == '\n' || *p == '\r' || *p == 0 ) )
+        {
+            continue;
+        }
+
+        if ( ! more || strncmp( p, "unit", 4 ) == 0 )
+        {
+            if ( inUnit )
+            {
+                placementFinishUnit( &units[ count++ ], text, textLength, broken );
+            }
+            if ( count == TMF8X2X_PLACEMENT_CHUNK_SIZE || ( ! more && count ) )
+            {
+                failed += placementSearchChunk( layout, units, count, total, threads );
+                total += count;
+                count = 0;
+            }
+            if ( ! more )
+            {
+                break;
+            }
+            inUnit = 1;
+            broken = 0;
+            textLength = 0;
+            if ( sscanf( p, "unit %63s", units[ count ].name ) != 1 )
+            {
+                strcpy( units[ count ].name, "-" );
+            }
+        }
+        else if ( ! inUnit || textLength + length >= sizeof( text ) )
+        {
+            if ( ! inUnit ) /* defect rows without a header line */
+            {
+                inUnit = 1;
+                textLength = 0;
+                strcpy( units[ count ].name, "-" );
+            }
+            broken = 1;
+        }
+        else
+        {
+            memcpy( text + textLength, p, length - (size_t)( p - line ) );
+            textLength += (uint32_t)( length - (size_t)( p - line ) );
+        }
+    }
+
+    elapsed = tmf8x2xTimeNs() - start;
+    dumpString( "# units: " );
+    dumpSignedDecimal( (int32_t)total );
+    dumpString( " placed: " );
+    dumpSignedDecimal( (int32_t)( total - failed ) );
+    dumpString( " failed: " );
+    dumpSignedDecimal( (int32_t)failed );
+    dumpString( " offsets: " );
+    dumpSignedDecimal( (int32_t)layout->offsetCount );
+    dumpString( " threads: " );
+    dumpSignedDecimal( (int32_t)threads );
+    dumpString( " time: " );
+    dumpUnsignedDecimal( elapsed / 1000u );
+    dumpString( " us throughput: " );
+    dumpSignedDecimal( (int32_t)( elapsed ? ( (uint64_t)total * 1000000000u / elapsed ) : 0 ) );
+    dumpString( " units/s\n" );
+
+    return failed;
+}
@@ -0,0 +1,145 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_placement.h
+ *  \brief defect aware placement search, finds the SPAD map offset that loses the fewest enabled SPADs to the screamers of one device.
+ *
+ * Defect stream format (one record per device):
+ *
+ *   # comment lines and empty lines are ignored
+ *   unit <name>
+ *   <12 rows of 18 values, 1 marks a defective SPAD (screamer), top row first>
+ *
+ * The defect map covers the area where screamers can be masked (TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE x
+ * TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE), the same area that dumpMainSpadEnableBitsAsText shows.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_PLACEMENT_H
+#define TMF8X2X_PLACEMENT_H
+
+/* largest number of legal offsets of a SPAD map: every x / y shift in the screamer area, for both Q1 parities */
+#define TMF8X2X_PLACEMENT_MAX_OFFSETS       ( 2 * ( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE + 1 ) * 2 * ( TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE + 1 ) )
+
+/* number of devices that are read from the stream and searched in parallel at once */
+#define TMF8X2X_PLACEMENT_CHUNK_SIZE        1024
+
+/* largest number of search threads */
+#define TMF8X2X_PLACEMENT_MAX_THREADS       64
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* screamers of one device, bit x of rows[ y ] is set if SPAD x|y is defective (y = 0 is the bottom row) */
+typedef struct _tmf8x2xDefectMap
+{
+    uint32_t rows[ TMF8X2X_MAIN_SPAD_SCREAMER_MAX_Y_SIZE ];
+} tmf8x2xDefectMap;
+
+/* a SPAD map prepared for the placement search, see tmf8x2xPreparePlacement */
+typedef struct _tmf8x2xPlacementLayout
+{
+    tmf8x2xHalMainSpadConfig config;                                                    /* packed SPAD map, offsets are replaced during the search */
+    uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];      /* enabled SPADs of each channel */
+    uint32_t usedChannels;                                                              /* bit ch is set if channel ch has enabled SPADs */
+    uint32_t offsetCount;                                                               /* number of legal offsets */
+    int8_t xOffsets_2[ TMF8X2X_PLACEMENT_MAX_OFFSETS ];                                 /* legal offsets, best (closest to the FoV center) first */
+    int8_t yOffsets_2[ TMF8X2X_PLACEMENT_MAX_OFFSETS ];
+} tmf8x2xPlacementLayout;
+
+/* result of the search for one device */
+typedef struct _tmf8x2xPlacement
+{
+    int8_t xOffset_2;
+    int8_t yOffset_2;
+    uint16_t lost;          /* enabled SPADs of the map that are defective at this offset */
+} tmf8x2xPlacement;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xPreparePlacement creates the packed SPAD map, runs the offset independent checks and collects all legal offsets
+ * @param layout receives the prepared SPAD map
+ * @param mask SPAD map in human readable format, its offsets are ignored
+ * @return TMF8X2X_VALIDATE_OK, or the first check that failed (TMF8X2X_VALIDATE_ERROR_AREA if there is no legal offset)
+ */
+uint8_t tmf8x2xPreparePlacement( tmf8x2xPlacementLayout * layout, const tmf8x2xSpadMask * mask );
+
+/**
+ * @brief tmf8x2xFindPlacement searches all legal offsets of a SPAD map for the one that loses the fewest enabled SPADs to defects.
+ * At each offset the defective SPADs are disabled, no zone may lose all of its SPADs and tmf8x2xCheckMainSpadAssignment has to pass.
+ * Ties are resolved in favour of the offset closest to the FoV center.
+ * @param placement receives the best offset
+ * @param layout prepared SPAD map
+ * @param defects screamers of the device
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if no offset passes the checks, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xFindPlacement( tmf8x2xPlacement * placement, const tmf8x2xPlacementLayout * layout, const tmf8x2xDefectMap * defects );
+
+/**
+ * @brief tmf8x2xParseDefectMap parses a defect map, 12 rows of 18 values (0/1), top row first
+ * @param defects receives the defect map
+ * @param text of the defect map, does not need to be zero terminated
+ * @param length of the text in characters
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG for syntax errors or a wrong size, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xParseDefectMap( tmf8x2xDefectMap * defects, const char * text, uint32_t length );
+
+/**
+ * @brief tmf8x2xRunPlacement reads the defect maps of many devices, searches the best offset for each in parallel and
+ * dumps one result line per device in stream order, followed by throughput statistics
+ * @param input stream of defect records
+ * @param layout prepared SPAD map
+ * @param threads number of search threads (up to TMF8X2X_PLACEMENT_MAX_THREADS), 0 for one thread per online CPU
+ * @return number of devices without a placement (or with a broken record)
+ */
+uint32_t tmf8x2xRunPlacement( FILE * input, const tmf8x2xPlacementLayout * layout, uint32_t threads );
+
+#endif /* TMF8X2X_PLACEMENT_H */
@@ -0,0 +1,255 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_pool.c
+ *  \brief work-stealing thread pool for record streams: the range of a job is split over the workers, idle workers steal half of the rest of another worker.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L /* sysconf */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "tmf8x2x_pool.h"
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief poolWorker thread function, runs the jobs of the pool until it stops
+ * @param arg tmf8x2xPoolWorker of the thread
+ * @return 0
+ */
+static void * poolWorker( void * arg );
+
+/**
+ * @brief poolDrain processes the range of a worker and steals from the others until no work is left
+ * @param pool running a job
+ * @param worker that processes
+ */
+static void poolDrain( tmf8x2xPool * pool, tmf8x2xPoolWorker * worker );
+
+/**
+ * @brief poolSteal moves the upper half of the rest of another worker's range to the (empty) range of a worker
+ * @param pool running a job
+ * @param worker that steals
+ * @return 1 if something was stolen, 0 if all ranges are empty
+ */
+static uint8_t poolSteal( tmf8x2xPool * pool, tmf8x2xPoolWorker * worker );
+
+/*
+ *****************************************************************************
+ * WORKERS
+ *****************************************************************************
+ */
+
+static uint8_t poolSteal ( tmf8x2xPool * pool, tmf8x2xPoolWorker * worker )
+{
+    for ( uint32_t k = 1; k < pool->threads; k++ )
+    {
+        tmf8x2xPoolWorker * victim = &pool->worker[ ( worker->id + k ) % pool->threads ];
+        uint32_t begin;
+        uint32_t end;
+
+        pthread_mutex_lock( &victim->lock );
+        end = victim->end;
+        begin = victim->end - ( victim->end - victim->begin ) / 2; /* the owner keeps the lower half, a single item is not taken */
+        victim->end = begin;
+        pthread_mutex_unlock( &victim->lock );
+
+        if ( begin < end )
+        {
+            pthread_mutex_lock( &worker->lock );
+            worker->begin = begin;
+            worker->end = end;
+            worker->steals++;
+            pthread_mutex_unlock( &worker->lock );
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void poolDrain ( tmf8x2xPool * pool, tmf8x2xPoolWorker * worker )
+{
+    for ( ;; )
+    {
+        uint32_t begin;
+        uint32_t end;
+
+        pthread_mutex_lock( &worker->lock );
+        begin = worker->begin;
+        end = ( worker->end - worker->begin > pool->grain ) ? worker->begin + pool->grain : worker->end;
+        worker->begin = end;
+        pthread_mutex_unlock( &worker->lock );
+
+        if ( begin < end )
+        {
+            pool->task( pool->context, begin, end );
+        }
+        else if ( ! poolSteal( pool, worker ) )
+        {
+            return; /* ranges that were stolen but are not processed yet are finished by their thieves */
+        }
+    }
+}
+
+static void * poolWorker ( void * arg )
+{
+    tmf8x2xPoolWorker * worker = (tmf8x2xPoolWorker *)arg;
+    tmf8x2xPool * pool = worker->pool;
+    uint32_t seen = 0;
+
+    for ( ;; )
+    {
+        pthread_mutex_lock( &pool->lock );
+        while ( ! pool->stop && pool->generation == seen )
+        {
+            pthread_cond_wait( &pool->wake, &pool->lock );
+        }
+        if ( pool->stop )
+        {
+            pthread_mutex_unlock( &pool->lock );
+            return 0;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock( &pool->lock );
+
+        poolDrain( pool, worker );
+
+        pthread_mutex_lock( &pool->lock );
+        if ( --pool->busy == 0 )
+        {
+            pthread_cond_signal( &pool->idle );
+        }
+        pthread_mutex_unlock( &pool->lock );
+    }
+}
+
+/*
+ *****************************************************************************
+ * POOL
+ *****************************************************************************
+ */
+
+uint32_t tmf8x2xPoolThreads ( uint32_t threads )
+{
+    if ( threads == 0 )
+    {
+        long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        threads = ( cpus > 0 ) ? (uint32_t)cpus : 1;
+    }
+    return ( threads > TMF8X2X_POOL_MAX_THREADS ) ? TMF8X2X_POOL_MAX_THREADS : threads;
+}
+
+uint32_t tmf8x2xPoolStart ( tmf8x2xPool * pool, uint32_t threads )
+{
+    memset( pool, 0, sizeof( *pool ) );
+    pthread_mutex_init( &pool->lock, 0 );
+    pthread_cond_init( &pool->wake, 0 );
+    pthread_cond_init( &pool->idle, 0 );
+    for ( uint32_t t = 0; t < threads && t < TMF8X2X_POOL_MAX_THREADS; t++ )
+    {
+        tmf8x2xPoolWorker * worker = &pool->worker[ pool->threads ];
+        pthread_mutex_init( &worker->lock, 0 );
+        worker->id = pool->threads;
+        worker->pool = pool;
+        if ( pthread_create( &worker->thread, 0, poolWorker, worker ) != 0 )
+        {
+            pthread_mutex_destroy( &worker->lock );
+            break; /* work with the threads that could be started */
+        }
+        pool->threads++;
+    }
+    return pool->threads;
+}
+
+void tmf8x2xPoolSubmit ( tmf8x2xPool * pool, uint32_t count, uint32_t grain, tmf8x2xPoolTask task, void * context )
+{
+    if ( pool->threads == 0 )
+    {
+        if ( count )
+        {
+            task( context, 0, count );
+        }
+        return;
+    }
+
+    pthread_mutex_lock( &pool->lock );
+    pool->task = task;
+    pool->context = context;
+    pool->grain = grain ? grain : 1;
+    for ( uint32_t t = 0; t < pool->threads; t++ ) /* contiguous shares, stealing evens out the rest */
+    {
+        tmf8x2xPoolWorker * worker = &pool->worker[ t ];
+        pthread_mutex_lock( &worker->lock );
+        worker->begin = (uint32_t)( (uint64_t)count * t / pool->threads );
+        worker->end = (uint32_t)( (uint64_t)count * ( t + 1 ) / pool->threads );
+        pthread_mutex_unlock( &worker->lock );
+    }
+    pool->busy = pool->threads;
+    pool->generation++;
+    pthread_cond_broadcast( &pool->wake );
+    pthread_mutex_unlock( &pool->lock );
+}
+
+void tmf8x2xPoolWait ( tmf8x2xPool * pool )
+{
+    pthread_mutex_lock( &pool->lock );
+    while ( pool->busy )
+    {
+        pthread_cond_wait( &pool->idle, &pool->lock );
+    }
+    pthread_mutex_unlock( &pool->lock );
+}
+
+void tmf8x2xPoolStop ( tmf8x2xPool * pool )
+{
+    pthread_mutex_lock( &pool->lock );
+    pool->stop = 1;
+    pthread_cond_broadcast( &pool->wake );
+    pthread_mutex_unlock( &pool->lock );
+    for ( uint32_t t = 0; t < pool->threads; t++ )
+    {
+        pthread_join( pool->worker[ t ].thread, 0 );
+        pthread_mutex_destroy( &pool->worker[ t ].lock );
+    }
+    pthread_cond_destroy( &pool->idle );
+    pthread_cond_destroy( &pool->wake );
+    pthread_mutex_destroy( &pool->lock );
+    pool->threads = 0;
+}
@@ -0,0 +1,135 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_pool.h
+ *  \brief work-stealing thread pool for record streams: the range of a job is split over the workers, idle workers steal half of the rest of another worker.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_POOL_H
+#define TMF8X2X_POOL_H
+
+#define TMF8X2X_POOL_MAX_THREADS            64
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* processes the items begin..end-1 of a job, called by the workers */
+typedef void ( * tmf8x2xPoolTask )( void * context, uint32_t begin, uint32_t end );
+
+struct _tmf8x2xPool;
+
+/* one worker thread and the rest of its range */
+typedef struct _tmf8x2xPoolWorker
+{
+    pthread_mutex_t lock;           /* protects begin / end, taken by the owner and by thieves */
+    uint32_t begin;
+    uint32_t end;
+    uint32_t steals;                /* ranges this worker stole from others */
+    uint32_t id;
+    pthread_t thread;
+    struct _tmf8x2xPool * pool;
+} tmf8x2xPoolWorker;
+
+/* a pool of worker threads that run one job at a time */
+typedef struct _tmf8x2xPool
+{
+    tmf8x2xPoolWorker worker[ TMF8X2X_POOL_MAX_THREADS ];
+    pthread_mutex_t lock;           /* protects the job and the counters below */
+    pthread_cond_t wake;            /* a job was submitted or the pool stops */
+    pthread_cond_t idle;            /* all workers finished the job */
+    tmf8x2xPoolTask task;
+    void * context;
+    uint32_t grain;                 /* items a worker takes from its own range at once */
+    uint32_t threads;
+    uint32_t generation;            /* running number of the job */
+    uint32_t busy;                  /* workers that did not finish the job yet */
+    uint8_t stop;
+} tmf8x2xPool;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xPoolThreads resolves a requested number of threads
+ * @param threads requested number, 0 for one per online CPU
+ * @return number of threads, 1..TMF8X2X_POOL_MAX_THREADS
+ */
+uint32_t tmf8x2xPoolThreads( uint32_t threads );
+
+/**
+ * @brief tmf8x2xPoolStart starts the worker threads
+ * @param pool to start
+ * @param threads number of workers, 1..TMF8X2X_POOL_MAX_THREADS
+ * @return number of workers that were started, jobs run on the calling thread if it is 0
+ */
+uint32_t tmf8x2xPoolStart( tmf8x2xPool * pool, uint32_t threads );
+
+/**
+ * @brief tmf8x2xPoolSubmit hands a job to the workers and returns without waiting for it, the previous job must be finished (tmf8x2xPoolWait)
+ * @param pool started pool
+ * @param count number of items of the job
+ * @param grain items a worker takes at once, at least 1
+ * @param task processes the items
+ * @param context passed to the task
+ */
+void tmf8x2xPoolSubmit( tmf8x2xPool * pool, uint32_t count, uint32_t grain, tmf8x2xPoolTask task, void * context );
+
+/**
+ * @brief tmf8x2xPoolWait waits until all items of the job were processed
+ * @param pool started pool
+ */
+void tmf8x2xPoolWait( tmf8x2xPool * pool );
+
+/**
+ * @brief tmf8x2xPoolStop stops and joins the worker threads
+ * @param pool started pool, the previous job must be finished
+ */
+void tmf8x2xPoolStop( tmf8x2xPool * pool );
+
+#endif /* TMF8X2X_POOL_H */
@@ -0,0 +1,172 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_register_image.c
+ *  \brief packed register image of a custom SPAD map, byte for byte the TMF882x I2C registers 0x24..0x90.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <string.h>
+#include "tmf8x2x_register_image.h"
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief putRegister stores a little endian register value in the image
+ * @param image register image
+ * @param reg register address
+ * @param value register value
+ * @param bytes width of the register
+ */
+static void putRegister( uint8_t * image, uint32_t reg, uint32_t value, uint32_t bytes );
+
+/**
+ * @brief getRegister reads a little endian register value from the image
+ * @param image register image
+ * @param reg register address
+ * @param bytes width of the register
+ * @return register value
+ */
+static uint32_t getRegister( const uint8_t * image, uint32_t reg, uint32_t bytes );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static void putRegister ( uint8_t * image, uint32_t reg, uint32_t value, uint32_t bytes )
+{
+    uint8_t * dst = image + TMF8X2X_REGISTER_IMAGE_OFFSET( reg );
+    for ( uint32_t i = 0; i < bytes; i++ )
+    {
+        dst[ i ] = (uint8_t)( value >> ( 8 * i ) );
+    }
+}
+
+static uint32_t getRegister ( const uint8_t * image, uint32_t reg, uint32_t bytes )
+{
+    const uint8_t * src = image + TMF8X2X_REGISTER_IMAGE_OFFSET( reg );
+    uint32_t value = 0;
+    for ( uint32_t i = 0; i < bytes; i++ )
+    {
+        value |= (uint32_t)src[ i ] << ( 8 * i );
+    }
+    return value;
+}
+
+/*
+ *****************************************************************************
+ * REGISTER IMAGE
+ *****************************************************************************
+ */
+
+void tmf8x2xPackRegisterImage ( uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ], const tmf8x2xHalMainSpadConfig * config )
+{
+    /* the SPAD registers are contiguous today, clearing first keeps any gap defined should the layout change */
+    memset( image, 0, TMF8X2X_REGISTER_IMAGE_SIZE );
+
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; i++ )
+    {
+        putRegister( image, TMF8X2X_COM_SPAD_ENABLE_SPAD0_0 + i * TMF8X2X_REGISTER_ENABLE_SPAD_BYTES, config->enableSpad[ i ], TMF8X2X_REGISTER_ENABLE_SPAD_BYTES );
+    }
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; i++ )
+    {
+        putRegister( image, TMF8X2X_COM_SPAD_TDC_CHANNEL0_0 + i * TMF8X2X_REGISTER_TDC_CHANNEL_BYTES, config->tdcChannel[ i ], TMF8X2X_REGISTER_TDC_CHANNEL_BYTES );
+    }
+    putRegister( image, TMF8X2X_COM_SPAD_TDC_CHANNEL_SELECT_0, config->tdcChannelSelect, TMF8X2X_REGISTER_CHANNEL_SELECT_BYTES );
+    putRegister( image, TMF8X2X_COM_SPAD_X_OFFSET_2, (uint8_t)config->xOffset_2, 1 );
+    putRegister( image, TMF8X2X_COM_SPAD_Y_OFFSET_2, (uint8_t)config->yOffset_2, 1 );
+    putRegister( image, TMF8X2X_COM_SPAD_X_SIZE, config->xSize, 1 );
+    putRegister( image, TMF8X2X_COM_SPAD_Y_SIZE, config->ySize, 1 );
+}
+
+void tmf8x2xUnpackRegisterImage ( tmf8x2xHalMainSpadConfig * config, const uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ] )
+{
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; i++ )
+    {
+        config->enableSpad[ i ] = getRegister( image, TMF8X2X_COM_SPAD_ENABLE_SPAD0_0 + i * TMF8X2X_REGISTER_ENABLE_SPAD_BYTES, TMF8X2X_REGISTER_ENABLE_SPAD_BYTES );
+    }
+    for ( uint32_t i = 0; i < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; i++ )
+    {
+        config->tdcChannel[ i ] = getRegister( image, TMF8X2X_COM_SPAD_TDC_CHANNEL0_0 + i * TMF8X2X_REGISTER_TDC_CHANNEL_BYTES, TMF8X2X_REGISTER_TDC_CHANNEL_BYTES );
+    }
+    config->tdcChannelSelect = getRegister( image, TMF8X2X_COM_SPAD_TDC_CHANNEL_SELECT_0, TMF8X2X_REGISTER_CHANNEL_SELECT_BYTES );
+    config->xOffset_2 = (int8_t)getRegister( image, TMF8X2X_COM_SPAD_X_OFFSET_2, 1 );
+    config->yOffset_2 = (int8_t)getRegister( image, TMF8X2X_COM_SPAD_Y_OFFSET_2, 1 );
+    config->xSize = (uint8_t)getRegister( image, TMF8X2X_COM_SPAD_X_SIZE, 1 );
+    config->ySize = (uint8_t)getRegister( image, TMF8X2X_COM_SPAD_Y_SIZE, 1 );
+}
+
+/*
+ *****************************************************************************
+ * REGISTER DELTA
+ *****************************************************************************
+ */
+
+void tmf8x2xDiffRegisterImages ( tmf8x2xRegisterDelta * delta, const uint8_t from[ TMF8X2X_REGISTER_IMAGE_SIZE ], const uint8_t to[ TMF8X2X_REGISTER_IMAGE_SIZE ], uint32_t mergeGap )
+{
+    tmf8x2xRegisterWrite * write = 0;   /* last write */
+    uint32_t i = 0;
+
+    delta->count = 0;
+    delta->changed = 0;
+    delta->bytes = 0;
+    while ( i < TMF8X2X_REGISTER_IMAGE_SIZE )
+    {
+        uint32_t begin;
+        if ( from[ i ] == to[ i ] )
+        {
+            i++;
+            continue;
+        }
+        for ( begin = i; i < TMF8X2X_REGISTER_IMAGE_SIZE && from[ i ] != to[ i ]; i++ )
+        {
+        }
+        delta->changed += i - begin;
+        if ( write && begin - ( write->offset + write->length ) <= mergeGap )
+        {
+            delta->bytes += i - ( write->offset + write->length ); /* the gap and the run */
+            write->length = (uint8_t)( i - write->offset );
+            continue;
+        }
+        write = &delta->writes[ delta->count++ ];
+        write->offset = (uint8_t)begin;
+        write->length = (uint8_t)( i - begin );
+        delta->bytes += i - begin;
+    }
+}
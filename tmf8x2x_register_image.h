@@ -0,0 +1,125 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_register_image.h
+ *  \brief packed register image of a custom SPAD map, byte for byte the TMF882x I2C registers 0x24..0x90.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_REGISTER_IMAGE_H
+#define TMF8X2X_REGISTER_IMAGE_H
+
+/* the register image covers all SPAD configuration registers, from enableSpad[ 0 ] up to and including ySize */
+#define TMF8X2X_REGISTER_IMAGE_START            TMF8X2X_COM_SPAD_ENABLE_SPAD0_0
+#define TMF8X2X_REGISTER_IMAGE_SIZE             ( TMF8X2X_COM_SPAD_Y_SIZE - TMF8X2X_REGISTER_IMAGE_START + 1 )
+
+/* position of a register in the image */
+#define TMF8X2X_REGISTER_IMAGE_OFFSET( reg )    ( (reg) - TMF8X2X_REGISTER_IMAGE_START )
+
+/* width of the registers in bytes, all multi byte registers are little endian */
+#define TMF8X2X_REGISTER_ENABLE_SPAD_BYTES      3
+#define TMF8X2X_REGISTER_TDC_CHANNEL_BYTES      4
+#define TMF8X2X_REGISTER_CHANNEL_SELECT_BYTES   3
+
+/* unchanged registers between two runs of changed ones that a register delta writes along instead of starting another
+   transfer. A transfer costs two bytes on the bus (address and register byte) plus start, stop and bus free time,
+   about 0.1 byte more at 100 kHz, 400 kHz and 1 MHz (tmf8x2xI2cMergeGap in tmf8x2x_device_model.h), so bridging
+   a gap of up to two bytes is cheaper. */
+#define TMF8X2X_REGISTER_DELTA_MERGE_GAP        2
+/* most writes of a register delta, every other register differs */
+#define TMF8X2X_REGISTER_DELTA_MAX_WRITES       ( ( TMF8X2X_REGISTER_IMAGE_SIZE + 1 ) / 2 )
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* one write transfer of a register delta */
+typedef struct _tmf8x2xRegisterWrite
+{
+    uint8_t offset;                 /* position of the first register in the image */
+    uint8_t length;                 /* number of registers */
+} tmf8x2xRegisterWrite;
+
+/* the write transfers that switch the registers from one register image to another, see tmf8x2xDiffRegisterImages */
+typedef struct _tmf8x2xRegisterDelta
+{
+    tmf8x2xRegisterWrite writes[ TMF8X2X_REGISTER_DELTA_MAX_WRITES ];
+    uint32_t count;                 /* number of writes */
+    uint32_t changed;               /* registers that differ */
+    uint32_t bytes;                 /* data bytes of all writes, changed registers and bridged gaps */
+} tmf8x2xRegisterDelta;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xPackRegisterImage converts a SPAD configuration into the register image that can be written with a single I2C transfer starting at TMF8X2X_REGISTER_IMAGE_START
+ * @param image receives TMF8X2X_REGISTER_IMAGE_SIZE bytes, bytes that do not belong to a register are 0
+ * @param config SPAD configuration in machine readable format (packed)
+ */
+void tmf8x2xPackRegisterImage( uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ], const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xUnpackRegisterImage converts a register image (e.g. read back from the device) into a SPAD configuration
+ * @param config receives the SPAD configuration in machine readable format (packed)
+ * @param image TMF8X2X_REGISTER_IMAGE_SIZE bytes of the registers starting at TMF8X2X_REGISTER_IMAGE_START
+ */
+void tmf8x2xUnpackRegisterImage( tmf8x2xHalMainSpadConfig * config, const uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ] );
+
+/**
+ * @brief tmf8x2xDiffRegisterImages finds the write transfers that switch the registers from one image to another: the runs of
+ * registers that differ, where runs with at most mergeGap unchanged registers between them are written as one transfer.
+ * The cost of a transfer set is linear (bytes plus a fixed cost per transfer), each gap is bridged or not on its own, so the
+ * result is the cheapest transfer set for this merge gap.
+ * @param delta receives the writes, no writes if the images are the same
+ * @param from register image that is currently loaded
+ * @param to register image that is loaded by the writes
+ * @param mergeGap longest run of unchanged registers that is written along, TMF8X2X_REGISTER_DELTA_MERGE_GAP for the I2C bus
+ */
+void tmf8x2xDiffRegisterImages( tmf8x2xRegisterDelta * delta, const uint8_t from[ TMF8X2X_REGISTER_IMAGE_SIZE ], const uint8_t to[ TMF8X2X_REGISTER_IMAGE_SIZE ], uint32_t mergeGap );
+
+#endif /* TMF8X2X_REGISTER_IMAGE_H */
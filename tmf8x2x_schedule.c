@@ -0,0 +1,462 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+
+/*! \file tmf8x2x_schedule.c
+ *  \brief scan schedule optimizer, finds the cyclic order of a set of SPAD maps that needs the least I2C bus time to switch through.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_register_image.h"
+#include "tmf8x2x_batch.h"
+#include "tmf8x2x_device_model.h"
+#include "tmf8x2x_schedule.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* subsets of the SPAD maps after the first one in the exact search */
+#define SCHEDULE_EXACT_SETS                 ( 1u << ( TMF8X2X_SCHEDULE_EXACT_MAX - 1 ) )
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+/* shortest path from the first map through a subset of the other maps, ending at one of them (Held-Karp) */
+static uint32_t exactNs[ SCHEDULE_EXACT_SETS ][ TMF8X2X_SCHEDULE_EXACT_MAX - 1 ];
+/* map before the end of that path */
+static uint8_t exactBefore[ SCHEDULE_EXACT_SETS ][ TMF8X2X_SCHEDULE_EXACT_MAX - 1 ];
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief scheduleDistances computes the bus time at 400 kHz from every SPAD map of a schedule to every other one
+ * @param schedule set of SPAD maps
+ */
+static void scheduleDistances( tmf8x2xSchedule * schedule );
+/**
+ * @brief scheduleExact finds the shortest cycle by dynamic programming over the subsets of the maps, up to TMF8X2X_SCHEDULE_EXACT_MAX maps
+ * @param schedule with distances, receives the order
+ */
+static void scheduleExact( tmf8x2xSchedule * schedule );
+/**
+ * @brief scheduleNearest builds a cycle that always continues with the closest map not visited yet
+ * @param schedule with distances
+ * @param start first map of the cycle
+ * @param order receives the cycle
+ */
+static void scheduleNearest( const tmf8x2xSchedule * schedule, uint16_t start, uint16_t * order );
+/**
+ * @brief scheduleTwoOpt reverses parts of a cycle as long as that shortens it: the edges a-b and c-d become a-c and b-d
+ * @param schedule with distances
+ * @param order cycle to improve
+ */
+static void scheduleTwoOpt( const tmf8x2xSchedule * schedule, uint16_t * order );
+/**
+ * @brief scheduleHeuristic improves nearest neighbour cycles from TMF8X2X_SCHEDULE_STARTS starts with 2-opt and keeps the shortest
+ * @param schedule with distances, receives the order
+ */
+static void scheduleHeuristic( tmf8x2xSchedule * schedule );
+/**
+ * @brief scheduleCycleCost adds the transfers, bytes and bus time at all speeds of switching through a cyclic order
+ * @param schedule set of SPAD maps
+ * @param order the count indexes of the SPAD maps
+ * @param cost to add to
+ */
+static void scheduleCycleCost( const tmf8x2xSchedule * schedule, const uint16_t * order, tmf8x2xI2cCost * cost );
+/**
+ * @brief scheduleRecord tmf8x2xBatchHandler of the schedule mode: checks a record and adds it to the schedule
+ * @param context tmf8x2xSchedule
+ * @param index of the record
+ * @param name of the record
+ * @param mask SPAD mask, 0 if the record could not be parsed
+ * @return TMF8X2X_VALIDATE_OK, the first check that failed or TMF8X2X_VALIDATE_ERROR_CREATE if the schedule is full
+ */
+static uint8_t scheduleRecord( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static void scheduleDistances ( tmf8x2xSchedule * schedule )
+{
+    uint32_t mergeGap = tmf8x2xI2cMergeGap( TMF8X2X_I2C_FAST );
+    tmf8x2xRegisterDelta delta;
+
+    for ( uint32_t i = 0; i < schedule->count; i++ )
+    {
+        schedule->distances[ i ][ i ] = 0;
+        for ( uint32_t j = i + 1; j < schedule->count; j++ ) /* the delta back writes the same registers */
+        {
+            tmf8x2xDiffRegisterImages( &delta, schedule->images[ i ], schedule->images[ j ], mergeGap );
+            schedule->distances[ i ][ j ] = tmf8x2xI2cDeltaNs( TMF8X2X_I2C_FAST, &delta );
+            schedule->distances[ j ][ i ] = schedule->distances[ i ][ j ];
+        }
+    }
+}
+
+static void scheduleExact ( tmf8x2xSchedule * schedule )
+{
+    uint32_t n = schedule->count - 1;   /* maps after the first one, map k + 1 is bit k of the subsets */
+    uint32_t all = ( 1u << n ) - 1;
+    uint32_t best = UINT32_MAX;
+    uint32_t end = 0;
+
+    for ( uint32_t set = 1; set <= all; set++ )
+    {
+        for ( uint32_t k = 0; k < n; k++ )
+        {
+            uint32_t rest = set & ~( 1u << k );
+            if ( ! ( set & ( 1u << k ) ) )
+            {
+                continue;
+            }
+            if ( ! rest )
+            {
+                exactNs[ set ][ k ] = schedule->distances[ 0 ][ k + 1 ];
+                continue;
+            }
+            exactNs[ set ][ k ] = UINT32_MAX;
+            for ( uint32_t j = 0; j < n; j++ )
+            {
+                if ( rest & ( 1u << j ) )
+                {
+                    uint32_t ns = exactNs[ rest ][ j ] + schedule->distances[ j + 1 ][ k + 1 ];
+                    if ( ns < exactNs[ set ][ k ] )
+                    {
+                        exactNs[ set ][ k ] = ns;
+                        exactBefore[ set ][ k ] = (uint8_t)j;
+                    }
+                }
+            }
+        }
+    }
+    for ( uint32_t k = 0; k < n; k++ )
+    {
+        uint32_t ns = exactNs[ all ][ k ] + schedule->distances[ k + 1 ][ 0 ];
+        if ( ns < best )
+        {
+            best = ns;
+            end = k;
+        }
+    }
+
+    schedule->order[ 0 ] = 0;
+    for ( uint32_t position = n, set = all; position > 0; position-- ) /* walk the shortest path back from its end */
+    {
+        uint32_t before = exactBefore[ set ][ end ];
+        schedule->order[ position ] = (uint16_t)( end + 1 );
+        set &= ~( 1u << end );
+        end = before;
+    }
+}
+
+static void scheduleNearest ( const tmf8x2xSchedule * schedule, uint16_t start, uint16_t * order )
+{
+    uint8_t visited[ TMF8X2X_SCHEDULE_MAX_CONFIGS ];
+
+    memset( visited, 0, sizeof( visited ) );
+    order[ 0 ] = start;
+    visited[ start ] = 1;
+    for ( uint32_t position = 1; position < schedule->count; position++ )
+    {
+        uint32_t from = order[ position - 1 ];
+        uint32_t best = UINT32_MAX;
+        uint16_t next = 0;
+        for ( uint16_t i = 0; i < schedule->count; i++ )
+        {
+            if ( ! visited[ i ] && schedule->distances[ from ][ i ] < best )
+            {
+                best = schedule->distances[ from ][ i ];
+                next = i;
+            }
+        }
+        order[ position ] = next;
+        visited[ next ] = 1;
+    }
+}
+
+static void scheduleTwoOpt ( const tmf8x2xSchedule * schedule, uint16_t * order )
+{
+    uint32_t n = schedule->count;
+    int improved = 1;
+
+    while ( improved )
+    {
+        improved = 0;
+        for ( uint32_t i = 0; i + 2 < n; i++ )
+        {
+            for ( uint32_t j = i + 2; j < n; j++ )
+            {
+                uint32_t a = order[ i ];
+                uint32_t b = order[ i + 1 ];
+                uint32_t c = order[ j ];
+                uint32_t d = order[ ( j + 1 ) % n ];
+                if ( d == a ) /* the edges share a map */
+                {
+                    continue;
+                }
+                if (  (uint64_t)schedule->distances[ a ][ c ] + schedule->distances[ b ][ d ]
+                    < (uint64_t)schedule->distances[ a ][ b ] + schedule->distances[ c ][ d ]
+                   )
+                {
+                    for ( uint32_t lo = i + 1, hi = j; lo < hi; lo++, hi-- ) /* b .. c in reverse order */
+                    {
+                        uint16_t swap = order[ lo ];
+                        order[ lo ] = order[ hi ];
+                        order[ hi ] = swap;
+                    }
+                    improved = 1;
+                }
+            }
+        }
+    }
+}
+
+static void scheduleHeuristic ( tmf8x2xSchedule * schedule )
+{
+    uint16_t order[ TMF8X2X_SCHEDULE_MAX_CONFIGS ];
+    uint64_t best = UINT64_MAX;
+    uint32_t starts = schedule->count < TMF8X2X_SCHEDULE_STARTS ? schedule->count : TMF8X2X_SCHEDULE_STARTS;
+    uint32_t first = 0;
+
+    for ( uint32_t s = 0; s < starts; s++ )
+    {
+        uint64_t ns;
+        scheduleNearest( schedule, (uint16_t)( s * schedule->count / starts ), order );
+        scheduleTwoOpt( schedule, order );
+        ns = tmf8x2xScheduleCycleNs( schedule, order );
+        if ( ns < best )
+        {
+            best = ns;
+            memcpy( schedule->order, order, schedule->count * sizeof( order[ 0 ] ) );
+        }
+    }
+
+    /* the cycle starts with the first map */
+    while ( schedule->order[ first ] != 0 )
+    {
+        first++;
+    }
+    memcpy( order, schedule->order, schedule->count * sizeof( order[ 0 ] ) );
+    for ( uint32_t i = 0; i < schedule->count; i++ )
+    {
+        schedule->order[ i ] = order[ ( first + i ) % schedule->count ];
+    }
+}
+
+static void scheduleCycleCost ( const tmf8x2xSchedule * schedule, const uint16_t * order, tmf8x2xI2cCost * cost )
+{
+    uint32_t mergeGap = tmf8x2xI2cMergeGap( TMF8X2X_I2C_FAST );
+    tmf8x2xRegisterDelta delta;
+
+    for ( uint32_t i = 0; i < schedule->count; i++ )
+    {
+        tmf8x2xDiffRegisterImages( &delta, schedule->images[ order[ i ] ], schedule->images[ order[ ( i + 1 ) % schedule->count ] ], mergeGap );
+        tmf8x2xAddI2cCost( cost, &delta );
+    }
+}
+
+static uint8_t scheduleRecord ( void * context, uint32_t index, const char * name, const tmf8x2xSpadMask * mask )
+{
+    tmf8x2xSchedule * schedule = (tmf8x2xSchedule *)context;
+    tmf8x2xHalMainSpadConfig config;
+    uint8_t result = mask ? tmf8x2xValidateSpadMask( &config, mask ) : TMF8X2X_VALIDATE_ERROR_CREATE;
+    const char * error = mask ? tmf8x2xValidateResultName( result ) : "record format";
+
+    if ( result == TMF8X2X_VALIDATE_OK && tmf8x2xAddScheduleConfig( schedule, name, index, &config ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        result = TMF8X2X_VALIDATE_ERROR_CREATE;
+        error = "schedule full";
+    }
+    if ( result != TMF8X2X_VALIDATE_OK )
+    {
+        dumpString( "# " );
+        dumpSignedDecimal( (int32_t)index );
+        dumpString( " " );
+        dumpString( name );
+        dumpString( " ERROR (" );
+        dumpString( error );
+        dumpString( ")\n" );
+    }
+    return result;
+}
+
+/*
+ *****************************************************************************
+ * SCHEDULE
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xAddScheduleConfig ( tmf8x2xSchedule * schedule, const char * name, uint32_t index, const tmf8x2xHalMainSpadConfig * config )
+{
+    uint32_t i = schedule->count;
+
+    if ( i >= TMF8X2X_SCHEDULE_MAX_CONFIGS )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    schedule->configs[ i ] = *config;
+    tmf8x2xPackRegisterImage( schedule->images[ i ], config );
+    strncpy( schedule->names[ i ], name, TMF8X2X_SCHEDULE_NAME_SIZE - 1 );
+    schedule->names[ i ][ TMF8X2X_SCHEDULE_NAME_SIZE - 1 ] = 0;
+    schedule->indexes[ i ] = index;
+    schedule->count++;
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint64_t tmf8x2xScheduleCycleNs ( const tmf8x2xSchedule * schedule, const uint16_t * order )
+{
+    uint64_t ns = 0;
+
+    for ( uint32_t i = 0; i < schedule->count; i++ )
+    {
+        ns += schedule->distances[ order[ i ] ][ order[ ( i + 1 ) % schedule->count ] ];
+    }
+    return ns;
+}
+
+void tmf8x2xOrderSchedule ( tmf8x2xSchedule * schedule )
+{
+    scheduleDistances( schedule );
+    schedule->exact = ( schedule->count <= TMF8X2X_SCHEDULE_EXACT_MAX );
+    if ( schedule->count <= 2 ) /* every order is the same cycle */
+    {
+        for ( uint16_t i = 0; i < schedule->count; i++ )
+        {
+            schedule->order[ i ] = i;
+        }
+    }
+    else if ( schedule->exact )
+    {
+        scheduleExact( schedule );
+    }
+    else
+    {
+        scheduleHeuristic( schedule );
+    }
+    schedule->cycleNs = tmf8x2xScheduleCycleNs( schedule, schedule->order );
+}
+
+/*
+ *****************************************************************************
+ * SCHEDULE MODE
+ *****************************************************************************
+ */
+
+uint32_t tmf8x2xRunSchedule ( FILE * input )
+{
+    static tmf8x2xSchedule schedule;
+    static uint16_t recordOrder[ TMF8X2X_SCHEDULE_MAX_CONFIGS ];
+    tmf8x2xI2cCost load;
+    tmf8x2xI2cCost cycle;
+    tmf8x2xI2cCost records;
+    uint32_t count;
+    uint32_t failed;
+    uint64_t start;
+    uint64_t elapsed;
+
+    schedule.count = 0;
+    failed = tmf8x2xReadBatch( input, scheduleRecord, &schedule, &count );
+
+    start = tmf8x2xTimeNs( );
+    tmf8x2xOrderSchedule( &schedule );
+    elapsed = tmf8x2xTimeNs( ) - start;
+
+    dumpString( "# schedule of " );
+    dumpSignedDecimal( (int32_t)schedule.count );
+    dumpString( schedule.exact ? " SPAD maps, shortest cycle (Held-Karp)" : " SPAD maps, nearest neighbour + 2-opt" );
+    dumpString( ", search time: " );
+    dumpUnsignedDecimal( elapsed / 1000u );
+    dumpString( " us\n" );
+    for ( uint32_t i = 0; i < schedule.count; i++ )
+    {
+        dumpString( "#   " );
+        dumpSignedDecimal( (int32_t)schedule.indexes[ schedule.order[ i ] ] );
+        dumpString( " " );
+        dumpString( schedule.names[ schedule.order[ i ] ] );
+        dumpString( "\n" );
+    }
+    dumpString( "\n" );
+
+    /* load the first map once, then switch through the cycle back to the first map */
+    memset( &load, 0, sizeof( load ) );
+    memset( &cycle, 0, sizeof( cycle ) );
+    memset( &records, 0, sizeof( records ) );
+    if ( schedule.count )
+    {
+        tmf8x2xDumpRegisterDelta( schedule.indexes[ 0 ], schedule.names[ 0 ], 0, &schedule.configs[ 0 ], &load );
+    }
+    for ( uint32_t i = 1; schedule.count > 1 && i <= schedule.count; i++ )
+    {
+        uint16_t from = schedule.order[ i - 1 ];
+        uint16_t to = schedule.order[ i % schedule.count ];
+        tmf8x2xDumpRegisterDelta( schedule.indexes[ to ], schedule.names[ to ], &schedule.configs[ from ], &schedule.configs[ to ], &cycle );
+    }
+    for ( uint16_t i = 0; i < schedule.count; i++ )
+    {
+        recordOrder[ i ] = i;
+    }
+    if ( schedule.count > 1 )
+    {
+        scheduleCycleCost( &schedule, recordOrder, &records );
+    }
+
+    dumpString( "# records: " );
+    dumpSignedDecimal( (int32_t)count );
+    dumpString( " ok: " );
+    dumpSignedDecimal( (int32_t)( count - failed ) );
+    dumpString( " failed: " );
+    dumpSignedDecimal( (int32_t)failed );
+    dumpString( "\n# cycle in record order:" );
+    tmf8x2xDumpI2cCost( &records );
+    dumpString( "# cycle in schedule order:" );
+    tmf8x2xDumpI2cCost( &cycle );
+    return failed;
+}
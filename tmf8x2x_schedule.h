@@ -0,0 +1,131 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+
+/*! \file tmf8x2x_schedule.h
+ *  \brief scan schedule optimizer, finds the cyclic order of a set of SPAD maps that needs the least I2C bus time to switch through.
+ *
+ * Switching from one SPAD map to the next costs the register delta of both register images (tmf8x2xDiffRegisterImages,
+ * with the merge gap of 400 kHz), its bus time at 400 kHz (tmf8x2xI2cDeltaNs) is the distance of the two maps. The
+ * distance is symmetric, the delta from A to B writes the same registers as the one from B to A. Sets of up to
+ * TMF8X2X_SCHEDULE_EXACT_MAX maps are ordered exactly (Held-Karp dynamic programming over the subsets), larger sets with
+ * nearest neighbour tours from several starts that are improved by 2-opt moves until none shortens the cycle.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_register_image.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_SCHEDULE_H
+#define TMF8X2X_SCHEDULE_H
+
+/* largest number of SPAD maps of a schedule */
+#define TMF8X2X_SCHEDULE_MAX_CONFIGS        256
+
+/* largest number of SPAD maps that are ordered exactly, the tables hold 2^(n-1) x (n-1) entries */
+#define TMF8X2X_SCHEDULE_EXACT_MAX          16
+
+/* number of nearest neighbour tours that are improved with 2-opt for larger sets */
+#define TMF8X2X_SCHEDULE_STARTS             16
+
+/* longest SPAD map name */
+#define TMF8X2X_SCHEDULE_NAME_SIZE          64
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* a set of SPAD maps and their order, see tmf8x2xOrderSchedule */
+typedef struct _tmf8x2xSchedule
+{
+    tmf8x2xHalMainSpadConfig configs[ TMF8X2X_SCHEDULE_MAX_CONFIGS ];
+    uint8_t images[ TMF8X2X_SCHEDULE_MAX_CONFIGS ][ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    char names[ TMF8X2X_SCHEDULE_MAX_CONFIGS ][ TMF8X2X_SCHEDULE_NAME_SIZE ];
+    uint32_t indexes[ TMF8X2X_SCHEDULE_MAX_CONFIGS ];                               /* running number of the record */
+    uint32_t distances[ TMF8X2X_SCHEDULE_MAX_CONFIGS ][ TMF8X2X_SCHEDULE_MAX_CONFIGS ]; /* bus time in ns at 400 kHz from one map to another */
+    uint16_t order[ TMF8X2X_SCHEDULE_MAX_CONFIGS ];                                 /* the cycle, starts with the first map */
+    uint32_t count;                                                                 /* number of SPAD maps */
+    uint64_t cycleNs;                                                               /* bus time of the cycle at 400 kHz */
+    uint8_t exact;                                                                  /* 1 if the order is the shortest cycle */
+} tmf8x2xSchedule;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xAddScheduleConfig adds a SPAD map to a schedule, set count to 0 before the first one
+ * @param schedule set of SPAD maps
+ * @param name of the SPAD map
+ * @param index running number of the record
+ * @param config checked configuration in machine readable format (packed)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the schedule holds TMF8X2X_SCHEDULE_MAX_CONFIGS maps already, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xAddScheduleConfig( tmf8x2xSchedule * schedule, const char * name, uint32_t index, const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xScheduleCycleNs returns the bus time at 400 kHz of switching through the SPAD maps of a schedule in a cyclic order
+ * @param schedule with distances, see tmf8x2xOrderSchedule
+ * @param order the count indexes of the SPAD maps
+ * @return bus time in nanoseconds, including the switch from the last map back to the first one
+ */
+uint64_t tmf8x2xScheduleCycleNs( const tmf8x2xSchedule * schedule, const uint16_t * order );
+
+/**
+ * @brief tmf8x2xOrderSchedule computes the distances of all SPAD maps of a schedule and the cyclic order with the least bus time
+ * @param schedule set of SPAD maps, receives distances, order, cycleNs and exact
+ */
+void tmf8x2xOrderSchedule( tmf8x2xSchedule * schedule );
+
+/**
+ * @brief tmf8x2xRunSchedule validates a stream of SPAD map / mask records (tmf8x2x_batch.h), orders the valid ones and dumps the schedule:
+ * the order, the I2C writes that load the first map and switch through the cycle back to the first map (tmf8x2xDumpRegisterDelta)
+ * and the cost of the cycle compared with the record order. Records that fail are reported and left out.
+ * @param input stream of records
+ * @return number of records that failed (parsing, checks or more than TMF8X2X_SCHEDULE_MAX_CONFIGS)
+ */
+uint32_t tmf8x2xRunSchedule( FILE * input );
+
+#endif /* TMF8X2X_SCHEDULE_H */
@@ -0,0 +1,827 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_server.c
+ *  \brief server mode, a resident process that answers SPAD map requests over a UNIX domain socket or stdin / stdout.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L /* sigaction, lstat */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_clock.h"
+#include "tmf8x2x_spad_parser.h"
+#include "tmf8x2x_output_sink.h"
+#include "tmf8x2x_spad_lib.h"
+#include "tmf8x2x_batch.h"
+#include "tmf8x2x_corpus.h"
+#include "tmf8x2x_format.h"
+#include "tmf8x2x_server.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* received data of a connection that is not processed yet, holds the longest request line */
+#define SERVER_INPUT_SIZE                   16384
+/* answers of a client that does not read them are queued, above the limit its requests wait. The rest of the queue holds
+   the largest answer (the stats answer with all latency buckets). */
+#define SERVER_OUTPUT_SIZE                  65536
+#define SERVER_OUTPUT_LIMIT                 ( SERVER_OUTPUT_SIZE / 2 )
+/* connections the kernel queues until they are accepted */
+#define SERVER_BACKLOG                      16
+
+/* what the next received data of a connection is */
+#define SERVER_STATE_COMMAND                0   /* a request line */
+#define SERVER_STATE_TEXT                   1   /* a line of a SPAD map record */
+#define SERVER_STATE_BINARY                 2   /* the bytes of a corpus record */
+
+/* quantiles of the stats answer in 1/1000 */
+#define SERVER_QUANTILES                    4
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* one client, or stdin / stdout */
+typedef struct _serverConnection
+{
+    int inFd;                               /* -1 for a free slot */
+    int outFd;
+    uint8_t state;                          /* SERVER_STATE_* */
+    uint8_t skipLine;                       /* the rest of an overlong line is dropped */
+    uint8_t closing;                        /* quit was received */
+    uint8_t writeError;                     /* the client went away */
+    uint32_t used;                          /* bytes in input */
+    uint32_t index;                         /* running number of the next answer */
+    uint32_t answered;                      /* answers in the sink or queue, their latency is recorded when they are written */
+    uint32_t queued;                        /* bytes in output */
+    uint64_t receivedNs;                    /* time stamp of the current block */
+    char name[ TMF8X2X_BATCH_NAME_SIZE ];   /* of the binary request in progress */
+    tmf8x2xBatchRecord record;              /* text request in progress */
+    tmf8x2xOutputSink sink;                 /* answers, written when the sink is full and after each received block */
+    char input[ SERVER_INPUT_SIZE + 1 ];    /* + 1: a line at the end of the buffer is zero terminated in place */
+    char output[ SERVER_OUTPUT_SIZE ];      /* answers the client did not take yet (sockets are non-blocking) */
+} serverConnection;
+
+/* all state of the server mode */
+typedef struct _serverState
+{
+    serverConnection connections[ TMF8X2X_SERVER_MAX_CONNECTIONS ];
+    tmf8x2xLatencyHistogram latency;
+    uint64_t requests;
+    uint64_t failed;
+    uint64_t accepted;                      /* connections */
+    uint32_t formats;                       /* of the answers */
+    uint8_t connectivity;                   /* strict mode, 0 if off */
+} serverState;
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+static serverState server;
+
+/* set by SIGINT / SIGTERM */
+static volatile sig_atomic_t serverStop = 0;
+
+static const uint32_t serverQuantiles[ SERVER_QUANTILES ] = { 500, 900, 990, 999 };
+static const char * const serverQuantileNames[ SERVER_QUANTILES ] = { "p50", "p90", "p99", "p999" };
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief serverSignal handler of SIGINT / SIGTERM, stops the server
+ * @param signal number of the signal
+ */
+static void serverSignal( int signal );
+/**
+ * @brief serverIsCommand tests if a line starts with a command word
+ * @param line request line without leading white space
+ * @param command word
+ * @return 1 if the line is the command, optionally followed by white space and arguments, 0 otherwise
+ */
+static int serverIsCommand( const char * line, const char * command );
+/**
+ * @brief serverDumpStats dumps the stats answer: request counters and latency histogram as JSON line
+ */
+static void serverDumpStats( void );
+/**
+ * @brief serverAnswer creates and checks a SPAD map and dumps the answer
+ * @param connection that received the request
+ * @param name of the SPAD map
+ * @param mask SPAD map / mask, 0 if the request could not be parsed
+ */
+static void serverAnswer( serverConnection * connection, const char * name, const tmf8x2xSpadMask * mask );
+/**
+ * @brief serverAnswerText answers the text request in progress
+ * @param connection that received the request
+ */
+static void serverAnswerText( serverConnection * connection );
+/**
+ * @brief serverAnswerBinary answers a binary request
+ * @param connection that received the request
+ * @param data TMF8X2X_CORPUS_RECORD_SIZE bytes of a tmf8x2xCorpusRecord
+ */
+static void serverAnswerBinary( serverConnection * connection, const char * data );
+/**
+ * @brief serverLine processes a received line
+ * @param connection that received the line
+ * @param line zero terminated, including the line feed
+ */
+static void serverLine( serverConnection * connection, const char * line );
+/**
+ * @brief serverProcess processes all complete lines and binary records in the input of a connection
+ * @param connection with received data
+ */
+static void serverProcess( serverConnection * connection );
+/**
+ * @brief serverSend writes as much as the client takes without blocking
+ * @param connection to write to
+ * @param data to write
+ * @param length of the data in bytes
+ * @return number of bytes written
+ */
+static uint32_t serverSend( serverConnection * connection, const char * data, uint32_t length );
+/**
+ * @brief serverWrite callback of the connection sinks, writes answers to the client or queues them, records the latency of written answers
+ * @param context serverConnection
+ * @param data answers
+ * @param length of the data in bytes
+ */
+static void serverWrite( void * context, const char * data, uint32_t length );
+/**
+ * @brief serverService answers the received requests, up to the output limit
+ * @param connection with received data or a drained queue
+ */
+static void serverService( serverConnection * connection );
+/**
+ * @brief serverOpen takes a free connection slot
+ * @param inFd file descriptor to receive requests from
+ * @param outFd file descriptor to write answers to
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if all slots are taken, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+static uint8_t serverOpen( int inFd, int outFd );
+/**
+ * @brief serverClose answers a text request without "end" line, frees the slot and closes a socket connection
+ * @param connection to close
+ */
+static void serverClose( serverConnection * connection );
+/**
+ * @brief serverReceive reads a block of requests and answers them
+ * @param connection that is readable
+ */
+static void serverReceive( serverConnection * connection );
+/**
+ * @brief serverDrain writes queued answers, the waiting requests are answered once the queue is empty
+ * @param connection that is writable
+ */
+static void serverDrain( serverConnection * connection );
+/**
+ * @brief serverListen creates the listening UNIX domain socket
+ * @param socketName path of the socket
+ * @return file descriptor, -1 if the socket cannot be set up
+ */
+static int serverListen( const char * socketName );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static void serverSignal ( int signal )
+{
+    (void)signal;
+    serverStop = 1;
+}
+
+static int serverIsCommand ( const char * line, const char * command )
+{
+    size_t length = strlen( command );
+    char next = line[ length ];
+
+    return strncmp( line, command, length ) == 0 && ( next == 0 || next == ' ' || next == '\t' || next == '\r' || next == '\n' );
+}
+
+/*
+ *****************************************************************************
+ * LATENCY HISTOGRAM
+ *****************************************************************************
+ */
+
+void tmf8x2xLatencyAdd ( tmf8x2xLatencyHistogram * histogram, uint64_t ns )
+{
+    uint32_t bucket = (uint32_t)ns;
+
+    if ( ns >= TMF8X2X_LATENCY_SUB_BUCKETS )
+    {
+        uint32_t octave = 3; /* highest set bit, ns >= 8 */
+        while ( octave < 63 && ( ns >> ( octave + 1 ) ) )
+        {
+            octave++;
+        }
+        bucket = ( octave - 2 ) * TMF8X2X_LATENCY_SUB_BUCKETS + (uint32_t)( ( ns >> ( octave - 3 ) ) & ( TMF8X2X_LATENCY_SUB_BUCKETS - 1 ) );
+        if ( bucket >= TMF8X2X_LATENCY_BUCKETS )
+        {
+            bucket = TMF8X2X_LATENCY_BUCKETS - 1;
+        }
+    }
+    histogram->counts[ bucket ]++;
+    if ( ! histogram->total || ns < histogram->minNs )
+    {
+        histogram->minNs = ns;
+    }
+    if ( ns > histogram->maxNs )
+    {
+        histogram->maxNs = ns;
+    }
+    histogram->total++;
+    histogram->sumNs += ns;
+}
+
+uint64_t tmf8x2xLatencyBucket ( uint32_t bucket, uint64_t * highNs )
+{
+    uint32_t octave = bucket / TMF8X2X_LATENCY_SUB_BUCKETS + 2;
+    uint64_t lowNs;
+
+    if ( bucket < TMF8X2X_LATENCY_SUB_BUCKETS )
+    {
+        *highNs = bucket;
+        return bucket;
+    }
+    lowNs = (uint64_t)( TMF8X2X_LATENCY_SUB_BUCKETS + bucket % TMF8X2X_LATENCY_SUB_BUCKETS ) << ( octave - 3 );
+    *highNs = ( bucket == TMF8X2X_LATENCY_BUCKETS - 1 ) ? UINT64_MAX : lowNs + ( (uint64_t)1 << ( octave - 3 ) ) - 1;
+    return lowNs;
+}
+
+uint64_t tmf8x2xLatencyQuantile ( const tmf8x2xLatencyHistogram * histogram, uint32_t permille )
+{
+    uint64_t rank = ( histogram->total * permille + 999 ) / 1000; /* the latency with this rank (1 = smallest) */
+    uint64_t seen = 0;
+
+    if ( ! histogram->total )
+    {
+        return 0;
+    }
+    for ( uint32_t bucket = 0; bucket < TMF8X2X_LATENCY_BUCKETS; bucket++ )
+    {
+        seen += histogram->counts[ bucket ];
+        if ( seen && seen >= rank )
+        {
+            uint64_t highNs;
+            tmf8x2xLatencyBucket( bucket, &highNs );
+            return ( highNs < histogram->maxNs ) ? highNs : histogram->maxNs;
+        }
+    }
+    return histogram->maxNs;
+}
+
+/*
+ *****************************************************************************
+ * REQUESTS
+ *****************************************************************************
+ */
+
+static void serverDumpStats ( void )
+{
+    const tmf8x2xLatencyHistogram * latency = &server.latency;
+    const char * separator = "";
+
+    dumpString( "{\"requests\":" );
+    dumpUnsignedDecimal( server.requests );
+    dumpString( ",\"failed\":" );
+    dumpUnsignedDecimal( server.failed );
+    dumpString( ",\"connections\":" );
+    dumpUnsignedDecimal( server.accepted );
+    dumpString( ",\"latencyNs\":{\"min\":" );
+    dumpUnsignedDecimal( latency->total ? latency->minNs : 0 );
+    dumpString( ",\"mean\":" );
+    dumpUnsignedDecimal( latency->total ? latency->sumNs / latency->total : 0 );
+    for ( uint32_t i = 0; i < SERVER_QUANTILES; i++ )
+    {
+        dumpString( ",\"" );
+        dumpString( serverQuantileNames[ i ] );
+        dumpString( "\":" );
+        dumpUnsignedDecimal( tmf8x2xLatencyQuantile( latency, serverQuantiles[ i ] ) );
+    }
+    dumpString( ",\"max\":" );
+    dumpUnsignedDecimal( latency->maxNs );
+    dumpString( ",\"histogram\":[" ); /* [ lowest, highest, count ] of the buckets that are not empty */
+    for ( uint32_t bucket = 0; bucket < TMF8X2X_LATENCY_BUCKETS; bucket++ )
+    {
+        uint64_t lowNs;
+        uint64_t highNs;
+        if ( ! latency->counts[ bucket ] )
+        {
+            continue;
+        }
+        lowNs = tmf8x2xLatencyBucket( bucket, &highNs );
+        dumpString( separator );
+        dumpString( "[" );
+        dumpUnsignedDecimal( lowNs );
+        dumpString( "," );
+        dumpUnsignedDecimal( ( highNs < latency->maxNs ) ? highNs : latency->maxNs );
+        dumpString( "," );
+        dumpUnsignedDecimal( latency->counts[ bucket ] );
+        dumpString( "]" );
+        separator = ",";
+    }
+    dumpString( "]}}\n" );
+}
+
+static void serverAnswer ( serverConnection * connection, const char * name, const tmf8x2xSpadMask * mask )
+{
+    tmf8x2xHalMainSpadConfig cfg;
+    tmf8x2xLibStatus status;
+
+    if ( mask && tmf8x2xLibValidateMask( &cfg, mask, &status ) == TMF8X2X_LIB_OK && server.connectivity )
+    {
+        tmf8x2xLibCheckConnectivity( &cfg, server.connectivity, &status );
+    }
+    tmf8x2xEmitRecord( server.formats, connection->index++, name, mask ? &status : 0, ( mask && status.check != TMF8X2X_VALIDATE_ERROR_CREATE ) ? &cfg : 0 );
+    server.requests++;
+    server.failed += ( ! mask || status.code != TMF8X2X_LIB_OK );
+    connection->answered++;
+}
+
+static void serverAnswerText ( serverConnection * connection )
+{
+    tmf8x2xSpadMaskStorage storage;
+
+    serverAnswer( connection, connection->record.name, ( tmf8x2xParseBatchRecord( &storage, &connection->record ) == TMF8X2X_SPAD_MAP_OK ) ? &storage.mask : 0 );
+    connection->state = SERVER_STATE_COMMAND;
+}
+
+static void serverAnswerBinary ( serverConnection * connection, const char * data )
+{
+    tmf8x2xCorpusRecord record;
+    tmf8x2xSpadMask mask;
+    uint8_t channels[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+
+    memcpy( &record, data, sizeof( record ) ); /* the input buffer is not aligned for the enable rows */
+    serverAnswer( connection, connection->name, ( tmf8x2xCorpusExpand( &mask, &record, channels ) == TMF8X2X_SPAD_MAP_OK ) ? &mask : 0 );
+    connection->state = SERVER_STATE_COMMAND;
+}
+
+static void serverLine ( serverConnection * connection, const char * line )
+{
+    const char * p = line;
+
+    while ( *p == ' ' || *p == '\t' )
+    {
+        p++;
+    }
+    if ( *p == '#' || *p == '\n' || *p == '\r' )
+    {
+        return;
+    }
+
+    if ( connection->state == SERVER_STATE_TEXT )
+    {
+        if ( serverIsCommand( p, "end" ) )
+        {
+            serverAnswerText( connection );
+            return;
+        }
+        if ( ! serverIsCommand( p, "map" ) )
+        {
+            tmf8x2xAddBatchLine( &connection->record, p );
+            return;
+        }
+        serverAnswerText( connection ); /* a header line ends the previous record, as in the batch mode */
+    }
+
+    if ( serverIsCommand( p, "map" ) )
+    {
+        tmf8x2xStartBatchRecord( &connection->record, p );
+        connection->state = SERVER_STATE_TEXT;
+    }
+    else if ( serverIsCommand( p, "bin" ) )
+    {
+        if ( sscanf( p, "bin %63s", connection->name ) != 1 )
+        {
+            strcpy( connection->name, "-" );
+        }
+        connection->state = SERVER_STATE_BINARY;
+    }
+    else if ( serverIsCommand( p, "stats" ) )
+    {
+        serverDumpStats();
+    }
+    else if ( serverIsCommand( p, "quit" ) )
+    {
+        connection->closing = 1;
+    }
+    else
+    {
+        serverAnswer( connection, "-", 0 ); /* unknown request */
+    }
+}
+
+static void serverProcess ( serverConnection * connection )
+{
+    uint32_t begin = 0;
+    int incomplete = 0;     /* stopped at a part of a line or binary record, not at the output limit */
+
+    while ( ! connection->closing && connection->queued <= SERVER_OUTPUT_LIMIT )
+    {
+        char * end;
+        char next;
+
+        if ( connection->state == SERVER_STATE_BINARY )
+        {
+            if ( connection->used - begin < TMF8X2X_CORPUS_RECORD_SIZE )
+            {
+                incomplete = 1;
+                break;
+            }
+            serverAnswerBinary( connection, connection->input + begin );
+            begin += TMF8X2X_CORPUS_RECORD_SIZE;
+            continue;
+        }
+        end = memchr( connection->input + begin, '\n', connection->used - begin );
+        if ( ! end )
+        {
+            incomplete = 1;
+            break;
+        }
+        if ( connection->skipLine )
+        {
+            connection->skipLine = 0;
+        }
+        else
+        {
+            next = end[ 1 ];
+            end[ 1 ] = 0;
+            serverLine( connection, connection->input + begin );
+            end[ 1 ] = next;
+        }
+        begin = (uint32_t)( end + 1 - connection->input );
+    }
+
+    memmove( connection->input, connection->input + begin, connection->used - begin );
+    connection->used -= begin;
+    if ( incomplete && connection->used == SERVER_INPUT_SIZE ) /* a full buffer without a line feed */
+    {
+        connection->used = 0;
+        connection->skipLine = 1;
+        connection->record.broken = ( connection->state == SERVER_STATE_TEXT ) ? 1 : connection->record.broken;
+    }
+}
+
+/*
+ *****************************************************************************
+ * CONNECTIONS
+ *****************************************************************************
+ */
+
+static uint32_t serverSend ( serverConnection * connection, const char * data, uint32_t length )
+{
+    uint32_t done = 0;
+
+    while ( done < length && ! connection->writeError )
+    {
+        ssize_t written = write( connection->outFd, data + done, length - done );
+        if ( written < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( written < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+        {
+            break;
+        }
+        if ( written <= 0 )
+        {
+            connection->writeError = 1;
+            break;
+        }
+        done += (uint32_t)written;
+    }
+    return done;
+}
+
+static void serverWrite ( void * context, const char * data, uint32_t length )
+{
+    serverConnection * connection = (serverConnection *)context;
+    uint32_t done = connection->queued ? 0 : serverSend( connection, data, length ); /* keep the order behind queued answers */
+
+    if ( connection->queued + length - done > SERVER_OUTPUT_SIZE )
+    {
+        connection->writeError = 1; /* cannot happen below SERVER_OUTPUT_LIMIT, drop the client rather than its answers */
+    }
+    if ( connection->writeError )
+    {
+        return;
+    }
+    memcpy( connection->output + connection->queued, data + done, length - done );
+    connection->queued += length - done;
+    if ( ! connection->queued )
+    {
+        uint64_t now = tmf8x2xTimeNs();
+        for ( ; connection->answered; connection->answered-- ) /* an answer that is still partly in the sink is recorded with the next write */
+        {
+            tmf8x2xLatencyAdd( &server.latency, now - connection->receivedNs );
+        }
+    }
+}
+
+static void serverService ( serverConnection * connection )
+{
+    tmf8x2xOutputSink * previous = dumpSelectSink( &connection->sink );
+
+    serverProcess( connection );
+    tmf8x2xSinkFlush( &connection->sink ); /* the answers of a pipelined block are written in few writes */
+    dumpSelectSink( previous );
+    if ( connection->writeError || ( connection->closing && ! connection->queued ) )
+    {
+        serverClose( connection );
+    }
+}
+
+static uint8_t serverOpen ( int inFd, int outFd )
+{
+    for ( uint32_t i = 0; i < TMF8X2X_SERVER_MAX_CONNECTIONS; i++ )
+    {
+        serverConnection * connection = &server.connections[ i ];
+        if ( connection->inFd < 0 )
+        {
+            connection->inFd = inFd;
+            connection->outFd = outFd;
+            connection->state = SERVER_STATE_COMMAND;
+            connection->skipLine = 0;
+            connection->closing = 0;
+            connection->writeError = 0;
+            connection->used = 0;
+            connection->index = 0;
+            connection->answered = 0;
+            connection->queued = 0;
+            tmf8x2xSinkInitCallback( &connection->sink, serverWrite, connection );
+            server.accepted++;
+            return TMF8X2X_SPAD_MAP_OK;
+        }
+    }
+    return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+}
+
+static void serverClose ( serverConnection * connection )
+{
+    if ( connection->state == SERVER_STATE_TEXT && ! connection->closing && ! connection->writeError )
+    {
+        tmf8x2xOutputSink * previous = dumpSelectSink( &connection->sink );
+        serverAnswerText( connection ); /* the end of the input ends the record, as in the batch mode */
+        tmf8x2xSinkFlush( &connection->sink );
+        dumpSelectSink( previous );
+    }
+    if ( connection->inFd != STDIN_FILENO )
+    {
+        close( connection->inFd );
+    }
+    connection->inFd = -1;
+}
+
+static void serverReceive ( serverConnection * connection )
+{
+    ssize_t received = read( connection->inFd, connection->input + connection->used, SERVER_INPUT_SIZE - connection->used );
+
+    if ( received < 0 && ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) )
+    {
+        return;
+    }
+    if ( received <= 0 )
+    {
+        serverClose( connection );
+        return;
+    }
+    connection->receivedNs = tmf8x2xTimeNs();
+    connection->used += (uint32_t)received;
+    serverService( connection );
+}
+
+static void serverDrain ( serverConnection * connection )
+{
+    uint32_t done = serverSend( connection, connection->output, connection->queued );
+
+    memmove( connection->output, connection->output + done, connection->queued - done );
+    connection->queued -= done;
+    if ( connection->writeError )
+    {
+        serverClose( connection );
+    }
+    else if ( ! connection->queued )
+    {
+        serverWrite( connection, connection->output, 0 ); /* records the latency of the queued answers */
+        serverService( connection );
+    }
+}
+
+static int serverListen ( const char * socketName )
+{
+    struct sockaddr_un address;
+    struct stat info;
+    int fd;
+
+    if ( strlen( socketName ) >= sizeof( address.sun_path ) )
+    {
+        return -1;
+    }
+    memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    strcpy( address.sun_path, socketName );
+    if ( lstat( socketName, &info ) == 0 && S_ISSOCK( info.st_mode ) )
+    {
+        unlink( socketName ); /* left over from a server that did not stop cleanly */
+    }
+
+    fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 )
+    {
+        return -1;
+    }
+    if ( bind( fd, (const struct sockaddr *)&address, sizeof( address ) ) != 0 || listen( fd, SERVER_BACKLOG ) != 0 )
+    {
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ *****************************************************************************
+ * SERVER MODE
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xRunServer ( const char * socketName, uint32_t formats, uint8_t connectivity )
+{
+    struct pollfd fds[ TMF8X2X_SERVER_MAX_CONNECTIONS + 1 ];
+    serverConnection * polled[ TMF8X2X_SERVER_MAX_CONNECTIONS + 1 ];
+    static tmf8x2xOutputSink statsSink;
+    tmf8x2xOutputSink * previous;
+    struct sigaction action;
+    int stdio = ( socketName[ 0 ] == '-' && socketName[ 1 ] == 0 );
+    int listenFd = -1;
+
+    memset( &server.latency, 0, sizeof( server.latency ) );
+    server.requests = 0;
+    server.failed = 0;
+    server.accepted = 0;
+    server.formats = TMF8X2X_FORMAT_JSON | ( formats & TMF8X2X_FORMAT_ANALYSIS );
+    server.connectivity = connectivity;
+    for ( uint32_t i = 0; i < TMF8X2X_SERVER_MAX_CONNECTIONS; i++ )
+    {
+        server.connections[ i ].inFd = -1;
+    }
+
+    memset( &action, 0, sizeof( action ) );
+    action.sa_handler = serverSignal; /* without SA_RESTART, poll returns */
+    sigemptyset( &action.sa_mask );
+    sigaction( SIGINT, &action, 0 );
+    sigaction( SIGTERM, &action, 0 );
+    action.sa_handler = SIG_IGN; /* a client that went away is a write error of its connection */
+    sigaction( SIGPIPE, &action, 0 );
+
+    if ( stdio )
+    {
+        serverOpen( STDIN_FILENO, STDOUT_FILENO );
+    }
+    else
+    {
+        listenFd = serverListen( socketName );
+        if ( listenFd < 0 )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+
+    while ( ! serverStop )
+    {
+        nfds_t count = 0;
+
+        if ( listenFd >= 0 )
+        {
+            fds[ count ].fd = listenFd;
+            fds[ count ].events = POLLIN;
+            polled[ count++ ] = 0;
+        }
+        for ( uint32_t i = 0; i < TMF8X2X_SERVER_MAX_CONNECTIONS; i++ )
+        {
+            serverConnection * connection = &server.connections[ i ];
+            if ( connection->inFd >= 0 )
+            {
+                fds[ count ].fd = connection->queued ? connection->outFd : connection->inFd; /* no new requests while answers are queued */
+                fds[ count ].events = connection->queued ? POLLOUT : POLLIN;
+                polled[ count++ ] = connection;
+            }
+        }
+        if ( ! count )
+        {
+            break; /* stdin / stdout: end of input or quit */
+        }
+        if ( poll( fds, count, -1 ) < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            break;
+        }
+
+        for ( nfds_t i = 0; i < count; i++ )
+        {
+            if ( ! fds[ i ].revents )
+            {
+                continue;
+            }
+            if ( ! polled[ i ] )
+            {
+                int fd = accept( listenFd, 0, 0 );
+                if ( fd >= 0 && ( fcntl( fd, F_SETFL, O_NONBLOCK ) != 0 || serverOpen( fd, fd ) != TMF8X2X_SPAD_MAP_OK ) )
+                {
+                    close( fd ); /* all slots taken */
+                }
+            }
+            else if ( polled[ i ]->queued )
+            {
+                serverDrain( polled[ i ] );
+            }
+            else
+            {
+                serverReceive( polled[ i ] );
+            }
+        }
+    }
+
+    for ( uint32_t i = 0; i < TMF8X2X_SERVER_MAX_CONNECTIONS; i++ )
+    {
+        if ( server.connections[ i ].inFd >= 0 )
+        {
+            serverClose( &server.connections[ i ] );
+        }
+    }
+    if ( listenFd >= 0 )
+    {
+        close( listenFd );
+        unlink( socketName );
+    }
+
+    /* the final stats go to stderr, stdout carries the answers in stdin / stdout mode */
+    tmf8x2xSinkInitFd( &statsSink, STDERR_FILENO );
+    previous = dumpSelectSink( &statsSink );
+    serverDumpStats();
+    dumpFlush();
+    dumpSelectSink( previous );
+    dumpFlush();
+    return TMF8X2X_SPAD_MAP_OK;
+}
@@ -0,0 +1,131 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_server.h
+ *  \brief server mode, a resident process that answers SPAD map requests over a UNIX domain socket or stdin / stdout.
+ *
+ * Line protocol, requests can be pipelined (sent without waiting for the answers), one answer per request in request order:
+ *
+ *   map <xOffset_2> <yOffset_2> [name]     a record as in the batch mode (tmf8x2x_batch.h), closed by a line "end"
+ *   <SPAD map rows>
+ *   [mask
+ *   <SPAD mask rows>]
+ *   end
+ *
+ *   bin [name]                             followed by TMF8X2X_CORPUS_RECORD_SIZE bytes, a tmf8x2xCorpusRecord (tmf8x2x_corpus.h)
+ *   stats                                  answers the request counters and the latency histogram
+ *   quit                                   closes the connection (stdin / stdout: stops the server)
+ *
+ * Every SPAD map request is answered with the JSON line of spad_tool -f json: verdict, failure reason, packed configuration
+ * and register bytes. Answers are collected in the output sink of the connection and written when it is full or the
+ * received block is done, so a client that pipelines requests gets its answers in few writes. The latency of a request
+ * is the time from reading the block that completes it to writing its answer.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_SERVER_H
+#define TMF8X2X_SERVER_H
+
+/* latency histogram: below 8 ns one bucket per ns, above 8 buckets per power of two (12.5 % resolution) */
+#define TMF8X2X_LATENCY_SUB_BUCKETS         8
+/* the last bucket collects everything from 2^41 ns (about 37 minutes) on */
+#define TMF8X2X_LATENCY_BUCKETS             ( TMF8X2X_LATENCY_SUB_BUCKETS * 40 )
+
+/* clients that can be connected at the same time, further connections are closed right away */
+#define TMF8X2X_SERVER_MAX_CONNECTIONS      32
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* log-linear histogram of latencies in nanoseconds, set to all zero before the first tmf8x2xLatencyAdd */
+typedef struct _tmf8x2xLatencyHistogram
+{
+    uint64_t counts[ TMF8X2X_LATENCY_BUCKETS ];
+    uint64_t total;                 /* number of latencies */
+    uint64_t sumNs;
+    uint64_t minNs;                 /* only valid if total is not 0 */
+    uint64_t maxNs;
+} tmf8x2xLatencyHistogram;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xLatencyAdd adds a latency to a histogram
+ * @param histogram to add to
+ * @param ns latency in nanoseconds
+ */
+void tmf8x2xLatencyAdd( tmf8x2xLatencyHistogram * histogram, uint64_t ns );
+
+/**
+ * @brief tmf8x2xLatencyBucket returns the range of latencies a bucket counts
+ * @param bucket number of the bucket, below TMF8X2X_LATENCY_BUCKETS
+ * @param highNs receives the largest latency of the bucket in nanoseconds
+ * @return smallest latency of the bucket in nanoseconds
+ */
+uint64_t tmf8x2xLatencyBucket( uint32_t bucket, uint64_t * highNs );
+
+/**
+ * @brief tmf8x2xLatencyQuantile returns a quantile of the latencies: the largest latency of the bucket that holds it, at most the maximum
+ * @param histogram with the latencies
+ * @param permille quantile in 1/1000, e.g. 500 for the median or 999 for p99.9
+ * @return latency in nanoseconds, 0 for an empty histogram
+ */
+uint64_t tmf8x2xLatencyQuantile( const tmf8x2xLatencyHistogram * histogram, uint32_t permille );
+
+/**
+ * @brief tmf8x2xRunServer answers requests until it is stopped (SIGINT / SIGTERM, or end of input / quit for stdin / stdout),
+ * then writes the stats answer to stderr
+ * @param socketName path of the UNIX domain socket to listen on (a socket left over at this path is replaced), "-" for stdin / stdout
+ * @param formats TMF8X2X_FORMAT_ZONE_STATS / TMF8X2X_FORMAT_ISLANDS add the zone statistics / islands to the answers, other bits are ignored
+ * @param connectivity strict mode: TMF8X2X_CONNECTIVITY_4 / TMF8X2X_CONNECTIVITY_8 rejects SPAD maps with a zone that is split into
+ * several islands, 0 for the checks of tmf8x2xValidateSpadMask only
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the socket cannot be set up, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xRunServer( const char * socketName, uint32_t formats, uint8_t connectivity );
+
+#endif /* TMF8X2X_SERVER_H */
@@ -0,0 +1,487 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_spad_kernels.c
+ *  \brief bit packing kernels for SPAD masks (scalar, SSE2, AVX2, BMI2) with runtime CPU dispatch.
+ *
+ * All kernels work row wise: the bytes of one SPAD row (up to 18) are turned into bit masks with one bit per SPAD
+ * (enable bit, the three channel bits, and "channel is 0/1" / "channel is 8/9" for the row select check).
+ * The channel bit rows are then transposed into the column layout of tdcChannel[ ] in one go.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_spad_kernels.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define TMF8X2X_KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define TMF8X2X_KERNELS_X86 0
+#endif
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* a row is read with one 32 byte load, rows closer than this to the end of the matrix are copied first */
+#define KERNEL_ROW_LOAD_SIZE                32
+
+/* byte lane constants for the 64-bit BMI2 kernel */
+#define KERNEL_BYTES_01                     0x0101010101010101ull
+#define KERNEL_BYTES_7F                     0x7f7f7f7f7f7f7f7full
+#define KERNEL_BYTES_80                     0x8080808080808080ull
+#define KERNEL_BYTES_FE                     0xfefefefefefefefeull
+#define KERNEL_BYTES_08                     0x0808080808080808ull
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* bit masks of one SPAD row, bit x belongs to SPAD x */
+typedef struct _tmf8x2xKernelRow
+{
+    uint32_t lsb;   /* channel bit 0 */
+    uint32_t mid;   /* channel bit 1 */
+    uint32_t msb;   /* channel bit 2 */
+    uint32_t low;   /* channel is 0 or 1 */
+    uint32_t alt;   /* channel is 8 or 9 */
+} tmf8x2xKernelRow;
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief kernelSupported checks if the CPU can run a kernel
+ * @param kernel TMF8X2X_KERNEL_* value (not AUTO)
+ * @return 1 if supported, 0 otherwise
+ */
+static int kernelSupported( uint8_t kernel );
+/**
+ * @brief kernelSelected returns the kernel to use for the next call
+ * @return TMF8X2X_KERNEL_* value (not AUTO)
+ */
+static uint8_t kernelSelected( void );
+/**
+ * @brief kernelRowPointer returns a pointer to a row that can safely be read with a KERNEL_ROW_LOAD_SIZE load
+ * @param matrix start of the byte matrix
+ * @param offset of the row in the matrix
+ * @param total size of the matrix in bytes
+ * @param padded buffer of KERNEL_ROW_LOAD_SIZE bytes used for rows at the end of the matrix
+ * @param xSize bytes in one row
+ * @return pointer to the row, either into the matrix or to the padded copy
+ */
+static const uint8_t * kernelRowPointer( const uint8_t * matrix, uint32_t offset, uint32_t total, uint8_t * padded, uint8_t xSize );
+
+static uint32_t packRowScalar( const uint8_t * row, uint8_t xSize );
+static void channelRowScalar( tmf8x2xKernelRow * bits, const uint8_t * row, uint8_t xSize );
+/**
+ * @brief transposeStage swaps the j x j bit blocks of one stage of the 32x32 bit transpose
+ * @param a 32 words of the matrix
+ * @param j block size in bits
+ * @param m mask of the lower j bits of each 2j bit group
+ */
+static inline void transposeStage( uint32_t a[ 32 ], uint32_t j, uint32_t m );
+#if TMF8X2X_KERNELS_X86
+static uint32_t packRowSse2( const uint8_t * row );
+static void channelRowSse2( tmf8x2xKernelRow * bits, const uint8_t * row );
+static uint32_t packRowAvx2( const uint8_t * row );
+static void channelRowAvx2( tmf8x2xKernelRow * bits, const uint8_t * row );
+static uint32_t packRowBmi2( const uint8_t * row );
+static void channelRowBmi2( tmf8x2xKernelRow * bits, const uint8_t * row );
+#endif
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+/* kernel forced by tmf8x2xSetKernel, only written before the kernels are used */
+static uint8_t forcedKernel = TMF8X2X_KERNEL_AUTO;
+
+/*
+ *****************************************************************************
+ * DISPATCH
+ *****************************************************************************
+ */
+
+static int kernelSupported ( uint8_t kernel )
+{
+    switch ( kernel )
+    {
+        case TMF8X2X_KERNEL_SCALAR: return 1;
+#if TMF8X2X_KERNELS_X86
+        case TMF8X2X_KERNEL_SSE2:   return !!__builtin_cpu_supports( "sse2" );
+        case TMF8X2X_KERNEL_AVX2:   return !!__builtin_cpu_supports( "avx2" );
+        case TMF8X2X_KERNEL_BMI2:   return !!__builtin_cpu_supports( "bmi2" );
+#endif
+        default:                    return 0;
+    }
+}
+
+static uint8_t kernelSelected ( void )
+{
+    if ( forcedKernel != TMF8X2X_KERNEL_AUTO )
+    {
+        return forcedKernel;
+    }
+    /* one load per row makes AVX2 the fastest, PEXT is microcoded on some CPUs so BMI2 comes after SSE2 */
+    if ( kernelSupported( TMF8X2X_KERNEL_AVX2 ) )
+    {
+        return TMF8X2X_KERNEL_AVX2;
+    }
+    if ( kernelSupported( TMF8X2X_KERNEL_SSE2 ) )
+    {
+        return TMF8X2X_KERNEL_SSE2;
+    }
+    if ( kernelSupported( TMF8X2X_KERNEL_BMI2 ) )
+    {
+        return TMF8X2X_KERNEL_BMI2;
+    }
+    return TMF8X2X_KERNEL_SCALAR;
+}
+
+uint8_t tmf8x2xSetKernel ( uint8_t kernel )
+{
+    if ( kernel != TMF8X2X_KERNEL_AUTO && ! kernelSupported( kernel ) )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    forcedKernel = kernel;
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xGetKernel ( void )
+{
+    return kernelSelected();
+}
+
+const char * tmf8x2xKernelName ( uint8_t kernel )
+{
+    switch ( kernel )
+    {
+        case TMF8X2X_KERNEL_AUTO:   return "auto";
+        case TMF8X2X_KERNEL_SCALAR: return "scalar";
+        case TMF8X2X_KERNEL_SSE2:   return "sse2";
+        case TMF8X2X_KERNEL_AVX2:   return "avx2";
+        case TMF8X2X_KERNEL_BMI2:   return "bmi2";
+        default:                    return "unknown";
+    }
+}
+
+static const uint8_t * kernelRowPointer ( const uint8_t * matrix, uint32_t offset, uint32_t total, uint8_t * padded, uint8_t xSize )
+{
+    if ( offset + KERNEL_ROW_LOAD_SIZE <= total )
+    {
+        return matrix + offset;
+    }
+    memset( padded, 0, KERNEL_ROW_LOAD_SIZE );
+    memcpy( padded, matrix + offset, xSize );
+    return padded;
+}
+
+/*
+ *****************************************************************************
+ * SCALAR KERNELS
+ *****************************************************************************
+ */
+
+static uint32_t packRowScalar ( const uint8_t * row, uint8_t xSize )
+{
+    uint32_t currentRowMap = 0;
+
+    for ( uint32_t col = 0; col < xSize; ++col )
+    {
+        currentRowMap |= ( row[ col ] > 0 ? 1 : 0 ) << col;
+    }
+    return currentRowMap;
+}
+
+static void channelRowScalar ( tmf8x2xKernelRow * bits, const uint8_t * row, uint8_t xSize )
+{
+    bits->lsb = 0;
+    bits->mid = 0;
+    bits->msb = 0;
+    bits->low = 0;
+    bits->alt = 0;
+    for ( uint32_t x = 0; x < xSize; x++ )
+    {
+        uint8_t ch = row[ x ];
+        bits->lsb |= (uint32_t)( ch & 1 ) << x;
+        bits->mid |= (uint32_t)( ( ch >> 1 ) & 1 ) << x;
+        bits->msb |= (uint32_t)( ( ch >> 2 ) & 1 ) << x;
+        bits->low |= (uint32_t)( ch == 0 || ch == 1 ) << x;
+        bits->alt |= (uint32_t)( ch == 8 || ch == 9 ) << x;
+    }
+}
+
+/*
+ *****************************************************************************
+ * X86 KERNELS
+ *****************************************************************************
+ */
+
+#if TMF8X2X_KERNELS_X86
+
+__attribute__(( target( "sse2" ) ))
+static uint32_t packRowSse2 ( const uint8_t * row )
+{
+    __m128i zero = _mm_setzero_si128();
+    uint32_t lo = (uint32_t)_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)row ), zero ) );
+    uint32_t hi = (uint32_t)_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)( row + 16 ) ), zero ) );
+    return ~( lo | ( hi << 16 ) );
+}
+
+__attribute__(( target( "sse2" ) ))
+static void channelRowSse2 ( tmf8x2xKernelRow * bits, const uint8_t * row )
+{
+    __m128i pairMask = _mm_set1_epi8( (char)0xfe );
+    __m128i alt = _mm_set1_epi8( 8 );
+    uint32_t result[ 5 ] = { 0, 0, 0, 0, 0 };
+
+    for ( uint32_t half = 0; half < 2; half++ )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i *)( row + 16 * half ) );
+        __m128i pair = _mm_and_si128( v, pairMask ); /* channel without bit 0: 0/1 -> 0, 8/9 -> 8 */
+        uint32_t shift = 16 * half;
+        result[ 0 ] |= (uint32_t)_mm_movemask_epi8( _mm_slli_epi16( v, 7 ) ) << shift; /* move bit 0 of each byte to the byte's top bit */
+        result[ 1 ] |= (uint32_t)_mm_movemask_epi8( _mm_slli_epi16( v, 6 ) ) << shift;
+        result[ 2 ] |= (uint32_t)_mm_movemask_epi8( _mm_slli_epi16( v, 5 ) ) << shift;
+        result[ 3 ] |= (uint32_t)_mm_movemask_epi8( _mm_cmpeq_epi8( pair, _mm_setzero_si128() ) ) << shift;
+        result[ 4 ] |= (uint32_t)_mm_movemask_epi8( _mm_cmpeq_epi8( pair, alt ) ) << shift;
+    }
+    bits->lsb = result[ 0 ];
+    bits->mid = result[ 1 ];
+    bits->msb = result[ 2 ];
+    bits->low = result[ 3 ];
+    bits->alt = result[ 4 ];
+}
+
+__attribute__(( target( "avx2" ) ))
+static uint32_t packRowAvx2 ( const uint8_t * row )
+{
+    __m256i v = _mm256_loadu_si256( (const __m256i *)row );
+    return ~(uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( v, _mm256_setzero_si256() ) );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void channelRowAvx2 ( tmf8x2xKernelRow * bits, const uint8_t * row )
+{
+    __m256i v = _mm256_loadu_si256( (const __m256i *)row );
+    __m256i pair = _mm256_and_si256( v, _mm256_set1_epi8( (char)0xfe ) );
+
+    bits->lsb = (uint32_t)_mm256_movemask_epi8( _mm256_slli_epi16( v, 7 ) );
+    bits->mid = (uint32_t)_mm256_movemask_epi8( _mm256_slli_epi16( v, 6 ) );
+    bits->msb = (uint32_t)_mm256_movemask_epi8( _mm256_slli_epi16( v, 5 ) );
+    bits->low = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( pair, _mm256_setzero_si256() ) );
+    bits->alt = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( pair, _mm256_set1_epi8( 8 ) ) );
+}
+
+/* top bit of each byte lane is set if the byte is not zero */
+__attribute__(( target( "bmi2" ) ))
+static inline uint64_t bytesNonZero ( uint64_t v )
+{
+    return ( ( ( v & KERNEL_BYTES_7F ) + KERNEL_BYTES_7F ) | v ) & KERNEL_BYTES_80;
+}
+
+__attribute__(( target( "bmi2" ) ))
+static uint32_t packRowBmi2 ( const uint8_t * row )
+{
+    uint32_t result = 0;
+    for ( uint32_t part = 0; part < 3; part++ )
+    {
+        uint64_t v;
+        memcpy( &v, row + 8 * part, sizeof( v ) );
+        result |= (uint32_t)_pext_u64( bytesNonZero( v ), KERNEL_BYTES_80 ) << ( 8 * part );
+    }
+    return result;
+}
+
+__attribute__(( target( "bmi2" ) ))
+static void channelRowBmi2 ( tmf8x2xKernelRow * bits, const uint8_t * row )
+{
+    uint32_t result[ 5 ] = { 0, 0, 0, 0, 0 };
+
+    for ( uint32_t part = 0; part < 3; part++ )
+    {
+        uint64_t v;
+        uint64_t pair;
+        uint32_t shift = 8 * part;
+        memcpy( &v, row + 8 * part, sizeof( v ) );
+        pair = v & KERNEL_BYTES_FE;
+        result[ 0 ] |= (uint32_t)_pext_u64( v, KERNEL_BYTES_01 ) << shift;
+        result[ 1 ] |= (uint32_t)_pext_u64( v, KERNEL_BYTES_01 << 1 ) << shift;
+        result[ 2 ] |= (uint32_t)_pext_u64( v, KERNEL_BYTES_01 << 2 ) << shift;
+        result[ 3 ] |= (uint32_t)_pext_u64( ~bytesNonZero( pair ), KERNEL_BYTES_80 ) << shift;
+        result[ 4 ] |= (uint32_t)_pext_u64( ~bytesNonZero( pair ^ KERNEL_BYTES_08 ), KERNEL_BYTES_80 ) << shift;
+    }
+    bits->lsb = result[ 0 ];
+    bits->mid = result[ 1 ];
+    bits->msb = result[ 2 ];
+    bits->low = result[ 3 ];
+    bits->alt = result[ 4 ];
+}
+
+#endif /* TMF8X2X_KERNELS_X86 */
+
+/*
+ *****************************************************************************
+ * PUBLIC KERNELS
+ *****************************************************************************
+ */
+
+static inline void transposeStage ( uint32_t a[ 32 ], uint32_t j, uint32_t m )
+{
+    for ( uint32_t block = 0; block < 32; block += 2 * j ) /* the inner loop works on j consecutive words, which the compiler can vectorise */
+    {
+        for ( uint32_t k = block; k < block + j; k++ )
+        {
+            uint32_t t = ( ( a[ k ] >> j ) ^ a[ k + j ] ) & m;
+            a[ k ] ^= t << j;
+            a[ k + j ] ^= t;
+        }
+    }
+}
+
+void tmf8x2xTranspose32 ( uint32_t a[ 32 ] )
+{
+    /* swap the upper j bits of word k with the lower j bits of word k+j, for blocks of 16, 8, 4, 2 and 1 bits */
+    transposeStage( a, 16, 0x0000ffff );
+    transposeStage( a, 8, 0x00ff00ff );
+    transposeStage( a, 4, 0x0f0f0f0f );
+    transposeStage( a, 2, 0x33333333 );
+    transposeStage( a, 1, 0x55555555 );
+}
+
+void tmf8x2xPackEnableMask ( uint32_t * packed, const uint8_t * enable, const uint8_t xSize, const uint8_t ySize )
+{
+    uint8_t kernel = kernelSelected();
+    uint32_t total = (uint32_t)xSize * ySize;
+    uint32_t xMask = ( 1u << xSize ) - 1;
+    uint8_t padded[ KERNEL_ROW_LOAD_SIZE ];
+
+    for ( uint32_t row = 0; row < ySize; ++row )
+    {
+        const uint8_t * data = enable + row * xSize;
+        uint32_t bits;
+#if TMF8X2X_KERNELS_X86
+        if ( kernel != TMF8X2X_KERNEL_SCALAR )
+        {
+            data = kernelRowPointer( enable, row * xSize, total, padded, xSize );
+        }
+        switch ( kernel )
+        {
+            case TMF8X2X_KERNEL_SSE2:   bits = packRowSse2( data ); break;
+            case TMF8X2X_KERNEL_AVX2:   bits = packRowAvx2( data ); break;
+            case TMF8X2X_KERNEL_BMI2:   bits = packRowBmi2( data ); break;
+            default:                    bits = packRowScalar( data, xSize ); break;
+        }
+#else
+        (void)kernel;
+        (void)total;
+        (void)padded;
+        bits = packRowScalar( data, xSize );
+#endif
+        packed[ row ] = bits & xMask;
+    }
+}
+
+uint8_t tmf8x2xEncodeChannelMap ( uint32_t * tdcChannel, uint32_t * tdcChannelSelect, const uint8_t * channels, const uint8_t xSize, const uint8_t ySize )
+{
+    uint8_t kernel = kernelSelected();
+    uint32_t total = (uint32_t)xSize * ySize;
+    uint32_t xMask = ( 1u << xSize ) - 1;
+    uint32_t lineSelect = 0;
+    uint32_t conflict = 0;
+    uint32_t bits[ 32 ];
+    uint8_t padded[ KERNEL_ROW_LOAD_SIZE ];
+    uint32_t y;
+
+    for ( y = 0; y < 32; y++ )
+    {
+        bits[ y ] = 0;
+    }
+
+    for ( y = 0; y < ySize; y++ )
+    {
+        uint32_t offset = ( ySize - 1 - y ) * xSize; /* the human readable map starts with the top row */
+        const uint8_t * data = channels + offset;
+        tmf8x2xKernelRow row;
+#if TMF8X2X_KERNELS_X86
+        if ( kernel != TMF8X2X_KERNEL_SCALAR )
+        {
+            data = kernelRowPointer( channels, offset, total, padded, xSize );
+        }
+        switch ( kernel )
+        {
+            case TMF8X2X_KERNEL_SSE2:   channelRowSse2( &row, data ); break;
+            case TMF8X2X_KERNEL_AVX2:   channelRowAvx2( &row, data ); break;
+            case TMF8X2X_KERNEL_BMI2:   channelRowBmi2( &row, data ); break;
+            default:                    channelRowScalar( &row, data, xSize ); break;
+        }
+#else
+        (void)kernel;
+        (void)total;
+        (void)padded;
+        channelRowScalar( &row, data, xSize );
+#endif
+        /* an 8 is encoded as a 0, and a 9 as a 1, the row select bit tells them apart */
+        bits[ TMF8X2X_MAIN_SPAD_VERTICAL_LSB_SHIFT + y ] = row.lsb & xMask;
+        bits[ TMF8X2X_MAIN_SPAD_VERTICAL_MID_SHIFT + y ] = row.mid & xMask;
+        bits[ TMF8X2X_MAIN_SPAD_VERTICAL_MSB_SHIFT + y ] = row.msb & xMask;
+        if ( row.alt & xMask )
+        {
+            lineSelect |= ( 1u << y ); /* this row has channels 8/9 selected */
+            conflict |= ( row.low & xMask ); /* no 0/1 in same row as 8/9 */
+        }
+    }
+
+    tmf8x2xTranspose32( bits ); /* rows of channel bits -> columns of 3x10 bits */
+    for ( uint32_t x = 0; x < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; x++ )
+    {
+        tdcChannel[ x ] = bits[ x ];
+    }
+    *tdcChannelSelect = lineSelect;
+
+    return conflict ? TMF8X2X_SPAD_MAP_ERROR_CONFIG : TMF8X2X_SPAD_MAP_OK;
+}
@@ -0,0 +1,101 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_spad_kernels.h
+ *  \brief bit packing kernels for SPAD masks (scalar, SSE2, AVX2, BMI2) with runtime CPU dispatch.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_SPAD_KERNELS_H
+#define TMF8X2X_SPAD_KERNELS_H
+
+/* kernel implementations, TMF8X2X_KERNEL_AUTO selects the best one the CPU supports */
+#define TMF8X2X_KERNEL_AUTO                 0
+#define TMF8X2X_KERNEL_SCALAR               1
+#define TMF8X2X_KERNEL_SSE2                 2
+#define TMF8X2X_KERNEL_AVX2                 3
+#define TMF8X2X_KERNEL_BMI2                 4
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xSetKernel forces a kernel implementation, e.g. to compare them. Call before any other thread uses the kernels.
+ * @param kernel TMF8X2X_KERNEL_* value
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the CPU does not support the kernel (the setting is not changed), TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xSetKernel( uint8_t kernel );
+
+/**
+ * @brief tmf8x2xGetKernel returns the kernel implementation that is used
+ * @return TMF8X2X_KERNEL_SCALAR, TMF8X2X_KERNEL_SSE2, TMF8X2X_KERNEL_AVX2 or TMF8X2X_KERNEL_BMI2
+ */
+uint8_t tmf8x2xGetKernel( void );
+
+/**
+ * @brief tmf8x2xKernelName returns the name of a kernel implementation
+ * @param kernel TMF8X2X_KERNEL_* value
+ * @return name of the kernel
+ */
+const char * tmf8x2xKernelName( uint8_t kernel );
+
+/**
+ * @brief tmf8x2xTranspose32 transposes a 32x32 bit matrix in place, afterwards bit c of word r holds what was bit r of word c before
+ * @param a 32 words of the matrix
+ */
+void tmf8x2xTranspose32( uint32_t a[ 32 ] );
+
+/**
+ * @brief tmf8x2xEncodeChannelMap encodes a human readable channel map into the packed TDC channel columns and the row select bits
+ * @param tdcChannel receives TMF8X2X_MAIN_SPAD_MAX_X_SIZE column words with 3x10 bits each (unused columns are cleared)
+ * @param tdcChannelSelect receives one bit per row, set for rows that use channels 8/9
+ * @param channels channel map, top row first
+ * @param xSize SPAD map size in x direction (up to TMF8X2X_MAIN_SPAD_MAX_X_SIZE)
+ * @param ySize SPAD map size in y direction (up to TMF8X2X_MAIN_SPAD_MAX_Y_SIZE)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if a row uses channel 0/1 and 8/9, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xEncodeChannelMap( uint32_t * tdcChannel, uint32_t * tdcChannelSelect, const uint8_t * channels, const uint8_t xSize, const uint8_t ySize );
+
+#endif /* TMF8X2X_SPAD_KERNELS_H */
@@ -0,0 +1,428 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_spad_lib.c
+ *  \brief entry points of libtmf8x2xspad: create, check, pack and encode SPAD configurations without stdio or global state.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_zone_stats.h"
+#include "tmf8x2x_spad_lib.h"
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* caller buffer of tmf8x2xLibEncode, filled by the callback sink */
+typedef struct _libTextBuffer
+{
+    char * text;
+    uint32_t size;
+    uint32_t length;        /* characters produced, also the ones that did not fit */
+} libTextBuffer;
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief libResult fills in the status (if given) and returns the code
+ * @param status receives the details, can be 0
+ * @param code TMF8X2X_LIB_*
+ * @param check TMF8X2X_VALIDATE_* of the check that failed
+ * @param channel channel concerned, or TMF8X2X_LIB_NONE
+ * @param x column concerned, or TMF8X2X_LIB_NONE
+ * @param y row concerned (0 is bottom), or TMF8X2X_LIB_NONE
+ * @return code
+ */
+static uint8_t libResult( tmf8x2xLibStatus * status, uint8_t code, uint8_t check, uint8_t channel, uint8_t x, uint8_t y );
+
+/**
+ * @brief libCheckChannels reports channel 0 and empty TDC channel pairs in the channel bitplanes of a SPAD map
+ * @param planes assigned SPADs per channel (bit x of planes[ ch ][ y ])
+ * @param ySize SPAD map size in y direction
+ * @param status receives the details, can be 0
+ * @return TMF8X2X_LIB_OK, TMF8X2X_LIB_ERROR_CHANNEL_0 or TMF8X2X_LIB_ERROR_CALIBRATION
+ */
+static uint8_t libCheckChannels( const uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ], uint8_t ySize, tmf8x2xLibStatus * status );
+
+/**
+ * @brief libCheckAdjacent reports the first channel that has enabled SPADs but no two adjacent ones
+ * @param config configuration in machine readable format (packed), size in range
+ * @param status receives the details, can be 0
+ * @return TMF8X2X_LIB_OK or TMF8X2X_LIB_ERROR_ASSIGNMENT
+ */
+static uint8_t libCheckAdjacent( const tmf8x2xHalMainSpadConfig * config, tmf8x2xLibStatus * status );
+
+/**
+ * @brief libTextWrite callback of the sink of tmf8x2xLibEncode, copies what fits into the caller buffer
+ * @param context libTextBuffer
+ * @param data to copy
+ * @param length of data
+ */
+static void libTextWrite( void * context, const char * data, uint32_t length );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static uint8_t libResult ( tmf8x2xLibStatus * status, uint8_t code, uint8_t check, uint8_t channel, uint8_t x, uint8_t y )
+{
+    if ( status )
+    {
+        status->code = code;
+        status->check = check;
+        status->channel = channel;
+        status->x = x;
+        status->y = y;
+    }
+    return code;
+}
+
+static uint8_t libCheckChannels ( const uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ], uint8_t ySize, tmf8x2xLibStatus * status )
+{
+    uint8_t used[ TMF8X2X_NUMBER_OF_CHANNELS ] = { 0 };
+
+    for ( uint8_t y = 0; y < ySize; y++ )
+    {
+        for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+        {
+            used[ ch ] |= ( planes[ ch ][ y ] != 0 );
+        }
+        if ( planes[ 0 ][ y ] )
+        {
+            uint8_t x = 0;
+            while ( ! ( ( planes[ 0 ][ y ] >> x ) & 1 ) )
+            {
+                x++;
+            }
+            return libResult( status, TMF8X2X_LIB_ERROR_CHANNEL_0, TMF8X2X_VALIDATE_ERROR_CHANNEL, 0, x, y );
+        }
+    }
+    for ( uint8_t ch = CHANNEL_2; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch += 2 ) /* TDC pairs 2/3, 4/5, 6/7, 8/9 */
+    {
+        if ( ! used[ ch ] && ! used[ ch + 1 ] )
+        {
+            return libResult( status, TMF8X2X_LIB_ERROR_CALIBRATION, TMF8X2X_VALIDATE_ERROR_CHANNEL, ch, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+        }
+    }
+    return TMF8X2X_LIB_OK;
+}
+
+static uint8_t libCheckAdjacent ( const tmf8x2xHalMainSpadConfig * config, tmf8x2xLibStatus * status )
+{
+    uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    uint32_t xMask = ( 1u << config->xSize ) - 1;
+
+    tmf8x2xDecodeChannelPlanes( config, planes );
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        uint32_t used = 0;
+        uint32_t adjacent = 0;
+        uint32_t below = 0;
+        for ( uint8_t y = 0; y < config->ySize; y++ )
+        {
+            uint32_t row = planes[ ch ][ y ] & config->enableSpad[ y ] & xMask;
+            used |= row;
+            adjacent |= row & ( row >> 1 );                                 /* (x+1|y) */
+            adjacent |= below & ( row | ( row >> 1 ) | ( row << 1 ) );      /* (x|y+1), (x+1|y+1), (x-1|y+1) seen from the row below */
+            below = row;
+        }
+        if ( used && ! adjacent )
+        {
+            return libResult( status, TMF8X2X_LIB_ERROR_ASSIGNMENT, TMF8X2X_VALIDATE_ERROR_ASSIGNMENT, ch, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+        }
+    }
+    return TMF8X2X_LIB_OK;
+}
+
+static void libTextWrite ( void * context, const char * data, uint32_t length )
+{
+    libTextBuffer * buffer = (libTextBuffer *)context;
+
+    if ( buffer->length < buffer->size )
+    {
+        uint32_t space = buffer->size - buffer->length;
+        memcpy( buffer->text + buffer->length, data, ( length < space ) ? length : space );
+    }
+    buffer->length += length;
+}
+
+/*
+ *****************************************************************************
+ * CREATE AND CHECK
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xLibValidateMask ( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask, tmf8x2xLibStatus * status )
+{
+    uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    uint8_t check;
+
+    if ( ! config || ! mask || ! mask->enable || ! mask->channels )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_ARGUMENT, TMF8X2X_VALIDATE_OK, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    check = tmf8x2xValidateSpadMask( config, mask );
+
+    /* the checks only tell which check failed, look for the details in the human readable map */
+    switch ( check )
+    {
+        case TMF8X2X_VALIDATE_OK:
+            return libResult( status, TMF8X2X_LIB_OK, check, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+        case TMF8X2X_VALIDATE_ERROR_CREATE:
+            if ( mask->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || mask->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+            {
+                return libResult( status, TMF8X2X_LIB_ERROR_SIZE, check, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+            }
+            for ( uint8_t y = 0; y < mask->ySize; y++ )
+            {
+                const uint8_t * row = mask->channels + ( mask->ySize - 1 - y ) * mask->xSize; /* the human readable map starts with the top row */
+                uint8_t low = 0;
+                uint8_t alt = 0;
+                for ( uint8_t x = 0; x < mask->xSize; x++ )
+                {
+                    low |= ( row[ x ] <= 1 );
+                    alt |= ( row[ x ] == 8 || row[ x ] == 9 );
+                }
+                if ( low && alt )
+                {
+                    return libResult( status, TMF8X2X_LIB_ERROR_ROW_CONFLICT, check, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, y );
+                }
+            }
+            return libResult( status, TMF8X2X_LIB_ERROR_AREA, check, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+        case TMF8X2X_VALIDATE_ERROR_AREA:
+            return libResult( status, TMF8X2X_LIB_ERROR_AREA, check, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+        case TMF8X2X_VALIDATE_ERROR_CHANNEL:
+            for ( uint32_t c = 0; c < (uint32_t)mask->xSize * mask->ySize; c++ ) /* same order as tmf8x2xCheckMainSpadChannelSetup */
+            {
+                if ( mask->channels[ c ] == 0 || mask->channels[ c ] >= TMF8X2X_NUMBER_OF_CHANNELS )
+                {
+                    return libResult( status, mask->channels[ c ] ? TMF8X2X_LIB_ERROR_CHANNEL_RANGE : TMF8X2X_LIB_ERROR_CHANNEL_0, check
+                                    , mask->channels[ c ], (uint8_t)( c % mask->xSize ), (uint8_t)( mask->ySize - 1 - c / mask->xSize ) );
+                }
+            }
+            tmf8x2xDecodeChannelPlanes( config, planes );
+            libCheckChannels( planes, config->ySize, status );
+            return TMF8X2X_LIB_ERROR_CALIBRATION;
+        default:
+            if ( mask->xSize < 1 || mask->ySize < 1 || ( mask->xSize == 1 && mask->ySize == 1 ) )
+            {
+                return libResult( status, TMF8X2X_LIB_ERROR_SIZE, check, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+            }
+            return libCheckAdjacent( config, status );
+    }
+}
+
+uint8_t tmf8x2xLibCreate ( tmf8x2xHalMainSpadConfig * config, const uint8_t * channels, const uint8_t * enable, uint8_t xSize, uint8_t ySize, int8_t xOffset_2, int8_t yOffset_2, tmf8x2xLibStatus * status )
+{
+    uint32_t enablePacked[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    tmf8x2xSpadMask mask;
+
+    if ( ! config || ! channels || ! enable )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_ARGUMENT, TMF8X2X_VALIDATE_OK, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    if ( xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_SIZE, TMF8X2X_VALIDATE_ERROR_CREATE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    tmf8x2xPackEnableMask( enablePacked, enable, xSize, ySize );
+    mask.enable = enablePacked;
+    mask.channels = channels;
+    mask.id = 0;
+    mask.xOffset_2 = xOffset_2;
+    mask.yOffset_2 = yOffset_2;
+    mask.xSize = xSize;
+    mask.ySize = ySize;
+    return tmf8x2xLibValidateMask( config, &mask, status );
+}
+
+uint8_t tmf8x2xLibCheck ( const tmf8x2xHalMainSpadConfig * config, tmf8x2xLibStatus * status )
+{
+    uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    uint8_t code;
+
+    if ( ! config )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_ARGUMENT, TMF8X2X_VALIDATE_OK, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    if ( config->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE || config->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_SIZE, TMF8X2X_VALIDATE_ERROR_CREATE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    if ( config->xSize < 1 || config->ySize < 1 || ( config->xSize == 1 && config->ySize == 1 ) )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_SIZE, TMF8X2X_VALIDATE_ERROR_ASSIGNMENT, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    if ( tmf8x2xCheckMainSpadArea( config ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_AREA, TMF8X2X_VALIDATE_ERROR_AREA, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    tmf8x2xDecodeChannelPlanes( config, planes );
+    code = libCheckChannels( planes, config->ySize, status );
+    if ( code == TMF8X2X_LIB_OK )
+    {
+        code = libCheckAdjacent( config, status );
+    }
+    if ( code == TMF8X2X_LIB_OK )
+    {
+        libResult( status, TMF8X2X_LIB_OK, TMF8X2X_VALIDATE_OK, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    return code;
+}
+
+uint8_t tmf8x2xLibCheckConnectivity ( const tmf8x2xHalMainSpadConfig * config, uint8_t connectivity, tmf8x2xLibStatus * status )
+{
+    tmf8x2xSpadMapComponents components;
+
+    if ( ! config || ( connectivity != TMF8X2X_CONNECTIVITY_4 && connectivity != TMF8X2X_CONNECTIVITY_8 ) )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_ARGUMENT, TMF8X2X_VALIDATE_OK, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    if ( tmf8x2xFindZoneComponents( config, connectivity, &components ) != TMF8X2X_SPAD_MAP_OK )
+    {
+        return libResult( status, TMF8X2X_LIB_ERROR_SIZE, TMF8X2X_VALIDATE_ERROR_CREATE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+    }
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        if ( components.fragmented & ( 1u << ch ) )
+        {
+            return libResult( status, TMF8X2X_LIB_ERROR_FRAGMENTED, TMF8X2X_VALIDATE_ERROR_CONNECTIVITY, ch, components.zones[ ch ].x, components.zones[ ch ].y );
+        }
+    }
+    return libResult( status, TMF8X2X_LIB_OK, TMF8X2X_VALIDATE_OK, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE, TMF8X2X_LIB_NONE );
+}
+
+/*
+ *****************************************************************************
+ * PACK AND ENCODE
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xLibPack ( uint8_t * image, uint32_t size, const tmf8x2xHalMainSpadConfig * config )
+{
+    if ( ! image || ! config )
+    {
+        return TMF8X2X_LIB_ERROR_ARGUMENT;
+    }
+    if ( size < TMF8X2X_REGISTER_IMAGE_SIZE )
+    {
+        return TMF8X2X_LIB_ERROR_BUFFER;
+    }
+    tmf8x2xPackRegisterImage( image, config );
+    return TMF8X2X_LIB_OK;
+}
+
+uint8_t tmf8x2xLibUnpack ( tmf8x2xHalMainSpadConfig * config, const uint8_t * image, uint32_t size )
+{
+    if ( ! image || ! config )
+    {
+        return TMF8X2X_LIB_ERROR_ARGUMENT;
+    }
+    if ( size < TMF8X2X_REGISTER_IMAGE_SIZE )
+    {
+        return TMF8X2X_LIB_ERROR_BUFFER;
+    }
+    tmf8x2xUnpackRegisterImage( config, image );
+    return TMF8X2X_LIB_OK;
+}
+
+uint8_t tmf8x2xLibEncode ( char * text, uint32_t size, uint32_t * length, const tmf8x2xHalMainSpadConfig * config, const char * name, uint8_t format )
+{
+    tmf8x2xOutputSink sink;     /* the dump functions write to the sink selected on this thread only */
+    tmf8x2xOutputSink * previous;
+    libTextBuffer buffer;
+
+    if ( ( ! text && size ) || ! config || ! name || format > TMF8X2X_LIB_FORMAT_ENABLE_TEXT )
+    {
+        return TMF8X2X_LIB_ERROR_ARGUMENT;
+    }
+    buffer.text = text;
+    buffer.size = size;
+    buffer.length = 0;
+    tmf8x2xSinkInitCallback( &sink, libTextWrite, &buffer );
+    previous = dumpSelectSink( &sink );
+    switch ( format )
+    {
+        case TMF8X2X_LIB_FORMAT_CSTRUCT:    dumpMainSpadConfigAsCstruct( name, config ); break;
+        case TMF8X2X_LIB_FORMAT_I2C:        dumpMainSpadConfigAsI2Cstrings( name, config ); break;
+        case TMF8X2X_LIB_FORMAT_I2C_BURST:  dumpMainSpadConfigAsI2Cburst( name, config ); break;
+        default:                            dumpMainSpadEnableBitsAsText( config ); break;
+    }
+    tmf8x2xSinkFlush( &sink );
+    dumpSelectSink( previous );
+
+    if ( length )
+    {
+        *length = buffer.length;
+    }
+    if ( buffer.length >= size )
+    {
+        if ( size )
+        {
+            text[ size - 1 ] = 0;
+        }
+        return TMF8X2X_LIB_ERROR_BUFFER;
+    }
+    text[ buffer.length ] = 0;
+    return TMF8X2X_LIB_OK;
+}
+
+const char * tmf8x2xLibErrorText ( uint8_t code )
+{
+    switch ( code )
+    {
+        case TMF8X2X_LIB_OK:                    return "OK";
+        case TMF8X2X_LIB_ERROR_ARGUMENT:        return "invalid argument";
+        case TMF8X2X_LIB_ERROR_SIZE:            return "SPAD map size out of range";
+        case TMF8X2X_LIB_ERROR_CHANNEL_RANGE:   return "channel out of range";
+        case TMF8X2X_LIB_ERROR_ROW_CONFLICT:    return "channels 0/1 and 8/9 in the same row";
+        case TMF8X2X_LIB_ERROR_AREA:            return "SPAD map out of bounds - size / offset";
+        case TMF8X2X_LIB_ERROR_CHANNEL_0:       return "channel 0 used";
+        case TMF8X2X_LIB_ERROR_CALIBRATION:     return "no SPAD on a TDC channel pair (electrical calibration)";
+        case TMF8X2X_LIB_ERROR_ASSIGNMENT:      return "channel without two adjacent enabled SPADs";
+        case TMF8X2X_LIB_ERROR_BUFFER:          return "output buffer too small";
+        case TMF8X2X_LIB_ERROR_FRAGMENTED:      return "channel with enabled SPADs outside its largest island";
+        default:                                return "unknown error";
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_spad_lib.h
+ *  \brief entry points of libtmf8x2xspad: create, check, pack and encode SPAD configurations without stdio or global state.
+ *
+ * All functions are reentrant and can be called from several threads at once: they only work on the caller's
+ * structures and buffers. Errors are reported with a TMF8X2X_LIB_* code and, if the caller passes a status,
+ * with the SPAD, row or channel that failed.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_register_image.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_SPAD_LIB_H
+#define TMF8X2X_SPAD_LIB_H
+
+/* result codes of the library functions */
+#define TMF8X2X_LIB_OK                      0
+#define TMF8X2X_LIB_ERROR_ARGUMENT          1   /* null pointer or unknown format */
+#define TMF8X2X_LIB_ERROR_SIZE              2   /* xSize / ySize out of range, or a single SPAD */
+#define TMF8X2X_LIB_ERROR_CHANNEL_RANGE     3   /* channel > 9 at x|y */
+#define TMF8X2X_LIB_ERROR_ROW_CONFLICT      4   /* channels 0/1 and 8/9 in row y */
+#define TMF8X2X_LIB_ERROR_AREA              5   /* size / offset outside the SPAD area */
+#define TMF8X2X_LIB_ERROR_CHANNEL_0         6   /* channel 0 used at x|y */
+#define TMF8X2X_LIB_ERROR_CALIBRATION       7   /* no SPAD on channel and channel + 1 (electrical calibration) */
+#define TMF8X2X_LIB_ERROR_ASSIGNMENT        8   /* channel has enabled SPADs, but no two adjacent ones */
+#define TMF8X2X_LIB_ERROR_BUFFER            9   /* output buffer too small */
+#define TMF8X2X_LIB_ERROR_FRAGMENTED        10  /* channel has enabled SPADs that are not connected to its largest island at x|y */
+
+/* value of status fields that do not apply */
+#define TMF8X2X_LIB_NONE                    0xff
+
+/* formats of tmf8x2xLibEncode */
+#define TMF8X2X_LIB_FORMAT_CSTRUCT          0   /* same as dumpMainSpadConfigAsCstruct */
+#define TMF8X2X_LIB_FORMAT_I2C              1   /* same as dumpMainSpadConfigAsI2Cstrings */
+#define TMF8X2X_LIB_FORMAT_I2C_BURST        2   /* same as dumpMainSpadConfigAsI2Cburst */
+#define TMF8X2X_LIB_FORMAT_ENABLE_TEXT      3   /* same as dumpMainSpadEnableBitsAsText */
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* details of a library result */
+typedef struct _tmf8x2xLibStatus
+{
+    uint8_t code;           /* TMF8X2X_LIB_* */
+    uint8_t check;          /* TMF8X2X_VALIDATE_* of the check that failed, TMF8X2X_VALIDATE_OK if none */
+    uint8_t channel;        /* channel concerned, or TMF8X2X_LIB_NONE */
+    uint8_t x;              /* column concerned (0 is left), or TMF8X2X_LIB_NONE */
+    uint8_t y;              /* row concerned (0 is bottom), or TMF8X2X_LIB_NONE */
+} tmf8x2xLibStatus;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xLibCreate creates the packed SPAD configuration from a channel map and enable mask and runs all checks (tmf8x2xValidateSpadMask)
+ * @param config receives the SPAD configuration, complete unless status->check is TMF8X2X_VALIDATE_ERROR_CREATE
+ * @param channels channel map, one byte per SPAD, top row first
+ * @param enable enable mask, one byte per SPAD, top row first, any value > 0 enables a SPAD
+ * @param xSize SPAD map size in x direction
+ * @param ySize SPAD map size in y direction
+ * @param xOffset_2 center offset in x direction in Q1 format
+ * @param yOffset_2 center offset in y direction in Q1 format
+ * @param status receives the details, can be 0
+ * @return TMF8X2X_LIB_OK or TMF8X2X_LIB_ERROR_*
+ */
+uint8_t tmf8x2xLibCreate( tmf8x2xHalMainSpadConfig * config, const uint8_t * channels, const uint8_t * enable, uint8_t xSize, uint8_t ySize, int8_t xOffset_2, int8_t yOffset_2, tmf8x2xLibStatus * status );
+
+/**
+ * @brief tmf8x2xLibValidateMask same as tmf8x2xLibCreate for a SPAD mask with packed enable bits
+ * @param config receives the SPAD configuration, complete unless status->check is TMF8X2X_VALIDATE_ERROR_CREATE
+ * @param mask SPAD configuration in human readable format
+ * @param status receives the details, can be 0
+ * @return TMF8X2X_LIB_OK or TMF8X2X_LIB_ERROR_*
+ */
+uint8_t tmf8x2xLibValidateMask( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask, tmf8x2xLibStatus * status );
+
+/**
+ * @brief tmf8x2xLibCheck checks a packed SPAD configuration, e.g. one read back from the device: size, area, channel setup and assignment.
+ * Channels are taken from the packed TDC channel columns and the row select bits.
+ * @param config configuration in machine readable format (packed)
+ * @param status receives the details, can be 0
+ * @return TMF8X2X_LIB_OK or TMF8X2X_LIB_ERROR_*
+ */
+uint8_t tmf8x2xLibCheck( const tmf8x2xHalMainSpadConfig * config, tmf8x2xLibStatus * status );
+
+/**
+ * @brief tmf8x2xLibCheckConnectivity strict mode: checks that the enabled SPADs of every channel form a single island (connected component)
+ * @param config configuration in machine readable format (packed), e.g. after tmf8x2xLibCheck passed
+ * @param connectivity TMF8X2X_CONNECTIVITY_4 or TMF8X2X_CONNECTIVITY_8 (tmf8x2x_zone_stats.h)
+ * @param status receives the details, can be 0. For TMF8X2X_LIB_ERROR_FRAGMENTED the first SPAD outside the largest island of the channel.
+ * @return TMF8X2X_LIB_OK, TMF8X2X_LIB_ERROR_ARGUMENT, TMF8X2X_LIB_ERROR_SIZE or TMF8X2X_LIB_ERROR_FRAGMENTED
+ */
+uint8_t tmf8x2xLibCheckConnectivity( const tmf8x2xHalMainSpadConfig * config, uint8_t connectivity, tmf8x2xLibStatus * status );
+
+/**
+ * @brief tmf8x2xLibPack packs a SPAD configuration into the register image 0x24..0x90
+ * @param image receives TMF8X2X_REGISTER_IMAGE_SIZE bytes
+ * @param size of the image buffer in bytes
+ * @param config configuration in machine readable format (packed)
+ * @return TMF8X2X_LIB_OK, TMF8X2X_LIB_ERROR_ARGUMENT or TMF8X2X_LIB_ERROR_BUFFER
+ */
+uint8_t tmf8x2xLibPack( uint8_t * image, uint32_t size, const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xLibUnpack converts a register image 0x24..0x90 back to a SPAD configuration
+ * @param config receives the configuration
+ * @param image register image
+ * @param size of the image in bytes, at least TMF8X2X_REGISTER_IMAGE_SIZE
+ * @return TMF8X2X_LIB_OK, TMF8X2X_LIB_ERROR_ARGUMENT or TMF8X2X_LIB_ERROR_BUFFER
+ */
+uint8_t tmf8x2xLibUnpack( tmf8x2xHalMainSpadConfig * config, const uint8_t * image, uint32_t size );
+
+/**
+ * @brief tmf8x2xLibEncode writes a SPAD configuration as text, in the formats of spad_tool
+ * @param text receives the zero terminated text
+ * @param size of the text buffer in bytes
+ * @param length receives the text length without the terminating zero, also if the buffer is too small (can be 0)
+ * @param config configuration in machine readable format (packed)
+ * @param name of the SPAD configuration in the output
+ * @param format TMF8X2X_LIB_FORMAT_*
+ * @return TMF8X2X_LIB_OK, TMF8X2X_LIB_ERROR_ARGUMENT or TMF8X2X_LIB_ERROR_BUFFER (the text is truncated then)
+ */
+uint8_t tmf8x2xLibEncode( char * text, uint32_t size, uint32_t * length, const tmf8x2xHalMainSpadConfig * config, const char * name, uint8_t format );
+
+/**
+ * @brief tmf8x2xLibErrorText returns a short description of a library result code
+ * @param code TMF8X2X_LIB_*
+ * @return description (no line feed)
+ */
+const char * tmf8x2xLibErrorText( uint8_t code );
+
+#endif /* TMF8X2X_SPAD_LIB_H */
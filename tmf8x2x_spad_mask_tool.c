@@ -36,16 +36,44 @@
  *****************************************************************************
  */
 
-#include <stdio.h>
 #include <math.h>
 #include "tmf8x2x_includes.h"
 #include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_spad_kernels.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* lanes of channel bitplanes in 64-bit words for the SPAD assignment check */
+#define CHECK_LANE_BITS                     21
+#define CHECK_LANE_MASK                     ( ( 1u << TMF8X2X_MAIN_SPAD_MAX_X_SIZE ) - 1 )
+#define CHECK_LANES_PER_WORD                3
+#define CHECK_LANE_WORDS                    ( ( TMF8X2X_NUMBER_OF_CHANNELS + CHECK_LANES_PER_WORD - 1 ) / CHECK_LANES_PER_WORD )
+
+/*
+ *****************************************************************************
+ * VARIABLES
+ *****************************************************************************
+ */
+
+/* default output sink, writes to stdout (file descriptor 1), initialised statically so that no thread has to set it up */
+static tmf8x2xOutputSink stdoutSink = { stdoutSink.storage, TMF8X2X_SINK_BUFFER_SIZE, 0, TMF8X2X_SINK_FD, 0, 1, 0, 0, { 0 } };
+/* sink selected with dumpSelectSink, 0 for the default sink. Each thread selects its own sink. */
+static TMF8X2X_THREAD_LOCAL tmf8x2xOutputSink * selectedSink = 0;
 
 /*
  *****************************************************************************
  * LOCAL PROTOTYPES
  *****************************************************************************
  */
+/**
+ * @brief dumpSink returns the sink all dump functions write to
+ * @return selected sink, or the stdout sink
+ */
+static tmf8x2xOutputSink * dumpSink( void );
 /**
  * @brief i2c8 converts an 8 bit number into a two character hex number representation
  * @param value to be converted
@@ -77,6 +105,21 @@ static int mainSpadLlc( uint8_t center_2, int8_t offset_2, uint8_t size );
  * @return x/y position in the SPAD array
  */
 static int mainSpadUrc( uint8_t llc, uint8_t size );
+/**
+ * @brief transposeChannelColumns transposes the packed TDC channel columns into rows, word (field shift + y) holds the bits of one channel bit field of row y
+ * @param config configuration in machine readable format (packed)
+ * @param bits receives the transposed bit matrix
+ */
+static void transposeChannelColumns( const tmf8x2xHalMainSpadConfig * config, uint32_t bits[ 32 ] );
+/**
+ * @brief decodeChannelRow splits one transposed row into one bit mask per channel (channels 8/9 restored from tdcChannelSelect)
+ * @param bits transposed channel columns
+ * @param config configuration in machine readable format (packed)
+ * @param y row to decode
+ * @param rowMask only SPADs set in this mask are reported
+ * @param row receives one bit mask per channel
+ */
+static void decodeChannelRow( const uint32_t bits[ 32 ], const tmf8x2xHalMainSpadConfig * config, int32_t y, uint32_t rowMask, uint32_t row[ TMF8X2X_NUMBER_OF_CHANNELS ] );
 
 /*
  *****************************************************************************
@@ -104,13 +147,11 @@ static int mainSpadUrc ( uint8_t llc, uint8_t size )
 
 tmf8x2xHalMainSpadConfig * tmf8x2xCreateMainSpad ( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask )
 {
-    int32_t x;
     int32_t y;
     int llcX;
     int llcY;
     int urcX;
     int urcY;
-    uint16_t lineSelect = 0; /* default all have channel 0/1 selected */
     if (  ! config
         || ! mask
         || ( mask->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE )
@@ -152,58 +193,10 @@ tmf8x2xHalMainSpadConfig * tmf8x2xCreateMainSpad ( tmf8x2xHalMainSpadConfig * co
     {
         config->enableSpad[ y ] = mask->enable[ mask->ySize - 1 - y ];  /* reverse as the mask->enable is order-reversed */
     }
-    /* check for correct channel selection (no 0/1 in same row as 8/9) */
-    for ( y = 0; y < mask->ySize; y++ )
+    /* pack the channel bits per column, and check for correct channel selection (no 0/1 in same row as 8/9) */
+    if ( tmf8x2xEncodeChannelMap( config->tdcChannel, &config->tdcChannelSelect, mask->channels, mask->xSize, mask->ySize ) != TMF8X2X_SPAD_MAP_OK )
     {
-        int is89 = 0; /* so far we do not know */
-        int is89Set = 0; /* so far we have neither 0 nor 1 selected */
-        const uint8_t * row = mask->channels + ( ( mask->ySize - 1 - y ) * mask->xSize ) ; /* step through linear array row wise. So as start-point for inner loop we have to go through lines */
-        for ( x = 0; x < mask->xSize; x++ )
-        {
-            if ( row[ x ] == 0 || row[ x ] == 1 )
-            {
-                if ( !is89Set ) /* never set for this row - so set it now that we have 0/1 and may not have 8/9 */
-                {
-                    is89Set = 1;
-                    is89 = 0;
-                }
-                else if ( is89 )
-                {
-                    return 0;
-                }
-            }
-            else if ( row[ x ] == 8 || row[ x ] == 9 )
-            {
-                if ( !is89Set ) /* never set for this row - so set it now that we have 8/9 and may not have 0/1 */
-                {
-                    is89Set = 1;
-                    is89 = 1;
-                    lineSelect |= ( 1 << y ); /* this row has channels 8/9 selected */
-                }
-                else if ( ! is89 )
-                {
-                    return 0;
-                }
-            }
-        }
-    }
-    /* clear all first */
-    for ( x = 0; x < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; x++ )
-    {
-        config->tdcChannel[ x ]  = 0;
-    }
-
-    /* now we can go on to pack the bits per column */
-    for ( x = 0; x < mask->xSize; x++ )
-    {
-        uint32_t encode = 0; /* default is tdc channel 0 for all */
-        uint8_t yIdx; /* now we go from bottom up in table, we need to invert the accessing index for y here. If ySize is 0, we won't enter below loop anyhow. */
-        for ( y = 0, yIdx = mask->ySize - 1; y < mask->ySize; y++, yIdx-- )
-        {
-            uint8_t ch = mask->channels[ x + ( yIdx * mask->xSize ) ];    /* in linear array we need to start from bottom */
-            encode |= TMF8X2X_MAIN_SPAD_ENCODE_CHANNEL( ch, y );/* an 8 is masked out by macro to a 0, and a 9 is masked out by macro to a 1 */
-        }
-        config->tdcChannel[ x ] = encode;
+        return 0;
     }
 
     /* finally set the boundaries correctly in config record, and the row channel line select bits */
@@ -211,7 +204,6 @@ tmf8x2xHalMainSpadConfig * tmf8x2xCreateMainSpad ( tmf8x2xHalMainSpadConfig * co
     config->yOffset_2 = mask->yOffset_2;
     config->xSize = mask->xSize;
     config->ySize = mask->ySize;
-    config->tdcChannelSelect = lineSelect;
 
     return config;
 }
@@ -222,34 +214,60 @@ tmf8x2xHalMainSpadConfig * tmf8x2xCreateMainSpad ( tmf8x2xHalMainSpadConfig * co
  *****************************************************************************
  */
 
+static tmf8x2xOutputSink * dumpSink ( void )
+{
+    return selectedSink ? selectedSink : &stdoutSink;
+}
+
+tmf8x2xOutputSink * dumpSelectSink ( tmf8x2xOutputSink * sink )
+{
+    tmf8x2xOutputSink * previous = selectedSink;
+    selectedSink = sink;
+    return previous;
+}
+
+void dumpFlush ( void )
+{
+    tmf8x2xSinkFlush( dumpSink() );
+}
+
 static void i2c8 ( uint8_t value)
 {
-    fprintf(stdout,"%02x ",value);
+    tmf8x2xSinkHexByte( dumpSink(), value );
+    tmf8x2xSinkWrite( dumpSink(), " ", 1 );
 }
 
 static void i2c24 ( uint32_t value )
 {
-    fprintf(stdout,"%02x %02x %02x ", value & UINT8_MAX, (value >> 8) & UINT8_MAX, (value >> 16) & UINT8_MAX );
+    i2c8( value & UINT8_MAX );
+    i2c8( (value >> 8) & UINT8_MAX );
+    i2c8( (value >> 16) & UINT8_MAX );
 }
 
 static void i2c32 ( uint32_t value )
 {
-    fprintf(stdout,"%02x %02x %02x %02x ", value & UINT8_MAX, (value >> 8) & UINT8_MAX, (value >> 16) & UINT8_MAX, (value >> 24) & UINT8_MAX );
+    i2c24( value );
+    i2c8( (value >> 24) & UINT8_MAX );
 }
 
 void dumpString (const char* dumpTxt)
 {
-    fprintf(stdout,"%s",dumpTxt);
+    tmf8x2xSinkString( dumpSink(), dumpTxt );
 }
 
 void dumpUnsignedHex (const uint32_t number)
 {
-    fprintf(stdout,"%x",number);
+    tmf8x2xSinkHex( dumpSink(), number );
 }
 
 void dumpSignedDecimal (const int32_t number)
 {
-    fprintf(stdout,"%d",number);
+    tmf8x2xSinkSignedDecimal( dumpSink(), number );
+}
+
+void dumpUnsignedDecimal (const uint64_t number)
+{
+    tmf8x2xSinkUnsignedDecimal( dumpSink(), number );
 }
 
 void dumpChannelMapAsText ( const tmf8x2xSpadMask * mask )
@@ -271,30 +289,47 @@ void dumpChannelMapAsText ( const tmf8x2xSpadMask * mask )
         dumpString( "/* y=" );
         dumpSignedDecimal( mask->ySize - 1 - y );
         dumpString( " */  " );
+        char line[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * 4 + 1 ]; /* up to 3 digits and a blank per SPAD, line feed */
+        uint32_t length = 0;
         for ( int32_t x = 0; x < mask->xSize; x++ )
         {
-            dumpSignedDecimal( mask->channels[ idx + x ] );
-            dumpString( " " );
+            uint8_t ch = mask->channels[ idx + x ];
+            if ( ch >= 100 )
+            {
+                line[ length++ ] = (char)( '0' + ch / 100 );
+            }
+            if ( ch >= 10 )
+            {
+                line[ length++ ] = (char)( '0' + ( ch / 10 ) % 10 );
+            }
+            line[ length++ ] = (char)( '0' + ch % 10 );
+            line[ length++ ] = ' ';
         }
-        dumpString( "\n" );
+        line[ length++ ] = '\n';
+        tmf8x2xSinkWrite( dumpSink(), line, length );
     }
 }
 
 static void dumpEnabledBitsLineHead( uint32_t* line )
 {
-    fprintf(stdout,"/* y=%2u */ ", *line);
+    dumpString( ( *line < 10 ) ? "/* y= " : "/* y=" );
+    dumpSignedDecimal( (int32_t)*line );
+    dumpString( " */ " );
     --(*line);
 }
 
 static void dumpEnableBits( uint32_t bits )
 {
+    char line[ 2 * TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE ];
     uint32_t currentBitNr = 0;
 
     while ( currentBitNr < TMF8X2X_MAIN_SPAD_SCREAMER_MAX_X_SIZE )
     {
-        dumpString( bits & ( 1 << currentBitNr ) ? "1 " : "0 " );
+        line[ 2 * currentBitNr ] = ( bits & ( 1 << currentBitNr ) ) ? '1' : '0';
+        line[ 2 * currentBitNr + 1 ] = ' ';
         ++currentBitNr;
     }
+    tmf8x2xSinkWrite( dumpSink(), line, sizeof( line ) );
 }
 
 void dumpMainSpadEnableBitsAsText ( const tmf8x2xHalMainSpadConfig * config )
@@ -408,13 +443,191 @@ void dumpMainSpadConfigAsI2Cstrings ( const char * name, const tmf8x2xHalMainSpa
     dumpString("P\n");
 }
 
+void dumpMainSpadConfigAsI2Cburst ( const char * name, const tmf8x2xHalMainSpadConfig * config )
+{
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+
+    tmf8x2xPackRegisterImage( image, config );
+    dumpString( "# use this format to set up custom SPAD maps with a single I2C transfer");
+    dumpString( "\n# tmf8x2xHalMainSpadConfig ");
+    dumpString( name );
+    dumpString( "\n# enableSpad[ ], tdcChannel[ ], tdcChannelSelect, xOffset_2, yOffset_2, xSize, ySize\nS 41 W ");
+    i2c8( TMF8X2X_REGISTER_IMAGE_START );
+    for ( uint32_t i = 0; i < TMF8X2X_REGISTER_IMAGE_SIZE; i++ )
+    {
+        i2c8( image[ i ] );
+    }
+    dumpString("P\n");
+}
+
+void dumpMainSpadConfigDeltaAsI2Cstrings ( const char * name, const tmf8x2xHalMainSpadConfig * from, const tmf8x2xHalMainSpadConfig * to, uint32_t mergeGap )
+{
+    uint8_t fromImage[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    uint8_t toImage[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+    tmf8x2xRegisterDelta delta;
+
+    tmf8x2xPackRegisterImage( fromImage, from );
+    tmf8x2xPackRegisterImage( toImage, to );
+    tmf8x2xDiffRegisterImages( &delta, fromImage, toImage, mergeGap );
+    dumpString( "# use this format to switch from the currently loaded SPAD map to another one via I2C transfers");
+    dumpString( "\n# tmf8x2xHalMainSpadConfig ");
+    dumpString( name );
+    dumpString( ", only the registers that differ\n");
+    for ( uint32_t w = 0; w < delta.count; w++ )
+    {
+        const tmf8x2xRegisterWrite * write = &delta.writes[ w ];
+        dumpString( "S 41 W " ); /* one transfer for each run of registers that differ, short gaps are written along */
+        i2c8( (uint8_t)( TMF8X2X_REGISTER_IMAGE_START + write->offset ) );
+        for ( uint32_t i = write->offset; i < (uint32_t)write->offset + write->length; i++ )
+        {
+            i2c8( toImage[ i ] );
+        }
+        dumpString( "P\n" );
+    }
+}
+
+void dumpMainSpadConfigAsBinary ( const tmf8x2xHalMainSpadConfig * config )
+{
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+
+    tmf8x2xPackRegisterImage( image, config );
+    tmf8x2xSinkWrite( dumpSink(), (const char *)image, TMF8X2X_REGISTER_IMAGE_SIZE );
+}
+
 /*
  *****************************************************************************
  * SPAD MAP CHECKS
  *****************************************************************************
  */
 
+static void transposeChannelColumns ( const tmf8x2xHalMainSpadConfig * config, uint32_t bits[ 32 ] )
+{
+    int32_t x;
+
+    /* the columns hold the 3 channel bits as LSB/MID/MSB fields of 10 bits each, after transposing
+       word (field shift + y) holds the bits of row y for that field, one bit per column */
+    for ( x = 0; x < TMF8X2X_MAIN_SPAD_MAX_X_SIZE; x++ )
+    {
+        bits[ x ] = config->tdcChannel[ x ];
+    }
+    for ( ; x < 32; x++ )
+    {
+        bits[ x ] = 0;
+    }
+    tmf8x2xTranspose32( bits );
+}
+
+static void decodeChannelRow ( const uint32_t bits[ 32 ], const tmf8x2xHalMainSpadConfig * config, int32_t y, uint32_t rowMask, uint32_t row[ TMF8X2X_NUMBER_OF_CHANNELS ] )
+{
+    uint32_t lsb = bits[ TMF8X2X_MAIN_SPAD_VERTICAL_LSB_SHIFT + y ];
+    uint32_t mid = bits[ TMF8X2X_MAIN_SPAD_VERTICAL_MID_SHIFT + y ];
+    uint32_t msb = bits[ TMF8X2X_MAIN_SPAD_VERTICAL_MSB_SHIFT + y ];
+    uint32_t low[ 4 ];  /* SPADs matching the lower two channel bits */
+    uint8_t ch;
+
+    low[ 0 ] = ~lsb & ~mid & rowMask;
+    low[ 1 ] =  lsb & ~mid & rowMask;
+    low[ 2 ] = ~lsb &  mid & rowMask;
+    low[ 3 ] =  lsb &  mid & rowMask;
+    for ( ch = 0; ch < 8; ch++ )
+    {
+        row[ ch ] = low[ ch & 3 ] & ( ( ch & 4 ) ? msb : ~msb );
+    }
+    row[ CHANNEL_8 ] = 0;
+    row[ CHANNEL_9 ] = 0;
+    if ( config->tdcChannelSelect & ( 1 << y ) ) /* the alternate channels, 0/1 are 8/9 in this row */
+    {
+        row[ CHANNEL_8 ] = row[ 0 ];
+        row[ CHANNEL_9 ] = row[ 1 ];
+        row[ 0 ] = 0;
+        row[ 1 ] = 0;
+    }
+}
+
+void tmf8x2xDecodeChannelPlanes ( const tmf8x2xHalMainSpadConfig * config, uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ] )
+{
+    uint32_t bits[ 32 ];
+    uint32_t xMask = ( 1u << config->xSize ) - 1;
+    int32_t y;
+
+    transposeChannelColumns( config, bits );
+    for ( y = 0; y < TMF8X2X_MAIN_SPAD_MAX_Y_SIZE; y++ )
+    {
+        uint32_t row[ TMF8X2X_NUMBER_OF_CHANNELS ];
+        decodeChannelRow( bits, config, y, ( y < config->ySize ) ? xMask : 0, row );
+        for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+        {
+            planes[ ch ][ y ] = row[ ch ];
+        }
+    }
+}
+
 uint8_t tmf8x2xCheckMainSpadAssignment ( const tmf8x2xHalMainSpadConfig * config )
+{
+    uint32_t bits[ 32 ];
+    uint64_t below[ CHECK_LANE_WORDS ];
+    uint64_t used[ CHECK_LANE_WORDS ];
+    uint64_t adjacent[ CHECK_LANE_WORDS ];
+    uint32_t xMask;
+    int32_t y;
+    uint32_t w;
+    uint8_t ch;
+
+    if (  ! config
+        || ( config->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE )
+        || ( config->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+        || ( config->xSize < 1 )
+        || ( config->ySize < 1 )
+        || ( config->xSize == 1 && config->ySize == 1 )  /* single SPAD are not allowed */
+        )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG; /* out of bound error */
+    }
+
+    transposeChannelColumns( config, bits );
+    xMask = ( 1u << config->xSize ) - 1;
+
+    /* the enabled SPADs of 3 channels share one 64-bit word (lanes of 21 bits, the upper 3 bits of each lane stay 0),
+       so shifting by one SPAD never moves a bit into the neighbouring channel's SPADs */
+    for ( w = 0; w < CHECK_LANE_WORDS; w++ )
+    {
+        below[ w ] = 0;
+        used[ w ] = 0;
+        adjacent[ w ] = 0;
+    }
+    for ( y = 0; y < config->ySize; y++ )
+    {
+        uint32_t planes[ CHECK_LANE_WORDS * CHECK_LANES_PER_WORD ];
+        decodeChannelRow( bits, config, y, config->enableSpad[ y ] & xMask, planes );
+        for ( ch = TMF8X2X_NUMBER_OF_CHANNELS; ch < CHECK_LANE_WORDS * CHECK_LANES_PER_WORD; ch++ )
+        {
+            planes[ ch ] = 0;
+        }
+        for ( w = 0; w < CHECK_LANE_WORDS; w++ )
+        {
+            uint64_t row = (uint64_t)planes[ CHECK_LANES_PER_WORD * w ]
+                         | ( (uint64_t)planes[ CHECK_LANES_PER_WORD * w + 1 ] << CHECK_LANE_BITS )
+                         | ( (uint64_t)planes[ CHECK_LANES_PER_WORD * w + 2 ] << ( 2 * CHECK_LANE_BITS ) );
+            used[ w ] |= row;
+            adjacent[ w ] |= row & ( row >> 1 );                                   /* (x+1|y) */
+            adjacent[ w ] |= below[ w ] & ( row | ( row >> 1 ) | ( row << 1 ) );  /* (x|y+1), (x+1|y+1), (x-1|y+1) seen from the row below */
+            below[ w ] = row;
+        }
+    }
+
+    for ( ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        uint64_t laneMask = (uint64_t)CHECK_LANE_MASK << ( CHECK_LANE_BITS * ( ch % CHECK_LANES_PER_WORD ) );
+        if ( ( used[ ch / CHECK_LANES_PER_WORD ] & laneMask ) && ! ( adjacent[ ch / CHECK_LANES_PER_WORD ] & laneMask ) ) /* zone is in use, but no two adjacent, enabled SPAD */
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xCheckMainSpadAssignmentReference ( const tmf8x2xHalMainSpadConfig * config )
 {
     int32_t x;
     int32_t y;
@@ -627,3 +840,43 @@ uint8_t tmf8x2xCheckMainSpadChannelSetup ( const uint8_t * spadMap, const uint8_
 
     return TMF8X2X_SPAD_MAP_OK;
 }
+
+uint8_t tmf8x2xValidateSpadMask ( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask )
+{
+    if ( tmf8x2xCreateMainSpad( config, mask ) == 0 )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+
+    if ( tmf8x2xCheckMainSpadArea( config ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_AREA;
+    }
+
+    if ( tmf8x2xCheckMainSpadChannelSetup( mask->channels, config->xSize, config->ySize ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CHANNEL;
+    }
+
+    if ( tmf8x2xCheckMainSpadAssignment( config ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_ASSIGNMENT;
+    }
+
+    return TMF8X2X_VALIDATE_OK;
+}
+
+const char * tmf8x2xValidateResultName ( uint8_t result )
+{
+    switch ( result )
+    {
+        case TMF8X2X_VALIDATE_OK:                   return "OK";
+        case TMF8X2X_VALIDATE_ERROR_CREATE:         return "basic checks and channel 0/1 / 8/9 assignment";
+        case TMF8X2X_VALIDATE_ERROR_AREA:           return "SPAD map out of bounds - size / offset";
+        case TMF8X2X_VALIDATE_ERROR_CHANNEL:        return "channel setup checks";
+        case TMF8X2X_VALIDATE_ERROR_ASSIGNMENT:     return "SPAD assignment checks";
+        case TMF8X2X_VALIDATE_ERROR_ROUND_TRIP:     return "round trip, configuration is not canonical";
+        case TMF8X2X_VALIDATE_ERROR_CONNECTIVITY:   return "zone connectivity (strict mode)";
+        default:                                    return "unknown error";
+    }
+}
@@ -27,7 +27,7 @@
  */
 
 /*! \file tmf8x2x_spad_mask_tool.h
- *  \brief tool to check masks in a "human-readable" format, and convert to HAL format and print on stdout.
+ *  \brief tool to check masks in a "human-readable" format, and convert to HAL format and print on stdout (or another output sink).
  */
 
 /*
@@ -38,6 +38,8 @@
 
 #include <stdint.h>
 #include "tmf8x2x_includes.h"
+#include "tmf8x2x_output_sink.h"
+#include "tmf8x2x_register_image.h"
 
 /*
  *****************************************************************************
@@ -48,12 +50,28 @@
 #ifndef TMF8X2X_SPAD_MASK_TOOL_H
 #define TMF8X2X_SPAD_MASK_TOOL_H
 
+/* storage class of per-thread variables */
+#if defined( __STDC_VERSION__ ) && ( __STDC_VERSION__ >= 201112L ) && ! defined( __STDC_NO_THREADS__ )
+#define TMF8X2X_THREAD_LOCAL                _Thread_local
+#else
+#define TMF8X2X_THREAD_LOCAL                __thread
+#endif
+
 /* constants for SPAD map checking */
 #define TMF8X2X_ZONE_INVESTIGATE            0
 #define TMF8X2X_ZONE_UNVERIFIED             1
 #define TMF8X2X_ZONE_VERIFIED               2
 #define TMF8X2X_CHECK_SCRATCH_BUFFER_SIZE   1024
 
+/* results of tmf8x2xValidateSpadMask: the first check that failed */
+#define TMF8X2X_VALIDATE_OK                 0
+#define TMF8X2X_VALIDATE_ERROR_CREATE       1
+#define TMF8X2X_VALIDATE_ERROR_AREA         2
+#define TMF8X2X_VALIDATE_ERROR_CHANNEL      3
+#define TMF8X2X_VALIDATE_ERROR_ASSIGNMENT   4
+#define TMF8X2X_VALIDATE_ERROR_ROUND_TRIP   5   /* only tmf8x2xAuditSpadConfig: the configuration does not encode back to itself */
+#define TMF8X2X_VALIDATE_ERROR_CONNECTIVITY 6   /* only strict mode (tmf8x2xLibCheckConnectivity): a zone is split into several islands */
+
 /*
  *****************************************************************************
  * FUNCTIONS
@@ -68,6 +86,15 @@
  */
 tmf8x2xHalMainSpadConfig * tmf8x2xCreateMainSpad( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask );
 
+/**
+ * @brief tmf8x2xPackEnableMask converts the SPAD enable mask from human readable (one byte per SPAD) to packed binary format (one bit per SPAD)
+ * @param packed receives one 32-bit word per row
+ * @param enable human readable enable mask, any value > 0 enables a SPAD
+ * @param xSize SPAD mask size in x direction
+ * @param ySize SPAD mask size in y direction
+ */
+void tmf8x2xPackEnableMask( uint32_t * packed, const uint8_t * enable, const uint8_t xSize, const uint8_t ySize );
+
 /**
  * @brief tmf8x2xCheckMainSpadAssignment checks SPAD map size and if in each used channel, there are at least two adjacent SPADs (can be in any direction).
  * @param config configuration in machine readable format (packed)
@@ -75,6 +102,22 @@ tmf8x2xHalMainSpadConfig * tmf8x2xCreateMainSpad( tmf8x2xHalMainSpadConfig * con
  */
 uint8_t tmf8x2xCheckMainSpadAssignment( const tmf8x2xHalMainSpadConfig * config );
 
+/**
+ * @brief tmf8x2xCheckMainSpadAssignmentReference is the original cell by cell implementation of tmf8x2xCheckMainSpadAssignment,
+ * kept as reference for the bitboard implementation. Both always return the same result.
+ * @param config configuration in machine readable format (packed)
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if checks found an error, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xCheckMainSpadAssignmentReference( const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief tmf8x2xDecodeChannelPlanes decodes the packed TDC channel columns into one row bitplane per channel (bit x of planes[ ch ][ y ] is set if SPAD x|y is assigned to channel ch).
+ * Rows with tdcChannelSelect set report channels 8/9 instead of 0/1. Only SPADs inside xSize / ySize are reported, the enable bits are not applied.
+ * @param config configuration in machine readable format (packed), xSize / ySize must be in range
+ * @param planes receives the channel bitplanes
+ */
+void tmf8x2xDecodeChannelPlanes( const tmf8x2xHalMainSpadConfig * config, uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ] );
+
 /**
  * @brief tmf8x2xCheckMainSpadArea checks if the SPAD map with applied X/Y offset fits in the SPAD area
  * @param config configuration in machine readable format (packed)
@@ -91,6 +134,21 @@ uint8_t tmf8x2xCheckMainSpadArea ( const tmf8x2xHalMainSpadConfig * config );
  */
 uint8_t tmf8x2xCheckMainSpadChannelSetup ( const uint8_t * spadMap, const uint8_t xSize, const uint8_t ySize );
 
+/**
+ * @brief tmf8x2xValidateSpadMask creates the packed SPAD configuration and runs all checks on it
+ * @param config receives the SPAD configuration in machine readable format (packed)
+ * @param mask SPAD configuration in human readable format
+ * @return TMF8X2X_VALIDATE_OK if all checks passed, otherwise the TMF8X2X_VALIDATE_ERROR_* code of the first failing check
+ */
+uint8_t tmf8x2xValidateSpadMask( tmf8x2xHalMainSpadConfig * config, const tmf8x2xSpadMask * mask );
+
+/**
+ * @brief tmf8x2xValidateResultName returns a short description of a tmf8x2xValidateSpadMask result
+ * @param result return value of tmf8x2xValidateSpadMask
+ * @return description (no line feed)
+ */
+const char * tmf8x2xValidateResultName( uint8_t result );
+
 /**
  * @brief dumpMainSpadConfigAsCstruct dumps a SPAD setup in C code for use in custom TMF882x firmware
  * @param name of the custom SPAD setup
@@ -105,6 +163,30 @@ void dumpMainSpadConfigAsCstruct( const char * name, const tmf8x2xHalMainSpadCon
  */
 void dumpMainSpadConfigAsI2Cstrings( const char * name, const tmf8x2xHalMainSpadConfig * config );
 
+/**
+ * @brief dumpMainSpadConfigAsI2Cburst dumps a SPAD setup as one I2C write of the complete register image (0x24..0x90)
+ * @param name of the custom SPAD setup
+ * @param config configuration in machine readable format (packed)
+ */
+void dumpMainSpadConfigAsI2Cburst( const char * name, const tmf8x2xHalMainSpadConfig * config );
+
+/**
+ * @brief dumpMainSpadConfigDeltaAsI2Cstrings dumps the I2C transfers that switch the TMF882x registers from one SPAD setup to another,
+ * one transfer for each run of consecutive registers that differ, runs with up to mergeGap unchanged registers between them are
+ * written as one transfer (tmf8x2xDiffRegisterImages)
+ * @param name of the SPAD setup that is loaded by the transfers
+ * @param from configuration that is currently loaded (packed)
+ * @param to configuration that is loaded by the transfers (packed)
+ * @param mergeGap longest run of unchanged registers that is written along, TMF8X2X_REGISTER_DELTA_MERGE_GAP for the I2C bus
+ */
+void dumpMainSpadConfigDeltaAsI2Cstrings( const char * name, const tmf8x2xHalMainSpadConfig * from, const tmf8x2xHalMainSpadConfig * to, uint32_t mergeGap );
+
+/**
+ * @brief dumpMainSpadConfigAsBinary writes the raw register image (TMF8X2X_REGISTER_IMAGE_SIZE bytes) of a SPAD setup to the selected output sink
+ * @param config configuration in machine readable format (packed)
+ */
+void dumpMainSpadConfigAsBinary( const tmf8x2xHalMainSpadConfig * config );
+
 /* show the channel map in a human readable format */
 /**
  * @brief dumpChannelMapAsText dumps the SPAD to TDC channel mapping in human readable format
@@ -120,22 +202,41 @@ void dumpMainSpadEnableBitsAsText( const tmf8x2xHalMainSpadConfig * config );
 
 
 /**
- * @brief dumpString writes a string to stdout
+ * @brief dumpSelectSink selects the output sink of all dump functions on the calling thread. The default sink is a buffered sink on stdout,
+ * shared by all threads that did not select a sink.
+ * @param sink to be used, or 0 for the default sink
+ * @return the sink that was selected before, 0 for the default sink (can be passed to dumpSelectSink again to restore it)
+ */
+tmf8x2xOutputSink * dumpSelectSink( tmf8x2xOutputSink * sink );
+
+/**
+ * @brief dumpFlush writes the buffered output of the selected sink
+ */
+void dumpFlush( void );
+
+/**
+ * @brief dumpString writes a string to the selected output sink
  * @param dumpTxt string to dump
  */
 void dumpString(const char* dumpTxt);
 
 /**
- * @brief dumpUnsignedHex writes an unsigned hex number to stdout
+ * @brief dumpUnsignedHex writes an unsigned hex number to the selected output sink
  * @param number to dump
  */
 void dumpUnsignedHex(const uint32_t number);
 
 /**
- * @brief dumpSignedDecimal writes a signed decimal number to stdout
+ * @brief dumpSignedDecimal writes a signed decimal number to the selected output sink
  * @param number to dump
  */
 void dumpSignedDecimal(const int32_t number);
 
+/**
+ * @brief dumpUnsignedDecimal writes an unsigned 64-bit decimal number to the selected output sink
+ * @param number to dump
+ */
+void dumpUnsignedDecimal(const uint64_t number);
+
 #endif /* TMF8X2X_SPAD_MASK_TOOL_H */
 
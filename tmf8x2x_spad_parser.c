@@ -0,0 +1,188 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_spad_parser.c
+ *  \brief parser for SPAD maps / masks in the linux driver text format (app/spad_map_0, app/spad_mask_0).
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_spad_parser.h"
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief isBlank checks for characters that separate values within one SPAD row
+ * @param c character to check
+ * @return 1 for blanks, 0 otherwise
+ */
+static int isBlank( char c );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static int isBlank ( char c )
+{
+    return ( c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f' );
+}
+
+/*
+ *****************************************************************************
+ * TEXT PARSING
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xParseSpadMatrix ( uint8_t * matrix, uint8_t * xSize, uint8_t * ySize, const char * text, uint32_t length, uint8_t maxValue )
+{
+    uint32_t pos = 0;
+    uint32_t rows = 0;
+    uint32_t columns = 0;
+
+    if ( ! matrix || ! xSize || ! ySize || ! text )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    while ( pos < length )
+    {
+        uint32_t valuesInRow = 0;
+        while ( pos < length && text[ pos ] != '\n' ) /* one SPAD row per line */
+        {
+            uint32_t value = 0;
+            if ( isBlank( text[ pos ] ) )
+            {
+                pos++;
+                continue;
+            }
+            if ( text[ pos ] < '0' || text[ pos ] > '9' )
+            {
+                return TMF8X2X_SPAD_MAP_ERROR_CONFIG; /* only decimal numbers are allowed */
+            }
+            while ( pos < length && text[ pos ] >= '0' && text[ pos ] <= '9' )
+            {
+                value = value * 10 + ( text[ pos ] - '0' );
+                if ( value > maxValue )
+                {
+                    return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+                }
+                pos++;
+            }
+            if ( valuesInRow >= TMF8X2X_MAIN_SPAD_MAX_X_SIZE || rows >= TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+            {
+                return TMF8X2X_SPAD_MAP_ERROR_CONFIG; /* matrix does not fit in a custom SPAD map */
+            }
+            matrix[ rows * TMF8X2X_MAIN_SPAD_MAX_X_SIZE + valuesInRow ] = (uint8_t)value;
+            valuesInRow++;
+        }
+        pos++; /* skip the line feed */
+        if ( valuesInRow == 0 ) /* empty lines are ignored, e.g. the leading line feed of the driver format */
+        {
+            continue;
+        }
+        if ( rows == 0 )
+        {
+            columns = valuesInRow;
+        }
+        else if ( valuesInRow != columns )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG; /* all rows need the same amount of SPADs */
+        }
+        rows++;
+    }
+
+    /* the rows were stored with a stride of the maximum x size, compact them to a linear array with a stride of xSize */
+    for ( uint32_t y = 1; y < rows; y++ )
+    {
+        for ( uint32_t x = 0; x < columns; x++ )
+        {
+            matrix[ y * columns + x ] = matrix[ y * TMF8X2X_MAIN_SPAD_MAX_X_SIZE + x ];
+        }
+    }
+
+    *xSize = (uint8_t)columns;
+    *ySize = (uint8_t)rows;
+    return ( rows == 0 ) ? TMF8X2X_SPAD_MAP_ERROR_CONFIG : TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xParseSpadMask ( tmf8x2xSpadMaskStorage * storage, const char * mapText, uint32_t mapLength, const char * maskText, uint32_t maskLength, int8_t xOffset_2, int8_t yOffset_2 )
+{
+    uint8_t xSize;
+    uint8_t ySize;
+
+    if ( ! storage
+        || tmf8x2xParseSpadMatrix( storage->channels, &xSize, &ySize, mapText, mapLength, TMF8X2X_PARSER_MAX_CHANNEL ) != TMF8X2X_SPAD_MAP_OK
+        )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+
+    if ( maskText )
+    {
+        uint8_t maskXSize;
+        uint8_t maskYSize;
+        if (  tmf8x2xParseSpadMatrix( storage->enable, &maskXSize, &maskYSize, maskText, maskLength, TMF8X2X_PARSER_MAX_ENABLE ) != TMF8X2X_SPAD_MAP_OK
+            || maskXSize != xSize
+            || maskYSize != ySize
+            )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+    else
+    {
+        for ( uint32_t i = 0; i < (uint32_t)xSize * ySize; i++ )
+        {
+            storage->enable[ i ] = 1; /* without a SPAD mask all SPADs of the map are enabled */
+        }
+    }
+
+    tmf8x2xPackEnableMask( storage->enablePacked, storage->enable, xSize, ySize );
+
+    storage->mask.enable = storage->enablePacked;
+    storage->mask.channels = storage->channels;
+    storage->mask.id = 0;
+    storage->mask.xOffset_2 = xOffset_2;
+    storage->mask.yOffset_2 = yOffset_2;
+    storage->mask.xSize = xSize;
+    storage->mask.ySize = ySize;
+
+    return TMF8X2X_SPAD_MAP_OK;
+}
@@ -0,0 +1,102 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_spad_parser.h
+ *  \brief parser for SPAD maps / masks in the linux driver text format (app/spad_map_0, app/spad_mask_0).
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_SPAD_PARSER_H
+#define TMF8X2X_SPAD_PARSER_H
+
+/* largest value allowed in a SPAD map (TDC channel) and in a SPAD mask (enable bit) */
+#define TMF8X2X_PARSER_MAX_CHANNEL          ( TMF8X2X_NUMBER_OF_CHANNELS - 1 )
+#define TMF8X2X_PARSER_MAX_ENABLE           1
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* backing storage for a SPAD mask that is created at runtime, the mask member points into this structure */
+typedef struct _tmf8x2xSpadMaskStorage
+{
+    uint32_t enablePacked[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];                              /* packed enable bits, same order as channels (top row first) */
+    uint8_t enable[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];      /* human readable enable bits, top row first */
+    uint8_t channels[ TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];    /* human readable channel map, top row first */
+    tmf8x2xSpadMask mask;
+} tmf8x2xSpadMaskStorage;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xParseSpadMatrix parses a matrix of whitespace separated decimal numbers, one SPAD row per text line.
+ * Empty lines are ignored, the size is inferred from the text.
+ * @param matrix receives the values row wise, top row first (at least TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE bytes)
+ * @param xSize receives the number of values per row
+ * @param ySize receives the number of rows
+ * @param text to be parsed, does not need to be zero terminated
+ * @param length of the text in characters
+ * @param maxValue largest value that is accepted
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG for syntax errors, values out of range, rows of different length or too large matrices, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xParseSpadMatrix( uint8_t * matrix, uint8_t * xSize, uint8_t * ySize, const char * text, uint32_t length, uint8_t maxValue );
+
+/**
+ * @brief tmf8x2xParseSpadMask builds a human readable SPAD mask from the text of a SPAD map and a SPAD mask in linux driver format
+ * @param storage receives the parsed data, storage->mask is ready for tmf8x2xCreateMainSpad afterwards
+ * @param mapText text of the SPAD map (app/spad_map_0)
+ * @param mapLength length of the SPAD map text
+ * @param maskText text of the SPAD mask (app/spad_mask_0), or 0 to enable all SPADs
+ * @param maskLength length of the SPAD mask text
+ * @param xOffset_2 center offset in Q1 to FOV center in x direction
+ * @param yOffset_2 center offset in Q1 to FOV center in y direction
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if a text could not be parsed or map and mask sizes differ, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xParseSpadMask( tmf8x2xSpadMaskStorage * storage, const char * mapText, uint32_t mapLength, const char * maskText, uint32_t maskLength, int8_t xOffset_2, int8_t yOffset_2 );
+
+#endif /* TMF8X2X_SPAD_PARSER_H */
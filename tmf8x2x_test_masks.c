@@ -36,7 +36,23 @@
  *****************************************************************************
  */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_spad_parser.h"
+#include "tmf8x2x_batch.h"
+#include "tmf8x2x_decoder.h"
+#include "tmf8x2x_multiplex.h"
+#include "tmf8x2x_placement.h"
+#include "tmf8x2x_optimizer.h"
+#include "tmf8x2x_spad_lib.h"
+#include "tmf8x2x_cache.h"
+#include "tmf8x2x_corpus.h"
+#include "tmf8x2x_format.h"
+#include "tmf8x2x_zone_stats.h"
+#include "tmf8x2x_server.h"
+#include "tmf8x2x_device_model.h"
+#include "tmf8x2x_schedule.h"
 
 /*
  *****************************************************************************
@@ -53,6 +69,9 @@
 #define TEST_SPAD_MAP_XSIZE     (18)
 #define TEST_SPAD_MAP_YSIZE     (6)
 
+/* largest SPAD map / mask text file in linux driver format that can be loaded at runtime */
+#define TEXT_FILE_MAX_SIZE      (4096)
+
 /*
  *****************************************************************************
  * TEST SPAD MAP, 3x3 checkerboard, 41° x 32°
@@ -84,13 +103,16 @@ static const uint8_t testSpadMapEnable [ TEST_SPAD_MAP_XSIZE * TEST_SPAD_MAP_YSI
 /* holds the packed version of the SPAD enable mask */
 static uint32_t testSpadMaskEnablePacked[ TEST_SPAD_MAP_YSIZE ];
 
+/* on-disk cache of checked SPAD maps (-c), its statistics are saved at exit */
+static tmf8x2xCache spadCache;
+
 /*
  *****************************************************************************
  * TEST SPAD MAP IN LINUX DRIVER FORMAT, 3x3 checkerboard, 41° x 32°
  *****************************************************************************
  */
 
-/* for reference only, not used in this program */
+/* files in this format can be loaded at runtime: spad_tool -m spad_map_0 -e spad_mask_0 [-x xOffset_2] [-y yOffset_2] */
 
 //  echo -n "
 //  1 1 1 1 1 1 2 2 2 2 2 2 3 3 3 3 3 3
@@ -116,8 +138,18 @@ static uint32_t testSpadMaskEnablePacked[ TEST_SPAD_MAP_YSIZE ];
  *****************************************************************************
  */
 
-static void tmf8x2xPackEnableMask( void );
-static void tmf8x2xDumpTestMap( void );
+static int tmf8x2xDumpSpadMap( const char * name, const tmf8x2xSpadMask * mask, const char * imageFileName, tmf8x2xCache * cache, uint32_t formats, uint8_t connectivity );
+static int saveRegisterImage( const char * fileName, const uint8_t * image );
+static int tmf8x2xDumpMultiplexPair( const tmf8x2xMultiplexLayout * layout );
+static uint32_t loadTextFile( const char * fileName, char * text, uint32_t size );
+static int parseOffset( const char * arg, int8_t * offset_2 );
+static int parseThreads( const char * arg, uint32_t * threads );
+static int tmf8x2xPlaceSpadMap( const tmf8x2xSpadMask * mask, const char * defectFileName, uint32_t threads );
+static int parseCount( const char * arg, uint32_t * count );
+static int parseConnectivity( const char * arg, uint8_t * connectivity );
+static void dumpZoneSpads( const char * label, const uint16_t * spads, int32_t score );
+static int tmf8x2xOptimizeSpadMap( tmf8x2xSpadMaskStorage * storage, uint32_t flips, uint32_t target, uint32_t balanceWeight, const char * imageFileName );
+static void closeSpadCache( void );
 static void displayCommandLineHelp( void );
 
 /*
@@ -132,85 +164,614 @@ static const tmf8x2xSpadMask tmf8x2xSpadMaskTestCfg =
     testSpadMaskEnablePacked, testSpadMapChannel, TEST_SPAD_MAP_ID, TEST_SPAD_MAP_XOFFSET_2, TEST_SPAD_MAP_YOFFSET_2, TEST_SPAD_MAP_XSIZE, TEST_SPAD_MAP_YSIZE
 };
 
-/* convert the SPAD enable mask from human readable to packed binary format */
-static void tmf8x2xPackEnableMask ( void )
+/* check a SPAD map / mask and output it in the selected formats, optionally save the register image, returns 0 on success.
+   With a cache, a SPAD map that was checked before is neither created, checked nor formatted again.
+   With a connectivity (strict mode), zones that are split into several islands are rejected. */
+static int tmf8x2xDumpSpadMap ( const char * name, const tmf8x2xSpadMask * mask, const char * imageFileName, tmf8x2xCache * cache, uint32_t formats, uint8_t connectivity )
 {
-    for ( uint32_t row = 0; row < TEST_SPAD_MAP_YSIZE; ++row )
+    static tmf8x2xCacheEntry entry;
+    tmf8x2xLibStatus status;
+    tmf8x2xHalMainSpadConfig cfg;
+    uint8_t image[ TMF8X2X_REGISTER_IMAGE_SIZE ];
+
+    if ( cache )
     {
-        uint32_t currentRowMap = 0;
+        if (  tmf8x2xCacheLookup( cache, mask, name, &entry ) != TMF8X2X_CACHE_HIT
+           || ( entry.status.code == TMF8X2X_LIB_OK && entry.textLength == 0 ) /* stored by -b without output, add it */
+           )
+        {
+            tmf8x2xCacheRender( &entry, mask, name );
+            tmf8x2xCacheStore( cache, mask, name, &entry );
+        }
+        status = entry.status;
+        tmf8x2xUnpackRegisterImage( &cfg, entry.image );
+    }
+    if ( ! cache || status.code != TMF8X2X_LIB_OK ) /* the cache keeps the configuration of valid SPAD maps only */
+    {
+        tmf8x2xLibValidateMask( &cfg, mask, &status );
+    }
+    if ( connectivity && status.code == TMF8X2X_LIB_OK ) /* strict mode is checked after the cache, entries do not depend on it */
+    {
+        tmf8x2xLibCheckConnectivity( &cfg, connectivity, &status );
+    }
 
-        for ( uint32_t col = 0; col < TEST_SPAD_MAP_XSIZE; ++col )
+    if ( formats & TMF8X2X_FORMAT_MACHINE )
+    {
+        tmf8x2xEmitHeader( formats );
+        tmf8x2xEmitRecord( formats, 0, name, &status, ( status.check != TMF8X2X_VALIDATE_ERROR_CREATE ) ? &cfg : 0 );
+    }
+    else if ( status.code != TMF8X2X_LIB_OK )
+    {
+        dumpString( "ERROR creating Test SPAD Setup (" );
+        dumpString( tmf8x2xValidateResultName( status.check ) );
+        dumpString( ": " );
+        dumpString( tmf8x2xLibErrorText( status.code ) );
+        if ( status.channel != TMF8X2X_LIB_NONE )
         {
-            currentRowMap |= ( testSpadMapEnable[ row * TEST_SPAD_MAP_XSIZE + col ] > 0 ? 1 : 0 ) << col;
+            dumpString( ", channel " );
+            dumpSignedDecimal( status.channel );
         }
+        if ( status.y != TMF8X2X_LIB_NONE )
+        {
+            dumpString( status.x != TMF8X2X_LIB_NONE ? ", SPAD " : ", row " );
+            if ( status.x != TMF8X2X_LIB_NONE )
+            {
+                dumpSignedDecimal( status.x );
+                dumpString( "|" );
+            }
+            dumpSignedDecimal( status.y );
+        }
+        dumpString( ").\n" );
+    }
+    else if ( cache && formats == TMF8X2X_FORMAT_TEXT )
+    {
+        dumpString( entry.text );
+    }
+    else
+    {
+        tmf8x2xDumpFormats( formats, name, mask, &cfg );
+    }
+    if ( status.code != TMF8X2X_LIB_OK )
+    {
+        return 1;
+    }
 
-        testSpadMaskEnablePacked[ row ] = currentRowMap;
+    tmf8x2xPackRegisterImage( image, &cfg );
+    if ( imageFileName && saveRegisterImage( imageFileName, image ) )
+    {
+        dumpString( "ERROR writing register image file.\n" );
+        return 1;
     }
+    return 0;
 }
 
-/* check test SPAD map / mask and output in human readable format */
-static void tmf8x2xDumpTestMap ( void )
+/* write the raw register image (0x24..0x90) to a binary file, returns 0 on success */
+static int saveRegisterImage ( const char * fileName, const uint8_t * image )
 {
-    tmf8x2xHalMainSpadConfig cfg;
-    tmf8x2xPackEnableMask();
+    FILE * file = fopen( fileName, "wb" );
+    int error;
 
-    tmf8x2xHalMainSpadConfig * spadConfig = tmf8x2xCreateMainSpad( &cfg, &tmf8x2xSpadMaskTestCfg );
+    if ( ! file )
+    {
+        return 1;
+    }
+    error = ( fwrite( image, 1, TMF8X2X_REGISTER_IMAGE_SIZE, file ) != TMF8X2X_REGISTER_IMAGE_SIZE );
+    error |= ( fclose( file ) != 0 );
+    return error;
+}
 
-    if ( spadConfig == 0 )
+/* split a time-multiplexed 4x4 layout, check both captures and output them with the register deltas, returns 0 on success */
+static int tmf8x2xDumpMultiplexPair ( const tmf8x2xMultiplexLayout * layout )
+{
+    static tmf8x2xMultiplexPair pair;
+    uint8_t result = tmf8x2xValidateMultiplexPair( &pair, layout );
+
+    if ( result != TMF8X2X_MULTIPLEX_OK )
     {
-        dumpString( "ERROR creating Test SPAD Setup (basic checks and channel 0/1 / 8/9 assignment).\n" );
-        return;
+        dumpString( "ERROR creating time-multiplexed SPAD Setup (" );
+        dumpString( tmf8x2xMultiplexResultName( result ) );
+        if ( result == TMF8X2X_MULTIPLEX_ERROR_CAPTURE_A || result == TMF8X2X_MULTIPLEX_ERROR_CAPTURE_B )
+        {
+            dumpString( ": " );
+            dumpString( tmf8x2xValidateResultName( pair.captureResult[ result - TMF8X2X_MULTIPLEX_ERROR_CAPTURE_A ] ) );
+        }
+        dumpString( ").\n" );
+        return 1;
     }
 
-    if ( tmf8x2xCheckMainSpadArea( &cfg ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    dumpString( "/* time-multiplexed 4x4 zones, capture A: zones 1..8 on channels 1..8 */\n\n" );
+    tmf8x2xDumpSpadMap( "tmf8x2xSpadMapCaptureA", &pair.capture[ TMF8X2X_MULTIPLEX_CAPTURE_A ].mask, 0, 0, TMF8X2X_FORMAT_TEXT, 0 );
+    dumpString( "\n/* time-multiplexed 4x4 zones, capture B: zones 9..16 on channels 1..8 */\n\n" );
+    tmf8x2xDumpSpadMap( "tmf8x2xSpadMapCaptureB", &pair.capture[ TMF8X2X_MULTIPLEX_CAPTURE_B ].mask, 0, 0, TMF8X2X_FORMAT_TEXT, 0 );
+    dumpString( "\n" );
+    dumpMainSpadConfigDeltaAsI2Cstrings( "tmf8x2xSpadMapCaptureB", &pair.config[ TMF8X2X_MULTIPLEX_CAPTURE_A ], &pair.config[ TMF8X2X_MULTIPLEX_CAPTURE_B ], TMF8X2X_REGISTER_DELTA_MERGE_GAP );
+    dumpString( "\n" );
+    dumpMainSpadConfigDeltaAsI2Cstrings( "tmf8x2xSpadMapCaptureA", &pair.config[ TMF8X2X_MULTIPLEX_CAPTURE_B ], &pair.config[ TMF8X2X_MULTIPLEX_CAPTURE_A ], TMF8X2X_REGISTER_DELTA_MERGE_GAP );
+    return 0;
+}
+
+/* read a complete text file into memory, returns the number of characters read, or 0 after errors */
+static uint32_t loadTextFile ( const char * fileName, char * text, uint32_t size )
+{
+    FILE * file = fopen( fileName, "rb" );
+    size_t length;
+
+    if ( ! file )
+    {
+        return 0;
+    }
+    length = fread( text, 1, size, file );
+    if ( length == size ) /* file does not fit into the buffer */
     {
-        dumpString( "ERROR creating Test SPAD Setup (SPAD map out of bounds - size / offset).\n" );
-        return;
+        length = 0;
     }
+    fclose( file );
+    return (uint32_t)length;
+}
+
+/* convert a command line argument to a Q1 offset, returns 0 on success */
+static int parseOffset ( const char * arg, int8_t * offset_2 )
+{
+    char * end;
+    long value = strtol( arg, &end, 10 );
 
-    if ( tmf8x2xCheckMainSpadChannelSetup( testSpadMapChannel, cfg.xSize, cfg.ySize ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    if ( *arg == 0 || *end != 0 || value < INT8_MIN || value > INT8_MAX )
     {
-        dumpString( "ERROR creating Test Spad Map (channel setup checks).\n" );
-        return;
+        return 1;
     }
+    *offset_2 = (int8_t)value;
+    return 0;
+}
 
-    if ( tmf8x2xCheckMainSpadAssignment( &cfg ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+/* convert a command line argument to a number of threads, returns 0 on success */
+static int parseThreads ( const char * arg, uint32_t * threads )
+{
+    char * end;
+    long value = strtol( arg, &end, 10 );
+
+    if ( *arg == 0 || *end != 0 || value < 1 || value > TMF8X2X_PLACEMENT_MAX_THREADS )
     {
-        dumpString( "ERROR creating Test Spad Setup (SPAD assignment checks).\n" );
-        return;
+        return 1;
     }
+    *threads = (uint32_t)value;
+    return 0;
+}
 
-    dumpMainSpadConfigAsCstruct(    "tmf8x2xTestSpadMap", &cfg );
-    dumpMainSpadConfigAsI2Cstrings( "tmf8x2xTestSpadMap", &cfg );
-    dumpString( "\n" );
-    dumpChannelMapAsText( &tmf8x2xSpadMaskTestCfg );
+/* search the best offset of a SPAD map for every device of a defect stream, returns 0 if all devices were placed */
+static int tmf8x2xPlaceSpadMap ( const tmf8x2xSpadMask * mask, const char * defectFileName, uint32_t threads )
+{
+    static tmf8x2xPlacementLayout layout;
+    uint8_t result = tmf8x2xPreparePlacement( &layout, mask );
+    FILE * input;
+    uint32_t failed;
+
+    if ( result != TMF8X2X_VALIDATE_OK )
+    {
+        dumpString( "ERROR creating Test SPAD Setup (" );
+        dumpString( tmf8x2xValidateResultName( result ) );
+        dumpString( ").\n" );
+        return 1;
+    }
+    input = ( defectFileName[ 0 ] == '-' && defectFileName[ 1 ] == 0 ) ? stdin : fopen( defectFileName, "r" );
+    if ( ! input )
+    {
+        dumpString( "ERROR reading defect map file.\n" );
+        return 1;
+    }
+    failed = tmf8x2xRunPlacement( input, &layout, threads );
+    if ( input != stdin )
+    {
+        fclose( input );
+    }
+    return failed ? 1 : 0;
+}
+
+/* convert a command line argument to a positive count, returns 0 on success */
+static int parseCount ( const char * arg, uint32_t * count )
+{
+    char * end;
+    unsigned long value = strtoul( arg, &end, 10 );
+
+    if ( *arg < '0' || *arg > '9' || *end != 0 || value < 1 || value > UINT32_MAX )
+    {
+        return 1;
+    }
+    *count = (uint32_t)value;
+    return 0;
+}
+
+/* convert a command line argument to a connectivity of the strict mode (4 or 8), returns 0 on success */
+static int parseConnectivity ( const char * arg, uint8_t * connectivity )
+{
+    if ( ( arg[ 0 ] != '4' && arg[ 0 ] != '8' ) || arg[ 1 ] != 0 )
+    {
+        return 1;
+    }
+    *connectivity = ( arg[ 0 ] == '4' ) ? TMF8X2X_CONNECTIVITY_4 : TMF8X2X_CONNECTIVITY_8;
+    return 0;
+}
+
+/* one line with the enabled SPADs per zone (channel) and the score */
+static void dumpZoneSpads ( const char * label, const uint16_t * spads, int32_t score )
+{
+    dumpString( label );
+    for ( uint32_t ch = 1; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        dumpString( " " );
+        dumpSignedDecimal( spads[ ch ] );
+    }
+    dumpString( "  score " );
+    dumpSignedDecimal( score );
     dumpString( "\n" );
-    dumpMainSpadEnableBitsAsText( &cfg );
+}
+
+/* equalize the enabled SPADs per zone of a SPAD map / mask and output the result, returns 0 on success */
+static int tmf8x2xOptimizeSpadMap ( tmf8x2xSpadMaskStorage * storage, uint32_t flips, uint32_t target, uint32_t balanceWeight, const char * imageFileName )
+{
+    tmf8x2xOptimizerResult result;
+    uint8_t check = tmf8x2xOptimizeUniformity( storage, flips, target, balanceWeight, 1, &result );
+
+    if ( check != TMF8X2X_VALIDATE_OK )
+    {
+        dumpString( "ERROR creating Test SPAD Setup (" );
+        dumpString( tmf8x2xValidateResultName( check ) );
+        dumpString( ").\n" );
+        return 1;
+    }
+    dumpString( "/* enabled SPADs of zones 1..9, target " );
+    dumpSignedDecimal( result.target );
+    dumpString( ", " );
+    dumpSignedDecimal( (int32_t)result.accepted );
+    dumpString( " of " );
+    dumpSignedDecimal( (int32_t)result.flips );
+    dumpString( " flips accepted\n" );
+    dumpZoneSpads( "   start:", result.startSpads, result.startScore );
+    dumpZoneSpads( "   best: ", result.bestSpads, result.bestScore );
+    dumpString( "*/\n\n" );
+    return tmf8x2xDumpSpadMap( "tmf8x2xSpadMap", &storage->mask, imageFileName, 0, TMF8X2X_FORMAT_TEXT, 0 );
+}
+
+/* append the cache statistics of this run to the cache directory */
+static void closeSpadCache ( void )
+{
+    tmf8x2xCacheClose( &spadCache );
 }
 
 static void displayCommandLineHelp ( void )
 {
-    dumpString( "Run this program without any command line parameters to generate the data structures for a custom SPAD map.\n\n" );
+    dumpString( "Run this program without any command line parameters to generate the data structures for the built-in SPAD map.\n\n" );
     dumpString( "To define your custom SPAD map update the source code in the section *** DEFINES.\n" );
     dumpString( "After that assign SPADs to TDC channels in the array testSpadMapChannel[ ]\n" );
     dumpString( "Enable or disable SPADs by setting '1' (enable) or '0' (disable) in testSpadMapEnable[ ]\n" );
-    dumpString( "Be sure to compare your intended SPAD setup with the output this tool provides as visual feedback.\n" );
+    dumpString( "Be sure to compare your intended SPAD setup with the output this tool provides as visual feedback.\n\n" );
+    dumpString( "Alternatively load a SPAD map and mask in linux driver format at runtime, without recompiling:\n" );
+    dumpString( "  spad_tool -m <spad_map file> [-e <spad_mask file>] [-x <xOffset_2>] [-y <yOffset_2>]\n" );
+    dumpString( "  -m  SPAD map, one row of TDC channels per line, the size is taken from the file\n" );
+    dumpString( "  -e  SPAD mask, one row of enable bits per line (default: all SPADs enabled)\n" );
+    dumpString( "  -x  center offset in x direction in Q1 format (default: 0)\n" );
+    dumpString( "  -y  center offset in y direction in Q1 format (default: 0)\n" );
+    dumpString( "  -r  additionally write the raw register image 0x24..0x90 to a binary file (also for the built-in map)\n" );
+    dumpString( "  -c  cache directory: SPAD maps that were checked before are output from the cache (also for the built-in map and -b)\n" );
+    dumpString( "  -f  comma separated output formats (also for the built-in map and -b, default: text):\n" );
+    dumpString( "      cstruct, i2c, burst, channels, enable, text (all five), stats (per-zone statistics), islands (connected SPADs per zone),\n" );
+    dumpString( "      or json (JSON Lines, can be combined with stats / islands) / csv on their own\n" );
+    dumpString( "  -i  strict mode, reject zones whose enabled SPADs are not one island, 4 or 8 connected (also for the built-in map and -b)\n\n" );
+    dumpString( "Show size and hit / miss statistics of a cache directory:\n" );
+    dumpString( "  spad_tool -s <cache directory>\n\n" );
+    dumpString( "Validate a stream of SPAD map / mask records, one result line per record:\n" );
+    dumpString( "  spad_tool -b <record file, or - for stdin> [-j <threads>] [-f <formats>] [-i <4|8>]\n" );
+    dumpString( "  each record starts with a line \"map <xOffset_2> <yOffset_2> [name]\", followed by the SPAD map rows,\n" );
+    dumpString( "  optionally a line \"mask\" and the SPAD mask rows. Lines starting with # are ignored.\n" );
+    dumpString( "  -o  convert the records to a binary corpus file instead of validating them\n" );
+    dumpString( "  -j  number of worker threads, the result lines keep the order of the records (default: one per CPU)\n" );
+    dumpString( "  -f  output formats of each record instead of the result line only, the human readable ones for valid records\n\n" );
+    dumpString( "Validate a binary corpus file in place, one result line per failed record:\n" );
+    dumpString( "  spad_tool -k <corpus file> [-o <record file>] [-j <threads>]\n" );
+    dumpString( "  -o  convert the corpus to text records instead of validating it\n\n" );
+    dumpString( "Keep the tool resident and answer SPAD map requests with JSON lines, over a UNIX domain socket or stdin / stdout:\n" );
+    dumpString( "  spad_tool -l <socket path, or - for stdin / stdout> [-f json,stats,islands] [-i <4|8>]\n" );
+    dumpString( "  requests: a record as for -b closed by a line \"end\", a line \"bin [name]\" followed by a 136 byte corpus record,\n" );
+    dumpString( "  \"stats\" (request counters and latency histogram) or \"quit\". Stop the server with SIGINT / SIGTERM.\n\n" );
+    dumpString( "Decode I2C logs (S 41 W ...) and C-struct dumps back to SPAD map / mask records and check them:\n" );
+    dumpString( "  spad_tool -d <log file, or - for stdin>\n\n" );
+    dumpString( "Apply I2C logs (S 41 W ...) or register images (-r) to a virtual TMF882x and estimate the bus time at 100 kHz / 400 kHz / 1 MHz:\n" );
+    dumpString( "  spad_tool -v <log or register image file, or - for stdin>\n\n" );
+    dumpString( "Load a stream of SPAD map / mask records (as for -b) one after the other with the fewest I2C transfers and bytes:\n" );
+    dumpString( "  spad_tool -a <record file, or - for stdin>\n" );
+    dumpString( "  the first record is written as one burst, each further one only in the registers that differ from the record before,\n" );
+    dumpString( "  with short runs of equal registers written along where that is cheaper than another transfer. The output can be fed to -v.\n\n" );
+    dumpString( "Order a set of SPAD map / mask records (as for -b, up to 256) for a scan cycle with the least I2C bus time:\n" );
+    dumpString( "  spad_tool -q <record file, or - for stdin>\n" );
+    dumpString( "  exact up to 16 records, nearest neighbour + 2-opt above. The output lists the order and the I2C transfers of the cycle.\n\n" );
+    dumpString( "Split a time-multiplexed 4x4 zone layout into both captures and check them together:\n" );
+    dumpString( "  spad_tool -t <zone layout file> [-e <spad_mask file>] [-x <xOffset_2>] [-y <yOffset_2>]\n" );
+    dumpString( "  -t  one row of zones (1..16) per line, capture A measures zones 1..8, capture B zones 9..16\n\n" );
+    dumpString( "Search the offset of a SPAD map that loses the fewest enabled SPADs to the screamers of each device:\n" );
+    dumpString( "  spad_tool -m <spad_map file> [-e <spad_mask file>] -p <defect file, or - for stdin> [-j <threads>]\n" );
+    dumpString( "  each record starts with a line \"unit <name>\", followed by 12 rows of 18 values (1 = defective SPAD).\n" );
+    dumpString( "  -j  number of search threads (default: one per CPU)\n\n" );
+    dumpString( "Equalize the enabled SPADs per zone, the channel map is kept and disabled SPADs of the mask stay disabled:\n" );
+    dumpString( "  spad_tool -m <spad_map file> [-e <spad_mask file>] -u <flips> [-z <SPADs per zone>] [-w <balance weight>]\n" );
+    dumpString( "  -u  number of single SPAD flips to try (1000000 is a good start)\n" );
+    dumpString( "  -z  enabled SPADs per zone to aim for (1..180, default: the largest count all zones can reach)\n" );
+    dumpString( "  -w  enabled SPADs that are worth one SPAD less deviation from the target (1..65535, default: 180, target first)\n" );
 }
 
 int main(int argc, char **argv)
 {
-    (void)argv; /* prevent compiler warning */
+    const char * mapFileName = 0;
+    const char * maskFileName = 0;
+    const char * batchFileName = 0;
+    const char * imageFileName = 0;
+    const char * decodeFileName = 0;
+    const char * zoneFileName = 0;
+    const char * defectFileName = 0;
+    const char * cacheDirectory = 0;
+    const char * statsDirectory = 0;
+    const char * corpusFileName = 0;
+    const char * corpusOutputFileName = 0;
+    const char * socketName = 0;
+    const char * deviceFileName = 0;
+    const char * deltaFileName = 0;
+    const char * scheduleFileName = 0;
+    tmf8x2xCache * cache = 0;
+    uint32_t threads = 0;
+    uint32_t flips = 0;
+    uint32_t target = 0;
+    uint32_t balanceWeight = TMF8X2X_OPTIMIZER_EQUAL_ZONES;
+    uint32_t formats = 0;
+    uint8_t connectivity = 0;
+    int8_t xOffset_2 = 0;
+    int8_t yOffset_2 = 0;
+    int showHelp = 0;
+    int modes;
+
+    atexit( dumpFlush ); /* the dump functions buffer their output */
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char * arg = argv[ i ];
+        const char * value = ( i + 1 < argc ) ? argv[ i + 1 ] : 0;
+        if ( arg[ 0 ] != '-' || arg[ 1 ] == 0 || arg[ 2 ] != 0 || ! value )
+        {
+            showHelp = 1;
+            break;
+        }
+        switch ( arg[ 1 ] )
+        {
+            case 'm': mapFileName = value; break;
+            case 'e': maskFileName = value; break;
+            case 'b': batchFileName = value; break;
+            case 'r': imageFileName = value; break;
+            case 'd': decodeFileName = value; break;
+            case 't': zoneFileName = value; break;
+            case 'p': defectFileName = value; break;
+            case 'c': cacheDirectory = value; break;
+            case 's': statsDirectory = value; break;
+            case 'k': corpusFileName = value; break;
+            case 'o': corpusOutputFileName = value; break;
+            case 'l': socketName = value; break;
+            case 'v': deviceFileName = value; break;
+            case 'a': deltaFileName = value; break;
+            case 'q': scheduleFileName = value; break;
+            case 'j': showHelp = parseThreads( value, &threads ); break;
+            case 'u': showHelp = parseCount( value, &flips ); break;
+            case 'z': showHelp = parseCount( value, &target ); break;
+            case 'w': showHelp = parseCount( value, &balanceWeight ); break;
+            case 'x': showHelp = parseOffset( value, &xOffset_2 ); break;
+            case 'y': showHelp = parseOffset( value, &yOffset_2 ); break;
+            case 'f': showHelp = ( tmf8x2xParseFormats( value, &formats ) != TMF8X2X_SPAD_MAP_OK ); break;
+            case 'i': showHelp = parseConnectivity( value, &connectivity ); break;
+            default:  showHelp = 1; break;
+        }
+        if ( showHelp )
+        {
+            break;
+        }
+        i++; /* skip the option value */
+    }
 
-    dumpString( "SPAD map tool - standalone version v1.0\n" );
-    dumpString( "(c) 2022 by ams OSRAM AG. All rights reserved.\n\n" );
+    if ( showHelp || ( ! ( formats & TMF8X2X_FORMAT_MACHINE ) && ! socketName ) ) /* JSON Lines / CSV output and answers start with the first record */
+    {
+        dumpString( "SPAD map tool - standalone version v1.0\n" );
+        dumpString( "(c) 2022 by ams OSRAM AG. All rights reserved.\n\n" );
+    }
 
-    if ( argc > 1 )
+    modes = ( mapFileName != 0 ) + ( batchFileName != 0 ) + ( decodeFileName != 0 ) + ( zoneFileName != 0 ) + ( statsDirectory != 0 ) + ( corpusFileName != 0 ) + ( socketName != 0 ) + ( deviceFileName != 0 ) + ( deltaFileName != 0 ) + ( scheduleFileName != 0 );
+    if (  showHelp
+       || modes > 1
+       || ( maskFileName && ! mapFileName && ! zoneFileName )
+       || ( imageFileName && modes && ! mapFileName )
+       || ( defectFileName && ( ! mapFileName || imageFileName ) )
+       || ( flips && ( ! mapFileName || defectFileName ) )
+       || target > TMF8X2X_OPTIMIZER_EQUAL_ZONES
+       || balanceWeight > TMF8X2X_OPTIMIZER_MAX_WEIGHT
+       || ( cacheDirectory && ( decodeFileName || zoneFileName || statsDirectory || defectFileName || flips || corpusFileName || socketName || deviceFileName || deltaFileName || scheduleFileName ) )
+       || ( corpusOutputFileName && ! batchFileName && ! corpusFileName )
+       || ( corpusOutputFileName && cacheDirectory )
+       || ( formats && ( decodeFileName || zoneFileName || statsDirectory || defectFileName || flips || corpusFileName || corpusOutputFileName || deviceFileName || deltaFileName || scheduleFileName ) )
+       || ( socketName && ( formats & ~( TMF8X2X_FORMAT_JSON | TMF8X2X_FORMAT_ANALYSIS ) ) )
+       || ( connectivity && ( decodeFileName || zoneFileName || statsDirectory || defectFileName || flips || corpusFileName || corpusOutputFileName || deviceFileName || deltaFileName || scheduleFileName ) )
+       )
     {
         displayCommandLineHelp();
+        return 0;
+    }
+
+    if ( cacheDirectory )
+    {
+        if ( tmf8x2xCacheOpen( &spadCache, cacheDirectory ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            dumpString( "ERROR opening cache directory.\n" );
+            return 1;
+        }
+        cache = &spadCache;
+        atexit( closeSpadCache );
+    }
+
+    if ( statsDirectory )
+    {
+        if ( tmf8x2xCacheReport( statsDirectory ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            dumpString( "ERROR reading cache directory.\n" );
+            return 1;
+        }
+        return 0;
+    }
+    else if ( socketName )
+    {
+        if ( tmf8x2xRunServer( socketName, formats, connectivity ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            dumpString( "ERROR setting up the server socket.\n" );
+            return 1;
+        }
+        return 0;
+    }
+    else if ( corpusFileName )
+    {
+        if ( corpusOutputFileName )
+        {
+            return tmf8x2xConvertCorpusToBatch( corpusFileName, corpusOutputFileName ) != TMF8X2X_SPAD_MAP_OK;
+        }
+        return tmf8x2xRunCorpus( corpusFileName, threads ) ? 1 : 0;
+    }
+    else if ( batchFileName )
+    {
+        FILE * input = ( batchFileName[ 0 ] == '-' && batchFileName[ 1 ] == 0 ) ? stdin : fopen( batchFileName, "r" );
+        uint32_t failed;
+
+        if ( ! input )
+        {
+            dumpString( "ERROR reading SPAD record file.\n" );
+            return 1;
+        }
+        failed = corpusOutputFileName ? tmf8x2xConvertBatchToCorpus( input, corpusOutputFileName ) : tmf8x2xRunBatch( input, cache, threads, formats, connectivity );
+        if ( input != stdin )
+        {
+            fclose( input );
+        }
+        return failed ? 1 : 0;
+    }
+    else if ( decodeFileName )
+    {
+        FILE * input = ( decodeFileName[ 0 ] == '-' && decodeFileName[ 1 ] == 0 ) ? stdin : fopen( decodeFileName, "r" );
+        uint32_t failed;
+
+        if ( ! input )
+        {
+            dumpString( "ERROR reading I2C log / C-struct file.\n" );
+            return 1;
+        }
+        failed = tmf8x2xRunDecode( input );
+        if ( input != stdin )
+        {
+            fclose( input );
+        }
+        return failed ? 1 : 0;
+    }
+    else if ( deviceFileName )
+    {
+        FILE * input = ( deviceFileName[ 0 ] == '-' && deviceFileName[ 1 ] == 0 ) ? stdin : fopen( deviceFileName, "rb" );
+        uint32_t failed;
+
+        if ( ! input )
+        {
+            dumpString( "ERROR reading I2C log / register image file.\n" );
+            return 1;
+        }
+        failed = tmf8x2xRunDeviceModel( input );
+        if ( input != stdin )
+        {
+            fclose( input );
+        }
+        return failed ? 1 : 0;
+    }
+    else if ( deltaFileName )
+    {
+        FILE * input = ( deltaFileName[ 0 ] == '-' && deltaFileName[ 1 ] == 0 ) ? stdin : fopen( deltaFileName, "r" );
+        uint32_t failed;
+
+        if ( ! input )
+        {
+            dumpString( "ERROR reading SPAD record file.\n" );
+            return 1;
+        }
+        failed = tmf8x2xRunRegisterDelta( input );
+        if ( input != stdin )
+        {
+            fclose( input );
+        }
+        return failed ? 1 : 0;
+    }
+    else if ( scheduleFileName )
+    {
+        FILE * input = ( scheduleFileName[ 0 ] == '-' && scheduleFileName[ 1 ] == 0 ) ? stdin : fopen( scheduleFileName, "r" );
+        uint32_t failed;
+
+        if ( ! input )
+        {
+            dumpString( "ERROR reading SPAD record file.\n" );
+            return 1;
+        }
+        failed = tmf8x2xRunSchedule( input );
+        if ( input != stdin )
+        {
+            fclose( input );
+        }
+        return failed ? 1 : 0;
+    }
+    else if ( zoneFileName )
+    {
+        static char zoneText[ TEXT_FILE_MAX_SIZE ];
+        static char maskText[ TEXT_FILE_MAX_SIZE ];
+        static tmf8x2xMultiplexLayout layout;
+        uint32_t zoneLength = loadTextFile( zoneFileName, zoneText, TEXT_FILE_MAX_SIZE );
+        uint32_t maskLength = maskFileName ? loadTextFile( maskFileName, maskText, TEXT_FILE_MAX_SIZE ) : 0;
+
+        if ( zoneLength == 0 || ( maskFileName && maskLength == 0 ) )
+        {
+            dumpString( "ERROR reading zone layout / SPAD mask file.\n" );
+            return 1;
+        }
+        if ( tmf8x2xParseMultiplexLayout( &layout, zoneText, zoneLength, maskFileName ? maskText : 0, maskLength, xOffset_2, yOffset_2 ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            dumpString( "ERROR parsing zone layout / SPAD mask file (format, zone range or size mismatch).\n" );
+            return 1;
+        }
+        return tmf8x2xDumpMultiplexPair( &layout );
+    }
+    else if ( mapFileName )
+    {
+        static char mapText[ TEXT_FILE_MAX_SIZE ];
+        static char maskText[ TEXT_FILE_MAX_SIZE ];
+        static tmf8x2xSpadMaskStorage storage;
+        uint32_t mapLength = loadTextFile( mapFileName, mapText, TEXT_FILE_MAX_SIZE );
+        uint32_t maskLength = maskFileName ? loadTextFile( maskFileName, maskText, TEXT_FILE_MAX_SIZE ) : 0;
+
+        if ( mapLength == 0 || ( maskFileName && maskLength == 0 ) )
+        {
+            dumpString( "ERROR reading SPAD map / mask file.\n" );
+            return 1;
+        }
+        if ( tmf8x2xParseSpadMask( &storage, mapText, mapLength, maskFileName ? maskText : 0, maskLength, xOffset_2, yOffset_2 ) != TMF8X2X_SPAD_MAP_OK )
+        {
+            dumpString( "ERROR parsing SPAD map / mask file (format, channel range or size mismatch).\n" );
+            return 1;
+        }
+        if ( defectFileName )
+        {
+            return tmf8x2xPlaceSpadMap( &storage.mask, defectFileName, threads );
+        }
+        if ( flips )
+        {
+            return tmf8x2xOptimizeSpadMap( &storage, flips, target, balanceWeight, imageFileName );
+        }
+        return tmf8x2xDumpSpadMap( "tmf8x2xSpadMap", &storage.mask, imageFileName, cache, formats ? formats : TMF8X2X_FORMAT_TEXT, connectivity );
     }
     else
     {
-        tmf8x2xDumpTestMap();
+        tmf8x2xPackEnableMask( testSpadMaskEnablePacked, testSpadMapEnable, TEST_SPAD_MAP_XSIZE, TEST_SPAD_MAP_YSIZE );
+        return tmf8x2xDumpSpadMap( "tmf8x2xTestSpadMap", &tmf8x2xSpadMaskTestCfg, imageFileName, cache, formats ? formats : TMF8X2X_FORMAT_TEXT, connectivity );
     }
 
     return 0;
@@ -0,0 +1,307 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_validator.c
+ *  \brief incremental validator, keeps the result of tmf8x2xValidateSpadMask up to date while single SPADs are edited.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_validator.h"
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief validatorGeometry runs the checks that only depend on size and offsets of the SPAD map
+ * @param mask SPAD configuration in human readable format
+ * @return TMF8X2X_VALIDATE_ERROR_CREATE, _AREA or _ASSIGNMENT (single SPAD or empty map), TMF8X2X_VALIDATE_OK otherwise
+ */
+static uint8_t validatorGeometry( const tmf8x2xSpadMask * mask );
+
+/**
+ * @brief validatorAdjacent counts the enabled neighbours of a SPAD that are assigned to a channel
+ * @param validator state
+ * @param x column
+ * @param r row, top row first
+ * @param ch channel
+ * @return number of enabled neighbours
+ */
+static uint32_t validatorAdjacent( const tmf8x2xSpadValidator * validator, int32_t x, int32_t r, uint8_t ch );
+
+/**
+ * @brief validatorInsert adds a SPAD with its current channel and enable bit to the counters
+ * @param validator state
+ * @param x column
+ * @param r row, top row first
+ */
+static void validatorInsert( tmf8x2xSpadValidator * validator, int32_t x, int32_t r );
+
+/**
+ * @brief validatorRemove takes a SPAD with its current channel and enable bit out of the counters
+ * @param validator state
+ * @param x column
+ * @param r row, top row first
+ */
+static void validatorRemove( tmf8x2xSpadValidator * validator, int32_t x, int32_t r );
+
+/**
+ * @brief validatorUpdate derives the result from the counters, in the order of tmf8x2xValidateSpadMask
+ * @param validator state
+ */
+static void validatorUpdate( tmf8x2xSpadValidator * validator );
+
+/*
+ *****************************************************************************
+ * COUNTERS
+ *****************************************************************************
+ */
+
+static uint8_t validatorGeometry ( const tmf8x2xSpadMask * mask )
+{
+    /* the same size and offsets with channel 1 everywhere can only fail on geometry */
+    uint8_t channels[ TMF8X2X_VALIDATOR_MAX_SPADS ];
+    uint32_t enable[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ] = { 0 };
+    tmf8x2xSpadMask probe = { enable, channels, 0, mask->xOffset_2, mask->yOffset_2, mask->xSize, mask->ySize };
+    tmf8x2xHalMainSpadConfig config;
+
+    memset( channels, 1, sizeof( channels ) );
+    if ( tmf8x2xCreateMainSpad( &config, &probe ) == 0 )
+    {
+        return TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    if ( tmf8x2xCheckMainSpadArea( &config ) == TMF8X2X_SPAD_MAP_ERROR_CONFIG )
+    {
+        return TMF8X2X_VALIDATE_ERROR_AREA;
+    }
+    if ( mask->xSize < 1 || mask->ySize < 1 || ( mask->xSize == 1 && mask->ySize == 1 ) )
+    {
+        return TMF8X2X_VALIDATE_ERROR_ASSIGNMENT; /* rejected by tmf8x2xCheckMainSpadAssignment */
+    }
+    return TMF8X2X_VALIDATE_OK;
+}
+
+static uint32_t validatorAdjacent ( const tmf8x2xSpadValidator * validator, int32_t x, int32_t r, uint8_t ch )
+{
+    int32_t xSize = validator->xSize;
+    int32_t ySize = validator->ySize;
+    uint32_t count = 0;
+
+    for ( int32_t dr = -1; dr <= 1; dr++ )
+    {
+        for ( int32_t dx = -1; dx <= 1; dx++ )
+        {
+            int32_t n = ( r + dr ) * xSize + x + dx;
+            if (  ( dx || dr )
+               && x + dx >= 0 && x + dx < xSize && r + dr >= 0 && r + dr < ySize
+               && validator->enable[ n ] && validator->channel[ n ] == ch
+               )
+            {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static void validatorInsert ( tmf8x2xSpadValidator * validator, int32_t x, int32_t r )
+{
+    int32_t i = r * validator->xSize + x;
+    uint8_t ch = validator->channel[ i ];
+
+    validator->conflictRows -= ( validator->rowLow[ r ] && validator->rowHigh[ r ] );
+    validator->lonelyZones -= ( validator->enabled[ ch ] && ! validator->pairs[ ch ] );
+
+    validator->spads[ ch ]++;
+    validator->rowLow[ r ] += ( ch <= 1 );
+    validator->rowHigh[ r ] += ( ch >= 8 );
+    if ( validator->enable[ i ] )
+    {
+        validator->enabled[ ch ]++;
+        validator->pairs[ ch ] += validatorAdjacent( validator, x, r, ch );
+    }
+
+    validator->conflictRows += ( validator->rowLow[ r ] && validator->rowHigh[ r ] );
+    validator->lonelyZones += ( validator->enabled[ ch ] && ! validator->pairs[ ch ] );
+}
+
+static void validatorRemove ( tmf8x2xSpadValidator * validator, int32_t x, int32_t r )
+{
+    int32_t i = r * validator->xSize + x;
+    uint8_t ch = validator->channel[ i ];
+
+    validator->conflictRows -= ( validator->rowLow[ r ] && validator->rowHigh[ r ] );
+    validator->lonelyZones -= ( validator->enabled[ ch ] && ! validator->pairs[ ch ] );
+
+    validator->spads[ ch ]--;
+    validator->rowLow[ r ] -= ( ch <= 1 );
+    validator->rowHigh[ r ] -= ( ch >= 8 );
+    if ( validator->enable[ i ] )
+    {
+        validator->enabled[ ch ]--;
+        validator->pairs[ ch ] -= validatorAdjacent( validator, x, r, ch );
+    }
+
+    validator->conflictRows += ( validator->rowLow[ r ] && validator->rowHigh[ r ] );
+    validator->lonelyZones += ( validator->enabled[ ch ] && ! validator->pairs[ ch ] );
+}
+
+static void validatorUpdate ( tmf8x2xSpadValidator * validator )
+{
+    const uint16_t * spads = validator->spads;
+
+    if ( validator->geometry == TMF8X2X_VALIDATE_ERROR_CREATE || validator->conflictRows )
+    {
+        validator->result = TMF8X2X_VALIDATE_ERROR_CREATE;
+    }
+    else if ( validator->geometry == TMF8X2X_VALIDATE_ERROR_AREA )
+    {
+        validator->result = TMF8X2X_VALIDATE_ERROR_AREA;
+    }
+    else if (  spads[ 0 ]                                       /* same checks as tmf8x2xCheckMainSpadChannelSetup */
+            || spads[ CHANNEL_2 ] + spads[ CHANNEL_3 ] == 0
+            || spads[ CHANNEL_4 ] + spads[ CHANNEL_5 ] == 0
+            || spads[ CHANNEL_6 ] + spads[ CHANNEL_7 ] == 0
+            || spads[ CHANNEL_8 ] + spads[ CHANNEL_9 ] == 0
+            )
+    {
+        validator->result = TMF8X2X_VALIDATE_ERROR_CHANNEL;
+    }
+    else if ( validator->geometry == TMF8X2X_VALIDATE_ERROR_ASSIGNMENT || validator->lonelyZones )
+    {
+        validator->result = TMF8X2X_VALIDATE_ERROR_ASSIGNMENT;
+    }
+    else
+    {
+        validator->result = TMF8X2X_VALIDATE_OK;
+    }
+}
+
+/*
+ *****************************************************************************
+ * VALIDATOR
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xValidatorInit ( tmf8x2xSpadValidator * validator, const tmf8x2xSpadMask * mask )
+{
+    if (  mask->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE
+       || mask->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    for ( uint32_t i = 0; i < (uint32_t)mask->xSize * mask->ySize; i++ )
+    {
+        if ( mask->channels[ i ] >= TMF8X2X_NUMBER_OF_CHANNELS )
+        {
+            return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+        }
+    }
+
+    memset( validator, 0, sizeof( *validator ) );
+    validator->xOffset_2 = mask->xOffset_2;
+    validator->yOffset_2 = mask->yOffset_2;
+    validator->xSize = mask->xSize;
+    validator->ySize = mask->ySize;
+    validator->geometry = validatorGeometry( mask );
+    memcpy( validator->channel, mask->channels, (uint32_t)mask->xSize * mask->ySize );
+
+    /* add the SPADs one by one, each adjacent pair is counted when its second SPAD is added */
+    for ( int32_t r = 0; r < mask->ySize; r++ )
+    {
+        for ( int32_t x = 0; x < mask->xSize; x++ )
+        {
+            validator->enable[ r * mask->xSize + x ] = ( mask->enable[ r ] >> x ) & 1;
+            validatorInsert( validator, x, r );
+        }
+    }
+    validatorUpdate( validator );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xValidatorSetEnable ( tmf8x2xSpadValidator * validator, uint8_t x, uint8_t y, uint8_t bit )
+{
+    int32_t r = validator->ySize - 1 - y;
+
+    if ( x >= validator->xSize || y >= validator->ySize )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    validatorRemove( validator, x, r );
+    validator->enable[ r * validator->xSize + x ] = ( bit != 0 );
+    validatorInsert( validator, x, r );
+    validatorUpdate( validator );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xValidatorSetChannel ( tmf8x2xSpadValidator * validator, uint8_t x, uint8_t y, uint8_t ch )
+{
+    int32_t r = validator->ySize - 1 - y;
+
+    if ( x >= validator->xSize || y >= validator->ySize || ch >= TMF8X2X_NUMBER_OF_CHANNELS )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    validatorRemove( validator, x, r );
+    validator->channel[ r * validator->xSize + x ] = ch;
+    validatorInsert( validator, x, r );
+    validatorUpdate( validator );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+uint8_t tmf8x2xValidatorResult ( const tmf8x2xSpadValidator * validator )
+{
+    return validator->result;
+}
+
+void tmf8x2xValidatorStore ( const tmf8x2xSpadValidator * validator, tmf8x2xSpadMaskStorage * storage )
+{
+    uint32_t size = (uint32_t)validator->xSize * validator->ySize;
+
+    memcpy( storage->channels, validator->channel, size );
+    memcpy( storage->enable, validator->enable, size );
+    tmf8x2xPackEnableMask( storage->enablePacked, storage->enable, validator->xSize, validator->ySize );
+    storage->mask.enable = storage->enablePacked;
+    storage->mask.channels = storage->channels;
+    storage->mask.id = 0;
+    storage->mask.xOffset_2 = validator->xOffset_2;
+    storage->mask.yOffset_2 = validator->yOffset_2;
+    storage->mask.xSize = validator->xSize;
+    storage->mask.ySize = validator->ySize;
+}
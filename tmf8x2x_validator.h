@@ -0,0 +1,137 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_validator.h
+ *  \brief incremental validator, keeps the result of tmf8x2xValidateSpadMask up to date while single SPADs are edited.
+ *
+ * The validator keeps the counters the checks are made of: SPADs and enabled SPADs per channel, adjacent enabled SPAD
+ * pairs per channel (8-neighbourhood, as in tmf8x2xCheckMainSpadAssignment) and SPADs of channels 0/1 and 8/9 per row.
+ * An edit changes at most 8 neighbours, so tmf8x2xValidatorSetEnable and tmf8x2xValidatorSetChannel update the
+ * counters and the result in constant time. The result is always the one tmf8x2xValidateSpadMask returns for the
+ * edited mask. Size and offsets of the SPAD map are fixed, their checks are done once by tmf8x2xValidatorInit.
+ *
+ * Coordinates are the ones of the text dumps: x = 0 is the left column, y = 0 is the bottom row.
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_parser.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_VALIDATOR_H
+#define TMF8X2X_VALIDATOR_H
+
+/* number of SPADs the validator can hold */
+#define TMF8X2X_VALIDATOR_MAX_SPADS         ( TMF8X2X_MAIN_SPAD_MAX_X_SIZE * TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* state of the incremental validator, SPAD i = ( ySize - 1 - y ) * xSize + x (top row first, as tmf8x2xSpadMaskStorage) */
+typedef struct _tmf8x2xSpadValidator
+{
+    uint8_t channel[ TMF8X2X_VALIDATOR_MAX_SPADS ];
+    uint8_t enable[ TMF8X2X_VALIDATOR_MAX_SPADS ];              /* 0 or 1 */
+    uint16_t spads[ TMF8X2X_NUMBER_OF_CHANNELS ];               /* SPADs assigned to each channel */
+    uint16_t enabled[ TMF8X2X_NUMBER_OF_CHANNELS ];             /* enabled SPADs of each channel */
+    uint16_t pairs[ TMF8X2X_NUMBER_OF_CHANNELS ];               /* adjacent enabled SPAD pairs of each channel */
+    uint8_t rowLow[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];             /* SPADs of channel 0/1 in each row (top row first) */
+    uint8_t rowHigh[ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];            /* SPADs of channel 8/9 in each row (top row first) */
+    uint8_t conflictRows;                                       /* rows with 0/1 and 8/9 */
+    uint8_t lonelyZones;                                        /* channels with enabled SPADs but without an adjacent pair */
+    uint8_t geometry;                                           /* result of the size / offset checks */
+    uint8_t result;                                             /* TMF8X2X_VALIDATE_* of the current mask */
+    int8_t xOffset_2;
+    int8_t yOffset_2;
+    uint8_t xSize;
+    uint8_t ySize;
+} tmf8x2xSpadValidator;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xValidatorInit loads a SPAD mask into the validator
+ * @param validator receives the state
+ * @param mask SPAD configuration in human readable format, channels have to be in 0..9
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if the mask does not fit into the validator, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xValidatorInit( tmf8x2xSpadValidator * validator, const tmf8x2xSpadMask * mask );
+
+/**
+ * @brief tmf8x2xValidatorSetEnable enables or disables one SPAD and updates the result
+ * @param validator state
+ * @param x column, 0 is left
+ * @param y row, 0 is bottom
+ * @param bit 0 disables, any other value enables the SPAD
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if x|y is outside the SPAD map (nothing changed), TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xValidatorSetEnable( tmf8x2xSpadValidator * validator, uint8_t x, uint8_t y, uint8_t bit );
+
+/**
+ * @brief tmf8x2xValidatorSetChannel assigns one SPAD to a TDC channel and updates the result
+ * @param validator state
+ * @param x column, 0 is left
+ * @param y row, 0 is bottom
+ * @param ch channel 0..9
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if x|y is outside the SPAD map or the channel is out of range (nothing changed), TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xValidatorSetChannel( tmf8x2xSpadValidator * validator, uint8_t x, uint8_t y, uint8_t ch );
+
+/**
+ * @brief tmf8x2xValidatorResult returns the result of the current mask
+ * @param validator state
+ * @return TMF8X2X_VALIDATE_OK, or the TMF8X2X_VALIDATE_ERROR_* code tmf8x2xValidateSpadMask returns for the current mask
+ */
+uint8_t tmf8x2xValidatorResult( const tmf8x2xSpadValidator * validator );
+
+/**
+ * @brief tmf8x2xValidatorStore writes the current mask into a storage, e.g. to create and dump the SPAD configuration
+ * @param validator state
+ * @param storage receives the mask (enable bits human readable and packed, channels, size and offsets)
+ */
+void tmf8x2xValidatorStore( const tmf8x2xSpadValidator * validator, tmf8x2xSpadMaskStorage * storage );
+
+#endif /* TMF8X2X_VALIDATOR_H */
@@ -0,0 +1,537 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_zone_stats.c
+ *  \brief per-zone statistics of a packed SPAD configuration: enabled SPADs, centroid, bounding box, boundary length and field of view,
+ *  and the connected components (islands) of the enabled SPADs of each zone.
+*/
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <string.h>
+#include "tmf8x2x_includes.h"
+#include "tmf8x2x_spad_mask_tool.h"
+#include "tmf8x2x_zone_stats.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+/* longest line of the statistics table */
+#define STATS_LINE_SIZE                     128
+
+/* the rows of a zone share 64-bit words (lanes of 21 bits, the upper 3 bits of each lane stay 0), so one popcount covers 3 rows */
+#define STATS_LANE_BITS                     21
+#define STATS_LANES_PER_WORD                3
+#define STATS_LANE_WORDS                    ( ( TMF8X2X_MAIN_SPAD_MAX_Y_SIZE + STATS_LANES_PER_WORD - 1 ) / STATS_LANES_PER_WORD )
+#define STATS_LANE_1                        ( 0x3FFFFull << STATS_LANE_BITS )
+#define STATS_LANE_2                        ( 0x3FFFFull << ( 2 * STATS_LANE_BITS ) )
+#define STATS_ROW_SHIFT( y )                ( ( (y) % STATS_LANES_PER_WORD ) * STATS_LANE_BITS )
+/* bit k of the x position is set: SPAD columns 0..17 repeated in every lane */
+#define STATS_X_BIT( mask )                 ( (uint64_t)( mask ) | ( (uint64_t)( mask ) << STATS_LANE_BITS ) | ( (uint64_t)( mask ) << ( 2 * STATS_LANE_BITS ) ) )
+
+/*
+ *****************************************************************************
+ * LOCAL PROTOTYPES
+ *****************************************************************************
+ */
+
+/**
+ * @brief statsCountBits counts the set bits of a word (SWAR, no loop over the bits)
+ * @param bits word
+ * @return number of set bits
+ */
+static uint32_t statsCountBits( uint64_t bits );
+/**
+ * @brief statsSumPositions sums the x positions of the set bits of a word of lanes, one count per bit of the position
+ * @param bits word of lanes
+ * @return sum of the x positions of the set bits
+ */
+static uint32_t statsSumPositions( uint64_t bits );
+/**
+ * @brief statsLowestBit returns the position of the lowest set bit
+ * @param bits row, not 0
+ * @return bit position
+ */
+static uint8_t statsLowestBit( uint32_t bits );
+/**
+ * @brief statsHighestBit returns the position of the highest set bit
+ * @param bits row, not 0
+ * @return bit position
+ */
+static uint8_t statsHighestBit( uint32_t bits );
+/**
+ * @brief statsDivide divides and rounds to the nearest integer (halves away from 0)
+ * @param numerator any sign
+ * @param denominator > 0
+ * @return rounded quotient
+ */
+static int32_t statsDivide( int32_t numerator, int32_t denominator );
+/**
+ * @brief statsAppend appends a number right-aligned to a line
+ * @param line text, must have room for width + 12 characters after length
+ * @param length current length of the line, updated
+ * @param value number, in hundredths if decimals is 2
+ * @param decimals 0 or 2
+ * @param width minimum field width
+ */
+static void statsAppend( char * line, uint32_t * length, int32_t value, uint32_t decimals, uint32_t width );
+/**
+ * @brief statsAppendRange appends a range "first..last" right-aligned to a line
+ * @param line text, must have room for width + 12 characters after length
+ * @param length current length of the line, updated
+ * @param first start of the range
+ * @param last end of the range
+ * @param width minimum field width
+ */
+static void statsAppendRange( char * line, uint32_t * length, uint8_t first, uint8_t last, uint32_t width );
+/**
+ * @brief statsAppendText appends a string to a line
+ * @param line text, must have room for the string after length
+ * @param length current length of the line, updated
+ * @param text to append
+ */
+static void statsAppendText( char * line, uint32_t * length, const char * text );
+/**
+ * @brief statsFill grows a component until it covers all SPADs of the region that are connected to it
+ * @param component seed SPADs, receives the component (rows in lanes)
+ * @param region SPADs that can be part of the component (rows in lanes, guard bits 0)
+ * @param connectivity TMF8X2X_CONNECTIVITY_4 or TMF8X2X_CONNECTIVITY_8
+ */
+static void statsFill( uint64_t component[ STATS_LANE_WORDS ], const uint64_t region[ STATS_LANE_WORDS ], uint8_t connectivity );
+
+/*
+ *****************************************************************************
+ * UTILITY FUNCTIONS
+ *****************************************************************************
+ */
+
+static uint32_t statsCountBits ( uint64_t bits )
+{
+    bits = bits - ( ( bits >> 1 ) & 0x5555555555555555ull );
+    bits = ( bits & 0x3333333333333333ull ) + ( ( bits >> 2 ) & 0x3333333333333333ull );
+    bits = ( bits + ( bits >> 4 ) ) & 0x0F0F0F0F0F0F0F0Full;
+    return (uint32_t)( ( bits * 0x0101010101010101ull ) >> 56 );
+}
+
+static uint32_t statsSumPositions ( uint64_t bits )
+{
+    return statsCountBits( bits & STATS_X_BIT( 0x2AAAA ) )
+         + ( statsCountBits( bits & STATS_X_BIT( 0x0CCCC ) ) << 1 )
+         + ( statsCountBits( bits & STATS_X_BIT( 0x0F0F0 ) ) << 2 )
+         + ( statsCountBits( bits & STATS_X_BIT( 0x0FF00 ) ) << 3 )
+         + ( statsCountBits( bits & STATS_X_BIT( 0x30000 ) ) << 4 );
+}
+
+static uint8_t statsLowestBit ( uint32_t bits )
+{
+    return (uint8_t)statsCountBits( ( bits & ( 0u - bits ) ) - 1 );
+}
+
+static uint8_t statsHighestBit ( uint32_t bits )
+{
+    bits |= bits >> 1;
+    bits |= bits >> 2;
+    bits |= bits >> 4;
+    bits |= bits >> 8;
+    bits |= bits >> 16;
+    return (uint8_t)( statsCountBits( bits ) - 1 );
+}
+
+static int32_t statsDivide ( int32_t numerator, int32_t denominator )
+{
+    if ( numerator < 0 )
+    {
+        return -( ( -numerator + denominator / 2 ) / denominator );
+    }
+    return ( numerator + denominator / 2 ) / denominator;
+}
+
+static void statsAppend ( char * line, uint32_t * length, int32_t value, uint32_t decimals, uint32_t width )
+{
+    char text[ 16 ];
+    uint32_t i = sizeof( text );
+    uint32_t magnitude = (uint32_t)( value < 0 ? -value : value );
+    uint32_t digits = 0;
+
+    do
+    {
+        text[ --i ] = (char)( '0' + magnitude % 10 );
+        magnitude /= 10;
+        if ( ++digits == decimals )
+        {
+            text[ --i ] = '.';
+        }
+    } while ( magnitude || digits <= decimals );
+    if ( value < 0 )
+    {
+        text[ --i ] = '-';
+    }
+    while ( sizeof( text ) - i < width )
+    {
+        line[ ( *length )++ ] = ' ';
+        width--;
+    }
+    memcpy( line + *length, text + i, sizeof( text ) - i );
+    *length += sizeof( text ) - i;
+}
+
+static void statsAppendRange ( char * line, uint32_t * length, uint8_t first, uint8_t last, uint32_t width )
+{
+    char range[ 16 ];
+    uint32_t rangeLength = 0;
+
+    statsAppend( range, &rangeLength, first, 0, 1 );
+    statsAppendText( range, &rangeLength, ".." );
+    statsAppend( range, &rangeLength, last, 0, 1 );
+    while ( rangeLength < width )
+    {
+        line[ ( *length )++ ] = ' ';
+        width--;
+    }
+    memcpy( line + *length, range, rangeLength );
+    *length += rangeLength;
+}
+
+static void statsAppendText ( char * line, uint32_t * length, const char * text )
+{
+    uint32_t textLength = (uint32_t)strlen( text );
+    memcpy( line + *length, text, textLength );
+    *length += textLength;
+}
+
+static void statsFill ( uint64_t component[ STATS_LANE_WORDS ], const uint64_t region[ STATS_LANE_WORDS ], uint8_t connectivity )
+{
+    uint64_t grown[ STATS_LANE_WORDS ];
+    uint64_t changed;
+
+    do
+    {
+        changed = 0;
+        for ( uint32_t w = 0; w < STATS_LANE_WORDS; w++ )
+        {
+            grown[ w ] = component[ w ] | ( component[ w ] << 1 ) | ( component[ w ] >> 1 ); /* bits shifted into the guard bits are masked by the region */
+        }
+        for ( uint32_t w = 0; w < STATS_LANE_WORDS; w++ )
+        {
+            /* with 8-connectivity the rows above and below grow from the left / right neighbours too */
+            const uint64_t * vertical = ( connectivity == TMF8X2X_CONNECTIVITY_8 ) ? grown : component;
+            uint64_t above = ( vertical[ w ] >> STATS_LANE_BITS ) | ( ( w + 1 < STATS_LANE_WORDS ) ? vertical[ w + 1 ] << ( 2 * STATS_LANE_BITS ) : 0 );
+            uint64_t below = ( vertical[ w ] << STATS_LANE_BITS ) | ( w > 0 ? vertical[ w - 1 ] >> ( 2 * STATS_LANE_BITS ) : 0 );
+            uint64_t next = ( grown[ w ] | above | below ) & region[ w ];
+            changed |= next ^ component[ w ];
+            component[ w ] = next;
+        }
+    } while ( changed );
+}
+
+/*
+ *****************************************************************************
+ * ZONE STATISTICS
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xComputeZoneStats ( const tmf8x2xHalMainSpadConfig * config, tmf8x2xSpadMapStats * stats )
+{
+    uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    uint32_t xMask;
+    uint32_t boundary = 0;
+    int32_t xCenter_2;
+    int32_t yCenter_2;
+    int32_t llcX;
+    int32_t llcY;
+
+    if (  ( config->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE )
+       || ( config->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+       || ( config->xSize < 1 )
+       || ( config->ySize < 1 )
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    memset( stats, 0, sizeof( *stats ) );
+    tmf8x2xDecodeChannelPlanes( config, planes );
+    xMask = ( 1u << config->xSize ) - 1;
+
+    /* position of the SPAD map in the SPAD array, the center depends on the size being even or odd */
+    xCenter_2 = ( config->xSize & 1 ) ? X_CENTER_2_B : X_CENTER_2_A;
+    yCenter_2 = ( config->ySize & 1 ) ? Y_CENTER_2_B : Y_CENTER_2_A;
+    llcX = ( xCenter_2 + config->xOffset_2 - config->xSize ) / 2;
+    llcY = ( yCenter_2 + config->yOffset_2 - config->ySize ) / 2;
+
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        tmf8x2xZoneStats * zone = &stats->zones[ ch ];
+        const uint32_t * rows = planes[ ch ];
+        uint64_t assigned[ STATS_LANE_WORDS ] = { 0 };
+        uint64_t enabled[ STATS_LANE_WORDS ] = { 0 };
+        uint64_t other[ STATS_LANE_WORDS ] = { 0 };     /* SPADs of another zone in the same row */
+        uint64_t otherUp[ STATS_LANE_WORDS ] = { 0 };   /* ... in the row above */
+        uint64_t otherDown[ STATS_LANE_WORDS ] = { 0 }; /* ... in the row below */
+        uint32_t columns = 0;
+        uint32_t sumX = 0;
+        uint32_t sumY = 0;
+        uint32_t spads = 0;
+        uint32_t edges = 0;
+        uint32_t used = 0;
+
+        for ( uint8_t y = 0; y < config->ySize; y++ )
+        {
+            uint32_t word = y / STATS_LANES_PER_WORD;
+            uint32_t shift = ( y % STATS_LANES_PER_WORD ) * STATS_LANE_BITS;
+            uint32_t enabledRow = rows[ y ] & config->enableSpad[ y ];
+
+            used |= rows[ y ];
+            assigned[ word ] |= (uint64_t)rows[ y ] << shift;
+            enabled[ word ] |= (uint64_t)enabledRow << shift;
+            other[ word ] |= (uint64_t)( xMask & ~rows[ y ] ) << shift;
+            otherDown[ word ] |= (uint64_t)( y > 0 ? xMask & ~rows[ y - 1 ] : 0 ) << shift;
+            otherUp[ word ] |= (uint64_t)( y + 1 < config->ySize ? xMask & ~rows[ y + 1 ] : 0 ) << shift;
+            if ( enabledRow )
+            {
+                if ( ! columns )
+                {
+                    zone->yMin = y;
+                }
+                zone->yMax = y;
+                columns |= enabledRow;
+            }
+        }
+        if ( ! used )
+        {
+            continue;
+        }
+
+        for ( uint32_t w = 0; w < STATS_LANE_WORDS; w++ )
+        {
+            uint32_t count;
+            if ( ! assigned[ w ] ) /* zones are compact, most of them span one or two words */
+            {
+                continue;
+            }
+            count = statsCountBits( enabled[ w ] );
+            spads += count;
+            sumX += statsSumPositions( enabled[ w ] );
+            sumY += count * w * STATS_LANES_PER_WORD + statsCountBits( enabled[ w ] & STATS_LANE_1 ) + 2 * statsCountBits( enabled[ w ] & STATS_LANE_2 );
+            /* lanes are wider than a row, shifting by one SPAD never moves a bit into another row */
+            edges += statsCountBits( assigned[ w ] & ( other[ w ] >> 1 ) ) + statsCountBits( assigned[ w ] & ( other[ w ] << 1 ) )
+                   + statsCountBits( assigned[ w ] & otherUp[ w ] ) + statsCountBits( assigned[ w ] & otherDown[ w ] );
+        }
+        zone->boundary = (uint16_t)edges;
+        boundary += edges;
+        if ( ! spads )
+        {
+            continue;
+        }
+
+        zone->spads = (uint16_t)spads;
+        zone->xCentroid = (uint16_t)statsDivide( (int32_t)( 100 * sumX ), (int32_t)spads );
+        zone->yCentroid = (uint16_t)statsDivide( (int32_t)( 100 * sumY ), (int32_t)spads );
+        zone->xMin = statsLowestBit( columns );
+        zone->xMax = statsHighestBit( columns );
+        /* centroid in half SPADs from the center, times spads: SPAD x of the array is centered at 2 * x + 1 in Q1 */
+        zone->xAngle = (int16_t)statsDivide( ( ( 2 * llcX + 1 - xCenter_2 ) * (int32_t)spads + 2 * (int32_t)sumX ) * TMF8X2X_ZONE_STATS_X_FOV_CDEG,
+                                             2 * TMF8X2X_ZONE_STATS_X_FOV_SPADS * (int32_t)spads );
+        zone->yAngle = (int16_t)statsDivide( ( ( 2 * llcY + 1 - yCenter_2 ) * (int32_t)spads + 2 * (int32_t)sumY ) * TMF8X2X_ZONE_STATS_Y_FOV_CDEG,
+                                             2 * TMF8X2X_ZONE_STATS_Y_FOV_SPADS * (int32_t)spads );
+        zone->xFov = (uint16_t)statsDivide( ( zone->xMax - zone->xMin + 1 ) * TMF8X2X_ZONE_STATS_X_FOV_CDEG, TMF8X2X_ZONE_STATS_X_FOV_SPADS );
+        zone->yFov = (uint16_t)statsDivide( ( zone->yMax - zone->yMin + 1 ) * TMF8X2X_ZONE_STATS_Y_FOV_CDEG, TMF8X2X_ZONE_STATS_Y_FOV_SPADS );
+        stats->zoneMask |= (uint16_t)( 1u << ch );
+        stats->spads += (uint16_t)spads;
+    }
+    stats->boundary = (uint16_t)( boundary / 2 );
+    stats->xFov = (uint16_t)statsDivide( config->xSize * TMF8X2X_ZONE_STATS_X_FOV_CDEG, TMF8X2X_ZONE_STATS_X_FOV_SPADS );
+    stats->yFov = (uint16_t)statsDivide( config->ySize * TMF8X2X_ZONE_STATS_Y_FOV_CDEG, TMF8X2X_ZONE_STATS_Y_FOV_SPADS );
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+void dumpZoneStatsAsText ( const tmf8x2xSpadMapStats * stats )
+{
+    char line[ STATS_LINE_SIZE ];
+    uint32_t length;
+
+    dumpString( "# zone statistics, x = 0 is the left column, y = 0 the bottom row, angles in degrees from the FoV center\n" );
+    dumpString( "zone spads   centroid x/y   columns    rows boundary   direction x/y       FoV x/y\n" );
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        const tmf8x2xZoneStats * zone = &stats->zones[ ch ];
+        if ( ! ( stats->zoneMask & ( 1u << ch ) ) )
+        {
+            continue;
+        }
+        length = 0;
+        statsAppend( line, &length, ch, 0, 4 );
+        statsAppend( line, &length, zone->spads, 0, 6 );
+        statsAppend( line, &length, zone->xCentroid, 2, 8 );
+        statsAppend( line, &length, zone->yCentroid, 2, 7 );
+        statsAppendRange( line, &length, zone->xMin, zone->xMax, 10 );
+        statsAppendRange( line, &length, zone->yMin, zone->yMax, 8 );
+        statsAppend( line, &length, zone->boundary, 0, 9 );
+        statsAppend( line, &length, zone->xAngle, 2, 10 );
+        statsAppend( line, &length, zone->yAngle, 2, 7 );
+        statsAppend( line, &length, zone->xFov, 2, 8 );
+        statsAppend( line, &length, zone->yFov, 2, 7 );
+        line[ length++ ] = '\n';
+        line[ length ] = 0;
+        dumpString( line );
+    }
+    length = 0;
+    statsAppendText( line, &length, "total " );
+    statsAppend( line, &length, stats->spads, 0, 1 );
+    statsAppendText( line, &length, " SPADs, boundary " );
+    statsAppend( line, &length, stats->boundary, 0, 1 );
+    statsAppendText( line, &length, ", FoV " );
+    statsAppend( line, &length, stats->xFov, 2, 1 );
+    statsAppendText( line, &length, " x " );
+    statsAppend( line, &length, stats->yFov, 2, 1 );
+    line[ length++ ] = '\n';
+    line[ length ] = 0;
+    dumpString( line );
+}
+
+/*
+ *****************************************************************************
+ * ZONE COMPONENTS
+ *****************************************************************************
+ */
+
+uint8_t tmf8x2xFindZoneComponents ( const tmf8x2xHalMainSpadConfig * config, uint8_t connectivity, tmf8x2xSpadMapComponents * components )
+{
+    uint32_t planes[ TMF8X2X_NUMBER_OF_CHANNELS ][ TMF8X2X_MAIN_SPAD_MAX_Y_SIZE ];
+    uint32_t xMask;
+
+    if (  ( config->xSize > TMF8X2X_MAIN_SPAD_MAX_X_SIZE )
+       || ( config->ySize > TMF8X2X_MAIN_SPAD_MAX_Y_SIZE )
+       || ( config->xSize < 1 )
+       || ( config->ySize < 1 )
+       || ( connectivity != TMF8X2X_CONNECTIVITY_4 && connectivity != TMF8X2X_CONNECTIVITY_8 )
+       )
+    {
+        return TMF8X2X_SPAD_MAP_ERROR_CONFIG;
+    }
+    memset( components, 0, sizeof( *components ) );
+    components->connectivity = connectivity;
+    tmf8x2xDecodeChannelPlanes( config, planes );
+    xMask = ( 1u << config->xSize ) - 1;
+
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        tmf8x2xZoneComponents * zone = &components->zones[ ch ];
+        uint64_t remaining[ STATS_LANE_WORDS ] = { 0 };
+        uint32_t largestIndex = 0;
+        uint32_t seeds[ 2 ] = { 0, 0 };     /* bit positions of the first SPADs of the first two components */
+        uint32_t w = 0;
+
+        zone->x = TMF8X2X_ZONE_COMPONENTS_NONE;
+        zone->y = TMF8X2X_ZONE_COMPONENTS_NONE;
+        for ( uint8_t y = 0; y < config->ySize; y++ )
+        {
+            remaining[ y / STATS_LANES_PER_WORD ] |= (uint64_t)( planes[ ch ][ y ] & config->enableSpad[ y ] & xMask ) << STATS_ROW_SHIFT( y );
+        }
+
+        /* the seed of each component is the first SPAD that is left, so the seed of component k is the first SPAD outside components 0..k-1 */
+        while ( w < STATS_LANE_WORDS )
+        {
+            uint64_t component[ STATS_LANE_WORDS ] = { 0 };
+            uint32_t seed;
+            uint32_t size = 0;
+
+            if ( ! remaining[ w ] )
+            {
+                w++;
+                continue;
+            }
+            component[ w ] = remaining[ w ] & ( 0u - remaining[ w ] );
+            seed = w * 64 + statsCountBits( component[ w ] - 1 );
+            statsFill( component, remaining, connectivity );
+            for ( uint32_t i = 0; i < STATS_LANE_WORDS; i++ )
+            {
+                size += statsCountBits( component[ i ] );
+                remaining[ i ] &= ~component[ i ];
+            }
+            if ( zone->components < 2 )
+            {
+                seeds[ zone->components ] = seed;
+            }
+            if ( size > zone->largest )
+            {
+                zone->largest = (uint16_t)size;
+                largestIndex = zone->components;
+            }
+            zone->stray += ( size == 1 );
+            zone->spads = (uint16_t)( zone->spads + size );
+            zone->components++;
+        }
+
+        if ( zone->components > 1 )
+        {
+            uint32_t seed = seeds[ largestIndex == 0 ? 1 : 0 ];
+            zone->x = (uint8_t)( ( seed % 64 ) % STATS_LANE_BITS );
+            zone->y = (uint8_t)( ( seed / 64 ) * STATS_LANES_PER_WORD + ( seed % 64 ) / STATS_LANE_BITS );
+            components->fragmented |= (uint16_t)( 1u << ch );
+        }
+    }
+    return TMF8X2X_SPAD_MAP_OK;
+}
+
+void dumpZoneComponentsAsText ( const tmf8x2xSpadMapComponents * connected4, const tmf8x2xSpadMapComponents * connected8 )
+{
+    char line[ STATS_LINE_SIZE ];
+    uint32_t length;
+
+    dumpString( "# zone islands (connected enabled SPADs), 4: left/right/above/below, 8: also diagonal, share of the largest island in %\n" );
+    dumpString( "zone spads  islands4 largest4  share4 stray4  islands8 largest8  share8 stray8\n" );
+    for ( uint8_t ch = 0; ch < TMF8X2X_NUMBER_OF_CHANNELS; ch++ )
+    {
+        const tmf8x2xSpadMapComponents * connected[ 2 ] = { connected4, connected8 };
+        if ( ! connected4->zones[ ch ].spads )
+        {
+            continue;
+        }
+        length = 0;
+        statsAppend( line, &length, ch, 0, 4 );
+        statsAppend( line, &length, connected4->zones[ ch ].spads, 0, 6 );
+        for ( uint32_t i = 0; i < 2; i++ )
+        {
+            const tmf8x2xZoneComponents * zone = &connected[ i ]->zones[ ch ];
+            statsAppend( line, &length, zone->components, 0, 10 );
+            statsAppend( line, &length, zone->largest, 0, 9 );
+            statsAppend( line, &length, statsDivide( 10000 * zone->largest, zone->spads ), 2, 8 );
+            statsAppend( line, &length, zone->stray, 0, 7 );
+        }
+        line[ length++ ] = '\n';
+        line[ length ] = 0;
+        dumpString( line );
+    }
+}
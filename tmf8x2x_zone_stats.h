@@ -0,0 +1,164 @@
+/*
+ *****************************************************************************
+ * Copyright by ams OSRAM AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/*
+ *      PROJECT:   tmf8x2x SPAD mask conversion/checking tool
+ *      $Revision: $
+ *      LANGUAGE:  C99
+ *
+ */
+
+/*! \file tmf8x2x_zone_stats.h
+ *  \brief per-zone statistics of a packed SPAD configuration: enabled SPADs, centroid, bounding box, boundary length and field of view,
+ *  and the connected components (islands) of the enabled SPADs of each zone.
+ *
+ * A zone is the set of SPADs of one TDC channel, channels 8/9 are restored from tdcChannelSelect. Counts, centroid and
+ * bounding box are taken over the enabled SPADs of a zone, the boundary over all SPADs assigned to it. Positions are
+ * SPAD map coordinates (x = 0 left column, y = 0 bottom row), angles are relative to the FoV center (X_CENTER_2_A /
+ * Y_CENTER_2_A) and use the SPAD pitch of the 3x3 sample map (18 x 6 SPADs for 41° x 32°). All values are integers
+ * in hundredths, the computation works on row bitplanes and has no stdio dependency.
+ *
+ * The components are found by a bit-parallel flood fill: three rows share a 64-bit word, each step grows a component
+ * by one SPAD in all directions at once. With 4-connectivity SPADs are connected to the left, right, above and below,
+ * with 8-connectivity also diagonally (the adjacency of tmf8x2xCheckMainSpadAssignment).
+ */
+
+/*
+ *****************************************************************************
+ * INCLUDES
+ *****************************************************************************
+ */
+
+#include <stdint.h>
+#include "tmf8x2x_includes.h"
+
+/*
+ *****************************************************************************
+ * DEFINES
+ *****************************************************************************
+ */
+
+#ifndef TMF8X2X_ZONE_STATS_H
+#define TMF8X2X_ZONE_STATS_H
+
+/* angular pitch of the SPADs: FoV in hundredths of a degree covered by a number of SPADs */
+#define TMF8X2X_ZONE_STATS_X_FOV_CDEG       4100    /* 41° ... */
+#define TMF8X2X_ZONE_STATS_X_FOV_SPADS      18      /* ... over 18 columns */
+#define TMF8X2X_ZONE_STATS_Y_FOV_CDEG       3200    /* 32° ... */
+#define TMF8X2X_ZONE_STATS_Y_FOV_SPADS      6       /* ... over 6 rows */
+
+/* connectivity of the zone components */
+#define TMF8X2X_CONNECTIVITY_4              4       /* left, right, above, below */
+#define TMF8X2X_CONNECTIVITY_8              8       /* also diagonal */
+
+/* position of tmf8x2xZoneComponents of zones that are not fragmented */
+#define TMF8X2X_ZONE_COMPONENTS_NONE        0xff
+
+/*
+ *****************************************************************************
+ * STRUCTURES
+ *****************************************************************************
+ */
+
+/* statistics of one zone (TDC channel), the fields of the enabled SPADs are 0 if the zone has none */
+typedef struct _tmf8x2xZoneStats
+{
+    uint16_t spads;             /* enabled SPADs */
+    uint16_t boundary;          /* edges between a SPAD of the zone and a SPAD of another zone (left/right/above/below) */
+    uint16_t xCentroid;         /* centroid of the enabled SPADs in hundredths of a SPAD */
+    uint16_t yCentroid;
+    uint8_t xMin;               /* bounding box of the enabled SPADs */
+    uint8_t xMax;
+    uint8_t yMin;
+    uint8_t yMax;
+    int16_t xAngle;             /* direction of the centroid in hundredths of a degree, 0 is the FoV center */
+    int16_t yAngle;
+    uint16_t xFov;              /* angular width / height of the bounding box in hundredths of a degree */
+    uint16_t yFov;
+} tmf8x2xZoneStats;
+
+/* statistics of a SPAD configuration */
+typedef struct _tmf8x2xSpadMapStats
+{
+    tmf8x2xZoneStats zones[ TMF8X2X_NUMBER_OF_CHANNELS ];
+    uint16_t zoneMask;          /* bit ch is set if zone ch has enabled SPADs */
+    uint16_t spads;             /* enabled SPADs of all zones */
+    uint16_t boundary;          /* edges between zones, each edge counted once */
+    uint16_t xFov;              /* angular width / height of the SPAD map in hundredths of a degree */
+    uint16_t yFov;
+} tmf8x2xSpadMapStats;
+
+/* connected components of the enabled SPADs of one zone */
+typedef struct _tmf8x2xZoneComponents
+{
+    uint16_t spads;             /* enabled SPADs */
+    uint16_t largest;           /* enabled SPADs of the largest component */
+    uint8_t components;         /* number of components (islands), 0 if the zone has no enabled SPADs */
+    uint8_t stray;              /* components of a single SPAD */
+    uint8_t x;                  /* first SPAD (lowest row, then lowest column) outside the largest component, */
+    uint8_t y;                  /* TMF8X2X_ZONE_COMPONENTS_NONE if the zone has one component */
+} tmf8x2xZoneComponents;
+
+/* connected components of all zones of a SPAD configuration */
+typedef struct _tmf8x2xSpadMapComponents
+{
+    tmf8x2xZoneComponents zones[ TMF8X2X_NUMBER_OF_CHANNELS ];
+    uint16_t fragmented;        /* bit ch is set if zone ch has more than one component */
+    uint8_t connectivity;       /* TMF8X2X_CONNECTIVITY_4 or TMF8X2X_CONNECTIVITY_8 */
+} tmf8x2xSpadMapComponents;
+
+/*
+ *****************************************************************************
+ * FUNCTIONS
+ *****************************************************************************
+ */
+
+/**
+ * @brief tmf8x2xComputeZoneStats computes the statistics of every zone of a packed SPAD configuration
+ * @param config configuration in machine readable format (packed)
+ * @param stats receives the statistics
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if xSize / ySize are out of range, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xComputeZoneStats( const tmf8x2xHalMainSpadConfig * config, tmf8x2xSpadMapStats * stats );
+
+/**
+ * @brief dumpZoneStatsAsText shows the statistics of the zones with enabled SPADs as a table on the selected output sink
+ * @param stats statistics of a SPAD configuration
+ */
+void dumpZoneStatsAsText( const tmf8x2xSpadMapStats * stats );
+
+/**
+ * @brief tmf8x2xFindZoneComponents labels the connected components of the enabled SPADs of every zone of a packed SPAD configuration
+ * @param config configuration in machine readable format (packed)
+ * @param connectivity TMF8X2X_CONNECTIVITY_4 or TMF8X2X_CONNECTIVITY_8
+ * @param components receives the components of each zone
+ * @return TMF8X2X_SPAD_MAP_ERROR_CONFIG if xSize / ySize or the connectivity are out of range, TMF8X2X_SPAD_MAP_OK otherwise
+ */
+uint8_t tmf8x2xFindZoneComponents( const tmf8x2xHalMainSpadConfig * config, uint8_t connectivity, tmf8x2xSpadMapComponents * components );
+
+/**
+ * @brief dumpZoneComponentsAsText shows the components of the zones with enabled SPADs for 4- and 8-connectivity as a table on the selected output sink
+ * @param connected4 components with TMF8X2X_CONNECTIVITY_4
+ * @param connected8 components with TMF8X2X_CONNECTIVITY_8 of the same configuration
+ */
+void dumpZoneComponentsAsText( const tmf8x2xSpadMapComponents * connected4, const tmf8x2xSpadMapComponents * connected8 );
+
+#endif /* TMF8X2X_ZONE_STATS_H */